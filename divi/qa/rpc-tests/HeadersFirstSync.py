@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The DIVI developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#
+# Measures how long a fresh node takes to sync a long chain from several
+# peers, once with the legacy getblocks sync and once with headers-first
+# sync and its parallel block download window.
+#
+
+from test_framework import BitcoinTestFramework
+from authproxy import AuthServiceProxy, JSONRPCException
+from util import *
+from PowToPosTransition import createPoSStacks, generatePoSBlocks
+import os
+import shutil
+import time
+
+class HeadersFirstSyncTest(BitcoinTestFramework):
+
+    def add_options(self, parser):
+        parser.add_option("--blocks", dest="blocks", default=100000, type=int,
+                          help="Length of the chain to sync (default: %default)")
+
+    def setup_network(self):
+        # Nodes 0 to 2 serve the chain, node 3 syncs it from scratch.
+        self.nodes = [start_node(i, self.options.tmpdir) for i in range(3)]
+        self.nodes.append(None)
+        self.is_network_split = False
+
+    def build_chain(self):
+        posStart = 100
+        node = self.nodes[0]
+
+        print ("Building a chain of %d blocks..." % self.options.blocks)
+        createPoSStacks([node], [node])
+        missing = posStart - node.getblockcount()
+        if missing > 0:
+            node.setgenerate(True, missing)
+        missing = self.options.blocks - node.getblockcount()
+        if missing > 0:
+            generatePoSBlocks([node], 0, missing)
+        assert_equal(node.getblockcount(), self.options.blocks)
+
+        tipTime = node.getblockheader(node.getbestblockhash())["time"]
+        set_node_times(self.nodes[1:3], tipTime)
+        for i in range(1, 3):
+            connect_nodes_bi(self.nodes, 0, i)
+        sync_blocks(self.nodes[0:3])
+        return tipTime
+
+    def time_sync(self, tipTime, headersFirst):
+        datadir = os.path.join(self.options.tmpdir, "node3", "regtest")
+        shutil.rmtree(datadir)
+        initialize_datadir(self.options.tmpdir, 3)
+
+        node = start_node(3, self.options.tmpdir, ["-headersfirst=%d" % headersFirst])
+        node.setmocktime(tipTime)
+        self.nodes[3] = node
+
+        start = time.time()
+        for i in range(3):
+            connect_nodes(node, i)
+        sync_blocks(self.nodes)
+        elapsed = time.time() - start
+        assert_equal(node.getbestblockhash(), self.nodes[0].getbestblockhash())
+
+        stop_node(node, 3)
+        self.nodes[3] = None
+        return elapsed
+
+    def run_test(self):
+        tipTime = self.build_chain()
+
+        legacy = self.time_sync(tipTime, 0)
+        print ("Legacy sync of %d blocks: %.1f s" % (self.options.blocks, legacy))
+        headersFirst = self.time_sync(tipTime, 1)
+        print ("Headers-first sync of %d blocks: %.1f s" % (self.options.blocks, headersFirst))
+
+if __name__ == '__main__':
+    HeadersFirstSyncTest().main()
@@ -67,6 +67,7 @@ TEST_EXIT_SKIPPED = 77
 EXTENDED_SCRIPTS = [
     # These tests are not run by default.
     # Longest test should go first, to favor running tests in parallel
+    'HeadersFirstSync.py',
 ]
 
 BASE_SCRIPTS = [
@@ -61,6 +61,7 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
     } catch (std::exception& e) {
         return error("%s : Deserialize or I/O error - %s", __func__, e.what());
     }
+    block.MemoizeHash();
 
     // Check the header
     if (block.IsProofOfWork()) {
@@ -0,0 +1,321 @@
+#include <BlockDownloadWindow.h>
+
+#include <algorithm>
+
+BlockDownloadWindow::BlockDownloadWindow(
+    unsigned windowSize,
+    int64_t stallingTimeout,
+    size_t maximumBufferedBytes,
+    unsigned maximumStallsPerBlock,
+    unsigned maximumHeadersAhead
+    ): windowSize_(windowSize)
+    , stallingTimeout_(stallingTimeout)
+    , maximumBufferedBytes_(maximumBufferedBytes)
+    , maximumStallsPerBlock_(maximumStallsPerBlock)
+    , maximumHeadersAhead_(maximumHeadersAhead)
+    , tipHeight_(-1)
+    , tipHash_()
+    , headerHashes_()
+    , headerSourceNodeIds_()
+    , lastHeaderTime_(0)
+    , heightByHash_()
+    , blocksInFlight_()
+    , numberOfBlocksInFlightByNodeId_()
+    , releasedBlocks_()
+    , bufferedBlocks_()
+    , bufferedBytes_(0u)
+    , numberOfStallsByHeight_()
+    , suspendedUntil_(0)
+    , headerRequestDeferred_(false)
+    , deferredHeaderSourceNodeId_(-1)
+{
+}
+
+void BlockDownloadWindow::reset(int tipHeight, const uint256& tipHash)
+{
+    tipHeight_ = tipHeight;
+    tipHash_ = tipHash;
+    headerHashes_.clear();
+    headerSourceNodeIds_.clear();
+    lastHeaderTime_ = 0;
+    heightByHash_.clear();
+    blocksInFlight_.clear();
+    numberOfBlocksInFlightByNodeId_.clear();
+    releasedBlocks_.clear();
+    bufferedBlocks_.clear();
+    bufferedBytes_ = 0u;
+    numberOfStallsByHeight_.clear();
+}
+
+void BlockDownloadWindow::releaseBlockInFlight(std::map<int, BlockInFlight>::iterator it)
+{
+    auto count = numberOfBlocksInFlightByNodeId_.find(it->second.nodeId);
+    if(count != numberOfBlocksInFlightByNodeId_.end() && --count->second == 0u)
+        numberOfBlocksInFlightByNodeId_.erase(count);
+    blocksInFlight_.erase(it);
+}
+
+void BlockDownloadWindow::recordStall(int height, NodeId stalledNodeId, int64_t now)
+{
+    const ReleasedBlock releasedBlock = {stalledNodeId, now};
+    releasedBlocks_[height] = releasedBlock;
+    ++numberOfStallsByHeight_[height];
+}
+
+void BlockDownloadWindow::dropBlocksUpToHeight(int height)
+{
+    while(!headerHashes_.empty() && tipHeight_ < height)
+    {
+        heightByHash_.erase(headerHashes_.front());
+        tipHash_ = headerHashes_.front();
+        headerHashes_.pop_front();
+        headerSourceNodeIds_.pop_front();
+        ++tipHeight_;
+    }
+    while(!blocksInFlight_.empty() && blocksInFlight_.begin()->first <= height)
+        releaseBlockInFlight(blocksInFlight_.begin());
+    releasedBlocks_.erase(releasedBlocks_.begin(), releasedBlocks_.upper_bound(height));
+    numberOfStallsByHeight_.erase(numberOfStallsByHeight_.begin(), numberOfStallsByHeight_.upper_bound(height));
+    while(!bufferedBlocks_.empty() && bufferedBlocks_.begin()->first <= height)
+    {
+        bufferedBytes_ -= bufferedBlocks_.begin()->second.size;
+        bufferedBlocks_.erase(bufferedBlocks_.begin());
+    }
+}
+
+void BlockDownloadWindow::updateTip(int tipHeight, const uint256& tipHash)
+{
+    if(tipHeight == tipHeight_ && tipHash == tipHash_)
+        return;
+    if(heightOf(tipHash) != tipHeight)
+    {
+        reset(tipHeight, tipHash);
+        return;
+    }
+    dropBlocksUpToHeight(tipHeight);
+}
+
+bool BlockDownloadWindow::appendHeader(
+    const uint256& hash,
+    const uint256& previousHash,
+    int64_t blockTime,
+    NodeId sourceNodeId)
+{
+    if(previousHash != lastHeaderHash() || heightByHash_.count(hash) > 0u)
+        return false;
+    if(headerHashes_.size() >= maximumHeadersAhead_)
+    {
+        headerRequestDeferred_ = true;
+        deferredHeaderSourceNodeId_ = sourceNodeId;
+        return false;
+    }
+    headerHashes_.push_back(hash);
+    headerSourceNodeIds_.push_back(sourceNodeId);
+    heightByHash_[hash] = lastHeaderHeight();
+    lastHeaderTime_ = blockTime;
+    return true;
+}
+
+bool BlockDownloadWindow::takeDeferredHeaderRequest(NodeId nodeId)
+{
+    if(!headerRequestDeferred_ || headerHashes_.size() > maximumHeadersAhead_ / 2u)
+        return false;
+    if(deferredHeaderSourceNodeId_ >= 0 && deferredHeaderSourceNodeId_ != nodeId)
+        return false;
+    headerRequestDeferred_ = false;
+    deferredHeaderSourceNodeId_ = -1;
+    return true;
+}
+
+void BlockDownloadWindow::suspend(int tipHeight, const uint256& tipHash, int64_t suspendedUntil)
+{
+    reset(tipHeight, tipHash);
+    suspendedUntil_ = suspendedUntil;
+    headerRequestDeferred_ = false;
+    deferredHeaderSourceNodeId_ = -1;
+}
+
+bool BlockDownloadWindow::isSuspended(int64_t now) const
+{
+    return now < suspendedUntil_;
+}
+
+bool BlockDownloadWindow::isActive() const
+{
+    return !headerHashes_.empty();
+}
+
+int BlockDownloadWindow::heightOf(const uint256& hash) const
+{
+    const auto it = heightByHash_.find(hash);
+    return it != heightByHash_.end()? it->second : -1;
+}
+
+int BlockDownloadWindow::lastHeaderHeight() const
+{
+    return tipHeight_ + static_cast<int>(headerHashes_.size());
+}
+
+const uint256& BlockDownloadWindow::lastHeaderHash() const
+{
+    return headerHashes_.empty()? tipHash_ : headerHashes_.back();
+}
+
+int64_t BlockDownloadWindow::lastHeaderTime() const
+{
+    return headerHashes_.empty()? 0 : lastHeaderTime_;
+}
+
+int BlockDownloadWindow::lowestUnsuppliableHeight() const
+{
+    for(const auto& stalls: numberOfStallsByHeight_)
+    {
+        if(stalls.second >= maximumStallsPerBlock_)
+            return stalls.first;
+    }
+    return -1;
+}
+
+NodeId BlockDownloadWindow::headerSourceOf(int height) const
+{
+    if(height <= tipHeight_ || height > lastHeaderHeight())
+        return -1;
+    return headerSourceNodeIds_[height - tipHeight_ - 1];
+}
+
+std::vector<BlockDownloadWindow::BlockToRequest> BlockDownloadWindow::assignBlocks(
+    NodeId nodeId,
+    int peerHeight,
+    unsigned maximumNumberOfBlocks,
+    int64_t now)
+{
+    std::vector<BlockToRequest> blocksToRequest;
+    int lastHeightToRequest = std::min(lastHeaderHeight(), std::min(peerHeight, tipHeight_ + static_cast<int>(windowSize_)));
+    if(bufferedBytes_ >= maximumBufferedBytes_ && !bufferedBlocks_.empty())
+    {
+        // Only fill the gaps that keep the buffered blocks from being connected
+        lastHeightToRequest = std::min(lastHeightToRequest, bufferedBlocks_.rbegin()->first - 1);
+    }
+
+    for(int height = tipHeight_ + 1; height <= lastHeightToRequest && blocksToRequest.size() < maximumNumberOfBlocks; ++height)
+    {
+        if(blocksInFlight_.count(height) > 0u || bufferedBlocks_.count(height) > 0u)
+            continue;
+        const auto released = releasedBlocks_.find(height);
+        if(released != releasedBlocks_.end())
+        {
+            // Give the block to a different peer unless nobody else took it in time
+            if(released->second.stalledNodeId == nodeId && now - released->second.releaseTime < stallingTimeout_)
+                continue;
+            releasedBlocks_.erase(released);
+        }
+        const BlockInFlight blockInFlight = {nodeId, now};
+        blocksInFlight_[height] = blockInFlight;
+        ++numberOfBlocksInFlightByNodeId_[nodeId];
+        const BlockToRequest blockToRequest = {height, headerHashes_[height - tipHeight_ - 1]};
+        blocksToRequest.push_back(blockToRequest);
+    }
+    return blocksToRequest;
+}
+
+std::vector<NodeId> BlockDownloadWindow::releaseStalledBlocks(int64_t now)
+{
+    std::vector<NodeId> stalledNodeIds;
+    const int highestBufferedHeight = bufferedBlocks_.empty()? tipHeight_ + 1 : bufferedBlocks_.rbegin()->first;
+    auto it = blocksInFlight_.begin();
+    while(it != blocksInFlight_.end() && it->first <= highestBufferedHeight)
+    {
+        if(now - it->second.requestTime <= stallingTimeout_)
+        {
+            ++it;
+            continue;
+        }
+        const NodeId stalledNodeId = it->second.nodeId;
+        if(std::find(stalledNodeIds.begin(), stalledNodeIds.end(), stalledNodeId) == stalledNodeIds.end())
+            stalledNodeIds.push_back(stalledNodeId);
+        recordStall(it->first, stalledNodeId, now);
+        releaseBlockInFlight(it++);
+    }
+    return stalledNodeIds;
+}
+
+void BlockDownloadWindow::markReceived(const uint256& hash)
+{
+    const int height = heightOf(hash);
+    const auto it = blocksInFlight_.find(height);
+    if(it != blocksInFlight_.end())
+        releaseBlockInFlight(it);
+    releasedBlocks_.erase(height);
+    numberOfStallsByHeight_.erase(height);
+}
+
+bool BlockDownloadWindow::markNotFound(const uint256& hash, NodeId nodeId, int64_t now)
+{
+    const auto it = blocksInFlight_.find(heightOf(hash));
+    if(it == blocksInFlight_.end() || it->second.nodeId != nodeId)
+        return false;
+    recordStall(it->first, nodeId, now);
+    releaseBlockInFlight(it);
+    return true;
+}
+
+void BlockDownloadWindow::removePeer(NodeId nodeId)
+{
+    // Any peer may pick up the deferred header request of a peer that is gone
+    if(deferredHeaderSourceNodeId_ == nodeId)
+        deferredHeaderSourceNodeId_ = -1;
+    if(numberOfBlocksInFlightByNodeId_.count(nodeId) == 0u)
+        return;
+    auto it = blocksInFlight_.begin();
+    while(it != blocksInFlight_.end())
+    {
+        if(it->second.nodeId == nodeId)
+            releaseBlockInFlight(it++);
+        else
+            ++it;
+    }
+}
+
+unsigned BlockDownloadWindow::numberOfBlocksInFlight(NodeId nodeId) const
+{
+    const auto it = numberOfBlocksInFlightByNodeId_.find(nodeId);
+    return it != numberOfBlocksInFlightByNodeId_.end()? it->second : 0u;
+}
+
+bool BlockDownloadWindow::bufferBlock(const CBlock& block, NodeId nodeId, size_t blockSize)
+{
+    const uint256 hash = block.GetHash();
+    const int height = heightOf(hash);
+    if(height < 0 || height > tipHeight_ + static_cast<int>(windowSize_))
+        return false;
+    markReceived(hash);
+    if(bufferedBlocks_.count(height) == 0u)
+    {
+        BufferedBlock& bufferedBlock = bufferedBlocks_[height];
+        bufferedBlock.nodeId = nodeId;
+        bufferedBlock.block = block;
+        bufferedBlock.size = blockSize;
+        bufferedBytes_ += blockSize;
+    }
+    return true;
+}
+
+bool BlockDownloadWindow::takeBufferedChild(const uint256& parentHash, CBlock& block, NodeId& nodeId)
+{
+    const int parentHeight = parentHash == tipHash_? tipHeight_ : heightOf(parentHash);
+    if(parentHeight < 0)
+        return false;
+    const auto it = bufferedBlocks_.find(parentHeight + 1);
+    if(it == bufferedBlocks_.end() || it->second.block.hashPrevBlock != parentHash)
+        return false;
+    block = it->second.block;
+    nodeId = it->second.nodeId;
+    bufferedBytes_ -= it->second.size;
+    bufferedBlocks_.erase(it);
+    return true;
+}
+
+size_t BlockDownloadWindow::bufferedBytes() const
+{
+    return bufferedBytes_;
+}
@@ -0,0 +1,136 @@
+#ifndef BLOCK_DOWNLOAD_WINDOW_H
+#define BLOCK_DOWNLOAD_WINDOW_H
+
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#include <NodeId.h>
+#include <primitives/block.h>
+#include <uint256.h>
+
+/** Headers-first block download: a chain of headers fetched ahead of the
+ *  active tip, whose blocks are requested from several peers in parallel.
+ *
+ *  Only blocks within windowSize of the tip are requested.  Blocks arriving
+ *  before their parent are buffered here until the chain reaches them; once
+ *  the buffered blocks exceed maximumBufferedBytes, only the gaps below them
+ *  are requested.  A block that is overdue and holds up buffered blocks (or
+ *  is the next one the chain needs) is taken away from its peer and handed
+ *  to the next peer asking for work.  A block that stalls or is reported
+ *  missing maximumStallsPerBlock times marks the header chain as one the
+ *  network cannot supply; it is then dropped so the node can fall back to
+ *  fetching blocks through getblocks for a while.
+ *
+ *  At most maximumHeadersAhead headers are kept ahead of the tip.  Headers
+ *  beyond that are refused, and the peer sending them is asked again once the
+ *  tip caught up with half of the header chain.
+ *
+ *  The headers themselves are not added to the block index: proof-of-stake
+ *  headers can only be validated together with their coinstake, so the block
+ *  index only learns about a block once its full data arrived.  */
+class BlockDownloadWindow
+{
+public:
+    struct BlockToRequest
+    {
+        int height;
+        uint256 hash;
+    };
+
+private:
+    struct BlockInFlight
+    {
+        NodeId nodeId;
+        int64_t requestTime;
+    };
+    struct ReleasedBlock
+    {
+        NodeId stalledNodeId;
+        int64_t releaseTime;
+    };
+    struct BufferedBlock
+    {
+        NodeId nodeId;
+        CBlock block;
+        size_t size;
+    };
+
+    const unsigned windowSize_;
+    const int64_t stallingTimeout_;
+    const size_t maximumBufferedBytes_;
+    const unsigned maximumStallsPerBlock_;
+    const unsigned maximumHeadersAhead_;
+
+    int tipHeight_;
+    uint256 tipHash_;
+    std::deque<uint256> headerHashes_;
+    std::deque<NodeId> headerSourceNodeIds_;
+    int64_t lastHeaderTime_;
+    std::map<uint256, int> heightByHash_;
+    std::map<int, BlockInFlight> blocksInFlight_;
+    std::map<NodeId, unsigned> numberOfBlocksInFlightByNodeId_;
+    std::map<int, ReleasedBlock> releasedBlocks_;
+    std::map<int, BufferedBlock> bufferedBlocks_;
+    size_t bufferedBytes_;
+    std::map<int, unsigned> numberOfStallsByHeight_;
+    int64_t suspendedUntil_;
+    bool headerRequestDeferred_;
+    NodeId deferredHeaderSourceNodeId_;
+
+    void releaseBlockInFlight(std::map<int, BlockInFlight>::iterator it);
+    void recordStall(int height, NodeId stalledNodeId, int64_t now);
+    void dropBlocksUpToHeight(int height);
+
+public:
+    BlockDownloadWindow(
+        unsigned windowSize,
+        int64_t stallingTimeout,
+        size_t maximumBufferedBytes,
+        unsigned maximumStallsPerBlock,
+        unsigned maximumHeadersAhead);
+
+    /** Forgets all headers and downloads, starting over from the given tip. */
+    void reset(int tipHeight, const uint256& tipHash);
+    /** Moves the window along with the active chain.  Resets it if the new tip
+     *  is not on the header chain.  */
+    void updateTip(int tipHeight, const uint256& tipHash);
+    /** Extends the header chain; fails if the header does not build on the last one
+     *  or the chain already reaches maximumHeadersAhead past the tip.  */
+    bool appendHeader(const uint256& hash, const uint256& previousHash, int64_t blockTime, NodeId sourceNodeId);
+    /** Whether the peer should be asked for the headers refused for being too far ahead of the tip. */
+    bool takeDeferredHeaderRequest(NodeId nodeId);
+    /** Drops the header chain and refuses new headers until the given time. */
+    void suspend(int tipHeight, const uint256& tipHash, int64_t suspendedUntil);
+    bool isSuspended(int64_t now) const;
+
+    bool isActive() const;
+    /** Height of the block on the header chain, or -1 if it is not part of it. */
+    int heightOf(const uint256& hash) const;
+    int lastHeaderHeight() const;
+    const uint256& lastHeaderHash() const;
+    int64_t lastHeaderTime() const;
+    /** Lowest height whose block stalled or was reported missing too often, or -1. */
+    int lowestUnsuppliableHeight() const;
+    /** Peer whose headers put the block at the given height on the chain, or -1. */
+    NodeId headerSourceOf(int height) const;
+
+    /** Picks up to maximumNumberOfBlocks blocks up to peerHeight that nobody is downloading. */
+    std::vector<BlockToRequest> assignBlocks(NodeId nodeId, int peerHeight, unsigned maximumNumberOfBlocks, int64_t now);
+    /** Releases overdue blocks that hold up the window and returns the peers they were assigned to. */
+    std::vector<NodeId> releaseStalledBlocks(int64_t now);
+    void markReceived(const uint256& hash);
+    /** Takes back a block the peer reported it does not have, counting it as a stall. */
+    bool markNotFound(const uint256& hash, NodeId nodeId, int64_t now);
+    void removePeer(NodeId nodeId);
+    unsigned numberOfBlocksInFlight(NodeId nodeId) const;
+
+    /** Keeps a downloaded block whose parent is not connected yet; fails for blocks outside the window. */
+    bool bufferBlock(const CBlock& block, NodeId nodeId, size_t blockSize);
+    /** Hands out the buffered block building on the given block, if any. */
+    bool takeBufferedChild(const uint256& parentHash, CBlock& block, NodeId& nodeId);
+    size_t bufferedBytes() const;
+};
+#endif// BLOCK_DOWNLOAD_WINDOW_H
@@ -0,0 +1,107 @@
+#include <BlockHeaderHashing.h>
+
+#include <primitives/block.h>
+#include <defaultValues.h>
+#include <ThreadManagementHelpers.h>
+#include <sync.h>
+
+extern int nScriptCheckThreads;
+static CCheckQueue<BlockHeaderHashCheck> headerHashQueue(128, MAX_SCRIPTCHECK_THREADS);
+/** The queue takes one batch at a time; held while a batch is on it. */
+static CCriticalSection cs_headerHashQueue;
+
+/** Below this many headers, handing them to the workers costs more than it saves. */
+static const size_t MIN_HEADERS_TO_HASH_IN_PARALLEL = 16;
+
+BlockHeaderHashCheck::BlockHeaderHashCheck(
+    ): header_(nullptr)
+    , hash_(nullptr)
+    , block_(nullptr)
+{
+}
+
+BlockHeaderHashCheck::BlockHeaderHashCheck(
+    const CBlockHeader& header,
+    uint256& hash
+    ): header_(&header)
+    , hash_(&hash)
+    , block_(nullptr)
+{
+}
+
+BlockHeaderHashCheck::BlockHeaderHashCheck(
+    CBlock& block
+    ): header_(nullptr)
+    , hash_(nullptr)
+    , block_(&block)
+{
+}
+
+bool BlockHeaderHashCheck::operator()()
+{
+    if(block_ != nullptr)
+        block_->MemoizeHash();
+    else if(header_ != nullptr)
+        *hash_ = header_->GetHash();
+    return true;
+}
+
+void BlockHeaderHashCheck::swap(BlockHeaderHashCheck& check)
+{
+    std::swap(header_, check.header_);
+    std::swap(hash_, check.hash_);
+    std::swap(block_, check.block_);
+}
+
+static void RunChecks(CCheckQueue<BlockHeaderHashCheck>* queue, std::vector<BlockHeaderHashCheck>& checks)
+{
+    if(queue == nullptr || checks.size() < MIN_HEADERS_TO_HASH_IN_PARALLEL)
+    {
+        for(BlockHeaderHashCheck& check: checks)
+            check();
+        return;
+    }
+
+    CCheckQueueControl<BlockHeaderHashCheck> control(queue);
+    control.Add(checks);
+    control.Wait();
+}
+
+std::vector<uint256> HashBlockHeaders(CCheckQueue<BlockHeaderHashCheck>* queue, const std::vector<CBlockHeader>& headers)
+{
+    std::vector<uint256> hashes(headers.size());
+    std::vector<BlockHeaderHashCheck> checks;
+    checks.reserve(headers.size());
+    for(size_t index = 0; index < headers.size(); ++index)
+        checks.emplace_back(headers[index], hashes[index]);
+    RunChecks(queue, checks);
+    return hashes;
+}
+
+void MemoizeBlockHashes(CCheckQueue<BlockHeaderHashCheck>* queue, const std::vector<CBlock*>& blocks)
+{
+    std::vector<BlockHeaderHashCheck> checks;
+    checks.reserve(blocks.size());
+    for(CBlock* block: blocks)
+        checks.emplace_back(*block);
+    RunChecks(queue, checks);
+}
+
+std::vector<uint256> HashBlockHeadersInParallel(const std::vector<CBlockHeader>& headers)
+{
+    // If another thread is using the workers, hashing here is as good as waiting for them
+    TRY_LOCK(cs_headerHashQueue, queueIsAvailable);
+    return HashBlockHeaders(nScriptCheckThreads && queueIsAvailable? &headerHashQueue : nullptr, headers);
+}
+
+void MemoizeBlockHashesInParallel(const std::vector<CBlock*>& blocks)
+{
+    TRY_LOCK(cs_headerHashQueue, queueIsAvailable);
+    MemoizeBlockHashes(nScriptCheckThreads && queueIsAvailable? &headerHashQueue : nullptr, blocks);
+}
+
+void ThreadBlockHeaderHashing()
+{
+    RenameThread("divi-hdrhash");
+    headerHashQueue.Thread();
+}
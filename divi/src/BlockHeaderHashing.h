@@ -0,0 +1,43 @@
+#ifndef BLOCK_HEADER_HASHING_H
+#define BLOCK_HEADER_HASHING_H
+
+#include <vector>
+#include <checkqueue.h>
+#include <uint256.h>
+
+class CBlock;
+class CBlockHeader;
+
+/** Computes the hash of one header into its own slot, or memoizes the hash
+ *  of one block.  Every check touches a different object, so the workers
+ *  never write to anything another thread reads.  */
+class BlockHeaderHashCheck
+{
+private:
+    const CBlockHeader* header_;
+    uint256* hash_;
+    CBlock* block_;
+
+public:
+    BlockHeaderHashCheck();
+    BlockHeaderHashCheck(const CBlockHeader& header, uint256& hash);
+    explicit BlockHeaderHashCheck(CBlock& block);
+
+    bool operator()();
+    void swap(BlockHeaderHashCheck& check);
+};
+
+/** Hashes a batch of headers on the given queue's workers (or on the calling
+ *  thread if queue is NULL) and returns the hashes in the same order.  */
+std::vector<uint256> HashBlockHeaders(CCheckQueue<BlockHeaderHashCheck>* queue, const std::vector<CBlockHeader>& headers);
+
+/** Memoizes the hash of each block on the given queue's workers (or on the
+ *  calling thread if queue is NULL).  The caller must own the blocks, and
+ *  nothing else may touch them until this returns.  */
+void MemoizeBlockHashes(CCheckQueue<BlockHeaderHashCheck>* queue, const std::vector<CBlock*>& blocks);
+
+/** Same as above on the block verification threads started with -par. */
+std::vector<uint256> HashBlockHeadersInParallel(const std::vector<CBlockHeader>& headers);
+void MemoizeBlockHashesInParallel(const std::vector<CBlock*>& blocks);
+void ThreadBlockHeaderHashing();
+#endif// BLOCK_HEADER_HASHING_H
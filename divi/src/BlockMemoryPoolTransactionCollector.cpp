@@ -6,6 +6,7 @@
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "txmempool.h"
+#include <MempoolPackageIndex.h>
 #include <ValidationState.h>
 #include <defaultValues.h>
 #include <Logging.h>
@@ -14,6 +15,11 @@
 
 #include <Settings.h>
 
+#include <algorithm>
+#include <deque>
+#include <iterator>
+#include <map>
+
 bool IsFinalTx(const CTransaction& tx, const CChain& activeChain, int nBlockHeight = 0 , int64_t nBlockTime = 0);
 
 static unsigned int GetMaxBlockSize(const Settings& settings,unsigned int defaultMaxBlockSize, unsigned int maxBlockSizeCurrent)
@@ -41,26 +47,41 @@ static unsigned int GetBlockMinSize(const Settings& settings, unsigned int defau
     return blockMinSize;
 }
 
-//
-// Unconfirmed transactions in the memory pool often depend on other
-// transactions in the memory pool. When we select transactions from the
-// pool, we select by highest priority or fee rate, so we might consider
-// transactions that depend on transactions that aren't yet in the block.
-// The COrphan class keeps track of these 'temporary orphans' while
-// CreateBlock is figuring out which transactions to include.
-//
-class COrphan
+// Bytes short of the maximum block size from which a block counts as nearly
+// full, and how many packages in a row may then fail to fit before the fee
+// rate phase stops looking.
+static const unsigned nearlyFullBlockMargin = 4000u;
+static const unsigned maximumConsecutivePackagesNotFitting = 1000u;
+
+// Running state of a block template under construction. Once part of a
+// package is in the block, the rest of it is tracked here with only the fees
+// and sizes still missing, so the fee rate phase compares what each package
+// would actually add to the block.
+class BlockAssemblyState
 {
 public:
-    const CTransaction* ptx;
-    std::set<uint256> setDependsOn;
-    CFeeRate feeRate;
-    double coinAgeOfInputsPerByte;
-    CAmount feePaid;
-    size_t txSize;
-
-    COrphan(const CTransaction* ptxIn) : ptx(ptxIn), feeRate(0), coinAgeOfInputsPerByte(0), feePaid(0), txSize(0u)
+    uint64_t blockSize;
+    int blockSigOps;
+    std::set<uint256> inBlock;
+    std::set<uint256> failed;
+    std::map<uint256, std::pair<CAmount, uint64_t> > modifiedPackages;
+    std::set<std::pair<CAmount, uint256> > modifiedByFeeRate;
+    std::vector<PrioritizedTransactionData> transactions;
+
+    BlockAssemblyState(
+        ): blockSize(1000)
+        , blockSigOps(100)
+        , inBlock()
+        , failed()
+        , modifiedPackages()
+        , modifiedByFeeRate()
+        , transactions()
+    {
+    }
+
+    static CAmount FeePerK(const std::pair<CAmount, uint64_t>& feesAndSize)
     {
+        return feesAndSize.second > 0u? feesAndSize.first * 1000 / static_cast<CAmount>(feesAndSize.second) : 0;
     }
 };
 
@@ -108,23 +129,16 @@ BlockMemoryPoolTransactionCollector::BlockMemoryPoolTransactionCollector(
     assert( blockMaxSize_ <= MAX_BLOCK_SIZE_CURRENT );
 }
 
-void BlockMemoryPoolTransactionCollector::RecordOrphanTransaction(
-    std::shared_ptr<COrphan>& porphan,
+bool BlockMemoryPoolTransactionCollector::IsCandidateForBlock(
     const CTransaction& tx,
-    const CTxIn& txin,
-    DependingTransactionsMap& dependentTransactions) const
+    const int nHeight) const
 {
-    if (porphan == nullptr)
-        porphan = std::make_shared<COrphan>(&tx);
-    dependentTransactions[txin.prevout.hash].push_back(porphan);
-    porphan->setDependsOn.insert(txin.prevout.hash);
+    return !tx.IsCoinBase() && !tx.IsCoinStake() && IsFinalTx(tx, activeChain_, nHeight);
 }
 
-void BlockMemoryPoolTransactionCollector::ComputeTransactionPriority(
+TxPriority BlockMemoryPoolTransactionCollector::ComputeTransactionPriority(
     const CTxMemPoolEntry& mempoolTx,
-    const int nHeight,
-    COrphan* porphan,
-    std::vector<TxPriority>& vecPriority) const
+    const int nHeight) const
 {
     const size_t transactionSize = mempoolTx.GetTxSize();
     const CTransaction& tx = mempoolTx.GetTx();
@@ -138,34 +152,7 @@ void BlockMemoryPoolTransactionCollector::ComputeTransactionPriority(
     CAmount nominalFee = nTotalIn - valueSent;
     CFeeRate feeRate(nominalFee, transactionSize);
 
-    if (porphan) {
-        porphan->coinAgeOfInputsPerByte = coinAgeOfInputsPerByte;
-        porphan->feeRate = feeRate;
-        porphan->feePaid = feePaid;
-        porphan->txSize = transactionSize;
-    } else
-        vecPriority.push_back(TxPriority(coinAgeOfInputsPerByte, feeRate, &tx,feePaid,transactionSize));
-}
-
-void BlockMemoryPoolTransactionCollector::AddDependingTransactionsToPriorityQueue(
-    DependingTransactionsMap& dependentTransactions,
-    const uint256& hash,
-    std::vector<TxPriority>& vecPriority,
-    TxPriorityCompare& comparer) const
-{
-    if (dependentTransactions.count(hash)) {
-        for (auto& porphan : dependentTransactions[hash]) {
-            if (!porphan->setDependsOn.empty()) {
-                porphan->setDependsOn.erase(hash);
-                if (porphan->setDependsOn.empty()) {
-                    vecPriority.push_back(
-                        TxPriority(porphan->coinAgeOfInputsPerByte, porphan->feeRate, porphan->ptx,porphan->feePaid,porphan->txSize)
-                        );
-                    std::push_heap(vecPriority.begin(), vecPriority.end(), comparer);
-                }
-            }
-        }
-    }
+    return TxPriority(coinAgeOfInputsPerByte, feeRate, &tx,feePaid,transactionSize);
 }
 
 bool BlockMemoryPoolTransactionCollector::ShouldSkipCheapTransaction(
@@ -190,47 +177,20 @@ void BlockMemoryPoolTransactionCollector::AddTransactionToBlock(
     block.vtx.push_back(tx);
 }
 
-std::vector<TxPriority> BlockMemoryPoolTransactionCollector::ComputeMempoolTransactionPriorities(
-    const int& nHeight,
-    DependingTransactionsMap& dependentTransactions,
-    CCoinsViewCache& view) const
+std::vector<TxPriority> BlockMemoryPoolTransactionCollector::ComputeReadyTransactionPriorities(
+    const MempoolPackageIndex& packageIndex,
+    const int& nHeight) const
 {
+    // Only transactions without unconfirmed parents can go first; the others
+    // are looked at once their parents are in the block.
     std::vector<TxPriority> vecPriority;
-    vecPriority.reserve(mempool_.mapTx.size());
-    for (auto mi = mempool_.mapTx.begin(); mi != mempool_.mapTx.end(); ++mi) {
-        const CTransaction& tx = mi->second.GetTx();
-        if (tx.IsCoinBase() || tx.IsCoinStake() || !IsFinalTx(tx, activeChain_, nHeight)){
+    vecPriority.reserve(packageIndex.readyTransactions().size());
+    for (const uint256& hash : packageIndex.readyTransactions()) {
+        const CTxMemPoolEntry& entry = *packageIndex.find(hash)->entry;
+        if (!IsCandidateForBlock(entry.GetTx(), nHeight)) {
             continue;
         }
-
-        std::shared_ptr<COrphan> porphan;
-        bool fMissingInputs = false;
-        for (const CTxIn& txin : tx.vin) {
-
-            // Read prev transaction
-            if (!view.HaveCoins(txin.prevout.hash)) {
-                CTransaction prevTx;
-                if(!mempool_.lookupOutpoint(txin.prevout.hash, prevTx)) {
-                    // This should never happen; all transactions in the memory
-                    // pool should connect to either transactions in the chain
-                    // or other transactions in the memory pool.
-                    LogPrintf("ERROR: %s - mempool transaction missing input\n",__func__);
-                    fMissingInputs = true;
-                    break;
-                }
-
-                // Has to wait for dependencies
-                RecordOrphanTransaction(porphan, tx, txin, dependentTransactions);
-                continue;
-            }
-
-            const CCoins* coins = view.AccessCoins(txin.prevout.hash);
-            assert(coins);
-        }
-        if (fMissingInputs) {
-            continue;
-        }
-        ComputeTransactionPriority(mi->second, nHeight, porphan.get(), vecPriority);
+        vecPriority.push_back(ComputeTransactionPriority(entry, nHeight));
     }
     return vecPriority;
 }
@@ -259,87 +219,222 @@ PrioritizedTransactionData::PrioritizedTransactionData(
 {
 }
 
-std::vector<PrioritizedTransactionData> BlockMemoryPoolTransactionCollector::PrioritizeTransactionsByBlockSpaceUsage(
-    std::vector<TxPriority>& vecPriority,
+bool BlockMemoryPoolTransactionCollector::AddTransactionIfValid(
+    const MempoolPackageIndex& packageIndex,
+    const uint256& hash,
     const int& nHeight,
     CCoinsViewCache& view,
-    DependingTransactionsMap& dependentTransactions) const
+    BlockAssemblyState& assembly) const
 {
-    std::vector<PrioritizedTransactionData> prioritizedTransactions;
-    uint64_t currentBlockSize = 1000;
-    int currentBlockSigOps = 100;
+    const MempoolPackage& package = *packageIndex.find(hash);
+    const CTransaction& tx = package.entry->GetTx();
     const unsigned int constexpr maximumSigOpsPerBlock = MAX_BLOCK_SIGOPS_CURRENT;
-    bool txsArePrioritizedByFeePaid = (blockPrioritySize_ <= 0);
 
-    TxPriorityCompare comparer(txsArePrioritizedByFeePaid);
+    // Legacy limits on sigOps:
+    unsigned int transactionSigOpCount = GetLegacySigOpCount(tx);
+    if (!IsCandidateForBlock(tx, nHeight) ||
+        assembly.blockSigOps + transactionSigOpCount >= maximumSigOpsPerBlock ||
+        !view.HaveInputs(tx))
+    {
+        assembly.failed.insert(hash);
+        return false;
+    }
+    transactionSigOpCount += GetP2SHSigOpCount(tx, view);
+    if (assembly.blockSigOps + transactionSigOpCount >= maximumSigOpsPerBlock) {
+        assembly.failed.insert(hash);
+        return false;
+    }
+
+    // Note that flags: we don't want to set mempool/IsStandard()
+    // policy here, but we still have to ensure that the block we
+    // create only contains transactions that are valid in new blocks.
+    CValidationState state;
+    if (!CheckInputs(tx, state, view, blockIndexMap_, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true)) {
+        assembly.failed.insert(hash);
+        return false;
+    }
+
+    assembly.transactions.emplace_back(tx, transactionSigOpCount, package.entry->GetFee());
+    assembly.blockSize += package.size;
+    assembly.blockSigOps += transactionSigOpCount;
+    assembly.inBlock.insert(hash);
+
+    CTxUndo txundo;
+    UpdateCoinsWithTransaction(tx, view, txundo, nHeight);
+
+    // Whatever spends this transaction now needs less to be mined:
+    std::set<uint256> descendants;
+    packageIndex.collectDescendants(hash, descendants);
+    for (const uint256& descendantHash : descendants) {
+        auto modified = assembly.modifiedPackages.find(descendantHash);
+        if (modified == assembly.modifiedPackages.end()) {
+            const MempoolPackage& descendant = *packageIndex.find(descendantHash);
+            modified = assembly.modifiedPackages.emplace(
+                descendantHash, std::make_pair(descendant.ancestorFees, descendant.ancestorSize)).first;
+        } else {
+            assembly.modifiedByFeeRate.erase(std::make_pair(BlockAssemblyState::FeePerK(modified->second), descendantHash));
+        }
+        modified->second.first -= package.fee;
+        modified->second.second -= package.size;
+        assembly.modifiedByFeeRate.insert(std::make_pair(BlockAssemblyState::FeePerK(modified->second), descendantHash));
+    }
+    return true;
+}
+
+void BlockMemoryPoolTransactionCollector::AddTransactionsByCoinAgePriority(
+    const MempoolPackageIndex& packageIndex,
+    const int& nHeight,
+    CCoinsViewCache& view,
+    BlockAssemblyState& assembly) const
+{
+    std::vector<TxPriority> vecPriority = ComputeReadyTransactionPriorities(packageIndex, nHeight);
+    TxPriorityCompare comparer(false);
     std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
 
     while (!vecPriority.empty()) {
         // Take highest priority transaction off the priority queue:
-        const auto& priorityDatum = vecPriority.front();
-        const bool mustPayFees = !CTxMemPoolEntry::AllowFree(priorityDatum._coinAgeOfInputsPerByte);
-        CFeeRate feeRate = priorityDatum._nominalFeeRate;
-        const CTransaction& tx = *(priorityDatum._transactionRef);
-        const CAmount fee = priorityDatum._feePaid;
-        const unsigned transactionSize = priorityDatum._transactionSize;
-
+        const TxPriority priorityDatum = vecPriority.front();
         std::pop_heap(vecPriority.begin(), vecPriority.end(), comparer);
         vecPriority.pop_back();
 
-        // Legacy limits on sigOps:
-        unsigned int transactionSigOpCount = GetLegacySigOpCount(tx);
-        const uint256& hash = tx.GetHash();
-        // Skip free transactions if we're past the minimum block size:
-        if (currentBlockSize + transactionSize >= blockMaxSize_ ||
-            currentBlockSigOps + transactionSigOpCount >= maximumSigOpsPerBlock)
+        const bool mustPayFees = !CTxMemPoolEntry::AllowFree(priorityDatum._coinAgeOfInputsPerByte);
+        const CTransaction& tx = *(priorityDatum._transactionRef);
+        const unsigned transactionSize = priorityDatum._transactionSize;
+        if (assembly.blockSize + transactionSize >= blockMaxSize_ ||
+            assembly.blockSigOps + GetLegacySigOpCount(tx) >= MAX_BLOCK_SIGOPS_CURRENT)
         {
             continue;
         }
         // Prioritise by fee once past the priority size or we run out of high-priority
-        // transactions:
-        if(!txsArePrioritizedByFeePaid)
-        {
-            if(ShouldSwitchToPriotizationByFee(currentBlockSize, transactionSize, mustPayFees))
-            {
-                txsArePrioritizedByFeePaid = true;
-                comparer.sortByFee();
-                std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
+        // transactions; everything not in the block yet is left to the package phase.
+        if (ShouldSwitchToPriotizationByFee(assembly.blockSize, transactionSize, mustPayFees)) {
+            return;
+        }
+
+        const uint256& hash = tx.GetHash();
+        if (!AddTransactionIfValid(packageIndex, hash, nHeight, view, assembly)) {
+            continue;
+        }
+
+        // Children whose parents are now all in the block can be mined next:
+        for (const uint256& childHash : packageIndex.find(hash)->children) {
+            const MempoolPackage& child = *packageIndex.find(childHash);
+            bool parentsInBlock = true;
+            for (const uint256& parentHash : child.parents) {
+                if (!assembly.inBlock.count(parentHash)) {
+                    parentsInBlock = false;
+                    break;
+                }
+            }
+            if (!parentsInBlock || !IsCandidateForBlock(child.entry->GetTx(), nHeight)) {
+                continue;
             }
+            vecPriority.push_back(ComputeTransactionPriority(*child.entry, nHeight));
+            std::push_heap(vecPriority.begin(), vecPriority.end(), comparer);
         }
-        else if( !mempool_.IsPrioritizedTransaction(hash) && ShouldSkipCheapTransaction(feeRate, currentBlockSize, transactionSize))
+    }
+}
+
+void BlockMemoryPoolTransactionCollector::AddPackagesByFeeRate(
+    const MempoolPackageIndex& packageIndex,
+    const int& nHeight,
+    CCoinsViewCache& view,
+    BlockAssemblyState& assembly) const
+{
+    // Packages are taken in the order the mempool keeps them by ancestor fee
+    // rate, unless a package that is partly in the block already pays more
+    // for what it still lacks.
+    const std::set<std::pair<CAmount, uint256> >& byAncestorFeeRate = packageIndex.byAncestorFeeRate();
+    auto next = byAncestorFeeRate.rbegin();
+    unsigned consecutivePackagesNotFitting = 0u;
+    while (true) {
+        while (next != byAncestorFeeRate.rend() &&
+               (assembly.inBlock.count(next->second) ||
+                assembly.failed.count(next->second) ||
+                assembly.modifiedPackages.count(next->second)))
         {
+            ++next;
+        }
+        const bool haveModified = !assembly.modifiedByFeeRate.empty();
+        if (next == byAncestorFeeRate.rend() && !haveModified) {
+            break;
+        }
+
+        uint256 hash;
+        if (haveModified && (next == byAncestorFeeRate.rend() || *assembly.modifiedByFeeRate.rbegin() > *next)) {
+            auto best = std::prev(assembly.modifiedByFeeRate.end());
+            hash = best->second;
+            assembly.modifiedByFeeRate.erase(best);
+        } else {
+            hash = next->second;
+            ++next;
+        }
+        if (assembly.inBlock.count(hash) || assembly.failed.count(hash)) {
             continue;
         }
 
-        if (!view.HaveInputs(tx)) {
+        // What the package still lacks is known up front, so packages that
+        // do not fit or pay too little are passed over without walking them.
+        const MempoolPackage& candidate = *packageIndex.find(hash);
+        const auto modified = assembly.modifiedPackages.find(hash);
+        const std::pair<CAmount, uint64_t> packageFeesAndSize =
+            modified != assembly.modifiedPackages.end()?
+                modified->second : std::make_pair(candidate.ancestorFees, candidate.ancestorSize);
+        const uint64_t packageSize = packageFeesAndSize.second;
+        if (assembly.blockSize + packageSize >= blockMaxSize_) {
+            // Once the block is nearly full the rest of the pool is unlikely
+            // to have anything small enough left.
+            if (assembly.blockSize + nearlyFullBlockMargin >= blockMaxSize_ &&
+                ++consecutivePackagesNotFitting >= maximumConsecutivePackagesNotFitting)
+            {
+                break;
+            }
             continue;
         }
-        transactionSigOpCount += GetP2SHSigOpCount(tx, view);
-        if (currentBlockSigOps + transactionSigOpCount >= maximumSigOpsPerBlock) {
+        consecutivePackagesNotFitting = 0u;
+        const CFeeRate packageFeeRate(packageFeesAndSize.first, packageSize);
+        if (!mempool_.IsPrioritizedTransaction(hash) && ShouldSkipCheapTransaction(packageFeeRate, assembly.blockSize, packageSize)) {
             continue;
         }
 
-        // Note that flags: we don't want to set mempool/IsStandard()
-        // policy here, but we still have to ensure that the block we
-        // create only contains transactions that are valid in new blocks.
-        CValidationState state;
-        if (!CheckInputs(tx, state, view, blockIndexMap_, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true)) {
+        // The package is the transaction and its ancestors not in the block yet.
+        std::vector<const MempoolPackage*> packageInOrder(1u, &candidate);
+        std::set<uint256> packageHashes;
+        std::deque<uint256> toVisit(1u, hash);
+        bool packageFailed = false;
+        while (!toVisit.empty() && !packageFailed) {
+            const MempoolPackage& package = *packageIndex.find(toVisit.front());
+            toVisit.pop_front();
+            for (const uint256& parentHash : package.parents) {
+                if (assembly.inBlock.count(parentHash) || !packageHashes.insert(parentHash).second) {
+                    continue;
+                }
+                if (assembly.failed.count(parentHash)) {
+                    packageFailed = true;
+                    break;
+                }
+                packageInOrder.push_back(packageIndex.find(parentHash));
+                toVisit.push_back(parentHash);
+            }
+        }
+        if (packageFailed) {
+            assembly.failed.insert(hash);
             continue;
         }
 
-        prioritizedTransactions.emplace_back(tx, transactionSigOpCount,fee);
-        currentBlockSize += transactionSize;
-        currentBlockSigOps += transactionSigOpCount;
-
-        CTxUndo txundo;
-        UpdateCoinsWithTransaction(tx, view, txundo, nHeight);
-
-        // Add transactions that depend on this one to the priority queue
-        AddDependingTransactionsToPriorityQueue(dependentTransactions, hash, vecPriority, comparer);
+        // An entry has more ancestors than any of its parents, so this puts
+        // parents first.
+        std::sort(packageInOrder.begin(), packageInOrder.end(),
+            [](const MempoolPackage* a, const MempoolPackage* b) {
+                return a->ancestorCount < b->ancestorCount;
+            });
+        for (const MempoolPackage* package : packageInOrder) {
+            if (!AddTransactionIfValid(packageIndex, package->entry->GetTx().GetHash(), nHeight, view, assembly)) {
+                assembly.failed.insert(hash);
+                break;
+            }
+        }
     }
-
-    LogPrintf("%s: total size %u\n",__func__, currentBlockSize);
-    return prioritizedTransactions;
 }
 
 void BlockMemoryPoolTransactionCollector::AddTransactionsToBlockIfPossible(
@@ -347,19 +442,15 @@ void BlockMemoryPoolTransactionCollector::AddTransactionsToBlockIfPossible(
     CCoinsViewCache& view,
     CBlock& block) const
 {
-    DependingTransactionsMap dependentTransactions;
-
-    std::vector<TxPriority> vecPriority =
-        ComputeMempoolTransactionPriorities(nHeight, dependentTransactions, view);
-
-    std::vector<PrioritizedTransactionData> prioritizedTransactions =
-        PrioritizeTransactionsByBlockSpaceUsage(
-            vecPriority,
-            nHeight,
-            view,
-            dependentTransactions);
+    const MempoolPackageIndex& packageIndex = mempool_.GetPackageIndex();
+    BlockAssemblyState assembly;
+    if (blockPrioritySize_ > 0) {
+        AddTransactionsByCoinAgePriority(packageIndex, nHeight, view, assembly);
+    }
+    AddPackagesByFeeRate(packageIndex, nHeight, view, assembly);
+    LogPrintf("%s: total size %u\n",__func__, assembly.blockSize);
 
-    for(const PrioritizedTransactionData& txData: prioritizedTransactions)
+    for(const PrioritizedTransactionData& txData: assembly.transactions)
     {
         const CTransaction& tx = *txData.tx;
         AddTransactionToBlock(tx, txData.fee, block);
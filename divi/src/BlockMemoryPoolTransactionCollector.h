@@ -20,7 +20,6 @@ class BlockMap;
 class CCriticalSection;
 class CTxMemPoolEntry;
 class CTransaction;
-class CTxIn;
 class CBlock;
 class CCoinsViewCache;
 class CBlockIndex;
@@ -42,8 +41,6 @@ struct PrioritizedTransactionData
         CAmount feePaid);
 };
 
-class COrphan;
-
 // We want to sort transactions by priority and fee rate, so:
 struct TxPriority
 {
@@ -70,12 +67,12 @@ public:
 };
 class TxPriorityCompare;
 class CChain;
+class MempoolPackageIndex;
+class BlockAssemblyState;
 
 class BlockMemoryPoolTransactionCollector: public I_BlockTransactionCollector
 {
 private:
-    using DependingTransactionsMap = std::map<uint256, std::vector<std::shared_ptr<COrphan>>>;
-
     CCoinsViewCache* baseCoinsViewCache_;
     const CChain& activeChain_;
     const BlockMap& blockIndexMap_;
@@ -87,22 +84,13 @@ private:
     const unsigned blockMinSize_;
 
 private:
-    void RecordOrphanTransaction(
-        std::shared_ptr<COrphan>& porphan,
+    bool IsCandidateForBlock(
         const CTransaction& tx,
-        const CTxIn& txin,
-        DependingTransactionsMap& mapDependers) const;
+        const int nHeight) const;
 
-    void ComputeTransactionPriority(
+    TxPriority ComputeTransactionPriority(
         const CTxMemPoolEntry& tx,
-        const int nHeight,
-        COrphan* porphan,
-        std::vector<TxPriority>& vecPriority) const;
-    void AddDependingTransactionsToPriorityQueue(
-        DependingTransactionsMap& mapDependers,
-        const uint256& hash,
-        std::vector<TxPriority>& vecPriority,
-        TxPriorityCompare& comparer) const;
+        const int nHeight) const;
 
     bool ShouldSkipCheapTransaction(
         const CFeeRate& feeRate,
@@ -114,20 +102,30 @@ private:
         const CAmount feePaid,
         CBlock& block) const;
 
-    std::vector<TxPriority> ComputeMempoolTransactionPriorities(
-        const int& nHeight,
-        DependingTransactionsMap& mapDependers,
-        CCoinsViewCache& view) const;
+    std::vector<TxPriority> ComputeReadyTransactionPriorities(
+        const MempoolPackageIndex& packageIndex,
+        const int& nHeight) const;
 
     bool ShouldSwitchToPriotizationByFee(
         const uint64_t& currentBlockSize,
         const unsigned int& transactionSize,
         const bool mustPayFees) const;
-    std::vector<PrioritizedTransactionData> PrioritizeTransactionsByBlockSpaceUsage(
-        std::vector<TxPriority>& vecPriority,
+    bool AddTransactionIfValid(
+        const MempoolPackageIndex& packageIndex,
+        const uint256& hash,
+        const int& nHeight,
+        CCoinsViewCache& view,
+        BlockAssemblyState& assembly) const;
+    void AddTransactionsByCoinAgePriority(
+        const MempoolPackageIndex& packageIndex,
+        const int& nHeight,
+        CCoinsViewCache& view,
+        BlockAssemblyState& assembly) const;
+    void AddPackagesByFeeRate(
+        const MempoolPackageIndex& packageIndex,
         const int& nHeight,
         CCoinsViewCache& view,
-        DependingTransactionsMap& mapDependers) const;
+        BlockAssemblyState& assembly) const;
     void AddTransactionsToBlockIfPossible(
         const int& nHeight,
         CCoinsViewCache& view,
@@ -0,0 +1,56 @@
+#include <CachedPoSStakeModifierService.h>
+#include <StakingData.h>
+#include <chain.h>
+#include <atomic>
+
+static std::atomic<uint64_t> stakeModifierCacheHits(0);
+static std::atomic<uint64_t> stakeModifierCacheMisses(0);
+
+void GetStakeModifierCacheStatistics(uint64_t& hits, uint64_t& misses)
+{
+    hits = stakeModifierCacheHits;
+    misses = stakeModifierCacheMisses;
+}
+
+CachedPoSStakeModifierService::CachedPoSStakeModifierService(
+    const I_PoSStakeModifierService& decorated,
+    const CChain& activeChain
+    ): decoratedStakeModifierService_(decorated)
+    , activeChain_(activeChain)
+    , cs_cache_()
+    , activeChainTipOfCachedEntries_(nullptr)
+    , cachedStakeModifiers_()
+{
+}
+
+std::pair<uint64_t,bool> CachedPoSStakeModifierService::getStakeModifier(const StakingData& stakingData) const
+{
+    const CacheKey key(stakingData.blockHashOfChainTipBlock_, stakingData.blockHashOfFirstConfirmationBlock_);
+    {
+        LOCK(cs_cache_);
+        const CBlockIndex* activeChainTip = activeChain_.Tip();
+        if(activeChainTip != activeChainTipOfCachedEntries_)
+        {
+            cachedStakeModifiers_.clear();
+            activeChainTipOfCachedEntries_ = activeChainTip;
+        }
+        StakeModifierCache::const_iterator it = cachedStakeModifiers_.find(key);
+        if(it != cachedStakeModifiers_.end())
+        {
+            ++stakeModifierCacheHits;
+            return std::make_pair(it->second,true);
+        }
+    }
+
+    ++stakeModifierCacheMisses;
+    std::pair<uint64_t,bool> stakeModifier = decoratedStakeModifierService_.getStakeModifier(stakingData);
+    if(stakeModifier.second)
+    {
+        LOCK(cs_cache_);
+        if(activeChain_.Tip() == activeChainTipOfCachedEntries_)
+        {
+            cachedStakeModifiers_[key] = stakeModifier.first;
+        }
+    }
+    return stakeModifier;
+}
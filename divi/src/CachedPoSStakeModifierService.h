@@ -0,0 +1,44 @@
+#ifndef CACHED_POS_STAKE_MODIFIER_SERVICE_H
+#define CACHED_POS_STAKE_MODIFIER_SERVICE_H
+#include <stdint.h>
+#include <utility>
+#include <I_PoSStakeModifierService.h>
+#include <uint256.h>
+#include <sync.h>
+#include <boost/unordered_map.hpp>
+
+class StakingData;
+class CChain;
+class CBlockIndex;
+
+struct StakeModifierCacheKeyHasher
+{
+    size_t operator()(const std::pair<uint256,uint256>& key) const
+    {
+        return key.first.GetLow64() ^ key.second.GetLow64();
+    }
+};
+
+/** Decorator that memoizes stake modifiers per (chain tip, first confirmation block).
+ *  All entries are dropped as soon as the active chain tip moves, i.e. after
+ *  every UpdateTip/DisconnectTip, so the cache never outlives the chain state
+ *  the decorated lookups depend on. */
+class CachedPoSStakeModifierService: public I_PoSStakeModifierService
+{
+private:
+    typedef std::pair<uint256,uint256> CacheKey;
+    typedef boost::unordered_map<CacheKey, uint64_t, StakeModifierCacheKeyHasher> StakeModifierCache;
+
+    const I_PoSStakeModifierService& decoratedStakeModifierService_;
+    const CChain& activeChain_;
+    mutable CCriticalSection cs_cache_;
+    mutable const CBlockIndex* activeChainTipOfCachedEntries_;
+    mutable StakeModifierCache cachedStakeModifiers_;
+public:
+    CachedPoSStakeModifierService(const I_PoSStakeModifierService& decorated, const CChain& activeChain);
+    virtual std::pair<uint64_t,bool> getStakeModifier(const StakingData& stakingData) const;
+};
+
+/** Hit and miss counts accumulated over all stake modifier caches */
+void GetStakeModifierCacheStatistics(uint64_t& hits, uint64_t& misses);
+#endif// CACHED_POS_STAKE_MODIFIER_SERVICE_H
@@ -0,0 +1,94 @@
+#include <CollateralHeightIndex.h>
+
+#include <primitives/block.h>
+
+namespace
+{
+/** Collaterals may refer to their transaction by txid or by bare txid. */
+template <typename Callback>
+void ForEachReferencingHash(const CBlock& block, Callback callback)
+{
+    for(const CTransaction& tx: block.vtx)
+    {
+        callback(tx.GetHash());
+        if(tx.GetBareTxid() != tx.GetHash()) callback(tx.GetBareTxid());
+    }
+}
+}
+
+const int CollateralHeightIndex::UNCONFIRMED;
+
+CollateralHeightIndex::CollateralHeightIndex(
+    ): confirmationHeights_()
+    , unconfirmedCollaterals_()
+{
+}
+
+bool CollateralHeightIndex::lookup(const COutPoint& collateral, int& confirmationHeight) const
+{
+    const auto it = confirmationHeights_.find(collateral);
+    if(it != confirmationHeights_.end())
+    {
+        confirmationHeight = it->second;
+        return true;
+    }
+    if(unconfirmedCollaterals_.count(collateral) > 0)
+    {
+        confirmationHeight = UNCONFIRMED;
+        return true;
+    }
+    return false;
+}
+
+void CollateralHeightIndex::record(const COutPoint& collateral, int confirmationHeight)
+{
+    if(confirmationHeight < 0)
+    {
+        confirmationHeights_.erase(collateral);
+        unconfirmedCollaterals_.insert(collateral);
+    }
+    else
+    {
+        unconfirmedCollaterals_.erase(collateral);
+        confirmationHeights_[collateral] = confirmationHeight;
+    }
+}
+
+void CollateralHeightIndex::blockConnected(const CBlock& block, int height)
+{
+    if(unconfirmedCollaterals_.empty()) return;
+    ForEachReferencingHash(block, [this, height](const uint256& txHash)
+    {
+        auto it = unconfirmedCollaterals_.lower_bound(COutPoint(txHash, 0));
+        while(it != unconfirmedCollaterals_.end() && it->hash == txHash)
+        {
+            confirmationHeights_[*it] = height;
+            it = unconfirmedCollaterals_.erase(it);
+        }
+    });
+}
+
+void CollateralHeightIndex::blockDisconnected(const CBlock& block)
+{
+    if(confirmationHeights_.empty()) return;
+    ForEachReferencingHash(block, [this](const uint256& txHash)
+    {
+        auto it = confirmationHeights_.lower_bound(COutPoint(txHash, 0));
+        while(it != confirmationHeights_.end() && it->first.hash == txHash)
+        {
+            unconfirmedCollaterals_.insert(it->first);
+            it = confirmationHeights_.erase(it);
+        }
+    });
+}
+
+void CollateralHeightIndex::clear()
+{
+    confirmationHeights_.clear();
+    unconfirmedCollaterals_.clear();
+}
+
+size_t CollateralHeightIndex::size() const
+{
+    return confirmationHeights_.size() + unconfirmedCollaterals_.size();
+}
@@ -0,0 +1,40 @@
+#ifndef COLLATERAL_HEIGHT_INDEX_H
+#define COLLATERAL_HEIGHT_INDEX_H
+
+#include <map>
+#include <set>
+
+#include <primitives/transaction.h>
+
+class CBlock;
+
+/** Remembers at which height masternode collaterals were confirmed, so that
+ *  ranking and payment queue computations do not have to go back to the
+ *  coins database or the transaction index for every masternode.
+ *
+ *  Collaterals are added as they are first looked up and kept in step with
+ *  the active chain by replaying connected and disconnected blocks.  */
+class CollateralHeightIndex
+{
+public:
+    static const int UNCONFIRMED = -1;
+
+private:
+    std::map<COutPoint, int> confirmationHeights_;
+    std::set<COutPoint> unconfirmedCollaterals_;
+
+public:
+    CollateralHeightIndex();
+
+    /** Returns false if the collateral has not been recorded yet. Otherwise
+     *  sets confirmationHeight, to UNCONFIRMED if not in the active chain. */
+    bool lookup(const COutPoint& collateral, int& confirmationHeight) const;
+    void record(const COutPoint& collateral, int confirmationHeight);
+
+    void blockConnected(const CBlock& block, int height);
+    void blockDisconnected(const CBlock& block);
+
+    void clear();
+    size_t size() const;
+};
+#endif// COLLATERAL_HEIGHT_INDEX_H
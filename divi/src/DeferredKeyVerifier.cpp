@@ -0,0 +1,102 @@
+#include <DeferredKeyVerifier.h>
+
+#include <key.h>
+#include <keystore.h>
+#include <Logging.h>
+#include <ThreadManagementHelpers.h>
+#include <tinyformat.h>
+
+#include <boost/thread.hpp>
+
+DeferredKeyVerifier::DeferredKeyVerifier(
+    ): cs_verifier()
+    , state_(NOTHING_DEFERRED)
+    , keysToVerify_()
+    , numberOfVerifiedKeys_(0u)
+    , failedKeys_()
+{
+}
+
+void DeferredKeyVerifier::deferVerification(const CPubKey& pubkey)
+{
+    LOCK(cs_verifier);
+    keysToVerify_.push_back(pubkey);
+    state_ = PENDING;
+}
+
+void DeferredKeyVerifier::verify(const CKeyStore& keyStore)
+{
+    std::vector<CPubKey> keysToVerify;
+    {
+        LOCK(cs_verifier);
+        if(state_ != PENDING) return;
+        state_ = RUNNING;
+        keysToVerify = keysToVerify_;
+    }
+    LogPrintf("%s : Verifying %u key pairs loaded without verification\n", __func__, keysToVerify.size());
+
+    for(const CPubKey& pubkey: keysToVerify)
+    {
+        boost::this_thread::interruption_point();
+        CKey key;
+        const bool verified = keyStore.GetKey(pubkey.GetID(), key) && key.VerifyPubKey(pubkey);
+
+        LOCK(cs_verifier);
+        ++numberOfVerifiedKeys_;
+        if(!verified)
+        {
+            LogPrintf("ERROR: %s : Private key of %s does not match its public key\n", __func__, pubkey.GetID().ToString());
+            failedKeys_.push_back(pubkey.GetID());
+        }
+    }
+
+    LOCK(cs_verifier);
+    state_ = failedKeys_.empty()? COMPLETE : FAILED;
+    if(state_ == FAILED)
+    {
+        strMiscWarning = strprintf("Warning: %u wallet key pairs are corrupt, see getkeyverificationstatus!", failedKeys_.size());
+    }
+    LogPrintf("%s : Verified %u key pairs, %u failed\n", __func__, numberOfVerifiedKeys_, failedKeys_.size());
+}
+
+DeferredKeyVerifier::State DeferredKeyVerifier::state() const
+{
+    LOCK(cs_verifier);
+    return state_;
+}
+
+const char* DeferredKeyVerifier::describe(State state)
+{
+    switch(state)
+    {
+        case NOTHING_DEFERRED:
+            return "none";
+        case PENDING:
+            return "pending";
+        case RUNNING:
+            return "running";
+        case COMPLETE:
+            return "complete";
+        case FAILED:
+            return "failed";
+    }
+    return "unknown";
+}
+
+size_t DeferredKeyVerifier::numberOfKeys() const
+{
+    LOCK(cs_verifier);
+    return keysToVerify_.size();
+}
+
+unsigned DeferredKeyVerifier::numberOfVerifiedKeys() const
+{
+    LOCK(cs_verifier);
+    return numberOfVerifiedKeys_;
+}
+
+std::vector<CKeyID> DeferredKeyVerifier::failedKeys() const
+{
+    LOCK(cs_verifier);
+    return failedKeys_;
+}
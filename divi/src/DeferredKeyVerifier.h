@@ -0,0 +1,47 @@
+#ifndef DEFERRED_KEY_VERIFIER_H
+#define DEFERRED_KEY_VERIFIER_H
+#include <vector>
+#include <pubkey.h>
+#include <sync.h>
+
+class CKeyStore;
+
+/**
+ * Key pairs loaded from the wallet file without checking that the private key
+ * matches the public key, to be verified once the node is up (-deferkeyverification).
+ * Until then a corrupt key pair goes unnoticed, so verification failures are
+ * logged and raised as a warning.
+ */
+class DeferredKeyVerifier
+{
+public:
+    enum State
+    {
+        NOTHING_DEFERRED,
+        PENDING,
+        RUNNING,
+        COMPLETE,
+        FAILED,
+    };
+
+private:
+    mutable CCriticalSection cs_verifier;
+    State state_;
+    std::vector<CPubKey> keysToVerify_;
+    unsigned numberOfVerifiedKeys_;
+    std::vector<CKeyID> failedKeys_;
+
+public:
+    DeferredKeyVerifier();
+
+    void deferVerification(const CPubKey& pubkey);
+    /** Checks every deferred key pair against the key store; stops at thread interruption. */
+    void verify(const CKeyStore& keyStore);
+
+    State state() const;
+    static const char* describe(State state);
+    size_t numberOfKeys() const;
+    unsigned numberOfVerifiedKeys() const;
+    std::vector<CKeyID> failedKeys() const;
+};
+#endif// DEFERRED_KEY_VERIFIER_H
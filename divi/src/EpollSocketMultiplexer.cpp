@@ -0,0 +1,145 @@
+#include <EpollSocketMultiplexer.h>
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <errno.h>
+#include <poll.h>
+#include <sys/epoll.h>
+
+namespace
+{
+/** Upper bound on the events fetched by a single epoll_wait call; further
+ *  events stay queued in the kernel for the next call. */
+constexpr int MAXIMUM_EVENTS_PER_WAIT = 256;
+}
+
+EpollSocketMultiplexer::EpollSocketMultiplexer(
+    ): epollFd_(epoll_create1(EPOLL_CLOEXEC))
+    , readinessBySocket_()
+    , socketsToRevalidate_()
+{
+}
+
+EpollSocketMultiplexer::~EpollSocketMultiplexer()
+{
+    if(epollFd_ >= 0) close(epollFd_);
+}
+
+bool EpollSocketMultiplexer::isValid() const
+{
+    return epollFd_ >= 0;
+}
+
+bool EpollSocketMultiplexer::add(SOCKET socket)
+{
+    if(!isValid() || socket == INVALID_SOCKET) return false;
+
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.fd = socket;
+    if(epoll_ctl(epollFd_, EPOLL_CTL_ADD, socket, &event) != 0) return false;
+
+    readinessBySocket_[socket] = SocketReadiness();
+    // Anything that became ready before registration produced no edge.
+    socketsToRevalidate_.push_back(socket);
+    return true;
+}
+
+void EpollSocketMultiplexer::remove(SOCKET socket)
+{
+    if(readinessBySocket_.erase(socket) == 0) return;
+    // Closed sockets already left the epoll set, so failures are expected.
+    struct epoll_event event;
+    epoll_ctl(epollFd_, EPOLL_CTL_DEL, socket, &event);
+}
+
+bool EpollSocketMultiplexer::contains(SOCKET socket) const
+{
+    return readinessBySocket_.count(socket) > 0;
+}
+
+size_t EpollSocketMultiplexer::size() const
+{
+    return readinessBySocket_.size();
+}
+
+void EpollSocketMultiplexer::revalidateServicedSockets()
+{
+    std::vector<struct pollfd> pollFds;
+    pollFds.reserve(socketsToRevalidate_.size());
+    for(SOCKET socket: socketsToRevalidate_)
+    {
+        if(!contains(socket)) continue;
+        struct pollfd pollFd;
+        pollFd.fd = socket;
+        pollFd.events = POLLIN | POLLOUT | POLLRDHUP;
+        pollFd.revents = 0;
+        pollFds.push_back(pollFd);
+    }
+    socketsToRevalidate_.clear();
+    if(pollFds.empty() || poll(pollFds.data(), pollFds.size(), 0) < 0) return;
+
+    for(const struct pollfd& pollFd: pollFds)
+    {
+        SocketReadiness& readiness = readinessBySocket_[pollFd.fd];
+        readiness.error = (pollFd.revents & (POLLERR | POLLHUP | POLLRDHUP | POLLNVAL)) != 0;
+        readiness.readable = readiness.error || (pollFd.revents & POLLIN) != 0;
+        readiness.writable = (pollFd.revents & POLLOUT) != 0;
+    }
+}
+
+int EpollSocketMultiplexer::wait(int timeoutMilliseconds)
+{
+    if(!isValid()) return SOCKET_ERROR;
+    revalidateServicedSockets();
+
+    struct epoll_event events[MAXIMUM_EVENTS_PER_WAIT];
+    const int numberOfEvents = epoll_wait(epollFd_, events, MAXIMUM_EVENTS_PER_WAIT, timeoutMilliseconds);
+    if(numberOfEvents < 0) return errno == EINTR? 0 : SOCKET_ERROR;
+
+    for(int eventIndex = 0; eventIndex < numberOfEvents; ++eventIndex)
+    {
+        const struct epoll_event& event = events[eventIndex];
+        const auto it = readinessBySocket_.find(event.data.fd);
+        if(it == readinessBySocket_.end()) continue;
+
+        SocketReadiness& readiness = it->second;
+        if(event.events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+        {
+            readiness.error = true;
+            readiness.readable = true;
+        }
+        if(event.events & EPOLLIN) readiness.readable = true;
+        if(event.events & EPOLLOUT) readiness.writable = true;
+    }
+    return numberOfEvents;
+}
+
+void EpollSocketMultiplexer::markServiced(SOCKET socket)
+{
+    if(contains(socket)) socketsToRevalidate_.push_back(socket);
+}
+
+const EpollSocketMultiplexer::SocketReadiness* EpollSocketMultiplexer::findReadiness(SOCKET socket) const
+{
+    const auto it = readinessBySocket_.find(socket);
+    return it != readinessBySocket_.end()? &it->second : nullptr;
+}
+
+bool EpollSocketMultiplexer::isReadable(SOCKET socket) const
+{
+    const SocketReadiness* readiness = findReadiness(socket);
+    return readiness && readiness->readable;
+}
+
+bool EpollSocketMultiplexer::isWritable(SOCKET socket) const
+{
+    const SocketReadiness* readiness = findReadiness(socket);
+    return readiness && readiness->writable;
+}
+
+bool EpollSocketMultiplexer::hasError(SOCKET socket) const
+{
+    const SocketReadiness* readiness = findReadiness(socket);
+    return readiness && readiness->error;
+}
+#endif// HAVE_SYS_EPOLL_H
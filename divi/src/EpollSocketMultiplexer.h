@@ -0,0 +1,53 @@
+#ifndef EPOLL_SOCKET_MULTIPLEXER_H
+#define EPOLL_SOCKET_MULTIPLEXER_H
+
+#include <compat.h>
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <map>
+#include <vector>
+
+/** Edge-triggered readiness tracking for a set of sockets on top of epoll.
+ *  Sockets are registered once for both directions; the readiness reported
+ *  by each edge is remembered until the caller marks the socket as serviced,
+ *  after which it is re-checked (level-triggered) on the next wait so data
+ *  left over from a partial read or write is not lost.  */
+class EpollSocketMultiplexer
+{
+private:
+    struct SocketReadiness
+    {
+        bool readable;
+        bool writable;
+        bool error;
+        SocketReadiness(): readable(false), writable(false), error(false) {}
+    };
+
+    int epollFd_;
+    std::map<SOCKET, SocketReadiness> readinessBySocket_;
+    std::vector<SOCKET> socketsToRevalidate_;
+
+    void revalidateServicedSockets();
+    const SocketReadiness* findReadiness(SOCKET socket) const;
+
+public:
+    EpollSocketMultiplexer();
+    ~EpollSocketMultiplexer();
+
+    bool isValid() const;
+    bool add(SOCKET socket);
+    void remove(SOCKET socket);
+    bool contains(SOCKET socket) const;
+    size_t size() const;
+
+    /** Waits up to the given timeout for new readiness edges and returns the
+     *  number of events received, or SOCKET_ERROR.  */
+    int wait(int timeoutMilliseconds);
+    void markServiced(SOCKET socket);
+
+    bool isReadable(SOCKET socket) const;
+    bool isWritable(SOCKET socket) const;
+    bool hasError(SOCKET socket) const;
+};
+#endif// HAVE_SYS_EPOLL_H
+#endif// EPOLL_SOCKET_MULTIPLEXER_H
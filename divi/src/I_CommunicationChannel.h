@@ -1,11 +1,18 @@
 #ifndef I_COMMUNICATION_CHANNEL_H
 #define I_COMMUNICATION_CHANNEL_H
 #include <cstdlib>
+struct ConstDataBuffer
+{
+    const void* data;
+    size_t len;
+};
 class I_CommunicationChannel
 {
 public:
     virtual ~I_CommunicationChannel(){}
     virtual int sendData(const void* buffer, size_t len) const = 0;
+    /** Sends the buffers back to back in as few calls as possible, returning the total sent like sendData. */
+    virtual int sendData(const ConstDataBuffer* buffers, size_t numberOfBuffers) const = 0;
     virtual int receiveData(void* buffer, size_t len) const = 0;
     virtual void close() = 0;
     virtual bool isValid() const = 0;
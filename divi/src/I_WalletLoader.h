@@ -36,6 +36,7 @@ public:
     virtual bool LoadMinVersion(int nVersion) = 0;
     virtual bool LoadMultiSig(const CScript& dest) = 0;
     virtual bool LoadKey(const CKey& key, const CPubKey& pubkey) = 0;
+    virtual void DeferKeyVerification(const CPubKey& pubkey) = 0;
     virtual bool LoadMasterKey(unsigned int masterKeyIndex, CMasterKey& masterKey) = 0;
     virtual bool LoadCryptedKey(const CPubKey& vchPubKey, const std::vector<unsigned char>& vchCryptedSecret) = 0;
     virtual bool LoadKeyMetadata(const CPubKey& pubkey, const CKeyMetadata& metadata, const bool updateFirstKeyTimestamp) = 0;
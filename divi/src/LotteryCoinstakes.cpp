@@ -1,7 +1,7 @@
 #include <LotteryCoinstakes.h>
 
 LotteryCoinstakeData::LotteryCoinstakeData(
-    ): storage(std::make_shared<LotteryCoinstakes>())
+    ): storage()
     , heightOfDataStorage(0)
     , storageIsLocal(true)
 {
@@ -9,7 +9,7 @@ LotteryCoinstakeData::LotteryCoinstakeData(
 LotteryCoinstakeData::LotteryCoinstakeData(
     int height,
     const LotteryCoinstakes& coinstakes
-    ): storage(std::make_shared<LotteryCoinstakes>(coinstakes))
+    ): storage(coinstakes.empty()? std::shared_ptr<LotteryCoinstakes>(): std::make_shared<LotteryCoinstakes>(coinstakes))
     , heightOfDataStorage(height)
     , storageIsLocal(true)
 {
@@ -17,7 +17,7 @@ LotteryCoinstakeData::LotteryCoinstakeData(
 
 bool LotteryCoinstakeData::IsValid() const
 {
-    return static_cast<bool>(storage.get());
+    return storageIsLocal || static_cast<bool>(storage.get());
 }
 void LotteryCoinstakeData::MarkAsShallowStorage()
 {
@@ -32,7 +32,8 @@ int LotteryCoinstakeData::height() const
 
 const LotteryCoinstakes& LotteryCoinstakeData::getLotteryCoinstakes() const
 {
-    return *storage;
+    static const LotteryCoinstakes noCoinstakes;
+    return storage? *storage : noCoinstakes;
 }
 void LotteryCoinstakeData::updateShallowDataStore(LotteryCoinstakeData& other)
 {
@@ -47,7 +48,7 @@ void LotteryCoinstakeData::clear()
 {
     heightOfDataStorage =0;
     storageIsLocal = true;
-    storage = std::make_shared<LotteryCoinstakes>();
+    storage.reset();
 }
 
 LotteryCoinstakeData LotteryCoinstakeData::getShallowCopy() const
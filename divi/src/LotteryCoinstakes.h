@@ -9,6 +9,9 @@
 typedef std::pair<uint256,CScript> LotteryCoinstake;
 typedef std::vector<LotteryCoinstake> LotteryCoinstakes;
 
+/** Lottery winners recorded on a block index. Most blocks carry the same
+ *  winners as an ancestor and only hold a shallow reference to its storage;
+ *  storage is left unallocated while the list is empty. */
 struct LotteryCoinstakeData
 {
 public:
@@ -40,15 +43,16 @@ public:
         {
             if(!ser_action.ForRead())
             {
-                LotteryCoinstakes& coinstakes = *storage;
+                LotteryCoinstakes& coinstakes = const_cast<LotteryCoinstakes&>(getLotteryCoinstakes());
                 READWRITE(coinstakes);
             }
             else
             {
-                storage.reset();
-                storage = std::make_shared<LotteryCoinstakes>();
-                LotteryCoinstakes& coinstakes = *storage;
+                LotteryCoinstakes coinstakes;
                 READWRITE(coinstakes);
+                storage.reset();
+                if(!coinstakes.empty())
+                    storage = std::make_shared<LotteryCoinstakes>(std::move(coinstakes));
             }
 
         }
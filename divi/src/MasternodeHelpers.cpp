@@ -6,6 +6,8 @@
 #include <timedata.h>
 #include <masternode.h>
 #include <blockmap.h>
+#include <coins.h>
+#include <CollateralHeightIndex.h>
 #include <TransactionDiskAccessor.h>
 #include <MasternodePing.h>
 #include <Logging.h>
@@ -15,6 +17,7 @@ extern bool fImporting;
 extern bool fReindex;
 extern CChain chainActive;
 extern BlockMap mapBlockIndex;
+extern CCoinsViewCache* pcoinsTip;
 
 static bool mnResyncRequested  = false;
 bool MasternodeResyncIsRequested()
@@ -84,38 +87,52 @@ bool GetBlockHashForScoring(uint256& hash, const CBlockIndex* pindex, const int
     return true;
 }
 
-const CBlockIndex* ComputeCollateralBlockIndex(const CMasternode& masternode)
-{
-    static std::map<COutPoint,const CBlockIndex*> cachedCollateralBlockIndices;
+static CollateralHeightIndex collateralHeightIndex;
 
-    const CBlockIndex* collateralBlockIndex = cachedCollateralBlockIndices[masternode.vin.prevout];
-    if (collateralBlockIndex)
-    {
-        if(chainActive.Contains(collateralBlockIndex))
-        {
-            return collateralBlockIndex;
-        }
-    }
+static int LookupCollateralConfirmationHeight(const COutPoint& collateral)
+{
+    // Unspent collaterals are found in the coins cache, without touching disk
+    const CCoins* coins = pcoinsTip->AccessCoins(collateral.hash);
+    if (coins && coins->IsAvailable(collateral.n))
+        return coins->nHeight;
 
     uint256 hashBlock;
     CTransaction tx;
-    if (!GetTransaction(masternode.vin.prevout.hash, tx, hashBlock, true)) {
-        collateralBlockIndex = nullptr;
-        return collateralBlockIndex;
-    }
+    if (!GetTransaction(collateral.hash, tx, hashBlock, true))
+        return CollateralHeightIndex::UNCONFIRMED;
 
     const auto mi = mapBlockIndex.find(hashBlock);
-    if (mi == mapBlockIndex.end() || mi->second == nullptr) {
-        collateralBlockIndex = nullptr;
-        return collateralBlockIndex;
-    }
+    if (mi == mapBlockIndex.end() || mi->second == nullptr || !chainActive.Contains(mi->second))
+        return CollateralHeightIndex::UNCONFIRMED;
+
+    return mi->second->nHeight;
+}
 
-    if (!chainActive.Contains(mi->second)) {
-        collateralBlockIndex = nullptr;
-        return collateralBlockIndex;
+const CBlockIndex* ComputeCollateralBlockIndex(const CMasternode& masternode)
+{
+    AssertLockHeld(cs_main);
+
+    int confirmationHeight;
+    if (!collateralHeightIndex.lookup(masternode.vin.prevout, confirmationHeight)) {
+        confirmationHeight = LookupCollateralConfirmationHeight(masternode.vin.prevout);
+        collateralHeightIndex.record(masternode.vin.prevout, confirmationHeight);
     }
-    collateralBlockIndex = mi->second;
-    return collateralBlockIndex;
+
+    if (confirmationHeight == CollateralHeightIndex::UNCONFIRMED)
+        return nullptr;
+    return chainActive[confirmationHeight];
+}
+
+void UpdateCollateralHeightsForConnectedBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+    collateralHeightIndex.blockConnected(block, pindex->nHeight);
+}
+
+void UpdateCollateralHeightsForDisconnectedBlock(const CBlock& block)
+{
+    AssertLockHeld(cs_main);
+    collateralHeightIndex.blockDisconnected(block);
 }
 
 const CBlockIndex* ComputeMasternodeConfirmationBlockIndex(const CMasternode& masternode)
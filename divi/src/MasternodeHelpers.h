@@ -2,6 +2,7 @@
 #define MASTERNODE_HELPERS_H
 #include <stdint.h>
 class uint256;
+class CBlock;
 class CBlockIndex;
 class CMasternode;
 class CMasternodePing;
@@ -27,7 +28,11 @@ bool GetBlockHashForScoring(uint256& hash, int nBlockHeight);
 bool GetBlockHashForScoring(uint256& hash,
                             const CBlockIndex* pindex, const int offset);
 
+/** Requires cs_main. Collateral confirmation heights are cached and kept in
+ *  step with the active chain through the two functions below.  */
 const CBlockIndex* ComputeCollateralBlockIndex(const CMasternode& masternode);
+void UpdateCollateralHeightsForConnectedBlock(const CBlock& block, const CBlockIndex* pindex);
+void UpdateCollateralHeightsForDisconnectedBlock(const CBlock& block);
 const CBlockIndex* ComputeMasternodeConfirmationBlockIndex(const CMasternode& masternode);
 int ComputeMasternodeInputAge(const CMasternode& masternode);
 CMasternodePing createCurrentPing(const CTxIn& newVin);
@@ -282,7 +282,7 @@ void ForceMasternodeResync()
 bool ShareMasternodePingWithPeer(CNode* peer,const uint256& inventoryHash)
 {
     static const MasternodeNetworkMessageManager& networkMessageManager = mnModule.getNetworkMessageManager();
-    const CMasternodePing& ping = networkMessageManager.getKnownPing(inventoryHash);
+    const CMasternodePing ping = networkMessageManager.getKnownPing(inventoryHash);
     if (ping.GetHash() == inventoryHash)
     {
         peer->PushMessage("mnp", ping);
@@ -294,7 +294,7 @@ bool ShareMasternodePingWithPeer(CNode* peer,const uint256& inventoryHash)
 bool ShareMasternodeBroadcastWithPeer(CNode* peer,const uint256& inventoryHash)
 {
     static const MasternodeNetworkMessageManager& networkMessageManager = mnModule.getNetworkMessageManager();
-    const CMasternodeBroadcast& broadcast = networkMessageManager.getKnownBroadcast(inventoryHash);
+    const CMasternodeBroadcast broadcast = networkMessageManager.getKnownBroadcast(inventoryHash);
     if (broadcast.GetHash() == inventoryHash)
     {
         peer->PushMessage("mnb", broadcast);
@@ -306,9 +306,9 @@ bool ShareMasternodeBroadcastWithPeer(CNode* peer,const uint256& inventoryHash)
 bool ShareMasternodeWinnerWithPeer(CNode* peer,const uint256& inventoryHash)
 {
     static const MasternodePaymentData& paymentData = mnModule.getMasternodePaymentData();
-    const auto* winner = paymentData.getPaymentWinnerForHash(inventoryHash);
-    if (winner != nullptr) {
-        peer->PushMessage("mnw", *winner);
+    CMasternodePaymentWinner winner;
+    if (paymentData.getKnownWinner(inventoryHash, winner)) {
+        peer->PushMessage("mnw", winner);
         return true;
     }
     return false;
@@ -335,7 +335,7 @@ bool MasternodeWinnerIsKnown(const uint256& inventoryHash)
 {
     static const MasternodePaymentData& paymentData = mnModule.getMasternodePaymentData();
     static CMasternodeSync& masternodeSync = mnModule.getMasternodeSynchronization();
-    if (paymentData.getPaymentWinnerForHash(inventoryHash) != nullptr)
+    if (paymentData.winnerIsKnown(inventoryHash))
     {
         masternodeSync.RecordMasternodeWinnerUpdate(inventoryHash);
         return true;
@@ -356,6 +356,20 @@ void ProcessMasternodeMessages(CNode* pfrom, std::string strCommand, CDataStream
     }
 }
 
+bool PrecheckMasternodeMessage(CNode* pfrom, const std::string& strCommand, const CDataStream& vRecv)
+{
+    static CMasternodeMan& mnodeman = mnModule.getMasternodeManager();
+    if(strCommand != "mnp" || fLiteMode || !IsBlockchainSynced()) return true;
+
+    CDataStream pingStream(vRecv);
+    CMasternodePing mnp;
+    pingStream >> mnp;
+    int nDoS = 0;
+    if(mnodeman.PrecheckPing(mnp, nDoS)) return true;
+    if(nDoS > 0) Misbehaving(pfrom->GetNodeState(), nDoS);
+    return false;
+}
+
 bool VoteForMasternodePayee(const CBlockIndex* pindex)
 {
     static CMasternodeSync& masternodeSync = mnModule.getMasternodeSynchronization();
@@ -72,6 +72,7 @@ const MasternodeModule& GetMasternodeModule();
 // Used in main to manage signals back and forth
 bool VoteForMasternodePayee(const CBlockIndex* pindex);
 void ProcessMasternodeMessages(CNode* pfrom, std::string strCommand, CDataStream& vRecv);
+bool PrecheckMasternodeMessage(CNode* pfrom, const std::string& strCommand, const CDataStream& vRecv);
 bool MasternodeWinnerIsKnown(const uint256& inventoryHash);
 bool MasternodeIsKnown(const uint256& inventoryHash);
 bool MasternodePingIsKnown(const uint256& inventoryHash);
@@ -261,32 +261,30 @@ void MasternodeNetworkMessageManager::recordBroadcast(const CMasternodeBroadcast
     if(broadcastIsKnown(hash)) return;
     mapSeenMasternodeBroadcast.emplace(hash,mnb);
 }
-const CMasternodeBroadcast& MasternodeNetworkMessageManager::getKnownBroadcast(const uint256& broadcastHash) const
+CMasternodeBroadcast MasternodeNetworkMessageManager::getKnownBroadcast(const uint256& broadcastHash) const
 {
     LOCK(cs_process_message);
-    static CMasternodeBroadcast dummyBroadcast;
     std::map<uint256, CMasternodeBroadcast>::const_iterator it = mapSeenMasternodeBroadcast.find(broadcastHash);
     if(it != mapSeenMasternodeBroadcast.end())
     {
-        return mapSeenMasternodeBroadcast.find(broadcastHash)->second;
+        return it->second;
     }
     else
     {
-        return dummyBroadcast;
+        return CMasternodeBroadcast();
     }
 }
-const CMasternodePing& MasternodeNetworkMessageManager::getKnownPing(const uint256& pingHash) const
+CMasternodePing MasternodeNetworkMessageManager::getKnownPing(const uint256& pingHash) const
 {
     LOCK(cs_process_message);
-    static CMasternodePing dummyPing;
     std::map<uint256, CMasternodePing>::const_iterator it = mapSeenMasternodePing.find(pingHash);
     if(it != mapSeenMasternodePing.end())
     {
-        return mapSeenMasternodePing.find(pingHash)->second;
+        return it->second;
     }
     else
     {
-        return dummyPing;
+        return CMasternodePing();
     }
 }
 const CMasternode* MasternodeNetworkMessageManager::find(const CTxIn& vin) const
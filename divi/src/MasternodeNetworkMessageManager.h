@@ -59,8 +59,8 @@ public:
     bool pingIsKnown(const uint256& pingHash) const;
     void recordLastPing(const CMasternode& mn);
     void recordBroadcast(const CMasternodeBroadcast& mnb);
-    const CMasternodeBroadcast& getKnownBroadcast(const uint256& broadcastHash) const;
-    const CMasternodePing& getKnownPing(const uint256& pingHash) const;
+    CMasternodeBroadcast getKnownBroadcast(const uint256& broadcastHash) const;
+    CMasternodePing getKnownPing(const uint256& pingHash) const;
     const CMasternode* find(const CTxIn& vin) const;
 
     ADD_SERIALIZE_METHODS
@@ -41,10 +41,14 @@ bool MasternodePaymentData::recordWinner(const CMasternodePaymentWinner& mnw)
     payees->CountVote(mnw.vinMasternode.prevout, mnw.payee);
     return true;
 }
-const CMasternodePaymentWinner& MasternodePaymentData::getKnownWinner(const uint256& winnerHash) const
+bool MasternodePaymentData::getKnownWinner(const uint256& winnerHash, CMasternodePaymentWinner& winner) const
 {
     LOCK(cs_mapMasternodePayeeVotes);
-    return mapMasternodePayeeVotes.find(winnerHash)->second;
+    const auto mit = mapMasternodePayeeVotes.find(winnerHash);
+    if (mit == mapMasternodePayeeVotes.end())
+        return false;
+    winner = mit->second;
+    return true;
 }
 void MasternodePaymentData::pruneOutdatedMasternodeWinners(const int currentChainHeight)
 {
@@ -85,19 +89,6 @@ std::string MasternodePaymentData::ToString() const
     return info.str();
 }
 
-/** Retrieves the payment winner for the given hash.  Returns null
- *  if there is no entry for that hash.  */
-const CMasternodePaymentWinner* MasternodePaymentData::getPaymentWinnerForHash(const uint256& hash) const
-{
-    return const_cast<MasternodePaymentData*>(this)->getPaymentWinnerForHash(hash);
-}
-CMasternodePaymentWinner* MasternodePaymentData::getPaymentWinnerForHash(const uint256& hash)
-{
-    const auto mit = mapMasternodePayeeVotes.find(hash);
-    if (mit == mapMasternodePayeeVotes.end())
-        return nullptr;
-    return &mit->second;
-}
 bool MasternodePaymentData::canVote(const COutPoint& outMasternode, const uint256& scoringBlockHash)
 {
     LOCK(cs_mapMasternodePayeeVotes);
@@ -21,12 +21,11 @@ public:
 
     bool winnerIsKnown(const uint256& winnerHash) const;
     bool recordWinner(const CMasternodePaymentWinner& mnw);
-    const CMasternodePaymentWinner& getKnownWinner(const uint256& winnerHash) const;
+    /** Copies the winner with the given hash; fails if it is unknown.  */
+    bool getKnownWinner(const uint256& winnerHash, CMasternodePaymentWinner& winner) const;
     void pruneOutdatedMasternodeWinners(const int currentChainHeight);
     const CMasternodeBlockPayees* getPayeesForScoreHash(const uint256& hash) const;
     CMasternodeBlockPayees* getPayeesForScoreHash(const uint256& hash);
-    const CMasternodePaymentWinner* getPaymentWinnerForHash(const uint256& hash) const;
-    CMasternodePaymentWinner* getPaymentWinnerForHash(const uint256& hash);
     bool canVote(const COutPoint& outMasternode, const uint256& scoringBlockHash);
 
     void CheckAndRemove(){}
@@ -0,0 +1,226 @@
+#include <MasternodeScoringEngine.h>
+
+#include <algorithm>
+#include <cassert>
+
+#include <checkqueue.h>
+#include <hash.h>
+#include <masternode.h>
+#include <version.h>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+namespace
+{
+/** Below this many masternodes per thread, handing them to the pool costs more than it saves. */
+constexpr size_t MINIMUM_CANDIDATES_PER_THREAD = 64;
+/** Number of masternodes a pool thread scores before it looks for more work. */
+constexpr unsigned SCORING_BATCH_SIZE = 16;
+
+bool IsLowerCollateral(const MasternodeScoreTable::ScoredCollateral& a, const MasternodeScoreTable::ScoredCollateral& b)
+{
+    return a.second < b.second;
+}
+
+/** Scores one masternode on a pool thread. */
+class MasternodeScoringCheck
+{
+private:
+    const CHashWriter* scoringBlockHasher_;
+    const MasternodeScoringEngine::Candidate* candidate_;
+    MasternodeScoreTable::ScoredCollateral* score_;
+
+public:
+    MasternodeScoringCheck(
+        ): scoringBlockHasher_(nullptr)
+        , candidate_(nullptr)
+        , score_(nullptr)
+    {
+    }
+    MasternodeScoringCheck(
+        const CHashWriter& scoringBlockHasher,
+        const MasternodeScoringEngine::Candidate& candidate,
+        MasternodeScoreTable::ScoredCollateral& score
+        ): scoringBlockHasher_(&scoringBlockHasher)
+        , candidate_(&candidate)
+        , score_(&score)
+    {
+    }
+    bool operator()()
+    {
+        *score_ = std::make_pair(
+            CMasternode::CalculateScore(*scoringBlockHasher_, candidate_->first, candidate_->second),
+            candidate_->first);
+        return true;
+    }
+    void swap(MasternodeScoringCheck& check)
+    {
+        std::swap(scoringBlockHasher_, check.scoringBlockHasher_);
+        std::swap(candidate_, check.candidate_);
+        std::swap(score_, check.score_);
+    }
+};
+}
+
+/** Worker threads that live as long as the engine, so that scoring a new
+ *  block does not pay for starting threads.  The calling thread joins them
+ *  while it waits.  */
+class MasternodeScoringPool
+{
+private:
+    CCheckQueue<MasternodeScoringCheck> queue_;
+    boost::thread_group workers_;
+
+public:
+    explicit MasternodeScoringPool(
+        unsigned numberOfThreads
+        ): queue_(SCORING_BATCH_SIZE, numberOfThreads)
+        , workers_()
+    {
+        for(unsigned threadIndex = 1; threadIndex < numberOfThreads; ++threadIndex)
+            workers_.create_thread(boost::bind(&CCheckQueue<MasternodeScoringCheck>::Thread, &queue_));
+    }
+    ~MasternodeScoringPool()
+    {
+        workers_.interrupt_all();
+        workers_.join_all();
+    }
+    void run(std::vector<MasternodeScoringCheck>& checks)
+    {
+        CCheckQueueControl<MasternodeScoringCheck> control(&queue_);
+        control.Add(checks);
+        control.Wait();
+    }
+};
+
+MasternodeScoreTable::MasternodeScoreTable(
+    ): scores_()
+{
+}
+
+void MasternodeScoreTable::insert(std::vector<ScoredCollateral> scores)
+{
+    std::sort(scores.begin(), scores.end(), IsLowerCollateral);
+    const size_t numberOfExistingScores = scores_.size();
+    scores_.insert(scores_.end(), scores.begin(), scores.end());
+    std::inplace_merge(scores_.begin(), scores_.begin() + numberOfExistingScores, scores_.end(), IsLowerCollateral);
+}
+
+bool MasternodeScoreTable::contains(const COutPoint& collateral) const
+{
+    const ScoredCollateral key(uint256(), collateral);
+    return std::binary_search(scores_.begin(), scores_.end(), key, IsLowerCollateral);
+}
+
+const uint256& MasternodeScoreTable::scoreOf(const COutPoint& collateral) const
+{
+    const ScoredCollateral key(uint256(), collateral);
+    const auto it = std::lower_bound(scores_.begin(), scores_.end(), key, IsLowerCollateral);
+    assert(it != scores_.end() && it->second == collateral);
+    return it->first;
+}
+
+size_t MasternodeScoreTable::size() const
+{
+    return scores_.size();
+}
+
+MasternodeScoringEngine::MasternodeScoringEngine(
+    unsigned maximumNumberOfTables,
+    unsigned maximumNumberOfThreads
+    ): cs_()
+    , maximumNumberOfTables_(std::max(1u, maximumNumberOfTables))
+    , maximumNumberOfThreads_(std::max(1u, maximumNumberOfThreads))
+    , recentlyUsedTables_()
+    , tablesByScoringHash_()
+    , scoringPool_(maximumNumberOfThreads_ > 1u? new MasternodeScoringPool(maximumNumberOfThreads_): nullptr)
+{
+}
+
+MasternodeScoringEngine::~MasternodeScoringEngine()
+{
+}
+
+std::vector<MasternodeScoreTable::ScoredCollateral> MasternodeScoringEngine::computeScores(
+    const uint256& scoringBlockHash,
+    const std::vector<Candidate>& candidates) const
+{
+    CHashWriter scoringBlockHasher(SER_GETHASH, PROTOCOL_VERSION);
+    scoringBlockHasher << scoringBlockHash;
+
+    std::vector<MasternodeScoreTable::ScoredCollateral> scores(candidates.size());
+    std::vector<MasternodeScoringCheck> checks;
+    checks.reserve(candidates.size());
+    for(size_t index = 0; index < candidates.size(); ++index)
+    {
+        checks.emplace_back(scoringBlockHasher, candidates[index], scores[index]);
+    }
+
+    // Callers hold cs_, so the pool is only ever used by one of them at a time.
+    if(!scoringPool_ || candidates.size() < 2u * MINIMUM_CANDIDATES_PER_THREAD)
+    {
+        for(MasternodeScoringCheck& check: checks)
+            check();
+    }
+    else
+    {
+        scoringPool_->run(checks);
+    }
+    return scores;
+}
+
+MasternodeScoringEngine::ScoreTablePtr MasternodeScoringEngine::getScores(
+    const uint256& scoringBlockHash,
+    const std::vector<Candidate>& candidates)
+{
+    LOCK(cs_);
+    ScoreTablePtr table;
+    const auto it = tablesByScoringHash_.find(scoringBlockHash);
+    if(it != tablesByScoringHash_.end())
+    {
+        table = it->second->second;
+        recentlyUsedTables_.splice(recentlyUsedTables_.begin(), recentlyUsedTables_, it->second);
+    }
+
+    std::vector<Candidate> unscoredCandidates;
+    for(const Candidate& candidate: candidates)
+    {
+        if(!table || !table->contains(candidate.first)) unscoredCandidates.push_back(candidate);
+    }
+    if(table && unscoredCandidates.empty()) return table;
+
+    // Tables may still be read by earlier callers, so extend a copy.
+    std::shared_ptr<MasternodeScoreTable> updatedTable =
+        table? std::make_shared<MasternodeScoreTable>(*table) : std::make_shared<MasternodeScoreTable>();
+    updatedTable->insert(computeScores(scoringBlockHash, unscoredCandidates));
+
+    if(it != tablesByScoringHash_.end())
+    {
+        it->second->second = updatedTable;
+    }
+    else
+    {
+        recentlyUsedTables_.emplace_front(scoringBlockHash, updatedTable);
+        tablesByScoringHash_[scoringBlockHash] = recentlyUsedTables_.begin();
+        if(recentlyUsedTables_.size() > maximumNumberOfTables_)
+        {
+            tablesByScoringHash_.erase(recentlyUsedTables_.back().first);
+            recentlyUsedTables_.pop_back();
+        }
+    }
+    return updatedTable;
+}
+
+void MasternodeScoringEngine::clear()
+{
+    LOCK(cs_);
+    recentlyUsedTables_.clear();
+    tablesByScoringHash_.clear();
+}
+
+size_t MasternodeScoringEngine::size() const
+{
+    LOCK(cs_);
+    return recentlyUsedTables_.size();
+}
@@ -0,0 +1,72 @@
+#ifndef MASTERNODE_SCORING_ENGINE_H
+#define MASTERNODE_SCORING_ENGINE_H
+
+#include <list>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <masternode-tier.h>
+#include <primitives/transaction.h>
+#include <sync.h>
+#include <uint256.h>
+
+/** Scores of all masternodes known for one scoring block hash. */
+class MasternodeScoreTable
+{
+public:
+    typedef std::pair<uint256, COutPoint> ScoredCollateral;
+
+private:
+    /** Scored collaterals, ordered by collateral for lookups. */
+    std::vector<ScoredCollateral> scores_;
+
+public:
+    MasternodeScoreTable();
+
+    /** Merges in freshly computed scores of collaterals not in the table yet. */
+    void insert(std::vector<ScoredCollateral> scores);
+    bool contains(const COutPoint& collateral) const;
+    /** Score of a collateral the table contains. */
+    const uint256& scoreOf(const COutPoint& collateral) const;
+    size_t size() const;
+};
+
+class MasternodeScoringPool;
+
+/** Computes masternode scores for a scoring block hash once, spreading the
+ *  hashing across a pool of threads that lives as long as the engine, and
+ *  keeps the tables of the most recently used scoring hashes.  Later requests
+ *  for the same hash only score masternodes that were not part of the table
+ *  yet.  */
+class MasternodeScoringEngine
+{
+public:
+    typedef std::pair<COutPoint, MasternodeTier> Candidate;
+    typedef std::shared_ptr<const MasternodeScoreTable> ScoreTablePtr;
+
+private:
+    typedef std::list<std::pair<uint256, ScoreTablePtr>> RecentlyUsedTables;
+
+    mutable CCriticalSection cs_;
+    const unsigned maximumNumberOfTables_;
+    const unsigned maximumNumberOfThreads_;
+    RecentlyUsedTables recentlyUsedTables_;
+    std::map<uint256, RecentlyUsedTables::iterator> tablesByScoringHash_;
+    std::unique_ptr<MasternodeScoringPool> scoringPool_;
+
+    std::vector<MasternodeScoreTable::ScoredCollateral> computeScores(
+        const uint256& scoringBlockHash,
+        const std::vector<Candidate>& candidates) const;
+
+public:
+    MasternodeScoringEngine(unsigned maximumNumberOfTables, unsigned maximumNumberOfThreads);
+    ~MasternodeScoringEngine();
+
+    /** Returns the score table for the given hash, covering at least all
+     *  of the given candidates.  */
+    ScoreTablePtr getScores(const uint256& scoringBlockHash, const std::vector<Candidate>& candidates);
+    void clear();
+    size_t size() const;
+};
+#endif// MASTERNODE_SCORING_ENGINE_H
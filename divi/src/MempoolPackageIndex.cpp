@@ -0,0 +1,319 @@
+#include <MempoolPackageIndex.h>
+
+#include <MemPoolEntry.h>
+
+#include <deque>
+
+MempoolPackage::MempoolPackage(
+    const CTxMemPoolEntry& mempoolEntry,
+    CAmount feeDelta
+    ): entry(&mempoolEntry)
+    , fee(mempoolEntry.GetFee() + feeDelta)
+    , size(mempoolEntry.GetTxSize())
+    , parents()
+    , children()
+    , ancestorFees(fee)
+    , ancestorSize(size)
+    , ancestorCount(1u)
+    , descendantFees(fee)
+    , descendantSize(size)
+    , descendantCount(1u)
+{
+}
+
+CAmount MempoolPackage::ancestorFeePerK() const
+{
+    return ancestorSize > 0u? ancestorFees * 1000 / static_cast<CAmount>(ancestorSize) : 0;
+}
+
+CAmount MempoolPackage::descendantFeePerK() const
+{
+    return descendantSize > 0u? descendantFees * 1000 / static_cast<CAmount>(descendantSize) : 0;
+}
+
+MempoolPackageIndex::MempoolPackageIndex(
+    ): packages_()
+    , readyTransactions_()
+    , byAncestorFeeRate_()
+    , byDescendantFeeRate_()
+{
+}
+
+void MempoolPackageIndex::collectAncestors(const uint256& txHash, std::set<uint256>& ancestors) const
+{
+    std::deque<uint256> toVisit(1u, txHash);
+    while(!toVisit.empty())
+    {
+        const MempoolPackage& package = packages_.find(toVisit.front())->second;
+        toVisit.pop_front();
+        for(const uint256& parentHash: package.parents)
+        {
+            if(ancestors.insert(parentHash).second) toVisit.push_back(parentHash);
+        }
+    }
+}
+
+void MempoolPackageIndex::collectDescendants(const uint256& txHash, std::set<uint256>& descendants) const
+{
+    std::deque<uint256> toVisit(1u, txHash);
+    while(!toVisit.empty())
+    {
+        const MempoolPackage& package = packages_.find(toVisit.front())->second;
+        toVisit.pop_front();
+        for(const uint256& childHash: package.children)
+        {
+            if(descendants.insert(childHash).second) toVisit.push_back(childHash);
+        }
+    }
+}
+
+void MempoolPackageIndex::addToAncestorState(const uint256& txHash, CAmount fees, int64_t size, int count)
+{
+    MempoolPackage& package = packages_.find(txHash)->second;
+    byAncestorFeeRate_.erase(std::make_pair(package.ancestorFeePerK(), txHash));
+    package.ancestorFees += fees;
+    package.ancestorSize += size;
+    package.ancestorCount += count;
+    byAncestorFeeRate_.insert(std::make_pair(package.ancestorFeePerK(), txHash));
+}
+
+void MempoolPackageIndex::addToDescendantState(const uint256& txHash, CAmount fees, int64_t size, int count)
+{
+    MempoolPackage& package = packages_.find(txHash)->second;
+    byDescendantFeeRate_.erase(std::make_pair(package.descendantFeePerK(), txHash));
+    package.descendantFees += fees;
+    package.descendantSize += size;
+    package.descendantCount += count;
+    byDescendantFeeRate_.insert(std::make_pair(package.descendantFeePerK(), txHash));
+}
+
+void MempoolPackageIndex::addTransaction(
+    const uint256& txHash,
+    const CTxMemPoolEntry& entry,
+    CAmount feeDelta,
+    const std::vector<uint256>& spendingTransactions)
+{
+    MempoolPackage& package = packages_.emplace(txHash, MempoolPackage(entry, feeDelta)).first->second;
+    for(const CTxIn& txin: entry.GetTx().vin)
+    {
+        auto parent = packages_.find(txin.prevout.hash);
+        if(parent == packages_.end()) continue;
+        package.parents.insert(parent->first);
+        parent->second.children.insert(txHash);
+    }
+    if(package.parents.empty()) readyTransactions_.insert(txHash);
+    byAncestorFeeRate_.insert(std::make_pair(package.ancestorFeePerK(), txHash));
+    byDescendantFeeRate_.insert(std::make_pair(package.descendantFeePerK(), txHash));
+
+    std::set<uint256> ancestors;
+    collectAncestors(txHash, ancestors);
+    for(const uint256& ancestorHash: ancestors)
+    {
+        const MempoolPackage& ancestor = packages_.find(ancestorHash)->second;
+        addToAncestorState(txHash, ancestor.fee, ancestor.size, 1);
+        addToDescendantState(ancestorHash, package.fee, package.size, 1);
+    }
+
+    // Entries already spending this one only show up when a block is
+    // disconnected. Their own ancestors have to be known before linking so
+    // that ancestors they already shared with this entry are not counted
+    // twice.
+    std::set<uint256> descendants;
+    for(const uint256& childHash: spendingTransactions)
+    {
+        if(packages_.count(childHash) && descendants.insert(childHash).second)
+        {
+            collectDescendants(childHash, descendants);
+        }
+    }
+    std::map<uint256, std::set<uint256> > previousAncestors;
+    if(!ancestors.empty())
+    {
+        for(const uint256& descendantHash: descendants)
+        {
+            collectAncestors(descendantHash, previousAncestors[descendantHash]);
+        }
+    }
+    for(const uint256& childHash: spendingTransactions)
+    {
+        auto child = packages_.find(childHash);
+        if(child == packages_.end()) continue;
+        package.children.insert(childHash);
+        child->second.parents.insert(txHash);
+        readyTransactions_.erase(childHash);
+    }
+    for(const uint256& descendantHash: descendants)
+    {
+        const MempoolPackage& descendant = packages_.find(descendantHash)->second;
+        addToAncestorState(descendantHash, package.fee, package.size, 1);
+        addToDescendantState(txHash, descendant.fee, descendant.size, 1);
+        if(ancestors.empty()) continue;
+        const std::set<uint256>& alreadyCounted = previousAncestors[descendantHash];
+        for(const uint256& ancestorHash: ancestors)
+        {
+            if(alreadyCounted.count(ancestorHash)) continue;
+            const MempoolPackage& ancestor = packages_.find(ancestorHash)->second;
+            addToAncestorState(descendantHash, ancestor.fee, ancestor.size, 1);
+            addToDescendantState(ancestorHash, descendant.fee, descendant.size, 1);
+        }
+    }
+}
+
+void MempoolPackageIndex::removeTransaction(const uint256& txHash)
+{
+    auto it = packages_.find(txHash);
+    if(it == packages_.end()) return;
+
+    const MempoolPackage& package = it->second;
+    std::set<uint256> ancestors;
+    collectAncestors(txHash, ancestors);
+    std::set<uint256> descendants;
+    collectDescendants(txHash, descendants);
+    for(const uint256& descendantHash: descendants)
+    {
+        addToAncestorState(descendantHash, -package.fee, -static_cast<int64_t>(package.size), -1);
+    }
+    for(const uint256& ancestorHash: ancestors)
+    {
+        addToDescendantState(ancestorHash, -package.fee, -static_cast<int64_t>(package.size), -1);
+    }
+
+    byAncestorFeeRate_.erase(std::make_pair(package.ancestorFeePerK(), txHash));
+    byDescendantFeeRate_.erase(std::make_pair(package.descendantFeePerK(), txHash));
+    for(const uint256& parentHash: package.parents)
+    {
+        packages_.find(parentHash)->second.children.erase(txHash);
+    }
+    for(const uint256& childHash: package.children)
+    {
+        MempoolPackage& child = packages_.find(childHash)->second;
+        child.parents.erase(txHash);
+        if(child.parents.empty()) readyTransactions_.insert(childHash);
+    }
+    readyTransactions_.erase(txHash);
+    packages_.erase(it);
+
+    // Only an entry removed from the middle of a chain can cut descendants
+    // off from ancestors they reached through it alone.
+    if(!ancestors.empty())
+    {
+        for(const uint256& descendantHash: descendants)
+        {
+            const MempoolPackage& descendant = packages_.find(descendantHash)->second;
+            std::set<uint256> remainingAncestors;
+            collectAncestors(descendantHash, remainingAncestors);
+            for(const uint256& ancestorHash: ancestors)
+            {
+                if(remainingAncestors.count(ancestorHash)) continue;
+                const MempoolPackage& ancestor = packages_.find(ancestorHash)->second;
+                addToAncestorState(descendantHash, -ancestor.fee, -static_cast<int64_t>(ancestor.size), -1);
+                addToDescendantState(ancestorHash, -descendant.fee, -static_cast<int64_t>(descendant.size), -1);
+            }
+        }
+    }
+}
+
+void MempoolPackageIndex::removeTransactionsWithDescendants(const std::set<uint256>& txHashes)
+{
+    // Nothing outside of the set spends an entry in it, so only the
+    // descendant totals of ancestors outside of it change. Each of those is
+    // walked once however many of the removed entries it leads to.
+    std::set<uint256> outsideAncestors;
+    for(const uint256& txHash: txHashes)
+    {
+        auto it = packages_.find(txHash);
+        if(it == packages_.end()) continue;
+        for(const uint256& parentHash: it->second.parents)
+        {
+            if(txHashes.count(parentHash) || !outsideAncestors.insert(parentHash).second) continue;
+            collectAncestors(parentHash, outsideAncestors);
+        }
+    }
+    for(const uint256& ancestorHash: outsideAncestors)
+    {
+        std::set<uint256> descendants;
+        collectDescendants(ancestorHash, descendants);
+        for(const uint256& descendantHash: descendants)
+        {
+            if(!txHashes.count(descendantHash)) continue;
+            const MempoolPackage& descendant = packages_.find(descendantHash)->second;
+            addToDescendantState(ancestorHash, -descendant.fee, -static_cast<int64_t>(descendant.size), -1);
+        }
+    }
+
+    for(const uint256& txHash: txHashes)
+    {
+        auto it = packages_.find(txHash);
+        if(it == packages_.end()) continue;
+        const MempoolPackage& package = it->second;
+        byAncestorFeeRate_.erase(std::make_pair(package.ancestorFeePerK(), txHash));
+        byDescendantFeeRate_.erase(std::make_pair(package.descendantFeePerK(), txHash));
+        for(const uint256& parentHash: package.parents)
+        {
+            if(!txHashes.count(parentHash)) packages_.find(parentHash)->second.children.erase(txHash);
+        }
+        readyTransactions_.erase(txHash);
+        packages_.erase(it);
+    }
+}
+
+void MempoolPackageIndex::updateFeeDelta(const uint256& txHash, CAmount feeDelta)
+{
+    auto it = packages_.find(txHash);
+    if(it == packages_.end()) return;
+
+    MempoolPackage& package = it->second;
+    const CAmount feeChange = package.entry->GetFee() + feeDelta - package.fee;
+    if(feeChange == 0) return;
+    package.fee += feeChange;
+
+    std::set<uint256> descendants;
+    collectDescendants(txHash, descendants);
+    addToAncestorState(txHash, feeChange, 0, 0);
+    for(const uint256& descendantHash: descendants)
+    {
+        addToAncestorState(descendantHash, feeChange, 0, 0);
+    }
+
+    std::set<uint256> ancestors;
+    collectAncestors(txHash, ancestors);
+    addToDescendantState(txHash, feeChange, 0, 0);
+    for(const uint256& ancestorHash: ancestors)
+    {
+        addToDescendantState(ancestorHash, feeChange, 0, 0);
+    }
+}
+
+void MempoolPackageIndex::clear()
+{
+    packages_.clear();
+    readyTransactions_.clear();
+    byAncestorFeeRate_.clear();
+    byDescendantFeeRate_.clear();
+}
+
+const MempoolPackage* MempoolPackageIndex::find(const uint256& txHash) const
+{
+    auto it = packages_.find(txHash);
+    return it != packages_.end()? &it->second : nullptr;
+}
+
+const std::map<uint256, MempoolPackage>& MempoolPackageIndex::packages() const
+{
+    return packages_;
+}
+
+const std::set<uint256>& MempoolPackageIndex::readyTransactions() const
+{
+    return readyTransactions_;
+}
+
+const std::set<std::pair<CAmount, uint256> >& MempoolPackageIndex::byAncestorFeeRate() const
+{
+    return byAncestorFeeRate_;
+}
+
+const uint256* MempoolPackageIndex::lowestDescendantFeeRateTransaction() const
+{
+    return byDescendantFeeRate_.empty()? nullptr : &byDescendantFeeRate_.begin()->second;
+}
@@ -0,0 +1,88 @@
+#ifndef MEMPOOL_PACKAGE_INDEX_H
+#define MEMPOOL_PACKAGE_INDEX_H
+
+#include <amount.h>
+#include <uint256.h>
+
+#include <map>
+#include <set>
+#include <stdint.h>
+#include <vector>
+
+class CTxMemPoolEntry;
+
+/** A mempool transaction together with its links to other mempool
+ *  transactions and running totals over its in-mempool ancestors and
+ *  descendants (the transaction itself included in both). */
+struct MempoolPackage
+{
+    const CTxMemPoolEntry* entry;
+    /** Fee of the entry including its prioritisetransaction delta. */
+    CAmount fee;
+    uint64_t size;
+    std::set<uint256> parents;
+    std::set<uint256> children;
+    CAmount ancestorFees;
+    uint64_t ancestorSize;
+    unsigned ancestorCount;
+    CAmount descendantFees;
+    uint64_t descendantSize;
+    unsigned descendantCount;
+
+    MempoolPackage(const CTxMemPoolEntry& mempoolEntry, CAmount feeDelta);
+    /** Fee rate of the transaction together with everything it spends. */
+    CAmount ancestorFeePerK() const;
+    /** Fee rate of the transaction together with everything spending it. */
+    CAmount descendantFeePerK() const;
+};
+
+/** Dependency graph over the memory pool, kept current as transactions are
+ *  added and removed so block assembly does not need to rediscover which
+ *  transactions wait on others through coin lookups. Ancestor and descendant
+ *  totals are adjusted by the entries that join or leave a package instead
+ *  of being summed up again, so an update costs one walk over the entries
+ *  affected. */
+class MempoolPackageIndex
+{
+private:
+    std::map<uint256, MempoolPackage> packages_;
+    std::set<uint256> readyTransactions_;
+    std::set<std::pair<CAmount, uint256> > byAncestorFeeRate_;
+    std::set<std::pair<CAmount, uint256> > byDescendantFeeRate_;
+
+    void addToAncestorState(const uint256& txHash, CAmount fees, int64_t size, int count);
+    void addToDescendantState(const uint256& txHash, CAmount fees, int64_t size, int count);
+
+public:
+    MempoolPackageIndex();
+
+    /** Links a new entry to its in-mempool parents and to any in-mempool
+     *  transactions spending it, e.g. when a block is disconnected. */
+    void addTransaction(
+        const uint256& txHash,
+        const CTxMemPoolEntry& entry,
+        CAmount feeDelta,
+        const std::vector<uint256>& spendingTransactions);
+    void removeTransaction(const uint256& txHash);
+    /** Removes entries that together include every in-mempool descendant of
+     *  each of them, as recursive removal and eviction do. */
+    void removeTransactionsWithDescendants(const std::set<uint256>& txHashes);
+    /** Replaces the prioritisetransaction delta counted into the entry's fee. */
+    void updateFeeDelta(const uint256& txHash, CAmount feeDelta);
+    void clear();
+
+    void collectAncestors(const uint256& txHash, std::set<uint256>& ancestors) const;
+    void collectDescendants(const uint256& txHash, std::set<uint256>& descendants) const;
+
+    const MempoolPackage* find(const uint256& txHash) const;
+    const std::map<uint256, MempoolPackage>& packages() const;
+    /** Transactions without unconfirmed parents, i.e. mineable on their own. */
+    const std::set<uint256>& readyTransactions() const;
+    /** All entries ordered by the fee rate of the package formed with their
+     *  ancestors, the order in which block assembly takes packages. */
+    const std::set<std::pair<CAmount, uint256> >& byAncestorFeeRate() const;
+    /** The transaction whose descendant package pays the lowest fee rate,
+     *  i.e. the first to evict when the pool is full. Null if empty. */
+    const uint256* lowestDescendantFeeRateTransaction() const;
+};
+#endif// MEMPOOL_PACKAGE_INDEX_H
@@ -0,0 +1,84 @@
+#include <MessageLatencyHistograms.h>
+
+#include <algorithm>
+
+constexpr unsigned LatencyHistogram::NUMBER_OF_BUCKETS;
+constexpr unsigned MessageLatencyHistograms::MAXIMUM_NUMBER_OF_COMMANDS;
+const char* const MessageLatencyHistograms::OTHER_COMMANDS = "other";
+
+LatencyHistogram::LatencyHistogram(
+    ): counts()
+    , numberOfSamples(0)
+    , totalMicros(0)
+    , maximumMicros(0)
+{
+}
+
+unsigned LatencyHistogram::bucketIndex(int64_t micros)
+{
+    unsigned bucket = 0;
+    while(bucket + 1 < NUMBER_OF_BUCKETS && micros >= bucketUpperBoundMicros(bucket))
+    {
+        ++bucket;
+    }
+    return bucket;
+}
+
+int64_t LatencyHistogram::bucketUpperBoundMicros(unsigned bucket)
+{
+    return int64_t(1) << std::min(bucket, NUMBER_OF_BUCKETS - 1);
+}
+
+void LatencyHistogram::record(int64_t micros)
+{
+    micros = std::max<int64_t>(0, micros);
+    ++counts[bucketIndex(micros)];
+    ++numberOfSamples;
+    totalMicros += micros;
+    maximumMicros = std::max(maximumMicros, micros);
+}
+
+int64_t LatencyHistogram::percentileMicros(double fraction) const
+{
+    const uint64_t samplesBelow = static_cast<uint64_t>(fraction * numberOfSamples);
+    uint64_t samplesSeen = 0;
+    for(unsigned bucket = 0; bucket < NUMBER_OF_BUCKETS; ++bucket)
+    {
+        samplesSeen += counts[bucket];
+        if(samplesSeen > samplesBelow || samplesSeen == numberOfSamples)
+            return std::min(bucketUpperBoundMicros(bucket), maximumMicros);
+    }
+    return maximumMicros;
+}
+
+MessageLatencyHistograms::MessageLatencyHistograms(
+    ): cs_()
+    , latencyByCommand_()
+{
+}
+
+void MessageLatencyHistograms::record(const std::string& command, int64_t queuedMicros, int64_t processingMicros)
+{
+    LOCK(cs_);
+    auto it = latencyByCommand_.find(command);
+    if(it == latencyByCommand_.end())
+    {
+        const bool tooManyCommands = latencyByCommand_.size() >= MAXIMUM_NUMBER_OF_COMMANDS;
+        it = latencyByCommand_.insert(
+            std::make_pair(tooManyCommands? std::string(OTHER_COMMANDS) : command, MessageLatency())).first;
+    }
+    it->second.queued.record(queuedMicros);
+    it->second.processing.record(processingMicros);
+}
+
+std::map<std::string, MessageLatencyHistograms::MessageLatency> MessageLatencyHistograms::snapshot() const
+{
+    LOCK(cs_);
+    return latencyByCommand_;
+}
+
+void MessageLatencyHistograms::clear()
+{
+    LOCK(cs_);
+    latencyByCommand_.clear();
+}
@@ -0,0 +1,58 @@
+#ifndef MESSAGE_LATENCY_HISTOGRAMS_H
+#define MESSAGE_LATENCY_HISTOGRAMS_H
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+
+#include <sync.h>
+
+/** Distribution of latencies in power-of-two microsecond buckets: bucket i
+ *  counts latencies below 2^i us, the last bucket everything above.  */
+class LatencyHistogram
+{
+public:
+    static constexpr unsigned NUMBER_OF_BUCKETS = 32;
+
+    uint64_t counts[NUMBER_OF_BUCKETS];
+    uint64_t numberOfSamples;
+    int64_t totalMicros;
+    int64_t maximumMicros;
+
+    LatencyHistogram();
+    void record(int64_t micros);
+    /** Upper latency bound of the bucket containing the given fraction of samples. */
+    int64_t percentileMicros(double fraction) const;
+
+    static unsigned bucketIndex(int64_t micros);
+    static int64_t bucketUpperBoundMicros(unsigned bucket);
+};
+
+/** Latencies of received network messages per message type: how long a
+ *  complete message waited before its handler ran, and how long the handler
+ *  took.  Peers pick the command strings, so only a bounded number of
+ *  distinct commands is tracked; the rest is counted under OTHER_COMMANDS.  */
+class MessageLatencyHistograms
+{
+public:
+    struct MessageLatency
+    {
+        LatencyHistogram queued;
+        LatencyHistogram processing;
+    };
+    static constexpr unsigned MAXIMUM_NUMBER_OF_COMMANDS = 64;
+    static const char* const OTHER_COMMANDS;
+
+private:
+    mutable CCriticalSection cs_;
+    std::map<std::string, MessageLatency> latencyByCommand_;
+
+public:
+    MessageLatencyHistograms();
+
+    void record(const std::string& command, int64_t queuedMicros, int64_t processingMicros);
+    std::map<std::string, MessageLatency> snapshot() const;
+    void clear();
+};
+#endif// MESSAGE_LATENCY_HISTOGRAMS_H
@@ -15,6 +15,9 @@
 #include <NodeSignals.h>
 #include <NodeState.h>
 
+#include <algorithm>
+#include <string.h>
+
 extern Settings& settings;
 uint64_t nLocalHostNonce = 0;
 
@@ -113,6 +116,18 @@ void NetworkMessageSerializer::EndMessage(CDataStream& dataStream, unsigned& dat
     memcpy((char*)&dataStream[CMessageHeader::CHECKSUM_OFFSET], &nChecksum, sizeof(nChecksum));
 }
 
+SharedNetworkMessage NetworkMessageSerializer::ToSharedMessage(const CDataStream& dataStream)
+{
+    return std::make_shared<const NetworkMessageBuffer>(dataStream.begin(), dataStream.end());
+}
+std::string NetworkMessageSerializer::GetCommand(const NetworkMessageBuffer& message)
+{
+    if (message.size() < CMessageHeader::HEADER_SIZE)
+        return std::string();
+    const char* command = &message[MESSAGE_START_SIZE];
+    return std::string(command, strnlen(command, CMessageHeader::COMMAND_SIZE));
+}
+
 NetworkMessageSerializer::DeserializationStatus NetworkMessageSerializer::DeserializeNetworkMessageFromBuffer(const char*& buffer,unsigned& bytes,CNetMessage& msg)
 {
     constexpr unsigned int MAX_PROTOCOL_MESSAGE_LENGTH = 2 * 1024 * 1024;
@@ -232,20 +247,38 @@ void QueuedMessageConnection::CloseCommsChannel()
 void QueuedMessageConnection::SendData()
 {
     AssertLockHeld(cs_vSend);
-    std::deque<CSerializeData>::iterator it = vSendMsg.begin();
+    constexpr size_t maximumBuffersPerSend = 64;
+    std::deque<SharedNetworkMessage>::iterator it = vSendMsg.begin();
 
     while (it != vSendMsg.end()) {
-        const CSerializeData& data = *it;
-        assert(data.size() > nSendOffset);
-        int nBytes = channel_.sendData(&data[nSendOffset], data.size() - nSendOffset);
+        // Gather the queued messages so that one call can send all of them
+        ConstDataBuffer buffers[maximumBuffersPerSend];
+        size_t numberOfBuffers = 0;
+        size_t offset = nSendOffset;
+        for (auto gathered = it; gathered != vSendMsg.end() && numberOfBuffers < maximumBuffersPerSend; ++gathered) {
+            const NetworkMessageBuffer& data = **gathered;
+            assert(data.size() > offset);
+            buffers[numberOfBuffers].data = &data[offset];
+            buffers[numberOfBuffers].len = data.size() - offset;
+            ++numberOfBuffers;
+            offset = 0;
+        }
+        int nBytes = channel_.sendData(buffers, numberOfBuffers);
         if (nBytes > 0) {
             dataLogger_.RecordSentBytes(nBytes);
-            nSendOffset += nBytes;
-            if (nSendOffset == data.size()) {
-                nSendOffset = 0;
-                nSendSize -= data.size();
-                it++;
-            } else {
+            size_t bytesToAccountFor = nBytes;
+            while (bytesToAccountFor > 0) {
+                const size_t messageSize = (*it)->size();
+                const size_t sentOfMessage = std::min(bytesToAccountFor, messageSize - nSendOffset);
+                nSendOffset += sentOfMessage;
+                bytesToAccountFor -= sentOfMessage;
+                if (nSendOffset == messageSize) {
+                    nSendOffset = 0;
+                    nSendSize -= messageSize;
+                    it++;
+                }
+            }
+            if (nSendOffset != 0) {
                 // could not send full message; stop sending more
                 break;
             }
@@ -270,14 +303,14 @@ void QueuedMessageConnection::SendData()
 }
 
 // Requires LOCK(cs_vRecvMsg)
-void QueuedMessageConnection::ReceiveData(boost::condition_variable& messageHandlerCondition)
+void QueuedMessageConnection::ReceiveData(CWakeupSignal& messageHandlerWakeup)
 {
     AssertLockHeld(cs_vRecvMsg);
     // typical socket buffer is 8K-64K
     char pchBuf[0x10000];
     int nBytes = channel_.receiveData(&pchBuf[0], sizeof(pchBuf));
     if (nBytes > 0) {
-        if (!ConvertDataBufferToNetworkMessage(pchBuf, nBytes,messageHandlerCondition))
+        if (!ConvertDataBufferToNetworkMessage(pchBuf, nBytes,messageHandlerWakeup))
             CloseCommsAndDisconnect();
         dataLogger_.RecordReceivedBytes(nBytes);
     } else if (nBytes == 0) {
@@ -301,11 +334,12 @@ bool QueuedMessageConnection::TrySendData()
 
     return true;
 }
-bool QueuedMessageConnection::TryReceiveData(boost::condition_variable& messageHandlerCondition)
+bool QueuedMessageConnection::TryReceiveData(CWakeupSignal& messageHandlerWakeup, bool socketHasError)
 {
     TRY_LOCK(cs_vRecvMsg, lockRecv);
-    if (lockRecv && commsMode_ != SEND)
-        ReceiveData(messageHandlerCondition);
+    // Errors and hangups are picked up by receiving, even while draining the send buffer
+    if (lockRecv && (commsMode_ != SEND || socketHasError))
+        ReceiveData(messageHandlerWakeup);
     return true;
 }
 
@@ -342,7 +376,7 @@ unsigned int QueuedMessageConnection::GetTotalRecvSize()
     return total;
 }
 // requires LOCK(cs_vRecvMsg)
-bool QueuedMessageConnection::ConvertDataBufferToNetworkMessage(const char* pch, unsigned int nBytes,boost::condition_variable& messageHandlerCondition)
+bool QueuedMessageConnection::ConvertDataBufferToNetworkMessage(const char* pch, unsigned int nBytes,CWakeupSignal& messageHandlerWakeup)
 {
     AssertLockHeld(cs_vRecvMsg);
     /** Maximum length of incoming protocol messages (no message over 2 MiB is currently acceptable). */
@@ -358,7 +392,7 @@ bool QueuedMessageConnection::ConvertDataBufferToNetworkMessage(const char* pch,
         if(deserializationStatus == NetworkMessageSerializer::SUCCESS)
         {
             msg.nTime = GetTimeMicros();
-            messageHandlerCondition.notify_one();
+            messageHandlerWakeup.notify();
         }
         else if(deserializationStatus == NetworkMessageSerializer::FAILURE)
         {
@@ -480,15 +514,37 @@ void QueuedMessageConnection::EndMessage(unsigned int& messageDataSize) UNLOCK_F
     // Set the size
     NetworkMessageSerializer::EndMessage(ssSend,messageDataSize);
 
-    std::deque<CSerializeData>::iterator it = vSendMsg.insert(vSendMsg.end(), CSerializeData());
-    ssSend.GetAndClear(*it);
-    nSendSize += (*it).size();
+    EnqueueMessage(NetworkMessageSerializer::ToSharedMessage(ssSend));
+
+    // Keep the serialization buffer for the next message unless it was grown by
+    // an unusually large one
+    constexpr size_t maximumRetainedSerializationBuffer = 64 * 1024;
+    if (ssSend.size() > maximumRetainedSerializationBuffer) {
+        CSerializeData released;
+        ssSend.GetAndClear(released);
+    } else {
+        ssSend.clear();
+    }
+
+    LEAVE_CRITICAL_SECTION(cs_vSend);
+}
+
+// requires LOCK(cs_vSend)
+void QueuedMessageConnection::EnqueueMessage(const SharedNetworkMessage& message)
+{
+    AssertLockHeld(cs_vSend);
+    vSendMsg.push_back(message);
+    nSendSize += message->size();
 
     // If write queue empty, attempt "optimistic write"
-    if (it == vSendMsg.begin())
+    if (vSendMsg.size() == 1u)
         SendData();
+}
 
-    LEAVE_CRITICAL_SECTION(cs_vSend);
+void QueuedMessageConnection::PushSerializedMessage(const SharedNetworkMessage& message)
+{
+    LOCK(cs_vSend);
+    EnqueueMessage(message);
 }
 
 std::deque<CNetMessage>& QueuedMessageConnection::GetReceivedMessageQueue()
@@ -594,9 +650,9 @@ bool CNode::TrySendData()
 {
     return messageConnection_.TrySendData();
 }
-bool CNode::TryReceiveData(boost::condition_variable& messageHandlerCondition)
+bool CNode::TryReceiveData(CWakeupSignal& messageHandlerWakeup, bool socketHasError)
 {
-    return messageConnection_.TryReceiveData(messageHandlerCondition);
+    return messageConnection_.TryReceiveData(messageHandlerWakeup, socketHasError);
 }
 NodeBufferStatus CNode::GetSendBufferStatus() const
 {
@@ -627,6 +683,12 @@ void CNode::LogMessageSize(unsigned int messageDataSize) const
 {
     LogPrint("net", "(%d bytes) peer=%d\n", messageDataSize, id);
 }
+void CNode::PushSerializedMessage(const SharedNetworkMessage& message)
+{
+    LogPrint("net", "sending: %s ", SanitizeString(NetworkMessageSerializer::GetCommand(*message)));
+    messageConnection_.PushSerializedMessage(message);
+    LogMessageSize(message->size() - CMessageHeader::HEADER_SIZE);
+}
 
 void CNode::ProcessReceiveMessages(bool& shouldSleep)
 {
@@ -654,6 +716,13 @@ void CNode::ProcessSendMessages(bool trickle)
         nodeSignals_->SendMessages(this,trickle || fWhitelisted);
     }
 }
+void CNode::ProcessDataRequests()
+{
+    // Requests wait for cs_main, so they are made without holding the send
+    // lock that threads pushing messages under cs_main may be waiting for
+    if(!IsFlaggedForDisconnection())
+        nodeSignals_->RequestDataFrom(this);
+}
 bool CNode::RespondToRequestForData()
 {
     if (!vRecvGetData.empty())
@@ -787,7 +856,10 @@ void CNode::AdvertizeLocalAddress(int64_t rebroadcastTimestamp)
 
     // Periodically clear setAddrKnown to allow refresh broadcasts
     if (rebroadcastTimestamp > 0)
+    {
+        LOCK(cs_addrRelay);
         setAddrKnown.clear();
+    }
 
     // Rebroadcast our address
     nodeSignals_->AdvertizeLocalAddress(this);
@@ -847,6 +919,7 @@ int CNode::GetRefCount() const
 
 void CNode::AddAddressKnown(const CAddress& addr)
 {
+    LOCK(cs_addrRelay);
     setAddrKnown.insert(addr);
 }
 void CNode::AddInventoryKnown(const CInv& inv)
@@ -870,6 +943,7 @@ void CNode::PushAddress(const CAddress& addr)
     // Known checking here is only to save space from duplicates.
     // SendMessages will filter it again for knowns that were added
     // after addresses were pushed.
+    LOCK(cs_addrRelay);
     if (addr.IsValid() && !setAddrKnown.count(addr)) {
         if (vAddrToSend.size() >= MAX_ADDR_TO_SEND) {
             vAddrToSend[FastRandomContext()(vAddrToSend.size())] = addr;
@@ -15,8 +15,7 @@
 #include <memory>
 #include <atomic>
 #include <I_CommunicationChannel.h>
-
-#include <boost/thread/condition_variable.hpp>
+#include <vector>
 
 class CBloomFilter;
 class CNodeSignals;
@@ -52,11 +51,32 @@ public:
     int readData(const char* pch, unsigned int nBytes);
 };
 
+/** A complete network message, header included. Queued messages are never
+ *  modified, so one serialization can be queued for any number of peers.
+ *  Unlike CSerializeData these are not wiped on release: nothing sent to a
+ *  peer is secret.  */
+typedef std::vector<char> NetworkMessageBuffer;
+typedef std::shared_ptr<const NetworkMessageBuffer> SharedNetworkMessage;
+
 class NetworkMessageSerializer
 {
 public:
     static void BeginMessage(CDataStream& dataStream, const char* pszCommand);
     static void EndMessage(CDataStream& dataStream, unsigned& dataSize);
+    static SharedNetworkMessage ToSharedMessage(const CDataStream& dataStream);
+    static std::string GetCommand(const NetworkMessageBuffer& message);
+
+    /** Serializes a message once so that it can be pushed to several peers. */
+    template <typename ...Args>
+    static SharedNetworkMessage SerializeMessage(int nVersion, const char* pszCommand, Args&&... args)
+    {
+        CDataStream dataStream(SER_NETWORK, nVersion);
+        dataStream << CMessageHeader(pszCommand, 0);
+        SerializeNextArgument(dataStream,std::forward<Args>(args)...);
+        unsigned dataSize = 0u;
+        EndMessage(dataStream, dataSize);
+        return ToSharedMessage(dataStream);
+    }
 
     static void SerializeNextArgument(CDataStream& dataStream)
     {
@@ -109,7 +129,7 @@ private:
     CommsMode commsMode_;
 
     CDataStream ssSend;
-    std::deque<CSerializeData> vSendMsg;
+    std::deque<SharedNetworkMessage> vSendMsg;
     CCriticalSection cs_vSend;
 
     std::deque<CNetMessage> vRecvMsg;
@@ -129,11 +149,12 @@ private:
     // TODO: Document the precondition of this function.  Is cs_vSend locked?
     void EndMessage(unsigned int& messageDataSize) UNLOCK_FUNCTION(cs_vSend);
 
+    void EnqueueMessage(const SharedNetworkMessage& message);
     size_t GetSendBufferSize() const;
 
     void SendData();
-    void ReceiveData(boost::condition_variable& messageHandlerCondition);
-    bool ConvertDataBufferToNetworkMessage(const char* pch, unsigned int nBytes,boost::condition_variable& messageHandlerCondition);
+    void ReceiveData(CWakeupSignal& messageHandlerWakeup);
+    bool ConvertDataBufferToNetworkMessage(const char* pch, unsigned int nBytes,CWakeupSignal& messageHandlerWakeup);
     unsigned int GetTotalRecvSize();
 
 public:
@@ -156,8 +177,9 @@ public:
         CommunicationLogger& dataLogger);
     void CloseCommsChannel();
     void CloseCommsAndDisconnect();
+    void PushSerializedMessage(const SharedNetworkMessage& message);
     bool TrySendData();
-    bool TryReceiveData(boost::condition_variable& messageHandlerCondition);
+    bool TryReceiveData(CWakeupSignal& messageHandlerWakeup, bool socketHasError);
 
     bool IsAvailableToReceive();
     bool IsAvailableToSend();
@@ -188,7 +210,7 @@ public:
     void CloseCommsAndDisconnect();
     CommsMode SelectCommunicationMode();
     bool TrySendData();
-    bool TryReceiveData(boost::condition_variable& messageHandlerCondition);
+    bool TryReceiveData(CWakeupSignal& messageHandlerWakeup, bool socketHasError);
     NodeBufferStatus GetSendBufferStatus() const;
     void SetInboundSerializationVersion(int versionNumber);
     void SetOutboundSerializationVersion(int versionNumber);
@@ -259,6 +281,7 @@ public:
     // flood relay
     std::vector<CAddress> vAddrToSend;
     mruset<CAddress> setAddrKnown;
+    CCriticalSection cs_addrRelay;
     bool fGetAddr;
     std::set<uint256> setKnown;
 
@@ -297,9 +320,11 @@ public:
         messageConnection_.PushMessageAndRecordDataSize(messageDataSize,pszCommand,std::forward<Args>(args)...);
         LogMessageSize(messageDataSize);
     }
+    void PushSerializedMessage(const SharedNetworkMessage& message);
 
     void ProcessReceiveMessages(bool& shouldSleep);
     void ProcessSendMessages(bool trickle);
+    void ProcessDataRequests();
     void AdvertizeLocalAddress(int64_t rebroadcastTimestamp);
     bool IsInUse();
     void MaybeSendPing();
@@ -11,6 +11,7 @@ struct CNodeSignals {
     boost::signals2::signal<void(NodeId)> FinalizeNode;
     boost::signals2::signal<bool(CNode*)> ProcessReceivedMessages;
     boost::signals2::signal<bool(CNode*,bool)> SendMessages;
+    boost::signals2::signal<void(CNode*)> RequestDataFrom;
     boost::signals2::signal<void(CNode*)> RespondToRequestForDataFrom;
     boost::signals2::signal<void(CNode*)> AdvertizeLocalAddress;
 };
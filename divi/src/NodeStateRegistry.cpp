@@ -10,6 +10,8 @@
 #include <blockmap.h>
 #include <Settings.h>
 #include <BlocksInFlightRegistry.h>
+#include <BlockDownloadWindow.h>
+#include <defaultValues.h>
 
 extern Settings& settings;
 extern CCriticalSection cs_main;
@@ -17,6 +19,14 @@ extern CCriticalSection cs_main;
 /** Number of blocks in flight with validated headers. */
 BlocksInFlightRegistry blocksInFlightRegistry;
 
+/** Headers-first download of blocks from several peers. Requires cs_main. */
+BlockDownloadWindow blockDownloadWindow(
+    BLOCK_DOWNLOAD_WINDOW,
+    1000000 * BLOCK_STALLING_TIMEOUT,
+    MAX_BUFFERED_DOWNLOAD_BYTES,
+    MAX_BLOCK_DOWNLOAD_STALLS,
+    MAX_HEADERS_AHEAD_OF_TIP);
+
 /** Map maintaining per-node state. Requires cs_main. */
 std::map<NodeId, CNodeState*> mapNodeState;
 
@@ -41,6 +51,7 @@ void FinalizeNode(NodeId nodeId)
 {
     LOCK(cs_main);
     blocksInFlightRegistry.UnregisterNodeId(nodeId);
+    blockDownloadWindow.removePeer(nodeId);
     mapNodeState.erase(nodeId);
 }
 
@@ -76,6 +87,11 @@ void MarkBlockAsInFlight(NodeId nodeid, const uint256& hash, CBlockIndex* pindex
     AssertLockHeld(cs_main);
     blocksInFlightRegistry.MarkBlockAsInFlight(nodeid,hash,pindex);
 }
+BlockDownloadWindow& GetBlockDownloadWindow()
+{
+    AssertLockHeld(cs_main);
+    return blockDownloadWindow;
+}
 bool BlockIsInFlight(const uint256& hash)
 {
     AssertLockHeld(cs_main);
@@ -13,6 +13,7 @@ class BlockMap;
 class CAddress;
 class CAddrMan;
 class CBlockReject;
+class BlockDownloadWindow;
 
 // Requires cs_main.
 void InitializeNode(CNodeState& nodeState);
@@ -20,6 +21,7 @@ void FinalizeNode(NodeId nodeId);
 void MarkBlockAsReceived(const uint256& hash);
 void MarkBlockAsInFlight(NodeId nodeid, const uint256& hash, CBlockIndex* pindex = nullptr);
 bool BlockIsInFlight(const uint256& hash);
+BlockDownloadWindow& GetBlockDownloadWindow();
 void UpdateBlockAvailability(const BlockMap& blockIndicesByHash, CNodeState* state, const uint256& hash);
 void FindNextBlocksToDownload(
     const BlockMap& blockIndicesByHash,
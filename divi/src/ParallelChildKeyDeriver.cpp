@@ -0,0 +1,78 @@
+#include <ParallelChildKeyDeriver.h>
+
+#include <defaultValues.h>
+
+ChildPubKeyDerivationCheck::ChildPubKeyDerivationCheck(
+    ): parent_(nullptr)
+    , childIndex_(0u)
+    , child_(nullptr)
+    , derived_(nullptr)
+{
+}
+
+ChildPubKeyDerivationCheck::ChildPubKeyDerivationCheck(
+    const CExtPubKey& parent,
+    uint32_t childIndex,
+    CExtPubKey& child,
+    char& derived
+    ): parent_(&parent)
+    , childIndex_(childIndex)
+    , child_(&child)
+    , derived_(&derived)
+{
+}
+
+bool ChildPubKeyDerivationCheck::operator()()
+{
+    if(parent_ != nullptr)
+        *derived_ = parent_->Derive(*child_, childIndex_);
+    return true;
+}
+
+void ChildPubKeyDerivationCheck::swap(ChildPubKeyDerivationCheck& check)
+{
+    std::swap(parent_, check.parent_);
+    std::swap(childIndex_, check.childIndex_);
+    std::swap(child_, check.child_);
+    std::swap(derived_, check.derived_);
+}
+
+ParallelChildKeyDeriver::ParallelChildKeyDeriver(
+    unsigned numberOfThreads
+    ): queue_(KEYPOOL_DERIVATION_BATCH_SIZE, numberOfThreads)
+    , workers_()
+{
+    // The thread waiting on the queue works on it as well
+    for(unsigned threadIndex = 1; threadIndex < numberOfThreads; ++threadIndex)
+        workers_.create_thread(boost::bind(&CCheckQueue<ChildPubKeyDerivationCheck>::Thread, &queue_));
+}
+
+ParallelChildKeyDeriver::~ParallelChildKeyDeriver()
+{
+    workers_.interrupt_all();
+    workers_.join_all();
+}
+
+std::vector<CExtPubKey> ParallelChildKeyDeriver::derive(const CExtPubKey& parent, uint32_t firstChildIndex, unsigned numberOfChildren)
+{
+    std::vector<CExtPubKey> children(numberOfChildren);
+    std::vector<char> derived(numberOfChildren, 0);
+    std::vector<ChildPubKeyDerivationCheck> checks;
+    checks.reserve(numberOfChildren);
+    for(unsigned childOffset = 0; childOffset < numberOfChildren; ++childOffset)
+        checks.emplace_back(parent, firstChildIndex + childOffset, children[childOffset], derived[childOffset]);
+    {
+        CCheckQueueControl<ChildPubKeyDerivationCheck> control(&queue_);
+        control.Add(checks);
+        control.Wait();
+    }
+
+    std::vector<CExtPubKey> derivedChildren;
+    derivedChildren.reserve(numberOfChildren);
+    for(unsigned childOffset = 0; childOffset < numberOfChildren; ++childOffset)
+    {
+        if(derived[childOffset])
+            derivedChildren.push_back(children[childOffset]);
+    }
+    return derivedChildren;
+}
@@ -0,0 +1,50 @@
+#ifndef PARALLEL_CHILD_KEY_DERIVER_H
+#define PARALLEL_CHILD_KEY_DERIVER_H
+#include <stdint.h>
+#include <vector>
+#include <pubkey.h>
+#include <checkqueue.h>
+
+#include <boost/thread.hpp>
+
+/** Derives one non-hardened child of an extended public key. */
+class ChildPubKeyDerivationCheck
+{
+private:
+    const CExtPubKey* parent_;
+    uint32_t childIndex_;
+    CExtPubKey* child_;
+    char* derived_;
+
+public:
+    ChildPubKeyDerivationCheck();
+    ChildPubKeyDerivationCheck(const CExtPubKey& parent, uint32_t childIndex, CExtPubKey& child, char& derived);
+
+    bool operator()();
+    void swap(ChildPubKeyDerivationCheck& check);
+};
+
+/**
+ * Derives runs of consecutive children of an extended public key on a set of
+ * worker threads that lives as long as the deriver, so that the keys of a large
+ * key pool top-up only cost one public derivation step each and are computed
+ * without holding any wallet lock.
+ */
+class ParallelChildKeyDeriver
+{
+private:
+    CCheckQueue<ChildPubKeyDerivationCheck> queue_;
+    boost::thread_group workers_;
+
+public:
+    explicit ParallelChildKeyDeriver(unsigned numberOfThreads);
+    ~ParallelChildKeyDeriver();
+
+    /**
+     * Returns the children firstChildIndex, firstChildIndex + 1, ... of parent
+     * in index order. Indexes that cannot be derived (which BIP32 says to skip)
+     * are left out, so fewer than numberOfChildren keys may be returned.
+     */
+    std::vector<CExtPubKey> derive(const CExtPubKey& parent, uint32_t firstChildIndex, unsigned numberOfChildren);
+};
+#endif// PARALLEL_CHILD_KEY_DERIVER_H
@@ -18,6 +18,15 @@
 #include <StakableCoin.h>
 #include <timedata.h>
 #include <ForkActivation.h>
+#include <defaultValues.h>
+#include <checkqueue.h>
+
+#include <atomic>
+#include <functional>
+#include <limits>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
 
 class StakedCoins
 {
@@ -46,6 +55,104 @@ public:
     }
 };
 
+/** Shared state of one kernel search over the stakable coins. Candidates are
+ *  claimed in set order, so once a kernel is found every preceding candidate
+ *  has already been claimed and the serial loop's choice can be recovered. */
+struct HashproofSearchRound
+{
+    static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+
+    std::atomic<size_t> nextCandidate;
+    std::atomic<size_t> firstSuccessfulCandidate;
+    std::atomic<size_t> firstCandidateAfterTipChange;
+    std::atomic<bool> hashproofSetupSucceeded;
+    std::vector<unsigned> hashproofTimestamps;
+
+    explicit HashproofSearchRound(
+        size_t numberOfCandidates
+        ): nextCandidate(0)
+        , firstSuccessfulCandidate(NONE)
+        , firstCandidateAfterTipChange(NONE)
+        , hashproofSetupSucceeded(false)
+        , hashproofTimestamps(numberOfCandidates, 0u)
+    {
+    }
+
+    static void lowerTo(std::atomic<size_t>& candidateIndex, size_t newValue)
+    {
+        size_t currentValue = candidateIndex.load();
+        while(newValue < currentValue && !candidateIndex.compare_exchange_weak(currentValue, newValue))
+        {
+        }
+    }
+};
+constexpr size_t HashproofSearchRound::NONE;
+
+/** Runs one share of a kernel search round on a pool thread. */
+class HashproofSearchCheck
+{
+private:
+    std::function<void()> search_;
+
+public:
+    HashproofSearchCheck(): search_()
+    {
+    }
+    explicit HashproofSearchCheck(const std::function<void()>& search): search_(search)
+    {
+    }
+    bool operator()()
+    {
+        if(search_)
+            search_();
+        return true;
+    }
+    void swap(HashproofSearchCheck& check)
+    {
+        search_.swap(check.search_);
+    }
+};
+
+/** Worker threads that live as long as the creator, so that a round does not
+ *  pay for starting threads. The minting thread joins them while it waits. */
+class HashproofSearchPool
+{
+private:
+    CCheckQueue<HashproofSearchCheck> queue_;
+    boost::thread_group workers_;
+
+public:
+    explicit HashproofSearchPool(
+        unsigned numberOfThreads
+        ): queue_(1u, numberOfThreads)
+        , workers_()
+    {
+        for(unsigned threadIndex = 1; threadIndex < numberOfThreads; ++threadIndex)
+            workers_.create_thread(boost::bind(&CCheckQueue<HashproofSearchCheck>::Thread, &queue_));
+    }
+    ~HashproofSearchPool()
+    {
+        workers_.interrupt_all();
+        workers_.join_all();
+    }
+    void run(size_t numberOfSearches, const std::function<void()>& search)
+    {
+        std::vector<HashproofSearchCheck> checks(numberOfSearches, HashproofSearchCheck(search));
+        CCheckQueueControl<HashproofSearchCheck> control(&queue_);
+        control.Add(checks);
+        control.Wait();
+    }
+};
+
+static unsigned ComputeNumberOfStakingThreads(const Settings& settings)
+{
+    // -stakingthreads=0 means autodetect
+    int64_t stakingThreads = settings.GetArg("-stakingthreads", DEFAULT_STAKING_THREADS);
+    if (stakingThreads <= 0)
+        stakingThreads += boost::thread::hardware_concurrency();
+    return static_cast<unsigned>(std::max<int64_t>(1, std::min<int64_t>(stakingThreads, MAX_STAKING_THREADS)));
+}
+
 PoSTransactionCreator::PoSTransactionCreator(
     const Settings& settings,
     const CChainParams& chainParameters,
@@ -67,6 +174,8 @@ PoSTransactionCreator::PoSTransactionCreator(
     , wallet_(wallet)
     , hashedBlockTimestamps_(hashedBlockTimestamps)
     , hashproofTimestampMinimumValue_(0)
+    , stakingThreads_(ComputeNumberOfStakingThreads(settings_))
+    , hashproofSearchPool_(stakingThreads_ > 1u? new HashproofSearchPool(stakingThreads_): nullptr)
 {
 }
 
@@ -173,18 +282,17 @@ void PoSTransactionCreator::CombineUtxos(
     }
 }
 
-bool PoSTransactionCreator::FindHashproof(
+HashproofCreationResult PoSTransactionCreator::FindHashproof(
     const CBlockIndex* chainTip,
     unsigned int nBits,
-    unsigned int& nTxNewTime,
-    const StakableCoin& stakeData,
-    CMutableTransaction& txNew)
+    unsigned int initialTimestamp,
+    const StakableCoin& stakeData) const
 {
     BlockMap::const_iterator it = blockIndexByHash_.find(stakeData.blockHashOfFirstConfirmation);
     if (it == blockIndexByHash_.end())
     {
         LogPrint("staking","%s failed to find block index for %s\n",__func__,stakeData.blockHashOfFirstConfirmation);
-        return false;
+        return HashproofCreationResult::FailedSetup();
     }
 
     StakingData stakingData(
@@ -194,26 +302,44 @@ bool PoSTransactionCreator::FindHashproof(
         stakeData.utxo,
         stakeData.GetTxOut().nValue,
         chainTip->GetBlockHash());
-    HashproofCreationResult hashproofResult = proofGenerator_.CreateHashproofTimestamp(stakingData,nTxNewTime);
-    if(!hashproofResult.failedAtSetup())
+    HashproofCreationResult hashproofResult = proofGenerator_.CreateHashproofTimestamp(stakingData,initialTimestamp);
+    if (hashproofResult.succeeded() && hashproofResult.timestamp() <= chainTip->GetMedianTimePast())
     {
-        hashedBlockTimestamps_.clear();
-        hashedBlockTimestamps_[chainTip->nHeight] = GetTime();
+        LogPrintf("%s : kernel found, but it is too far in the past \n",__func__);
+        return HashproofCreationResult::FailedGeneration();
     }
-    if (hashproofResult.succeeded())
+    return hashproofResult;
+}
+
+void PoSTransactionCreator::SearchForHashproofs(
+    const CBlockIndex* chainTip,
+    unsigned int nBits,
+    unsigned int initialTimestamp,
+    const std::vector<const StakableCoin*>& candidates,
+    HashproofSearchRound& searchRound) const
+{
+    for(size_t candidate = searchRound.nextCandidate++; candidate < candidates.size(); candidate = searchRound.nextCandidate++)
     {
-        if (hashproofResult.timestamp() <= chainTip->GetMedianTimePast())
+        if(candidate > searchRound.firstSuccessfulCandidate || candidate > searchRound.firstCandidateAfterTipChange)
         {
-            LogPrintf("%s : kernel found, but it is too far in the past \n",__func__);
-            return false;
+            return;
+        }
+        if(chainTip->nHeight != activeChain_.Height())
+        {
+            HashproofSearchRound::lowerTo(searchRound.firstCandidateAfterTipChange, candidate);
+            return;
+        }
+        HashproofCreationResult hashproofResult = FindHashproof(chainTip, nBits, initialTimestamp, *candidates[candidate]);
+        if(!hashproofResult.failedAtSetup())
+        {
+            searchRound.hashproofSetupSucceeded = true;
+        }
+        if(hashproofResult.succeeded())
+        {
+            searchRound.hashproofTimestamps[candidate] = hashproofResult.timestamp();
+            HashproofSearchRound::lowerTo(searchRound.firstSuccessfulCandidate, candidate);
         }
-        LogPrint("staking","%s : kernel found for %s\n",__func__, stakeData.tx->ToStringShort());
-
-        SetSuportedStakingScript(stakeData,txNew);
-        nTxNewTime = hashproofResult.timestamp();
-        return true;
     }
-    return false;
 }
 
 const StakableCoin* PoSTransactionCreator::FindProofOfStake(
@@ -223,21 +349,51 @@ const StakableCoin* PoSTransactionCreator::FindProofOfStake(
     unsigned int& nTxNewTime,
     bool& isVaultScript)
 {
+    std::vector<const StakableCoin*> candidates;
+    std::vector<bool> candidateIsVault;
+    candidates.reserve(stakedCoins_->asSet().size());
     for (const StakableCoin& pcoin: stakedCoins_->asSet())
     {
-        if(!IsSupportedScript(pcoin.GetTxOut().scriptPubKey,isVaultScript))
+        bool coinIsVault = false;
+        if(!IsSupportedScript(pcoin.GetTxOut().scriptPubKey,coinIsVault))
         {
             continue;
         }
-        if(chainTip->nHeight != activeChain_.Height())
-        {
-            hashproofTimestampMinimumValue_ = 0;
-            return nullptr;
-        }
-        if(FindHashproof(chainTip,blockBits, nTxNewTime, pcoin,txCoinStake) )
-        {
-            return &pcoin;
-        }
+        candidates.push_back(&pcoin);
+        candidateIsVault.push_back(coinIsVault);
+    }
+
+    HashproofSearchRound searchRound(candidates.size());
+    const unsigned initialTimestamp = nTxNewTime;
+    const std::function<void()> search = [&]()
+    {
+        SearchForHashproofs(chainTip, blockBits, initialTimestamp, candidates, searchRound);
+    };
+    if(hashproofSearchPool_ && candidates.size() > 1u)
+        hashproofSearchPool_->run(std::min<size_t>(stakingThreads_, candidates.size()), search);
+    else
+        search();
+
+    if(searchRound.hashproofSetupSucceeded)
+    {
+        hashedBlockTimestamps_.clear();
+        hashedBlockTimestamps_[chainTip->nHeight] = GetTime();
+    }
+    const size_t winningCandidate = searchRound.firstSuccessfulCandidate;
+    if(searchRound.firstCandidateAfterTipChange < winningCandidate)
+    {
+        hashproofTimestampMinimumValue_ = 0;
+        return nullptr;
+    }
+    if(winningCandidate != HashproofSearchRound::NONE)
+    {
+        const StakableCoin& stakeData = *candidates[winningCandidate];
+        LogPrint("staking","%s : kernel found for %s\n",__func__, stakeData.tx->ToStringShort());
+
+        isVaultScript = candidateIsVault[winningCandidate];
+        SetSuportedStakingScript(stakeData,txCoinStake);
+        nTxNewTime = searchRound.hashproofTimestamps[winningCandidate];
+        return &stakeData;
     }
     hashproofTimestampMinimumValue_ = nTxNewTime;
     return nullptr;
@@ -27,6 +27,9 @@ class StakedCoins;
 struct StakableCoin;
 class Settings;
 class I_StakingWallet;
+class HashproofCreationResult;
+struct HashproofSearchRound;
+class HashproofSearchPool;
 
 class PoSTransactionCreator: public I_PoSTransactionCreator
 {
@@ -42,6 +45,8 @@ private:
     I_StakingWallet& wallet_;
     std::map<unsigned int, unsigned int>& hashedBlockTimestamps_;
     int64_t hashproofTimestampMinimumValue_;
+    const unsigned stakingThreads_;
+    std::unique_ptr<HashproofSearchPool> hashproofSearchPool_;
 
     void CombineUtxos(
         const CAmount& stakeSplit,
@@ -55,12 +60,18 @@ private:
 
     bool SelectCoins();
 
-    bool FindHashproof(
+    HashproofCreationResult FindHashproof(
         const CBlockIndex* chainTip,
         unsigned int nBits,
-        unsigned int& nTxNewTime,
-        const StakableCoin& stakeData,
-        CMutableTransaction& txNew);
+        unsigned int initialTimestamp,
+        const StakableCoin& stakeData) const;
+
+    void SearchForHashproofs(
+        const CBlockIndex* chainTip,
+        unsigned int nBits,
+        unsigned int initialTimestamp,
+        const std::vector<const StakableCoin*>& candidates,
+        HashproofSearchRound& searchRound) const;
 
     const StakableCoin* FindProofOfStake(
         const CBlockIndex* chainTip,
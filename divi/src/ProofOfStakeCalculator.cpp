@@ -1,27 +1,23 @@
 #include <ProofOfStakeCalculator.h>
-#include <streams.h>
 #include <amount.h>
 #include <primitives/transaction.h>
-#include <hash.h>
 #include <StakingData.h>
 
 static constexpr unsigned int MAXIMUM_COIN_AGE_WEIGHT_FOR_STAKING = 60 * 60 * 24 * 7 - 60 * 60;
 
-static uint256 stakeHash(uint64_t stakeModifier, unsigned int hashproofTimestamp, const COutPoint& prevout, unsigned int coinstakeStartTime)
+//compute the target scaled by the coin-day weight of the utxo, returns false on overflow
+static bool computeStakeTarget(int64_t nValueIn, const uint256& bnTargetPerCoinDay, int64_t nTimeWeight, uint256& target)
 {
-    //Divi will hash in the transaction hash and the index number in order to make sure each hash is unique
-    CDataStream ss(SER_GETHASH, 0);
-    ss << stakeModifier << coinstakeStartTime << prevout.n << prevout.hash << hashproofTimestamp;
-    return Hash(ss.begin(), ss.end());
+    const uint256 bnCoinDayWeight = (uint256(nValueIn) * nTimeWeight) / COIN / 400;
+
+    target = bnTargetPerCoinDay;
+    return target.MultiplyBy(bnCoinDayWeight);
 }
 
 //test hash vs target
-static bool stakeTargetHit(const uint256& hashProofOfStake, int64_t nValueIn, const uint256& bnTargetPerCoinDay, int64_t nTimeWeight)
+static bool stakeTargetHit(const uint256& hashProofOfStake, const uint256& target, bool targetOverflows)
 {
-    const uint256 bnCoinDayWeight = (uint256(nValueIn) * nTimeWeight) / COIN / 400;
-
-    uint256 target = bnTargetPerCoinDay;
-    if (!target.MultiplyBy(bnCoinDayWeight)) {
+    if (targetOverflows) {
         // In regtest with minimal difficulty, it may happen that the
         // modification overflows the uint256, in which case it just means
         // that the target will always be hit.
@@ -41,7 +37,14 @@ ProofOfStakeCalculator::ProofOfStakeCalculator(
     , stakeModifier_(stakeModifier)
     , targetPerCoinDay_(uint256().SetCompact(stakingData.nBits_))
     , coinstakeStartTime_(stakingData.blockTimeOfFirstConfirmationBlock_)
+    , kernelHasher_(stakeModifier_, coinstakeStartTime_, utxoToStake_)
+    , targetAtMaximumCoinAgeWeight_()
+    , targetAtMaximumCoinAgeWeightOverflows_(false)
 {
+    // The coin age weight saturates for all but the youngest utxos, so the
+    // scaled target is usually the same for every timestamp that gets tried
+    targetAtMaximumCoinAgeWeightOverflows_ =
+        !computeStakeTarget(utxoValue_, targetPerCoinDay_, MAXIMUM_COIN_AGE_WEIGHT_FOR_STAKING, targetAtMaximumCoinAgeWeight_);
 }
 
 bool ProofOfStakeCalculator::computeProofOfStakeAndCheckItMeetsTarget(
@@ -49,7 +52,13 @@ bool ProofOfStakeCalculator::computeProofOfStakeAndCheckItMeetsTarget(
     uint256& computedProofOfStake,
     bool checkOnly) const
 {
-    if(!checkOnly) computedProofOfStake = stakeHash(stakeModifier_,hashproofTimestamp, utxoToStake_,coinstakeStartTime_);
+    if(!checkOnly) computedProofOfStake = kernelHasher_.computeHash(hashproofTimestamp);
     int64_t coinAgeWeightOfUtxo = std::min<int64_t>(hashproofTimestamp - coinstakeStartTime_, MAXIMUM_COIN_AGE_WEIGHT_FOR_STAKING);
-    return stakeTargetHit(computedProofOfStake,utxoValue_,targetPerCoinDay_, coinAgeWeightOfUtxo);
+    if(coinAgeWeightOfUtxo == MAXIMUM_COIN_AGE_WEIGHT_FOR_STAKING)
+    {
+        return stakeTargetHit(computedProofOfStake,targetAtMaximumCoinAgeWeight_,targetAtMaximumCoinAgeWeightOverflows_);
+    }
+    uint256 target;
+    const bool targetOverflows = !computeStakeTarget(utxoValue_,targetPerCoinDay_, coinAgeWeightOfUtxo, target);
+    return stakeTargetHit(computedProofOfStake,target,targetOverflows);
 }
\ No newline at end of file
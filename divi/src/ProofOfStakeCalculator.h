@@ -3,6 +3,7 @@
 #include <stdint.h>
 #include <uint256.h>
 #include <I_ProofOfStakeCalculator.h>
+#include <StakeKernelHasher.h>
 struct StakingData;
 class COutPoint;
 class ProofOfStakeCalculator: public I_ProofOfStakeCalculator
@@ -13,6 +14,9 @@ private:
     const uint64_t stakeModifier_;
     const uint256 targetPerCoinDay_;
     const unsigned int& coinstakeStartTime_;
+    const StakeKernelHasher kernelHasher_;
+    uint256 targetAtMaximumCoinAgeWeight_;
+    bool targetAtMaximumCoinAgeWeightOverflows_;
 public:
     ProofOfStakeCalculator(
         const StakingData& stakingData,
@@ -5,7 +5,6 @@
 #include <StakingData.h>
 #include <I_PoSStakeModifierService.h>
 #include <ProofOfStakeCalculator.h>
-#include <memory>
 
 // Start of Proof-of-Stake Computations
 HashproofCreationResult::HashproofCreationResult(
@@ -89,10 +88,10 @@ bool ProofOfStakeGenerator::ProofOfStakeTimeRequirementsAreMet(
     return true;
 }
 
-bool ProofOfStakeGenerator::CreateProofOfStakeCalculator(
+bool ProofOfStakeGenerator::FetchStakeModifierIfTimeRequirementsAreMet(
     const StakingData& stakingData,
     const unsigned& initialHashproofTimestamp,
-    std::shared_ptr<I_ProofOfStakeCalculator>& calculator) const
+    uint64_t& stakeModifier) const
 {
     if(!ProofOfStakeTimeRequirementsAreMet(stakingData.blockTimeOfFirstConfirmationBlock_,initialHashproofTimestamp))
         return false;
@@ -102,11 +101,7 @@ bool ProofOfStakeGenerator::CreateProofOfStakeCalculator(
     {
         return error("%s: failed to get kernel stake modifier \n",__func__);
     }
-    calculator = std::make_shared<ProofOfStakeCalculator>(stakingData, stakeModifierData.first);
-
-    if(!calculator.get())
-        return false;
-
+    stakeModifier = stakeModifierData.first;
     return true;
 }
 
@@ -115,23 +110,26 @@ bool ProofOfStakeGenerator::ComputeAndVerifyProofOfStake(
     const unsigned int& hashproofTimestamp,
     uint256& hashProofOfStake) const
 {
-    std::shared_ptr<I_ProofOfStakeCalculator> calculator;
-    if(!CreateProofOfStakeCalculator(stakingData,hashproofTimestamp,calculator))
+    uint64_t stakeModifier = 0;
+    if(!FetchStakeModifierIfTimeRequirementsAreMet(stakingData,hashproofTimestamp,stakeModifier))
         return false;
-    return calculator->computeProofOfStakeAndCheckItMeetsTarget(
+    const ProofOfStakeCalculator calculator(stakingData, stakeModifier);
+    return calculator.computeProofOfStakeAndCheckItMeetsTarget(
         hashproofTimestamp, hashProofOfStake,false);
 }
 HashproofCreationResult ProofOfStakeGenerator::CreateHashproofTimestamp(
     const StakingData& stakingData,
     const unsigned initialTimestamp) const
 {
-    std::shared_ptr<I_ProofOfStakeCalculator> calculator;
-    if(!CreateProofOfStakeCalculator(stakingData,initialTimestamp,calculator))
+    uint64_t stakeModifier = 0;
+    if(!FetchStakeModifierIfTimeRequirementsAreMet(stakingData,initialTimestamp,stakeModifier))
         return HashproofCreationResult::FailedSetup();
 
+    // Stack allocated so that concurrent searches over many utxos don't contend on the heap
+    const ProofOfStakeCalculator calculator(stakingData, stakeModifier);
     unsigned hashproofTimestamp = initialTimestamp;
     if(!CreateHashProofForProofOfStake(
-        *calculator,
+        calculator,
         stakingData,
         hashproofTimestamp))
     {
@@ -1,6 +1,6 @@
 #ifndef PROOF_OF_STAKE_GENERATOR_H
 #define PROOF_OF_STAKE_GENERATOR_H
-#include <memory>
+#include <stdint.h>
 #include <I_ProofOfStakeGenerator.h>
 
 class StakingData;
@@ -17,10 +17,10 @@ private:
     bool ProofOfStakeTimeRequirementsAreMet(
         unsigned int coinstakeStartTime,
         unsigned int hashproofTimestamp) const;
-    bool CreateProofOfStakeCalculator(
+    bool FetchStakeModifierIfTimeRequirementsAreMet(
         const StakingData& stakingData,
         const unsigned& initialHashproofTimestamp,
-        std::shared_ptr<I_ProofOfStakeCalculator>& calculator) const;
+        uint64_t& stakeModifier) const;
 public:
     ProofOfStakeGenerator(
         const I_PoSStakeModifierService& stakeModifierService,
@@ -12,6 +12,7 @@ class ProofOfStakeModule
 {
     std::unique_ptr<I_PoSStakeModifierService> legacyStakeModifierService_;
     std::unique_ptr<I_PoSStakeModifierService> stakeModifierService_;
+    std::unique_ptr<I_PoSStakeModifierService> cachedStakeModifierService_;
     std::unique_ptr<I_ProofOfStakeGenerator> proofGenerator_;
 public:
     ProofOfStakeModule(
@@ -0,0 +1,51 @@
+#include <RescanTransactionFilter.h>
+
+#include <hash.h>
+#include <primitives/transaction.h>
+
+RescanTransactionFilter::RescanTransactionFilter(
+    ): keyAndScriptHashes_()
+    , scripts_()
+{
+}
+
+void RescanTransactionFilter::addKeyOrScriptHash(const uint160& hash)
+{
+    keyAndScriptHashes_.insert(hash);
+}
+
+void RescanTransactionFilter::addScript(const CScript& script)
+{
+    scripts_.insert(script);
+}
+
+bool RescanTransactionFilter::scriptMayBeRelevant(const CScript& scriptPubKey) const
+{
+    if(scripts_.count(scriptPubKey) > 0u) return true;
+
+    CScript::const_iterator pc = scriptPubKey.begin();
+    opcodetype opcode;
+    std::vector<unsigned char> pushedData;
+    while(pc < scriptPubKey.end() && scriptPubKey.GetOp(pc, opcode, pushedData))
+    {
+        if(pushedData.size() == 20u)
+        {
+            if(keyAndScriptHashes_.count(uint160(pushedData)) > 0u) return true;
+        }
+        else if(pushedData.size() == 33u || pushedData.size() == 65u)
+        {
+            // Compressed or uncompressed public key, known to the wallet by its key id
+            if(keyAndScriptHashes_.count(Hash160(pushedData)) > 0u) return true;
+        }
+    }
+    return false;
+}
+
+bool RescanTransactionFilter::outputsMayBeRelevant(const CTransaction& tx) const
+{
+    for(const CTxOut& output: tx.vout)
+    {
+        if(scriptMayBeRelevant(output.scriptPubKey)) return true;
+    }
+    return false;
+}
@@ -0,0 +1,31 @@
+#ifndef RESCAN_TRANSACTION_FILTER_H
+#define RESCAN_TRANSACTION_FILTER_H
+#include <set>
+#include <uint256.h>
+#include <script/script.h>
+
+class CTransaction;
+
+/**
+ * Snapshot of the keys and scripts of a wallet, used to discard transactions
+ * whose outputs cannot possibly be relevant to it without taking the wallet
+ * lock. Outputs pass the filter if their script is one of the known scripts or
+ * pushes a key hash, script hash or public key belonging to the wallet, so
+ * every output the wallet considers its own passes, alongside a few that don't.
+ */
+class RescanTransactionFilter
+{
+private:
+    std::set<uint160> keyAndScriptHashes_;
+    std::set<CScript> scripts_;
+
+public:
+    RescanTransactionFilter();
+
+    void addKeyOrScriptHash(const uint160& hash);
+    void addScript(const CScript& script);
+
+    bool scriptMayBeRelevant(const CScript& scriptPubKey) const;
+    bool outputsMayBeRelevant(const CTransaction& tx) const;
+};
+#endif// RESCAN_TRANSACTION_FILTER_H
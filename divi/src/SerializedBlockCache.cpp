@@ -0,0 +1,89 @@
+#include <SerializedBlockCache.h>
+
+double SerializedBlockCache::Statistics::hitRate() const
+{
+    const uint64_t requests = hits + misses;
+    return requests > 0u? static_cast<double>(hits) / requests : 0.0;
+}
+
+SerializedBlockCache::SerializedBlockCache(
+    size_t maximumBytes
+    ): cs_()
+    , maximumBytes_(maximumBytes)
+    , usedBytes_(0u)
+    , blocksByRecency_()
+    , blockByHash_()
+    , hits_(0u)
+    , misses_(0u)
+{
+}
+
+bool SerializedBlockCache::isEnabled() const
+{
+    return maximumBytes_ > 0u;
+}
+
+void SerializedBlockCache::evictUntilSizeIsAtMost(size_t maximumBytes)
+{
+    AssertLockHeld(cs_);
+    while(usedBytes_ > maximumBytes && !blocksByRecency_.empty())
+    {
+        const BlocksByRecency::value_type& leastRecentlyUsed = blocksByRecency_.back();
+        usedBytes_ -= leastRecentlyUsed.second->size();
+        blockByHash_.erase(leastRecentlyUsed.first);
+        blocksByRecency_.pop_back();
+    }
+}
+
+SharedNetworkMessage SerializedBlockCache::get(const uint256& blockHash)
+{
+    LOCK(cs_);
+    const auto it = blockByHash_.find(blockHash);
+    if(it == blockByHash_.end())
+    {
+        ++misses_;
+        return SharedNetworkMessage();
+    }
+    ++hits_;
+    blocksByRecency_.splice(blocksByRecency_.begin(), blocksByRecency_, it->second);
+    return it->second->second;
+}
+
+void SerializedBlockCache::insert(const uint256& blockHash, const SharedNetworkMessage& blockMessage)
+{
+    if(!blockMessage) return;
+
+    LOCK(cs_);
+    if(blockMessage->size() > maximumBytes_ || blockByHash_.count(blockHash) > 0u) return;
+
+    evictUntilSizeIsAtMost(maximumBytes_ - blockMessage->size());
+    blocksByRecency_.push_front(std::make_pair(blockHash, blockMessage));
+    blockByHash_[blockHash] = blocksByRecency_.begin();
+    usedBytes_ += blockMessage->size();
+}
+
+bool SerializedBlockCache::contains(const uint256& blockHash) const
+{
+    LOCK(cs_);
+    return blockByHash_.count(blockHash) > 0u;
+}
+
+SerializedBlockCache::Statistics SerializedBlockCache::getStatistics() const
+{
+    LOCK(cs_);
+    Statistics statistics;
+    statistics.hits = hits_;
+    statistics.misses = misses_;
+    statistics.numberOfBlocks = blockByHash_.size();
+    statistics.usedBytes = usedBytes_;
+    statistics.maximumBytes = maximumBytes_;
+    return statistics;
+}
+
+void SerializedBlockCache::clear()
+{
+    LOCK(cs_);
+    blocksByRecency_.clear();
+    blockByHash_.clear();
+    usedBytes_ = 0u;
+}
@@ -0,0 +1,56 @@
+#ifndef SERIALIZED_BLOCK_CACHE_H
+#define SERIALIZED_BLOCK_CACHE_H
+
+#include <stdint.h>
+
+#include <list>
+#include <map>
+#include <utility>
+
+#include <Node.h>
+#include <sync.h>
+#include <uint256.h>
+
+/** Recently served or connected blocks as complete "block" network messages,
+ *  so that peers asking for the same block share one buffer instead of each
+ *  reading and reserializing it.  The least recently used blocks are dropped
+ *  once the cached messages exceed the byte limit.  */
+class SerializedBlockCache
+{
+public:
+    struct Statistics
+    {
+        uint64_t hits;
+        uint64_t misses;
+        size_t numberOfBlocks;
+        size_t usedBytes;
+        size_t maximumBytes;
+
+        double hitRate() const;
+    };
+
+private:
+    typedef std::list<std::pair<uint256, SharedNetworkMessage>> BlocksByRecency;
+
+    mutable CCriticalSection cs_;
+    const size_t maximumBytes_;
+    size_t usedBytes_;
+    BlocksByRecency blocksByRecency_;
+    std::map<uint256, BlocksByRecency::iterator> blockByHash_;
+    uint64_t hits_;
+    uint64_t misses_;
+
+    void evictUntilSizeIsAtMost(size_t maximumBytes);
+
+public:
+    explicit SerializedBlockCache(size_t maximumBytes);
+
+    bool isEnabled() const;
+    /** Returns the cached message or an empty pointer, counting hits and misses. */
+    SharedNetworkMessage get(const uint256& blockHash);
+    void insert(const uint256& blockHash, const SharedNetworkMessage& blockMessage);
+    bool contains(const uint256& blockHash) const;
+    Statistics getStatistics() const;
+    void clear();
+};
+#endif// SERIALIZED_BLOCK_CACHE_H
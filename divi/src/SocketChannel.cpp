@@ -2,6 +2,12 @@
 #include <netbase.h>
 #include <Logging.h>
 
+#include <algorithm>
+#include <string.h>
+#ifndef WIN32
+#include <sys/uio.h>
+#endif
+
 SocketChannel::SocketChannel(SOCKET socket): socket_(socket)
 {
 }
@@ -13,6 +19,29 @@ int SocketChannel::sendData(const void* buffer, size_t len) const
     return send(socket_, buffer, len, MSG_NOSIGNAL | MSG_DONTWAIT);
 #endif
 }
+int SocketChannel::sendData(const ConstDataBuffer* buffers, size_t numberOfBuffers) const
+{
+    if (numberOfBuffers == 0)
+        return 0;
+#ifdef WIN32
+    return sendData(buffers[0].data, buffers[0].len);
+#else
+    // sendmsg is writev with send flags, so a closed peer cannot raise SIGPIPE.
+    constexpr size_t maximumBuffersPerCall = 64;
+    struct iovec iov[maximumBuffersPerCall];
+    const size_t buffersToSend = std::min(numberOfBuffers, maximumBuffersPerCall);
+    for (size_t index = 0; index < buffersToSend; ++index)
+    {
+        iov[index].iov_base = const_cast<void*>(buffers[index].data);
+        iov[index].iov_len = buffers[index].len;
+    }
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = iov;
+    message.msg_iovlen = buffersToSend;
+    return sendmsg(socket_, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
+}
 int SocketChannel::receiveData(void* buffer, size_t len) const
 {
 #ifdef WIN32
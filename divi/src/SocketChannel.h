@@ -9,6 +9,7 @@ private:
 public:
     SocketChannel(SOCKET socket);
     virtual int sendData(const void* buffer, size_t len) const;
+    virtual int sendData(const ConstDataBuffer* buffers, size_t numberOfBuffers) const;
     virtual int receiveData(void* buffer, size_t len) const;
     virtual void close();
     virtual bool isValid() const;
@@ -0,0 +1,34 @@
+#include <StakeKernelHasher.h>
+
+#include <crypto/common.h>
+#include <primitives/transaction.h>
+#include <string.h>
+
+StakeKernelHasher::StakeKernelHasher(
+    uint64_t stakeModifier,
+    unsigned int coinstakeStartTime,
+    const COutPoint& utxoToStake
+    ): prefixState_()
+{
+    // Same byte layout as serializing the fields through a CDataStream
+    unsigned char prefix[PREFIX_SIZE];
+    WriteLE64(prefix, stakeModifier);
+    WriteLE32(prefix + 8, coinstakeStartTime);
+    WriteLE32(prefix + 12, utxoToStake.n);
+    memcpy(prefix + 16, utxoToStake.hash.begin(), 32);
+    prefixState_.Write(prefix, PREFIX_SIZE);
+}
+
+uint256 StakeKernelHasher::computeHash(unsigned int hashproofTimestamp) const
+{
+    unsigned char timestamp[4];
+    WriteLE32(timestamp, hashproofTimestamp);
+
+    unsigned char firstRound[CSHA256::OUTPUT_SIZE];
+    CSHA256 state = prefixState_;
+    state.Write(timestamp, sizeof(timestamp)).Finalize(firstRound);
+
+    uint256 result;
+    state.Reset().Write(firstRound, sizeof(firstRound)).Finalize(result.begin());
+    return result;
+}
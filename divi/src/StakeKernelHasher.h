@@ -0,0 +1,28 @@
+#ifndef STAKE_KERNEL_HASHER_H
+#define STAKE_KERNEL_HASHER_H
+#include <stdint.h>
+#include <crypto/sha256.h>
+#include <uint256.h>
+class COutPoint;
+
+/**
+ * Computes the proof-of-stake kernel hash
+ *   SHA256d(stakeModifier || coinstakeStartTime || prevout.n || prevout.hash || hashproofTimestamp)
+ * for a single utxo. The fixed prefix is serialized once and the SHA256 state
+ * after absorbing it is kept, so that hashing a new timestamp only requires
+ * appending its 4 trailing bytes and finalizing.
+ */
+class StakeKernelHasher
+{
+private:
+    static constexpr size_t PREFIX_SIZE = 8 + 4 + 4 + 32;
+    CSHA256 prefixState_;
+public:
+    StakeKernelHasher(
+        uint64_t stakeModifier,
+        unsigned int coinstakeStartTime,
+        const COutPoint& utxoToStake);
+
+    uint256 computeHash(unsigned int hashproofTimestamp) const;
+};
+#endif// STAKE_KERNEL_HASHER_H
@@ -11,7 +11,7 @@
 #include <ThreadManagementHelpers.h>
 
 extern int nScriptCheckThreads;
-static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+static CCheckQueue<CScriptCheck> scriptcheckqueue(128, MAX_SCRIPTCHECK_THREADS);
 
 void TransactionInputChecker::ThreadScriptCheck()
 {
@@ -0,0 +1,63 @@
+#include <UnlockedKeyCache.h>
+
+constexpr size_t UnlockedKeyCache::SECRET_SIZE;
+
+UnlockedKeyCache::UnlockedKeyCache(
+    ): cs_cache()
+    , secrets_()
+    , secretOffsetAndCompressionByKeyId_()
+    , hdChainKeys_()
+{
+}
+
+bool UnlockedKeyCache::getKey(const CKeyID& keyID, CKey& keyOut) const
+{
+    LOCK(cs_cache);
+    auto it = secretOffsetAndCompressionByKeyId_.find(keyID);
+    if(it == secretOffsetAndCompressionByKeyId_.end()) return false;
+
+    const unsigned char* secret = secrets_.data() + it->second.first;
+    keyOut.Set(secret, secret + SECRET_SIZE, it->second.second);
+    return keyOut.IsValid();
+}
+
+void UnlockedKeyCache::addKey(const CKeyID& keyID, const CKey& key)
+{
+    if(!key.IsValid() || key.size() != SECRET_SIZE) return;
+
+    LOCK(cs_cache);
+    if(secretOffsetAndCompressionByKeyId_.count(keyID) > 0) return;
+    // Growing the buffer moves the secrets; the old copy is wiped as it is released
+    secretOffsetAndCompressionByKeyId_[keyID] = std::make_pair(secrets_.size(), key.IsCompressed());
+    secrets_.insert(secrets_.end(), key.begin(), key.end());
+}
+
+bool UnlockedKeyCache::getHDChainKey(const uint256& hdChainId, uint32_t nAccountIndex, bool fInternal, CExtKey& chainKeyOut) const
+{
+    LOCK(cs_cache);
+    auto it = hdChainKeys_.find(std::make_tuple(hdChainId, nAccountIndex, fInternal));
+    if(it == hdChainKeys_.end()) return false;
+    chainKeyOut = it->second;
+    return true;
+}
+
+void UnlockedKeyCache::addHDChainKey(const uint256& hdChainId, uint32_t nAccountIndex, bool fInternal, const CExtKey& chainKey)
+{
+    LOCK(cs_cache);
+    hdChainKeys_[std::make_tuple(hdChainId, nAccountIndex, fInternal)] = chainKey;
+}
+
+void UnlockedKeyCache::clear()
+{
+    LOCK(cs_cache);
+    // Swapping releases the buffer, rather than only resetting its size
+    SecureVector().swap(secrets_);
+    secretOffsetAndCompressionByKeyId_.clear();
+    hdChainKeys_.clear();
+}
+
+size_t UnlockedKeyCache::numberOfKeys() const
+{
+    LOCK(cs_cache);
+    return secretOffsetAndCompressionByKeyId_.size();
+}
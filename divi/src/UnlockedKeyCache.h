@@ -0,0 +1,46 @@
+#ifndef UNLOCKED_KEY_CACHE_H
+#define UNLOCKED_KEY_CACHE_H
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <tuple>
+#include <utility>
+#include <allocators.h>
+#include <key.h>
+#include <pubkey.h>
+#include <sync.h>
+#include <uint256.h>
+
+/**
+ * The private keys an encrypted wallet has used since it was unlocked, kept
+ * so that signing with a key only decrypts and checks it the first time.
+ *
+ * Key secrets are stored back to back in one buffer allocated through the
+ * LockedPageManager, so that they share a few locked pages and are wiped in one
+ * go when the wallet gets locked again. The extended keys of HD chains are kept
+ * as well, which turns deriving an HD key from a BIP44 path walk from the seed
+ * into a single derivation step.
+ */
+class UnlockedKeyCache
+{
+private:
+    static constexpr size_t SECRET_SIZE = 32u;
+
+    mutable CCriticalSection cs_cache;
+    SecureVector secrets_;
+    std::map<CKeyID, std::pair<size_t, bool>> secretOffsetAndCompressionByKeyId_;
+    std::map<std::tuple<uint256, uint32_t, bool>, CExtKey> hdChainKeys_;
+
+public:
+    UnlockedKeyCache();
+
+    bool getKey(const CKeyID& keyID, CKey& keyOut) const;
+    void addKey(const CKeyID& keyID, const CKey& key);
+    bool getHDChainKey(const uint256& hdChainId, uint32_t nAccountIndex, bool fInternal, CExtKey& chainKeyOut) const;
+    void addHDChainKey(const uint256& hdChainId, uint32_t nAccountIndex, bool fInternal, const CExtKey& chainKey);
+    /** Wipes every cached secret. */
+    void clear();
+
+    size_t numberOfKeys() const;
+};
+#endif// UNLOCKED_KEY_CACHE_H
@@ -21,6 +21,7 @@ VaultManager::VaultManager(
     , outputTracker_(new SpentOutputTracker(*walletTxRecord_,confirmationsCalculator_))
     , managedScripts_()
     , whiteListedScripts_()
+    , revision_(0)
 {
     LOCK(cs_vaultManager_);
     vaultManagerDB_.ReadManagedScripts(managedScripts_);
@@ -160,6 +161,7 @@ void VaultManager::addTransaction(const CTransaction& tx, const CBlock *pblock,
         CWalletTx walletTx(tx);
         if(!blockIsNull) walletTx.SetMerkleBranch(*pblock);
         std::pair<CWalletTx*, bool> walletTxAndRecordStatus = outputTracker_->UpdateSpends(walletTx,false);
+        ++revision_;
 
         if(deposit || txIsWhiteListed || (tx.IsCoinStake() && !allInputsAreKnown(tx)) )
         {
@@ -185,6 +187,7 @@ void VaultManager::addManagedScript(const CScript& script)
     if(managedScripts_.count(script) == 0)
     {
         managedScripts_.insert(script);
+        ++revision_;
         vaultManagerDB_.WriteManagedScript(script);
     }
 }
@@ -203,6 +206,7 @@ void VaultManager::removeManagedScript(const CScript& script)
     if(managedScripts_.count(script) > 0)
     {
         managedScripts_.erase(script);
+        ++revision_;
         vaultManagerDB_.EraseManagedScript(script);
     }
 }
@@ -240,6 +244,18 @@ UnspentOutputs VaultManager::getManagedUTXOs(VaultUTXOFilters filter) const
     return outputs;
 }
 
+uint64_t VaultManager::getRevision() const
+{
+    LOCK(cs_vaultManager_);
+    return revision_;
+}
+
+bool VaultManager::hasTransaction(const uint256& hash) const
+{
+    LOCK(cs_vaultManager_);
+    return walletTxRecord_->GetWalletTx(hash) != nullptr;
+}
+
 const CWalletTx& VaultManager::getTransaction(const uint256& hash) const
 {
     static CWalletTx dummyValue;
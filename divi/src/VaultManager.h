@@ -4,6 +4,7 @@
 #include <map>
 #include <set>
 #include <memory>
+#include <stdint.h>
 #include <sync.h>
 #include <Output.h>
 
@@ -41,6 +42,7 @@ private:
     std::unique_ptr<SpentOutputTracker> outputTracker_;
     ManagedScripts managedScripts_;
     ManagedScripts whiteListedScripts_;
+    uint64_t revision_;
 
     bool isManagedScript(const CScript& script) const;
     bool transactionIsWhitelisted(const CTransaction& tx) const;
@@ -60,7 +62,11 @@ public:
     void removeManagedScript(const CScript& script);
     UnspentOutputs getManagedUTXOs(VaultUTXOFilters filter = VaultUTXOFilters::CONFIRMED_AND_MATURED) const;
 
+    /** Counter that changes whenever transactions or managed scripts are added or removed */
+    uint64_t getRevision() const;
+
     const CWalletTx& getTransaction(const uint256&) const;
+    bool hasTransaction(const uint256& hash) const;
     const ManagedScripts& getManagedScriptLimits() const;
 };
 #endif// VAULT_MANAGER_H
@@ -0,0 +1,132 @@
+#include <WalletBalanceLedger.h>
+
+#include <chain.h>
+
+WalletBalanceContribution::WalletBalanceContribution(
+    ): trustedAvailableCredit(0)
+    , creditByCoinType()
+    , dependsOnChainState(false)
+{
+}
+
+WalletBalanceContribution& WalletBalanceContribution::operator+=(const WalletBalanceContribution& other)
+{
+    trustedAvailableCredit += other.trustedAvailableCredit;
+    for(unsigned coinType = 0; coinType < NUMBER_OF_COIN_TYPES; ++coinType)
+    {
+        creditByCoinType[coinType] += other.creditByCoinType[coinType];
+    }
+    return *this;
+}
+
+WalletBalanceContribution& WalletBalanceContribution::operator-=(const WalletBalanceContribution& other)
+{
+    trustedAvailableCredit -= other.trustedAvailableCredit;
+    for(unsigned coinType = 0; coinType < NUMBER_OF_COIN_TYPES; ++coinType)
+    {
+        creditByCoinType[coinType] -= other.creditByCoinType[coinType];
+    }
+    return *this;
+}
+
+WalletBalanceLedger::WalletBalanceLedger(
+    ): contributionByTxHash_()
+    , modifiedTxHashes_()
+    , chainStateDependentTxHashes_()
+    , totals_()
+    , chainTipAtLastSync_(nullptr)
+    , requiresRebuild_(true)
+    , vaultBalance_(0)
+    , chainTipAtLastVaultSync_(nullptr)
+    , vaultRevisionAtLastSync_(0)
+    , vaultBalanceIsSet_(false)
+{
+}
+
+void WalletBalanceLedger::invalidate()
+{
+    requiresRebuild_ = true;
+    vaultBalanceIsSet_ = false;
+}
+
+void WalletBalanceLedger::markModified(const uint256& txHash)
+{
+    if(!requiresRebuild_) modifiedTxHashes_.insert(txHash);
+}
+
+bool WalletBalanceLedger::requiresRebuild(const CChain& activeChain) const
+{
+    if(requiresRebuild_) return true;
+    return chainTipAtLastSync_ != nullptr && !activeChain.Contains(chainTipAtLastSync_);
+}
+
+void WalletBalanceLedger::clear()
+{
+    contributionByTxHash_.clear();
+    modifiedTxHashes_.clear();
+    chainStateDependentTxHashes_.clear();
+    totals_ = WalletBalanceContribution();
+}
+
+std::set<uint256> WalletBalanceLedger::getTransactionsToReevaluate() const
+{
+    std::set<uint256> txHashes = modifiedTxHashes_;
+    txHashes.insert(chainStateDependentTxHashes_.begin(),chainStateDependentTxHashes_.end());
+    return txHashes;
+}
+
+void WalletBalanceLedger::update(const uint256& txHash, const WalletBalanceContribution& contribution)
+{
+    WalletBalanceContribution& recordedContribution = contributionByTxHash_[txHash];
+    totals_ -= recordedContribution;
+    totals_ += contribution;
+    recordedContribution = contribution;
+
+    if(contribution.dependsOnChainState)
+    {
+        chainStateDependentTxHashes_.insert(txHash);
+    }
+    else
+    {
+        chainStateDependentTxHashes_.erase(txHash);
+    }
+}
+
+void WalletBalanceLedger::remove(const uint256& txHash)
+{
+    auto it = contributionByTxHash_.find(txHash);
+    if(it == contributionByTxHash_.end()) return;
+    totals_ -= it->second;
+    contributionByTxHash_.erase(it);
+    chainStateDependentTxHashes_.erase(txHash);
+}
+
+void WalletBalanceLedger::recordSynchronization(const CBlockIndex* chainTip)
+{
+    modifiedTxHashes_.clear();
+    chainTipAtLastSync_ = chainTip;
+    requiresRebuild_ = false;
+}
+
+const WalletBalanceContribution& WalletBalanceLedger::totals() const
+{
+    return totals_;
+}
+
+bool WalletBalanceLedger::vaultBalanceIsCurrent(const CBlockIndex* chainTip, uint64_t vaultRevision) const
+{
+    return vaultBalanceIsSet_ && chainTipAtLastVaultSync_ == chainTip && vaultRevisionAtLastSync_ == vaultRevision;
+}
+
+void WalletBalanceLedger::updateVaultBalance(const CBlockIndex* chainTip, uint64_t vaultRevision, CAmount vaultBalance)
+{
+    vaultBalance_ = vaultBalance;
+    chainTipAtLastVaultSync_ = chainTip;
+    vaultRevisionAtLastSync_ = vaultRevision;
+    vaultBalanceIsSet_ = true;
+}
+
+CAmount WalletBalanceLedger::vaultBalance() const
+{
+    return vaultBalance_;
+}
@@ -0,0 +1,70 @@
+#ifndef WALLET_BALANCE_LEDGER_H
+#define WALLET_BALANCE_LEDGER_H
+#include <map>
+#include <set>
+#include <stdint.h>
+#include <amount.h>
+#include <uint256.h>
+
+class CBlockIndex;
+class CChain;
+
+struct WalletBalanceContribution
+{
+    static constexpr unsigned NUMBER_OF_COIN_TYPES = 3u;
+
+    CAmount trustedAvailableCredit;
+    CAmount creditByCoinType[NUMBER_OF_COIN_TYPES]; // Indexed by AvailableCoinsType
+    /** Whether the contribution can change without the wallet being notified,
+     *  i.e. it depends on the chain height, the block time or the mempool.  */
+    bool dependsOnChainState;
+
+    WalletBalanceContribution();
+    WalletBalanceContribution& operator+=(const WalletBalanceContribution& other);
+    WalletBalanceContribution& operator-=(const WalletBalanceContribution& other);
+};
+
+/**
+ * Running totals of the wallet balances, maintained per transaction so that
+ * balance queries don't need to scan every wallet transaction.
+ *
+ * Transactions are re-evaluated when they are marked as modified (added,
+ * updated, spent from or (un)locked) and, on every synchronization, when their
+ * contribution depends on the chain state (unconfirmed, conflicted, immature
+ * or non-final transactions). Any chain reorganization that disconnects the
+ * tip of the last synchronization forces a full rebuild.
+ */
+class WalletBalanceLedger
+{
+private:
+    std::map<uint256, WalletBalanceContribution> contributionByTxHash_;
+    std::set<uint256> modifiedTxHashes_;
+    std::set<uint256> chainStateDependentTxHashes_;
+    WalletBalanceContribution totals_;
+    const CBlockIndex* chainTipAtLastSync_;
+    bool requiresRebuild_;
+
+    CAmount vaultBalance_;
+    const CBlockIndex* chainTipAtLastVaultSync_;
+    uint64_t vaultRevisionAtLastSync_;
+    bool vaultBalanceIsSet_;
+
+public:
+    WalletBalanceLedger();
+
+    void invalidate();
+    void markModified(const uint256& txHash);
+
+    bool requiresRebuild(const CChain& activeChain) const;
+    void clear();
+    std::set<uint256> getTransactionsToReevaluate() const;
+    void update(const uint256& txHash, const WalletBalanceContribution& contribution);
+    void remove(const uint256& txHash);
+    void recordSynchronization(const CBlockIndex* chainTip);
+    const WalletBalanceContribution& totals() const;
+
+    bool vaultBalanceIsCurrent(const CBlockIndex* chainTip, uint64_t vaultRevision) const;
+    void updateVaultBalance(const CBlockIndex* chainTip, uint64_t vaultRevision, CAmount vaultBalance);
+    CAmount vaultBalance() const;
+};
+#endif// WALLET_BALANCE_LEDGER_H
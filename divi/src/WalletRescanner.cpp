@@ -9,6 +9,190 @@
 #include <Logging.h>
 #include <utiltime.h>
 #include <checkpoints.h>
+#include <RescanTransactionFilter.h>
+#include <StartAndShutdownSignals.h>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <algorithm>
+#include <deque>
+
+namespace
+{
+//! Number of blocks read ahead of the wallet
+constexpr unsigned RESCAN_WINDOW_SIZE = 256;
+constexpr unsigned RESCAN_READER_THREADS = 2;
+constexpr unsigned MAX_RESCAN_MATCHER_THREADS = 8;
+//! Number of blocks handed to the wallet per acquisition of the main and wallet locks
+constexpr unsigned RESCAN_BLOCKS_PER_LOCK = 50;
+
+bool RescanShouldAbort()
+{
+    const auto& shutdownRequested = StartAndShutdownSignals::instance().shutdownRequested;
+    return !shutdownRequested.empty() && *shutdownRequested();
+}
+
+struct PrefetchedBlock
+{
+    enum Stage { PENDING, READ, MATCHED };
+
+    Stage stage;
+    bool readSucceeded;
+    CBlock block;
+    std::vector<bool> transactionMayBeRelevant;
+
+    PrefetchedBlock(): stage(PENDING), readSucceeded(false), block(), transactionMayBeRelevant() {}
+};
+
+/**
+ * Reads the given blocks ahead of the consumer into a bounded window and runs
+ * the rescan filter over their transactions, on two pools of threads.
+ */
+class RescanPipeline
+{
+private:
+    const I_BlockDataReader& blockReader_;
+    const RescanTransactionFilter& filter_;
+    const std::vector<CBlockIndex*>& blocksToScan_;
+    std::vector<PrefetchedBlock> window_;
+    std::deque<size_t> blocksToMatch_;
+    size_t nextBlockToRead_;
+    size_t nextBlockToConsume_;
+    bool stopping_;
+    boost::mutex mutex_;
+    boost::condition_variable stateChanged_;
+    boost::thread_group threads_;
+
+    PrefetchedBlock& slot(size_t position) { return window_[position % window_.size()]; }
+
+    void readBlocks()
+    {
+        while(true)
+        {
+            size_t position;
+            {
+                boost::unique_lock<boost::mutex> lock(mutex_);
+                while(!stopping_ &&
+                    !(nextBlockToRead_ < blocksToScan_.size() && nextBlockToRead_ < nextBlockToConsume_ + window_.size()))
+                {
+                    stateChanged_.wait(lock);
+                }
+                if(stopping_) return;
+                position = nextBlockToRead_++;
+            }
+            PrefetchedBlock& prefetchedBlock = slot(position);
+            prefetchedBlock.readSucceeded = blockReader_.ReadBlock(blocksToScan_[position], prefetchedBlock.block);
+            {
+                boost::unique_lock<boost::mutex> lock(mutex_);
+                prefetchedBlock.stage = PrefetchedBlock::READ;
+                blocksToMatch_.push_back(position);
+            }
+            stateChanged_.notify_all();
+        }
+    }
+
+    void matchBlocks()
+    {
+        while(true)
+        {
+            size_t position;
+            {
+                boost::unique_lock<boost::mutex> lock(mutex_);
+                while(!stopping_ && blocksToMatch_.empty())
+                {
+                    stateChanged_.wait(lock);
+                }
+                if(stopping_) return;
+                position = blocksToMatch_.front();
+                blocksToMatch_.pop_front();
+            }
+            PrefetchedBlock& prefetchedBlock = slot(position);
+            const std::vector<CTransaction>& transactions = prefetchedBlock.block.vtx;
+            prefetchedBlock.transactionMayBeRelevant.assign(transactions.size(), false);
+            for(size_t txIndex = 0; txIndex < transactions.size(); ++txIndex)
+            {
+                prefetchedBlock.transactionMayBeRelevant[txIndex] = filter_.outputsMayBeRelevant(transactions[txIndex]);
+            }
+            {
+                boost::unique_lock<boost::mutex> lock(mutex_);
+                prefetchedBlock.stage = PrefetchedBlock::MATCHED;
+            }
+            stateChanged_.notify_all();
+        }
+    }
+
+public:
+    RescanPipeline(
+        const I_BlockDataReader& blockReader,
+        const RescanTransactionFilter& filter,
+        const std::vector<CBlockIndex*>& blocksToScan
+        ): blockReader_(blockReader)
+        , filter_(filter)
+        , blocksToScan_(blocksToScan)
+        , window_(std::min<size_t>(RESCAN_WINDOW_SIZE, std::max<size_t>(blocksToScan.size(), 1u)))
+        , blocksToMatch_()
+        , nextBlockToRead_(0)
+        , nextBlockToConsume_(0)
+        , stopping_(false)
+        , mutex_()
+        , stateChanged_()
+        , threads_()
+    {
+        const unsigned numberOfMatchers =
+            std::max(1u, std::min(MAX_RESCAN_MATCHER_THREADS, boost::thread::hardware_concurrency()));
+        for(unsigned threadIndex = 0; threadIndex < RESCAN_READER_THREADS; ++threadIndex)
+        {
+            threads_.create_thread(boost::bind(&RescanPipeline::readBlocks, this));
+        }
+        for(unsigned threadIndex = 0; threadIndex < numberOfMatchers; ++threadIndex)
+        {
+            threads_.create_thread(boost::bind(&RescanPipeline::matchBlocks, this));
+        }
+    }
+
+    ~RescanPipeline()
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        stateChanged_.notify_all();
+        threads_.join_all();
+    }
+
+    /** Blocks until the next block in chain order has been read and filtered. */
+    const PrefetchedBlock& waitForNextBlock()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        PrefetchedBlock& prefetchedBlock = slot(nextBlockToConsume_);
+        while(prefetchedBlock.stage != PrefetchedBlock::MATCHED)
+        {
+            stateChanged_.wait(lock);
+        }
+        return prefetchedBlock;
+    }
+
+    bool nextBlockIsReady()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        return nextBlockToConsume_ < blocksToScan_.size() && slot(nextBlockToConsume_).stage == PrefetchedBlock::MATCHED;
+    }
+
+    /** Hands the slot of the block last returned by waitForNextBlock back to the readers. */
+    void releaseBlock()
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(mutex_);
+            PrefetchedBlock& prefetchedBlock = slot(nextBlockToConsume_);
+            prefetchedBlock.stage = PrefetchedBlock::PENDING;
+            prefetchedBlock.block.SetNull();
+            ++nextBlockToConsume_;
+        }
+        stateChanged_.notify_all();
+    }
+};
+}
 
 WalletRescanner::WalletRescanner(
     const I_BlockDataReader& blockReader,
@@ -20,6 +204,34 @@ WalletRescanner::WalletRescanner(
 {
 }
 
+std::vector<CBlockIndex*> WalletRescanner::collectBlocksToScan(CBlockIndex* pindexStart) const
+{
+    AssertLockHeld(mainCS_);
+    std::vector<CBlockIndex*> blocksToScan;
+    if(pindexStart && activeChain_.Tip() && activeChain_.Contains(pindexStart))
+    {
+        blocksToScan.reserve(activeChain_.Height() - pindexStart->nHeight + 1);
+        for(CBlockIndex* pindex = pindexStart; pindex; pindex = activeChain_.Next(pindex))
+        {
+            blocksToScan.push_back(pindex);
+        }
+    }
+    return blocksToScan;
+}
+
+CBlockIndex* WalletRescanner::findFirstBlockToScan(const CWallet& wallet, CBlockIndex* pindexStart) const
+{
+    AssertLockHeld(mainCS_);
+    AssertLockHeld(wallet.cs_wallet);
+    // no need to read and scan block, if block was created before
+    // our wallet birthday (as adjusted for block time variability)
+    CBlockIndex* pindex = pindexStart;
+    const int64_t timestampOfFirstKey = wallet.getTimestampOfFistKey();
+    while (pindex && timestampOfFirstKey && (pindex->GetBlockTime() < (timestampOfFirstKey - 7200)))
+        pindex = activeChain_.Next(pindex);
+    return pindex;
+}
+
 int WalletRescanner::scanForWalletTransactions(CWallet& wallet, CBlockIndex* pindexStart, bool fUpdate)
 {
     static const CCheckpointServices checkpointsVerifier(GetCurrentChainCheckpoints);
@@ -27,36 +239,77 @@ int WalletRescanner::scanForWalletTransactions(CWallet& wallet, CBlockIndex* pin
     int ret = 0;
     int64_t nNow = GetTime();
 
-    CBlockIndex* pindex = pindexStart;
+    RescanTransactionFilter filter;
+    std::vector<CBlockIndex*> blocksToScan;
+    double dProgressStart;
+    double dProgressTip;
     {
         LOCK2(mainCS_, wallet.cs_wallet);
-        // no need to read and scan block, if block was created before
-        // our wallet birthday (as adjusted for block time variability)
-        const int64_t timestampOfFirstKey = wallet.getTimestampOfFistKey();
-        while (pindex && timestampOfFirstKey && (pindex->GetBlockTime() < (timestampOfFirstKey - 7200)))
-            pindex = activeChain_.Next(pindex);
-
-        wallet.ShowProgress(translate("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
-        double dProgressStart = checkpointsVerifier.GuessVerificationProgress(pindex, false);
-        double dProgressTip = checkpointsVerifier.GuessVerificationProgress(activeChain_.Tip(), false);
-        while (pindex) {
-            if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
-                wallet.ShowProgress(translate("Rescanning..."), std::max(1, std::min(99, (int)((checkpointsVerifier.GuessVerificationProgress(pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
-
-            CBlock block;
-            blockReader_.ReadBlock(pindex,block);
-            BOOST_FOREACH (CTransaction& tx, block.vtx)
-            {
-                if (wallet.AddToWalletIfInvolvingMe(tx, &block, fUpdate,TransactionSyncType::RESCAN))
-                    ret++;
+        CBlockIndex* pindex = findFirstBlockToScan(wallet, pindexStart);
+        wallet.BuildRescanTransactionFilter(filter);
+        blocksToScan = collectBlocksToScan(pindex);
+        dProgressStart = checkpointsVerifier.GuessVerificationProgress(pindex, false);
+        dProgressTip = checkpointsVerifier.GuessVerificationProgress(activeChain_.Tip(), false);
+    }
+
+    wallet.ShowProgress(translate("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
+    bool aborted = false;
+    while (!blocksToScan.empty() && !aborted) {
+        RescanPipeline pipeline(blockReader_, filter, blocksToScan);
+        CBlockIndex* pindexLastScanned = nullptr;
+        bool chainChanged = false;
+        size_t position = 0;
+        while (position < blocksToScan.size() && !chainChanged) {
+            if (RescanShouldAbort()) {
+                LogPrintf("Rescan aborted at block %d\n", blocksToScan[position]->nHeight);
+                aborted = true;
+                break;
             }
-            pindex = activeChain_.Next(pindex);
-            if (GetTime() >= nNow + 60) {
+            pipeline.waitForNextBlock();
+
+            LOCK2(mainCS_, wallet.cs_wallet);
+            for (unsigned blocksInChunk = 0; blocksInChunk < RESCAN_BLOCKS_PER_LOCK && position < blocksToScan.size(); ++blocksInChunk) {
+                if (blocksInChunk > 0 && !pipeline.nextBlockIsReady())
+                    break;
+                CBlockIndex* pindex = blocksToScan[position];
+                if (!activeChain_.Contains(pindex)) {
+                    chainChanged = true;
+                    break;
+                }
+                if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
+                    wallet.ShowProgress(translate("Rescanning..."), std::max(1, std::min(99, (int)((checkpointsVerifier.GuessVerificationProgress(pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
+
+                const PrefetchedBlock& prefetchedBlock = pipeline.waitForNextBlock();
+                if (!prefetchedBlock.readSucceeded)
+                    LogPrintf("%s : failed to read block %s at height %d\n", __func__, pindex->GetBlockHash().ToString(), pindex->nHeight);
+                const CBlock& block = prefetchedBlock.block;
+                for (size_t txIndex = 0; txIndex < block.vtx.size(); ++txIndex) {
+                    const CTransaction& tx = block.vtx[txIndex];
+                    if (!prefetchedBlock.transactionMayBeRelevant[txIndex] && !wallet.SpendsKnownTransaction(tx))
+                        continue;
+                    if (wallet.AddToWalletIfInvolvingMe(tx, &block, fUpdate, TransactionSyncType::RESCAN))
+                        ret++;
+                }
+                pipeline.releaseBlock();
+                pindexLastScanned = pindex;
+                ++position;
+            }
+
+            if (GetTime() >= nNow + 60 && pindexLastScanned) {
                 nNow = GetTime();
-                LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, checkpointsVerifier.GuessVerificationProgress(pindex));
+                LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindexLastScanned->nHeight, checkpointsVerifier.GuessVerificationProgress(pindexLastScanned));
             }
         }
-        wallet.ShowProgress(translate("Rescanning..."), 100); // hide progress dialog in GUI
+        if (aborted)
+            break;
+
+        // Blocks may have been connected or disconnected while the locks were
+        // released; continue with whatever the active chain now holds past the
+        // last block handed to the wallet.
+        LOCK(mainCS_);
+        const CBlockIndex* pindexFork = activeChain_.FindFork(pindexLastScanned ? pindexLastScanned : blocksToScan.front());
+        blocksToScan = collectBlocksToScan(pindexFork ? activeChain_.Next(pindexFork) : nullptr);
     }
+    wallet.ShowProgress(translate("Rescanning..."), 100); // hide progress dialog in GUI
     return ret;
-}
\ No newline at end of file
+}
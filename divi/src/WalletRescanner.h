@@ -1,18 +1,30 @@
 #ifndef WALLET_RESCANNER_H
 #define WALLET_RESCANNER_H
+#include <vector>
 class I_BlockDataReader;
 class CBlockIndex;
 class CChain;
 class CWallet;
 class CCriticalSection;
+class RescanTransactionFilter;
 
+/**
+ * Rescans the active chain for wallet transactions. Blocks are read ahead on
+ * I/O threads and their transactions filtered against a snapshot of the
+ * wallet's keys and scripts on matching threads; only the transactions that
+ * pass are handed to the wallet, in chain order and under the main and wallet
+ * locks, which are released between short chunks of blocks.
+ */
 class WalletRescanner
 {
     const I_BlockDataReader& blockReader_;
     const CChain& activeChain_;
     CCriticalSection& mainCS_;
+
+    std::vector<CBlockIndex*> collectBlocksToScan(CBlockIndex* pindexStart) const;
+    CBlockIndex* findFirstBlockToScan(const CWallet& wallet, CBlockIndex* pindexStart) const;
 public:
     WalletRescanner(const I_BlockDataReader& blockReader, const CChain& activeChain, CCriticalSection& mainCS);
     int scanForWalletTransactions(CWallet& wallet, CBlockIndex* pindexStart, bool fUpdate);
 };
-#endif// WALLET_RESCANNER_H
\ No newline at end of file
+#endif// WALLET_RESCANNER_H
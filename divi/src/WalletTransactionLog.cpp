@@ -0,0 +1,454 @@
+#include <WalletTransactionLog.h>
+
+#include <algorithm>
+#include <string.h>
+#include <vector>
+
+#include <clientversion.h>
+#include <crypto/common.h>
+#include <hash.h>
+#include <Logging.h>
+#include <util.h>
+
+#include <boost/filesystem.hpp>
+
+#ifdef WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace fs = boost::filesystem;
+
+static const unsigned char LOG_MAGIC[8] = {'d', 'v', 't', 'x', 'l', 'o', 'g', 1};
+static const unsigned char INDEX_MAGIC[8] = {'d', 'v', 't', 'x', 'i', 'd', 'x', 1};
+/** Key and payload size in front of every record in the log */
+static const uint64_t RECORD_HEADER_SIZE = 32 + 4;
+/** Key, offset, size and checksum of a record in the index */
+static const uint64_t INDEX_ENTRY_SIZE = 32 + 8 + 4 + 4;
+/** Rewriting a log with less stale data than this is not worth the time at startup. */
+static const uint64_t MIN_STALE_BYTES_TO_COMPACT = 1 << 20;
+
+namespace
+{
+uint32_t RecordChecksum(const char* begin, const char* end)
+{
+    return ReadLE32(Hash(begin, end).begin());
+}
+
+/** Read-only view of the first size bytes of a file, mapped into memory where the platform allows. */
+class ReadOnlyFileMapping
+{
+private:
+    const char* data_;
+    uint64_t size_;
+    bool isValid_;
+#ifdef WIN32
+    std::vector<char> buffer_;
+#endif
+
+public:
+    ReadOnlyFileMapping(
+        const fs::path& path,
+        uint64_t size
+        ): data_(nullptr)
+        , size_(size)
+        , isValid_(size == 0u)
+    {
+        if(size == 0u) return;
+#ifdef WIN32
+        std::ifstream file(path.string().c_str(), std::ios::binary);
+        buffer_.resize(size);
+        if(file.read(buffer_.data(), size))
+        {
+            data_ = buffer_.data();
+            isValid_ = true;
+        }
+#else
+        int fd = open(path.string().c_str(), O_RDONLY);
+        if(fd < 0) return;
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(mapping == MAP_FAILED) return;
+        data_ = static_cast<const char*>(mapping);
+        isValid_ = true;
+#endif
+    }
+    ~ReadOnlyFileMapping()
+    {
+#ifndef WIN32
+        if(data_ != nullptr) munmap(const_cast<char*>(data_), size_);
+#endif
+    }
+    bool isValid() const
+    {
+        return isValid_;
+    }
+    const char* data() const
+    {
+        return data_;
+    }
+
+private:
+    ReadOnlyFileMapping(const ReadOnlyFileMapping&) = delete;
+    void operator=(const ReadOnlyFileMapping&) = delete;
+};
+
+typedef std::pair<uint256, WalletTransactionLog::RecordLocation> KeyAndLocation;
+
+std::vector<KeyAndLocation> SortedByOffset(const std::map<uint256, WalletTransactionLog::RecordLocation>& locationByKey)
+{
+    std::vector<KeyAndLocation> records(locationByKey.begin(), locationByKey.end());
+    std::sort(records.begin(), records.end(),
+        [](const KeyAndLocation& a, const KeyAndLocation& b) { return a.second.offset < b.second.offset; });
+    return records;
+}
+
+bool CreateFileWithMagic(const fs::path& path, const unsigned char (&magic)[8])
+{
+    FILE* file = fopen(path.string().c_str(), "wb");
+    if(file == nullptr) return false;
+    const bool written = fwrite(magic, 1, sizeof(magic), file) == sizeof(magic);
+    FileCommit(file);
+    fclose(file);
+    return written;
+}
+
+bool HasMagic(const fs::path& path, const unsigned char (&magic)[8])
+{
+    FILE* file = fopen(path.string().c_str(), "rb");
+    if(file == nullptr) return false;
+    unsigned char buffer[sizeof(magic)];
+    const bool matches = fread(buffer, 1, sizeof(buffer), file) == sizeof(buffer) && memcmp(buffer, magic, sizeof(magic)) == 0;
+    fclose(file);
+    return matches;
+}
+}
+
+WalletTransactionLog::WalletTransactionLog(
+    const boost::filesystem::path& logPath
+    ): cs_log()
+    , logPath_(logPath)
+    , indexPath_(logPath.string() + ".idx")
+    , logFile_(nullptr)
+    , indexFile_(nullptr)
+    , logSize_(0u)
+    , liveBytes_(0u)
+    , locationByKey_()
+{
+}
+
+WalletTransactionLog::~WalletTransactionLog()
+{
+    LOCK(cs_log);
+    Close();
+}
+
+void WalletTransactionLog::Close()
+{
+    if(logFile_ != nullptr)
+    {
+        FileCommit(logFile_);
+        fclose(logFile_);
+        logFile_ = nullptr;
+    }
+    if(indexFile_ != nullptr)
+    {
+        FileCommit(indexFile_);
+        fclose(indexFile_);
+        indexFile_ = nullptr;
+    }
+}
+
+bool WalletTransactionLog::Open()
+{
+    LOCK(cs_log);
+    Close();
+    locationByKey_.clear();
+    liveBytes_ = 0u;
+
+    try
+    {
+        if(!fs::exists(logPath_))
+        {
+            fs::remove(indexPath_);
+            if(!CreateFileWithMagic(logPath_, LOG_MAGIC))
+                return error("%s : Failed to create %s", __func__, logPath_.string());
+        }
+        if(!HasMagic(logPath_, LOG_MAGIC))
+            return error("%s : %s is not a wallet transaction log", __func__, logPath_.string());
+        logSize_ = fs::file_size(logPath_);
+
+        if(!LoadIndex())
+        {
+            LogPrintf("%s : Rebuilding %s from the log\n", __func__, indexPath_.string());
+            locationByKey_.clear();
+            liveBytes_ = 0u;
+            fs::remove(indexPath_);
+        }
+        uint64_t indexedEnd = sizeof(LOG_MAGIC);
+        for(const auto& keyAndLocation: locationByKey_)
+        {
+            indexedEnd = std::max(indexedEnd, keyAndLocation.second.offset + keyAndLocation.second.size);
+        }
+        if(!ScanLog(indexedEnd))
+            return false;
+
+        logFile_ = fopen(logPath_.string().c_str(), "ab");
+        if(logFile_ == nullptr)
+            return error("%s : Failed to open %s", __func__, logPath_.string());
+
+        const uint64_t stale = staleBytes();
+        if(stale >= MIN_STALE_BYTES_TO_COMPACT && stale > liveBytes_ && !Compact())
+            return error("%s : Failed to compact %s", __func__, logPath_.string());
+    }
+    catch(const fs::filesystem_error& e)
+    {
+        return error("%s : %s", __func__, e.what());
+    }
+    return true;
+}
+
+bool WalletTransactionLog::LoadIndex()
+{
+    if(!fs::exists(indexPath_) || !HasMagic(indexPath_, INDEX_MAGIC)) return false;
+
+    const uint64_t indexSize = fs::file_size(indexPath_);
+    const uint64_t numberOfEntries = (indexSize - sizeof(INDEX_MAGIC)) / INDEX_ENTRY_SIZE;
+    const uint64_t intactIndexSize = sizeof(INDEX_MAGIC) + numberOfEntries * INDEX_ENTRY_SIZE;
+    {
+        ReadOnlyFileMapping index(indexPath_, intactIndexSize);
+        if(!index.isValid()) return false;
+
+        const unsigned char* entry = reinterpret_cast<const unsigned char*>(index.data()) + sizeof(INDEX_MAGIC);
+        for(uint64_t entryIndex = 0; entryIndex < numberOfEntries; ++entryIndex, entry += INDEX_ENTRY_SIZE)
+        {
+            uint256 key;
+            memcpy(key.begin(), entry, 32);
+            RecordLocation location;
+            location.offset = ReadLE64(entry + 32);
+            location.size = ReadLE32(entry + 40);
+            location.checksum = ReadLE32(entry + 44);
+            if(location.offset < sizeof(LOG_MAGIC) + RECORD_HEADER_SIZE || location.offset + location.size > logSize_)
+                return false;
+
+            auto inserted = locationByKey_.insert(std::make_pair(key, location));
+            if(!inserted.second)
+            {
+                liveBytes_ -= RECORD_HEADER_SIZE + inserted.first->second.size;
+                inserted.first->second = location;
+            }
+            liveBytes_ += RECORD_HEADER_SIZE + location.size;
+        }
+    }
+    // Drop an entry torn by a crash while it was being appended
+    if(intactIndexSize < indexSize) fs::resize_file(indexPath_, intactIndexSize);
+    return true;
+}
+
+bool WalletTransactionLog::ScanLog(uint64_t offset)
+{
+    std::vector<KeyAndLocation> unindexedRecords;
+    {
+        ReadOnlyFileMapping log(logPath_, logSize_);
+        if(!log.isValid())
+            return error("%s : Failed to map %s", __func__, logPath_.string());
+
+        while(offset + RECORD_HEADER_SIZE <= logSize_)
+        {
+            const unsigned char* header = reinterpret_cast<const unsigned char*>(log.data()) + offset;
+            uint256 key;
+            memcpy(key.begin(), header, 32);
+            RecordLocation location;
+            location.offset = offset + RECORD_HEADER_SIZE;
+            location.size = ReadLE32(header + 32);
+            if(location.offset + location.size > logSize_) break;
+            location.checksum = RecordChecksum(log.data() + location.offset, log.data() + location.offset + location.size);
+            unindexedRecords.emplace_back(key, location);
+            offset = location.offset + location.size;
+        }
+    }
+    if(offset < logSize_)
+    {
+        LogPrintf("%s : Dropping %u bytes of a record torn while being written to %s\n", __func__, logSize_ - offset, logPath_.string());
+        fs::resize_file(logPath_, offset);
+        logSize_ = offset;
+    }
+
+    if(!fs::exists(indexPath_) && !CreateFileWithMagic(indexPath_, INDEX_MAGIC))
+        return error("%s : Failed to create %s", __func__, indexPath_.string());
+    indexFile_ = fopen(indexPath_.string().c_str(), "ab");
+    if(indexFile_ == nullptr)
+        return error("%s : Failed to open %s", __func__, indexPath_.string());
+    for(const KeyAndLocation& record: unindexedRecords)
+    {
+        auto inserted = locationByKey_.insert(record);
+        if(!inserted.second)
+        {
+            liveBytes_ -= RECORD_HEADER_SIZE + inserted.first->second.size;
+            inserted.first->second = record.second;
+        }
+        liveBytes_ += RECORD_HEADER_SIZE + record.second.size;
+        if(!WriteIndexEntry(indexFile_, record.first, record.second))
+            return error("%s : Failed to write to %s", __func__, indexPath_.string());
+    }
+    FileCommit(indexFile_);
+    return true;
+}
+
+bool WalletTransactionLog::WriteIndexEntry(FILE* indexFile, const uint256& key, const RecordLocation& location) const
+{
+    unsigned char entry[INDEX_ENTRY_SIZE];
+    memcpy(entry, key.begin(), 32);
+    WriteLE64(entry + 32, location.offset);
+    WriteLE32(entry + 40, location.size);
+    WriteLE32(entry + 44, location.checksum);
+    return fwrite(entry, 1, sizeof(entry), indexFile) == sizeof(entry);
+}
+
+bool WalletTransactionLog::Append(const uint256& key, const CDataStream& record)
+{
+    LOCK(cs_log);
+    if(logFile_ == nullptr || indexFile_ == nullptr || record.empty()) return false;
+
+    RecordLocation location;
+    location.offset = logSize_ + RECORD_HEADER_SIZE;
+    location.size = record.size();
+    location.checksum = RecordChecksum(&record[0], &record[0] + record.size());
+
+    unsigned char header[RECORD_HEADER_SIZE];
+    memcpy(header, key.begin(), 32);
+    WriteLE32(header + 32, location.size);
+    if(fwrite(header, 1, sizeof(header), logFile_) != sizeof(header) ||
+        fwrite(&record[0], 1, record.size(), logFile_) != record.size() ||
+        fflush(logFile_) != 0)
+    {
+        return error("%s : Failed to write to %s", __func__, logPath_.string());
+    }
+    logSize_ = location.offset + location.size;
+
+    // The index entry only goes out once the record it points to is in the log
+    if(!WriteIndexEntry(indexFile_, key, location) || fflush(indexFile_) != 0)
+        return error("%s : Failed to write to %s", __func__, indexPath_.string());
+
+    auto inserted = locationByKey_.insert(std::make_pair(key, location));
+    if(!inserted.second)
+    {
+        liveBytes_ -= RECORD_HEADER_SIZE + inserted.first->second.size;
+        inserted.first->second = location;
+    }
+    liveBytes_ += RECORD_HEADER_SIZE + location.size;
+    return true;
+}
+
+bool WalletTransactionLog::ForEachRecord(const RecordVisitor& visitor, unsigned& numberOfCorruptRecords) const
+{
+    std::vector<KeyAndLocation> records;
+    uint64_t logSize;
+    {
+        LOCK(cs_log);
+        if(logFile_ != nullptr) fflush(logFile_);
+        records = SortedByOffset(locationByKey_);
+        logSize = logSize_;
+    }
+
+    // The log is only ever appended to, so the mapped prefix stays valid while visiting
+    numberOfCorruptRecords = 0u;
+    ReadOnlyFileMapping log(logPath_, logSize);
+    if(!log.isValid())
+        return error("%s : Failed to map %s", __func__, logPath_.string());
+    for(const KeyAndLocation& record: records)
+    {
+        const char* begin = log.data() + record.second.offset;
+        const char* end = begin + record.second.size;
+        if(RecordChecksum(begin, end) != record.second.checksum)
+        {
+            ++numberOfCorruptRecords;
+            continue;
+        }
+        CDataStream stream(begin, end, SER_DISK, CLIENT_VERSION);
+        visitor(record.first, stream);
+    }
+    return true;
+}
+
+bool WalletTransactionLog::Compact()
+{
+    AssertLockHeld(cs_log);
+    const fs::path newLogPath = logPath_.string() + ".new";
+    const fs::path newIndexPath = indexPath_.string() + ".new";
+    std::map<uint256, RecordLocation> compactedLocations;
+    uint64_t compactedSize = sizeof(LOG_MAGIC);
+    {
+        fflush(logFile_);
+        ReadOnlyFileMapping log(logPath_, logSize_);
+        if(!log.isValid()) return false;
+        if(!CreateFileWithMagic(newLogPath, LOG_MAGIC) || !CreateFileWithMagic(newIndexPath, INDEX_MAGIC)) return false;
+        FILE* newLog = fopen(newLogPath.string().c_str(), "ab");
+        FILE* newIndex = fopen(newIndexPath.string().c_str(), "ab");
+        bool written = newLog != nullptr && newIndex != nullptr;
+        for(const KeyAndLocation& record: SortedByOffset(locationByKey_))
+        {
+            if(!written) break;
+            const char* recordStart = log.data() + record.second.offset - RECORD_HEADER_SIZE;
+            const uint64_t recordSize = RECORD_HEADER_SIZE + record.second.size;
+            RecordLocation location = record.second;
+            location.offset = compactedSize + RECORD_HEADER_SIZE;
+            written = fwrite(recordStart, 1, recordSize, newLog) == recordSize &&
+                WriteIndexEntry(newIndex, record.first, location);
+            compactedLocations.insert(std::make_pair(record.first, location));
+            compactedSize += recordSize;
+        }
+        if(newLog != nullptr) { FileCommit(newLog); fclose(newLog); }
+        if(newIndex != nullptr) { FileCommit(newIndex); fclose(newIndex); }
+        if(!written)
+        {
+            fs::remove(newLogPath);
+            fs::remove(newIndexPath);
+            return false;
+        }
+    }
+
+    LogPrintf("%s : Compacting %s from %u to %u bytes\n", __func__, logPath_.string(), logSize_, compactedSize);
+    Close();
+    // Without an index the log is rescanned, so a crash between the renames cannot pair the new log with the old index
+    fs::remove(indexPath_);
+    fs::rename(newLogPath, logPath_);
+    fs::rename(newIndexPath, indexPath_);
+    locationByKey_.swap(compactedLocations);
+    logSize_ = compactedSize;
+    logFile_ = fopen(logPath_.string().c_str(), "ab");
+    indexFile_ = fopen(indexPath_.string().c_str(), "ab");
+    return logFile_ != nullptr && indexFile_ != nullptr;
+}
+
+void WalletTransactionLog::Sync()
+{
+    LOCK(cs_log);
+    if(logFile_ != nullptr) FileCommit(logFile_);
+    if(indexFile_ != nullptr) FileCommit(indexFile_);
+}
+
+size_t WalletTransactionLog::numberOfRecords() const
+{
+    LOCK(cs_log);
+    return locationByKey_.size();
+}
+
+uint64_t WalletTransactionLog::staleBytes() const
+{
+    LOCK(cs_log);
+    return logSize_ - sizeof(LOG_MAGIC) - liveBytes_;
+}
+
+const boost::filesystem::path& WalletTransactionLog::logPath() const
+{
+    return logPath_;
+}
+
+const boost::filesystem::path& WalletTransactionLog::indexPath() const
+{
+    return indexPath_;
+}
@@ -0,0 +1,75 @@
+#ifndef WALLET_TRANSACTION_LOG_H
+#define WALLET_TRANSACTION_LOG_H
+#include <stdint.h>
+#include <stdio.h>
+#include <functional>
+#include <map>
+#include <uint256.h>
+#include <sync.h>
+#include <streams.h>
+
+#include <boost/filesystem/path.hpp>
+
+/**
+ * Append-only store for wallet transaction records, kept next to the wallet
+ * file so that the Berkeley DB file only holds keys and metadata.
+ *
+ * Every write appends the serialized record to the log and a fixed size entry
+ * (key, offset, size, checksum) to a compact index file, so its cost does not
+ * depend on how many records are stored. A record written again supersedes
+ * the older copy, which stays in the log until the log gets compacted when it
+ * is opened with more stale than live data.
+ *
+ * Opening only reads the index. Records are read through a memory mapping of
+ * the log, so only the pages holding the latest copy of each record are ever
+ * touched. The log repeats the key and size in front of every record, which
+ * lets a lost or torn index be rebuilt from the log alone.
+ */
+class WalletTransactionLog
+{
+public:
+    struct RecordLocation
+    {
+        uint64_t offset;
+        uint32_t size;
+        uint32_t checksum;
+    };
+    typedef std::function<void(const uint256&, CDataStream&)> RecordVisitor;
+
+private:
+    mutable CCriticalSection cs_log;
+    const boost::filesystem::path logPath_;
+    const boost::filesystem::path indexPath_;
+    FILE* logFile_;
+    FILE* indexFile_;
+    uint64_t logSize_;
+    uint64_t liveBytes_;
+    std::map<uint256, RecordLocation> locationByKey_;
+
+    bool LoadIndex();
+    bool ScanLog(uint64_t offset);
+    bool WriteIndexEntry(FILE* indexFile, const uint256& key, const RecordLocation& location) const;
+    bool Compact();
+    void Close();
+
+public:
+    explicit WalletTransactionLog(const boost::filesystem::path& logPath);
+    ~WalletTransactionLog();
+
+    /** Opens the log and its index, creating them if missing and repairing a torn tail. */
+    bool Open();
+    bool Append(const uint256& key, const CDataStream& record);
+    /**
+     * Visits the latest copy of every record in the order they were written.
+     * Records failing their checksum are skipped and counted.
+     */
+    bool ForEachRecord(const RecordVisitor& visitor, unsigned& numberOfCorruptRecords) const;
+    /** Commits appended records to disk. */
+    void Sync();
+
+    size_t numberOfRecords() const;
+    uint64_t staleBytes() const;
+    const boost::filesystem::path& logPath() const;
+    const boost::filesystem::path& indexPath() const;
+};
+#endif// WALLET_TRANSACTION_LOG_H
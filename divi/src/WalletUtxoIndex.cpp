@@ -0,0 +1,89 @@
+#include <WalletUtxoIndex.h>
+
+constexpr unsigned WalletUtxoIndex::NUMBER_OF_COIN_TYPES;
+
+WalletUtxoIndex::IndexedOutput::IndexedOutput(
+    ): outputIndex(0u)
+    , coinTypes(0u)
+    , isSpendable(false)
+{
+}
+
+WalletUtxoIndex::IndexedOutput::IndexedOutput(
+    unsigned outputIndexIn,
+    unsigned coinTypesIn,
+    bool isSpendableIn
+    ): outputIndex(outputIndexIn)
+    , coinTypes(coinTypesIn)
+    , isSpendable(isSpendableIn)
+{
+}
+
+WalletUtxoIndex::WalletUtxoIndex(
+    ): outputsByTxHash_()
+    , txHashesByCoinType_()
+    , numberOfOutputs_(0u)
+{
+}
+
+void WalletUtxoIndex::clear()
+{
+    outputsByTxHash_.clear();
+    for(unsigned coinType = 0; coinType < NUMBER_OF_COIN_TYPES; ++coinType)
+    {
+        txHashesByCoinType_[coinType].clear();
+    }
+    numberOfOutputs_ = 0u;
+}
+
+void WalletUtxoIndex::update(const uint256& txHash, std::vector<IndexedOutput> outputs)
+{
+    remove(txHash);
+    if(outputs.empty()) return;
+
+    unsigned coinTypes = 0u;
+    for(const IndexedOutput& output: outputs)
+    {
+        coinTypes |= output.coinTypes;
+    }
+    for(unsigned coinType = 0; coinType < NUMBER_OF_COIN_TYPES; ++coinType)
+    {
+        if(coinTypes & (1u << coinType)) txHashesByCoinType_[coinType].insert(txHash);
+    }
+    numberOfOutputs_ += outputs.size();
+    outputsByTxHash_[txHash].swap(outputs);
+}
+
+void WalletUtxoIndex::remove(const uint256& txHash)
+{
+    auto it = outputsByTxHash_.find(txHash);
+    if(it == outputsByTxHash_.end()) return;
+    for(unsigned coinType = 0; coinType < NUMBER_OF_COIN_TYPES; ++coinType)
+    {
+        txHashesByCoinType_[coinType].erase(txHash);
+    }
+    numberOfOutputs_ -= it->second.size();
+    outputsByTxHash_.erase(it);
+}
+
+const std::set<uint256>& WalletUtxoIndex::transactionsWithCoinType(unsigned coinType) const
+{
+    return txHashesByCoinType_[coinType];
+}
+
+const std::vector<WalletUtxoIndex::IndexedOutput>& WalletUtxoIndex::outputsOf(const uint256& txHash) const
+{
+    static const std::vector<IndexedOutput> noOutputs;
+    auto it = outputsByTxHash_.find(txHash);
+    return it != outputsByTxHash_.end()? it->second : noOutputs;
+}
+
+size_t WalletUtxoIndex::numberOfTransactions() const
+{
+    return outputsByTxHash_.size();
+}
+
+size_t WalletUtxoIndex::numberOfOutputs() const
+{
+    return numberOfOutputs_;
+}
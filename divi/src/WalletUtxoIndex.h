@@ -0,0 +1,54 @@
+#ifndef WALLET_UTXO_INDEX_H
+#define WALLET_UTXO_INDEX_H
+#include <map>
+#include <set>
+#include <vector>
+#include <uint256.h>
+
+/**
+ * The unspent outputs of wallet transactions that the wallet could spend or
+ * stake, grouped by the coin types they are available as, so that coin
+ * selection only visits transactions that still hold such outputs instead of
+ * every wallet transaction.
+ *
+ * The index only records what does not depend on the chain tip: ownership,
+ * vault type and whether the output is spent. Depth, maturity, locked coins
+ * and value filters are still applied by the caller. It is kept current by
+ * the wallet together with the balance ledger, i.e. transactions are
+ * re-indexed whenever their balance contribution is re-evaluated.
+ */
+class WalletUtxoIndex
+{
+public:
+    static constexpr unsigned NUMBER_OF_COIN_TYPES = 3u;
+
+    struct IndexedOutput
+    {
+        unsigned outputIndex;
+        unsigned coinTypes; // Bit (1 << AvailableCoinsType) set for every type the output is available as
+        bool isSpendable;
+
+        IndexedOutput();
+        IndexedOutput(unsigned outputIndexIn, unsigned coinTypesIn, bool isSpendableIn);
+    };
+
+private:
+    std::map<uint256, std::vector<IndexedOutput>> outputsByTxHash_;
+    std::set<uint256> txHashesByCoinType_[NUMBER_OF_COIN_TYPES];
+    size_t numberOfOutputs_;
+
+public:
+    WalletUtxoIndex();
+
+    void clear();
+    /** Replaces the indexed outputs of a transaction; an empty list removes it. */
+    void update(const uint256& txHash, std::vector<IndexedOutput> outputs);
+    void remove(const uint256& txHash);
+
+    /** Transactions with an output of the given coin type, in hash order like mapWallet. */
+    const std::set<uint256>& transactionsWithCoinType(unsigned coinType) const;
+    const std::vector<IndexedOutput>& outputsOf(const uint256& txHash) const;
+    size_t numberOfTransactions() const;
+    size_t numberOfOutputs() const;
+};
+#endif// WALLET_UTXO_INDEX_H
@@ -0,0 +1,89 @@
+// Copyright (c) 2015 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include <BlockHeaderHashing.h>
+#include <primitives/block.h>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+// One full headers message worth of proof-of-work era (Quark hashed) headers
+static const unsigned numberOfHeaders = 2000;
+
+static std::vector<CBlockHeader> QuarkHeaders()
+{
+    std::vector<CBlockHeader> headers(numberOfHeaders);
+    for (unsigned index = 0; index < numberOfHeaders; ++index) {
+        headers[index].nVersion = 3;
+        headers[index].nTime = 1538000000 + 60 * index;
+        headers[index].nBits = 0x1e0ffff0;
+        headers[index].nNonce = index;
+        if (index > 0) headers[index].hashPrevBlock = headers[index - 1].GetHash();
+    }
+    return headers;
+}
+
+// Every header hashed from scratch, as the headers message and any block
+// whose hash was not memoized do.
+static void BlockHeaderHash_Uncached(benchmark::State& state)
+{
+    const std::vector<CBlockHeader> headers = QuarkHeaders();
+    state.SetItemsPerIteration(numberOfHeaders);
+    while (state.KeepRunning()) {
+        for (const CBlockHeader& header : headers) {
+            header.GetHash();
+        }
+    }
+}
+
+// The same blocks asked for their hash again after it was memoized, as
+// validation does several times per block.
+static void BlockHeaderHash_Memoized(benchmark::State& state)
+{
+    const std::vector<CBlockHeader> headers = QuarkHeaders();
+    std::vector<CBlock> blocks(headers.begin(), headers.end());
+    for (CBlock& block : blocks) {
+        block.MemoizeHash();
+    }
+    state.SetItemsPerIteration(numberOfHeaders);
+    while (state.KeepRunning()) {
+        for (const CBlock& block : blocks) {
+            block.GetHash();
+        }
+    }
+}
+
+// A batch of headers hashed with the master thread joining
+// numberOfThreads - 1 workers, as for -par=numberOfThreads.
+static void HashHeaderBatch(benchmark::State& state, unsigned numberOfThreads)
+{
+    CCheckQueue<BlockHeaderHashCheck> queue(128);
+    boost::thread_group threads;
+    for (unsigned threadIndex = 0; threadIndex + 1 < numberOfThreads; ++threadIndex) {
+        threads.create_thread(boost::bind(&CCheckQueue<BlockHeaderHashCheck>::Thread, &queue));
+    }
+
+    const std::vector<CBlockHeader> headers = QuarkHeaders();
+    state.SetItemsPerIteration(numberOfHeaders);
+    while (state.KeepRunning()) {
+        HashBlockHeaders(numberOfThreads > 1 ? &queue : nullptr, headers);
+    }
+
+    threads.interrupt_all();
+    threads.join_all();
+}
+
+static void BlockHeaderHash_Batch1Thread(benchmark::State& state) { HashHeaderBatch(state, 1); }
+static void BlockHeaderHash_Batch2Threads(benchmark::State& state) { HashHeaderBatch(state, 2); }
+static void BlockHeaderHash_Batch4Threads(benchmark::State& state) { HashHeaderBatch(state, 4); }
+static void BlockHeaderHash_Batch8Threads(benchmark::State& state) { HashHeaderBatch(state, 8); }
+
+BENCHMARK(BlockHeaderHash_Uncached);
+BENCHMARK(BlockHeaderHash_Memoized);
+BENCHMARK(BlockHeaderHash_Batch1Thread);
+BENCHMARK(BlockHeaderHash_Batch2Threads);
+BENCHMARK(BlockHeaderHash_Batch4Threads);
+BENCHMARK(BlockHeaderHash_Batch8Threads);
@@ -0,0 +1,105 @@
+// Copyright (c) 2015 The Bitcoin Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include <blockFileInfo.h>
+#include <chain.h>
+#include <random.h>
+#include <Settings.h>
+#include <txdb.h>
+#include <util.h>
+
+#include <boost/filesystem.hpp>
+
+#include <memory>
+#include <vector>
+
+extern Settings& settings;
+
+// Number of dirty block index entries flushed per iteration, roughly what a
+// reindex accumulates between two periodic flushes.
+static const unsigned numberOfDirtyBlockIndices = 50000;
+static const unsigned numberOfDirtyBlockFiles = 8;
+
+namespace
+{
+class DirtyBlockIndexState
+{
+private:
+    std::vector<uint256> blockHashes_;
+    std::vector<CBlockIndex> blockIndices_;
+    std::vector<CBlockFileInfo> blockFileInfos_;
+    std::unique_ptr<CBlockTreeDB> blockTreeDB_;
+
+public:
+    DirtyBlockIndexState(
+        ): blockHashes_(numberOfDirtyBlockIndices)
+        , blockIndices_(numberOfDirtyBlockIndices)
+        , blockFileInfos_(numberOfDirtyBlockFiles)
+        , blockTreeDB_()
+    {
+        const boost::filesystem::path pathTemp = GetTempPath() / strprintf("bench_divi_%lu_%i", (unsigned long)GetTime(), (int)(GetRand(100000)));
+        boost::filesystem::create_directories(pathTemp);
+        settings.SetParameter("-datadir", pathTemp.string());
+        blockTreeDB_.reset(new CBlockTreeDB(1 << 20, true));
+
+        for (unsigned height = 0; height < numberOfDirtyBlockIndices; ++height) {
+            blockHashes_[height] = GetRandHash();
+            CBlockIndex& blockIndex = blockIndices_[height];
+            blockIndex.phashBlock = &blockHashes_[height];
+            blockIndex.pprev = height > 0 ? &blockIndices_[height - 1] : nullptr;
+            blockIndex.nHeight = height;
+            blockIndex.nFile = height % numberOfDirtyBlockFiles;
+            blockIndex.nDataPos = height;
+            blockIndex.nStatus = BLOCK_HAVE_DATA | BLOCK_VALID_SCRIPTS;
+        }
+    }
+
+    CBlockTreeDB& blockTreeDB() { return *blockTreeDB_; }
+    const std::vector<CBlockIndex>& blockIndices() const { return blockIndices_; }
+    const std::vector<CBlockFileInfo>& blockFileInfos() const { return blockFileInfos_; }
+};
+}
+
+// Flush as done before WriteBatchSync: one batch per entry, then a sync.
+static void ReindexBlockIndexFlush_PerEntry(benchmark::State& state)
+{
+    DirtyBlockIndexState dirtyState;
+    CBlockTreeDB& blockTreeDB = dirtyState.blockTreeDB();
+    state.SetItemsPerIteration(numberOfDirtyBlockIndices);
+    while (state.KeepRunning()) {
+        for (unsigned nFile = 0; nFile < numberOfDirtyBlockFiles; ++nFile) {
+            blockTreeDB.WriteBlockFileInfo(nFile, dirtyState.blockFileInfos()[nFile]);
+        }
+        blockTreeDB.WriteLastBlockFile(numberOfDirtyBlockFiles - 1);
+        for (const CBlockIndex& blockIndex : dirtyState.blockIndices()) {
+            blockTreeDB.WriteBlockIndex(CDiskBlockIndex(&blockIndex));
+        }
+        blockTreeDB.Sync();
+    }
+}
+
+static void ReindexBlockIndexFlush_WriteBatchSync(benchmark::State& state)
+{
+    DirtyBlockIndexState dirtyState;
+    CBlockTreeDB& blockTreeDB = dirtyState.blockTreeDB();
+    state.SetItemsPerIteration(numberOfDirtyBlockIndices);
+    while (state.KeepRunning()) {
+        std::vector<std::pair<int, const CBlockFileInfo*> > vFiles;
+        vFiles.reserve(numberOfDirtyBlockFiles);
+        for (unsigned nFile = 0; nFile < numberOfDirtyBlockFiles; ++nFile) {
+            vFiles.push_back(std::make_pair(nFile, &dirtyState.blockFileInfos()[nFile]));
+        }
+        std::vector<const CBlockIndex*> vBlocks;
+        vBlocks.reserve(numberOfDirtyBlockIndices);
+        for (const CBlockIndex& blockIndex : dirtyState.blockIndices()) {
+            vBlocks.push_back(&blockIndex);
+        }
+        blockTreeDB.WriteBatchSync(vFiles, numberOfDirtyBlockFiles - 1, vBlocks);
+    }
+}
+
+BENCHMARK(ReindexBlockIndexFlush_PerEntry);
+BENCHMARK(ReindexBlockIndexFlush_WriteBatchSync);
@@ -0,0 +1,84 @@
+// Copyright (c) 2015 The Bitcoin Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include <blockmap.h>
+#include <chain.h>
+#include <uint256.h>
+
+#include <cassert>
+#include <vector>
+
+// Roughly the size of the mainnet block index at the time of writing.
+static const unsigned numberOfBlockIndices = 200000;
+
+static std::vector<uint256> BlockHashes()
+{
+    std::vector<uint256> blockHashes;
+    blockHashes.reserve(numberOfBlockIndices);
+    for (unsigned height = 0; height < numberOfBlockIndices; ++height) {
+        blockHashes.push_back(uint256(height + 1));
+    }
+    return blockHashes;
+}
+
+static void LinkBlockIndex(CBlockIndex* pindex, CBlockIndex* pindexPrev, unsigned height)
+{
+    pindex->pprev = pindexPrev;
+    pindex->nHeight = height;
+    pindex->nTime = height;
+    pindex->nStatus = BLOCK_HAVE_DATA | BLOCK_VALID_SCRIPTS;
+    pindex->BuildSkip();
+}
+
+static void WalkToGenesis(const CBlockIndex* pindex)
+{
+    int64_t totalTime = 0;
+    for (; pindex; pindex = pindex->pprev) {
+        totalTime += pindex->GetBlockTime();
+    }
+    assert(totalTime == int64_t(numberOfBlockIndices) * (numberOfBlockIndices - 1) / 2);
+}
+
+// One heap allocation per entry, as LoadBlockIndexGuts did before the arena.
+static void BlockIndexLoad_HeapAllocated(benchmark::State& state)
+{
+    const std::vector<uint256> blockHashes = BlockHashes();
+    state.SetItemsPerIteration(numberOfBlockIndices);
+    while (state.KeepRunning()) {
+        BlockMap blockIndicesByHash;
+        CBlockIndex* pindexPrev = nullptr;
+        for (unsigned height = 0; height < numberOfBlockIndices; ++height) {
+            CBlockIndex* pindex = new CBlockIndex();
+            pindex->phashBlock = &blockIndicesByHash.insert(std::make_pair(blockHashes[height], pindex)).first->first;
+            LinkBlockIndex(pindex, pindexPrev, height);
+            pindexPrev = pindex;
+        }
+        WalkToGenesis(pindexPrev);
+        for (auto& blockHashAndBlockIndex : blockIndicesByHash) {
+            delete blockHashAndBlockIndex.second;
+        }
+    }
+}
+
+static void BlockIndexLoad_Arena(benchmark::State& state)
+{
+    const std::vector<uint256> blockHashes = BlockHashes();
+    state.SetItemsPerIteration(numberOfBlockIndices);
+    while (state.KeepRunning()) {
+        BlockMap blockIndicesByHash;
+        CBlockIndex* pindexPrev = nullptr;
+        for (unsigned height = 0; height < numberOfBlockIndices; ++height) {
+            CBlockIndex* pindex = blockIndicesByHash.GetUniqueBlockIndexForHash(blockHashes[height]);
+            LinkBlockIndex(pindex, pindexPrev, height);
+            pindexPrev = pindex;
+        }
+        WalkToGenesis(pindexPrev);
+        blockIndicesByHash.DestroyBlockIndices();
+    }
+}
+
+BENCHMARK(BlockIndexLoad_HeapAllocated);
+BENCHMARK(BlockIndexLoad_Arena);
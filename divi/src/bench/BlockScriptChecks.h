@@ -0,0 +1,134 @@
+// Copyright (c) 2015 The Bitcoin Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BENCH_BLOCK_SCRIPT_CHECKS_H
+#define BENCH_BLOCK_SCRIPT_CHECKS_H
+
+#include <checkqueue.h>
+#include <coins.h>
+#include <key.h>
+#include <keystore.h>
+#include <primitives/transaction.h>
+#include <script/sign.h>
+#include <script/standard.h>
+#include <scriptCheck.h>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <cassert>
+#include <memory>
+#include <vector>
+
+// A block's worth of single-input transactions paying to a handful of keys.
+static const unsigned numberOfKeys = 16;
+static const unsigned numberOfTransactionsPerBlock = 1000;
+
+class BlockOfSignedTransactions
+{
+private:
+    CBasicKeyStore keyStore_;
+    CTransaction fundingTx_;
+    std::unique_ptr<CCoins> fundingCoins_;
+    std::vector<CTransaction> transactions_;
+
+public:
+    BlockOfSignedTransactions(
+        ): keyStore_()
+        , fundingTx_()
+        , fundingCoins_()
+        , transactions_()
+    {
+        std::vector<CScript> scripts;
+        for (unsigned keyIndex = 0; keyIndex < numberOfKeys; ++keyIndex) {
+            CKey key;
+            key.MakeNewKey(true);
+            keyStore_.AddKey(key);
+            scripts.push_back(GetScriptForDestination(key.GetPubKey().GetID()));
+        }
+
+        CMutableTransaction fundingTx;
+        fundingTx.vin.resize(1);
+        fundingTx.vout.resize(numberOfTransactionsPerBlock);
+        for (unsigned outputIndex = 0; outputIndex < numberOfTransactionsPerBlock; ++outputIndex) {
+            fundingTx.vout[outputIndex].nValue = 1000;
+            fundingTx.vout[outputIndex].scriptPubKey = scripts[outputIndex % numberOfKeys];
+        }
+        fundingTx_ = CTransaction(fundingTx);
+        fundingCoins_.reset(new CCoins(fundingTx_, 1));
+
+        for (unsigned outputIndex = 0; outputIndex < numberOfTransactionsPerBlock; ++outputIndex) {
+            CMutableTransaction spendingTx;
+            spendingTx.vin.resize(1);
+            spendingTx.vin[0].prevout = COutPoint(fundingTx_.GetHash(), outputIndex);
+            spendingTx.vout.resize(1);
+            spendingTx.vout[0].nValue = 900;
+            spendingTx.vout[0].scriptPubKey = scripts[(outputIndex + 1) % numberOfKeys];
+            SignSignature(keyStore_, fundingTx_, spendingTx, 0);
+            transactions_.push_back(CTransaction(spendingTx));
+        }
+    }
+
+    std::vector<CScriptCheck> CreateChecks(bool cacheStore) const
+    {
+        std::vector<CScriptCheck> checks;
+        checks.reserve(transactions_.size());
+        for (const CTransaction& tx : transactions_) {
+            checks.push_back(CScriptCheck());
+            CScriptCheck check(*fundingCoins_, tx, 0, STANDARD_SCRIPT_VERIFY_FLAGS, cacheStore);
+            check.swap(checks.back());
+        }
+        return checks;
+    }
+
+    /** Verify every input the way the mempool does, storing results in the signature cache. */
+    void AcceptToMempool() const
+    {
+        std::vector<CScriptCheck> checks = CreateChecks(true);
+        for (CScriptCheck& check : checks) {
+            const bool accepted = check();
+            assert(accepted);
+        }
+    }
+};
+
+class ScriptCheckWorkers
+{
+private:
+    CCheckQueue<CScriptCheck> queue_;
+    boost::thread_group threads_;
+
+public:
+    explicit ScriptCheckWorkers(
+        unsigned numberOfThreads
+        ): queue_(128)
+        , threads_()
+    {
+        for (unsigned threadIndex = 0; threadIndex < numberOfThreads; ++threadIndex) {
+            threads_.create_thread(boost::bind(&CCheckQueue<CScriptCheck>::Thread, &queue_));
+        }
+    }
+
+    ~ScriptCheckWorkers()
+    {
+        threads_.interrupt_all();
+        threads_.join_all();
+    }
+
+    /** Run the block's script checks on the worker threads, queued one transaction at a time as ConnectBlock does. */
+    void ConnectBlock(const BlockOfSignedTransactions& block)
+    {
+        CCheckQueueControl<CScriptCheck> control(&queue_);
+        std::vector<CScriptCheck> checks = block.CreateChecks(false);
+        for (CScriptCheck& check : checks) {
+            std::vector<CScriptCheck> transactionChecks(1);
+            transactionChecks[0].swap(check);
+            control.Add(transactionChecks);
+        }
+        const bool allValid = control.Wait();
+        assert(allValid);
+    }
+};
+
+#endif // BENCH_BLOCK_SCRIPT_CHECKS_H
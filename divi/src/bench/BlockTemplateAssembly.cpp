@@ -0,0 +1,127 @@
+// Copyright (c) 2015 The Bitcoin Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include <blockmap.h>
+#include <BlockMemoryPoolTransactionCollector.h>
+#include <BlockTemplate.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <coins.h>
+#include <primitives/transaction.h>
+#include <Settings.h>
+#include <sync.h>
+#include <txmempool.h>
+
+#include <cassert>
+
+extern Settings& settings;
+
+// Half of the pool spends confirmed outputs, the other half spends one of
+// those unconfirmed transactions, so block assembly has to track dependencies.
+static const unsigned numberOfMempoolTransactions = 50000;
+static const unsigned numberOfConfirmedOutputs = numberOfMempoolTransactions / 2;
+static const int chainHeight = 1000;
+
+namespace
+{
+class SyntheticMempool
+{
+private:
+    BlockMap blockIndexByHash_;
+    CChain activeChain_;
+    CCoinsViewCache coinsTip_;
+    bool addressIndex_;
+    bool spentIndex_;
+    CFeeRate relayFee_;
+    CTxMemPool mempool_;
+    CCriticalSection mainCS_;
+    BlockMemoryPoolTransactionCollector collector_;
+
+    static CTransaction SpendOutput(const uint256& txHash, unsigned outputIndex, CAmount value)
+    {
+        CMutableTransaction spendingTx;
+        spendingTx.vin.resize(1);
+        spendingTx.vin[0].prevout = COutPoint(txHash, outputIndex);
+        spendingTx.vout.resize(1);
+        spendingTx.vout[0].nValue = value;
+        spendingTx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+        return CTransaction(spendingTx);
+    }
+
+public:
+    SyntheticMempool(
+        ): blockIndexByHash_()
+        , activeChain_()
+        , coinsTip_()
+        , addressIndex_(false)
+        , spentIndex_(false)
+        , relayFee_(1000)
+        , mempool_(relayFee_, addressIndex_, spentIndex_)
+        , mainCS_()
+        , collector_(settings, &coinsTip_, activeChain_, blockIndexByHash_, mempool_, mainCS_, relayFee_)
+    {
+        SelectParams(CBaseChainParams::UNITTEST);
+
+        CBlockIndex* tip = blockIndexByHash_.GetUniqueBlockIndexForHash(uint256(chainHeight));
+        tip->nHeight = chainHeight;
+        activeChain_.SetTip(tip);
+        coinsTip_.SetBestBlock(tip->GetBlockHash());
+
+        CMutableTransaction fundingTx;
+        fundingTx.vin.resize(1);
+        fundingTx.vin[0].prevout = COutPoint(uint256(1), 0);
+        fundingTx.vout.resize(numberOfConfirmedOutputs);
+        for (unsigned outputIndex = 0; outputIndex < numberOfConfirmedOutputs; ++outputIndex) {
+            fundingTx.vout[outputIndex].nValue = 100 * COIN;
+            fundingTx.vout[outputIndex].scriptPubKey = CScript() << OP_TRUE;
+        }
+        const CTransaction funding(fundingTx);
+        coinsTip_.ModifyCoins(funding.GetHash())->FromTx(funding, 1);
+
+        LOCK2(mainCS_, mempool_.cs);
+        for (unsigned outputIndex = 0; outputIndex < numberOfConfirmedOutputs; ++outputIndex) {
+            const CAmount parentFee = 1000 * (1 + outputIndex % 97);
+            const CTransaction parent = SpendOutput(funding.GetHash(), outputIndex, 100 * COIN - parentFee);
+            mempool_.addUnchecked(parent.GetHash(), CTxMemPoolEntry(parent, parentFee, 0, 0.0, chainHeight), coinsTip_);
+
+            const CAmount childFee = 1000 * (1 + outputIndex % 89);
+            const CTransaction child = SpendOutput(parent.GetHash(), 0, parent.vout[0].nValue - childFee);
+            mempool_.addUnchecked(child.GetHash(), CTxMemPoolEntry(child, childFee, 0, 0.0, chainHeight), coinsTip_);
+        }
+        assert(mempool_.mapTx.size() == numberOfMempoolTransactions);
+    }
+
+    CBlockTemplate EmptyTemplate() const
+    {
+        CBlockTemplate blockTemplate;
+        blockTemplate.previousBlockIndex = activeChain_.Tip();
+        CMutableTransaction coinbase;
+        coinbase.vin.resize(1);
+        coinbase.vin[0].prevout.SetNull();
+        coinbase.vout.resize(1);
+        blockTemplate.block.vtx.push_back(CTransaction(coinbase));
+        return blockTemplate;
+    }
+
+    void AssembleBlock()
+    {
+        CBlockTemplate blockTemplate = EmptyTemplate();
+        const bool collected = collector_.CollectTransactionsIntoBlock(blockTemplate);
+        assert(collected && blockTemplate.block.vtx.size() > 1u);
+    }
+};
+}
+
+static void BlockTemplateAssembly_50kMempool(benchmark::State& state)
+{
+    SyntheticMempool mempool;
+    state.SetItemsPerIteration(numberOfMempoolTransactions);
+    while (state.KeepRunning()) {
+        mempool.AssembleBlock();
+    }
+}
+
+BENCHMARK(BlockTemplateAssembly_50kMempool);
@@ -0,0 +1,30 @@
+// Copyright (c) 2015 The Bitcoin Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "BlockScriptChecks.h"
+
+// Script checks of a block connected with a cold signature cache, with the
+// master thread joining numberOfThreads - 1 workers, as for -par=numberOfThreads.
+static void ConnectBlockScriptChecks(benchmark::State& state, unsigned numberOfThreads)
+{
+    BlockOfSignedTransactions block;
+    ScriptCheckWorkers workers(numberOfThreads - 1);
+    state.SetItemsPerIteration(numberOfTransactionsPerBlock);
+    while (state.KeepRunning()) {
+        workers.ConnectBlock(block);
+    }
+}
+
+static void CheckQueue_ConnectBlock1Thread(benchmark::State& state) { ConnectBlockScriptChecks(state, 1); }
+static void CheckQueue_ConnectBlock2Threads(benchmark::State& state) { ConnectBlockScriptChecks(state, 2); }
+static void CheckQueue_ConnectBlock4Threads(benchmark::State& state) { ConnectBlockScriptChecks(state, 4); }
+static void CheckQueue_ConnectBlock8Threads(benchmark::State& state) { ConnectBlockScriptChecks(state, 8); }
+static void CheckQueue_ConnectBlock16Threads(benchmark::State& state) { ConnectBlockScriptChecks(state, 16); }
+
+BENCHMARK(CheckQueue_ConnectBlock1Thread);
+BENCHMARK(CheckQueue_ConnectBlock2Threads);
+BENCHMARK(CheckQueue_ConnectBlock4Threads);
+BENCHMARK(CheckQueue_ConnectBlock8Threads);
+BENCHMARK(CheckQueue_ConnectBlock16Threads);
@@ -0,0 +1,80 @@
+// Copyright (c) 2015 The Bitcoin Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include <masternode.h>
+#include <MasternodeScoringEngine.h>
+#include <random.h>
+
+#include <boost/thread.hpp>
+
+#include <algorithm>
+#include <vector>
+
+static const unsigned numberOfMasternodes = 5000;
+
+namespace
+{
+std::vector<CMasternode> CreateMasternodes()
+{
+    std::vector<CMasternode> masternodes(numberOfMasternodes);
+    for (unsigned index = 0; index < numberOfMasternodes; ++index) {
+        masternodes[index].vin = CTxIn(COutPoint(GetRandHash(), 1));
+        masternodes[index].nTier = static_cast<MasternodeTier>(index % static_cast<unsigned>(MasternodeTier::INVALID));
+    }
+    return masternodes;
+}
+
+std::vector<MasternodeScoringEngine::Candidate> CreateCandidates(const std::vector<CMasternode>& masternodes)
+{
+    std::vector<MasternodeScoringEngine::Candidate> candidates;
+    for (const CMasternode& mn : masternodes)
+        candidates.emplace_back(mn.vin.prevout, mn.nTier);
+    return candidates;
+}
+}
+
+// Scoring as done before the scoring engine: one masternode at a time.
+static void MasternodeScoring_PerMasternode(benchmark::State& state)
+{
+    const std::vector<CMasternode> masternodes = CreateMasternodes();
+    state.SetItemsPerIteration(numberOfMasternodes);
+    while (state.KeepRunning()) {
+        const uint256 scoringBlockHash = GetRandHash();
+        std::vector<std::pair<uint256, COutPoint>> ranking;
+        ranking.reserve(masternodes.size());
+        for (const CMasternode& mn : masternodes)
+            ranking.emplace_back(mn.CalculateScore(scoringBlockHash), mn.vin.prevout);
+        std::sort(ranking.begin(), ranking.end());
+    }
+}
+
+// A new scoring block: the full table is computed on all cores.
+static void MasternodeScoring_EngineNewBlock(benchmark::State& state)
+{
+    const std::vector<MasternodeScoringEngine::Candidate> candidates = CreateCandidates(CreateMasternodes());
+    MasternodeScoringEngine engine(64u, boost::thread::hardware_concurrency());
+    state.SetItemsPerIteration(numberOfMasternodes);
+    while (state.KeepRunning()) {
+        engine.getScores(GetRandHash(), candidates);
+    }
+}
+
+// Repeated rank and queue queries for the same scoring block.
+static void MasternodeScoring_EngineCachedBlock(benchmark::State& state)
+{
+    const std::vector<MasternodeScoringEngine::Candidate> candidates = CreateCandidates(CreateMasternodes());
+    MasternodeScoringEngine engine(64u, boost::thread::hardware_concurrency());
+    const uint256 scoringBlockHash = GetRandHash();
+    engine.getScores(scoringBlockHash, candidates);
+    state.SetItemsPerIteration(numberOfMasternodes);
+    while (state.KeepRunning()) {
+        engine.getScores(scoringBlockHash, candidates);
+    }
+}
+
+BENCHMARK(MasternodeScoring_PerMasternode);
+BENCHMARK(MasternodeScoring_EngineNewBlock);
+BENCHMARK(MasternodeScoring_EngineCachedBlock);
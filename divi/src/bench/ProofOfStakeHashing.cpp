@@ -0,0 +1,68 @@
+// Copyright (c) 2015 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include <hash.h>
+#include <I_ProofOfStakeGenerator.h>
+#include <ProofOfStakeCalculator.h>
+#include <StakeKernelHasher.h>
+#include <StakingData.h>
+#include <streams.h>
+
+// Kernel hash as computed before StakeKernelHasher existed: the full preimage
+// is reserialized and rehashed for every timestamp.
+static uint256 SerializedStakeHash(uint64_t stakeModifier, unsigned int hashproofTimestamp, const COutPoint& prevout, unsigned int coinstakeStartTime)
+{
+    CDataStream ss(SER_GETHASH, 0);
+    ss << stakeModifier << coinstakeStartTime << prevout.n << prevout.hash << hashproofTimestamp;
+    return Hash(ss.begin(), ss.end());
+}
+
+static const uint64_t stakeModifier = 13260253192;
+static const unsigned coinstakeStartTime = 1538645320;
+static const unsigned hashproofStartTime = 1539663336;
+static const COutPoint utxo(uint256S("4266403b499375917920311b1af704805d3fa2d6d6f4e3217026618028423607"), 1);
+
+static void StakeKernelHash_Serialized(benchmark::State& state)
+{
+    state.SetItemsPerIteration(I_ProofOfStakeGenerator::nHashDrift);
+    while (state.KeepRunning()) {
+        unsigned timestamp = hashproofStartTime;
+        for (unsigned i = 0; i < I_ProofOfStakeGenerator::nHashDrift; ++i) {
+            SerializedStakeHash(stakeModifier, timestamp--, utxo, coinstakeStartTime);
+        }
+    }
+}
+
+static void StakeKernelHash_PrefixState(benchmark::State& state)
+{
+    state.SetItemsPerIteration(I_ProofOfStakeGenerator::nHashDrift);
+    while (state.KeepRunning()) {
+        StakeKernelHasher hasher(stakeModifier, coinstakeStartTime, utxo);
+        unsigned timestamp = hashproofStartTime;
+        for (unsigned i = 0; i < I_ProofOfStakeGenerator::nHashDrift; ++i) {
+            hasher.computeHash(timestamp--);
+        }
+    }
+}
+
+static void ProofOfStakeCalculator_HashDriftSearch(benchmark::State& state)
+{
+    // Unreachable target so that every timestamp in the drift window is tried
+    StakingData stakingData(0x1000001, coinstakeStartTime, uint256(), utxo, 0, uint256());
+    state.SetItemsPerIteration(I_ProofOfStakeGenerator::nHashDrift);
+    while (state.KeepRunning()) {
+        ProofOfStakeCalculator calculator(stakingData, stakeModifier);
+        uint256 hashproof;
+        unsigned timestamp = hashproofStartTime;
+        for (unsigned i = 0; i < I_ProofOfStakeGenerator::nHashDrift; ++i) {
+            calculator.computeProofOfStakeAndCheckItMeetsTarget(timestamp--, hashproof, false);
+        }
+    }
+}
+
+BENCHMARK(StakeKernelHash_Serialized);
+BENCHMARK(StakeKernelHash_PrefixState);
+BENCHMARK(ProofOfStakeCalculator_HashDriftSearch);
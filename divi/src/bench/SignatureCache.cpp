@@ -0,0 +1,32 @@
+// Copyright (c) 2015 The Bitcoin Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "BlockScriptChecks.h"
+
+static const unsigned numberOfScriptCheckThreads = 4;
+
+static void SignatureCache_BlockValidationWarmMempool(benchmark::State& state)
+{
+    BlockOfSignedTransactions block;
+    block.AcceptToMempool();
+    ScriptCheckWorkers workers(numberOfScriptCheckThreads);
+    state.SetItemsPerIteration(numberOfTransactionsPerBlock);
+    while (state.KeepRunning()) {
+        workers.ConnectBlock(block);
+    }
+}
+
+static void SignatureCache_BlockValidationColdMempool(benchmark::State& state)
+{
+    BlockOfSignedTransactions block;
+    ScriptCheckWorkers workers(numberOfScriptCheckThreads);
+    state.SetItemsPerIteration(numberOfTransactionsPerBlock);
+    while (state.KeepRunning()) {
+        workers.ConnectBlock(block);
+    }
+}
+
+BENCHMARK(SignatureCache_BlockValidationWarmMempool);
+BENCHMARK(SignatureCache_BlockValidationColdMempool);
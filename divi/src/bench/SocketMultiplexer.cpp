@@ -0,0 +1,158 @@
+// Copyright (c) 2015 The Bitcoin Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include <EpollSocketMultiplexer.h>
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <netbase.h>
+#include <util.h>
+
+#include <poll.h>
+
+#include <algorithm>
+#include <string.h>
+#include <vector>
+
+static const int numberOfPeers = 2000;
+static const int numberOfSendingPeersPerRound = 16;
+
+namespace
+{
+/** Loopback TCP connections standing in for connected peers; the accepted
+ *  (node) ends are non-blocking like the sockets of real inbound peers. */
+class LoopbackPeers
+{
+private:
+    SOCKET listenSocket_;
+    std::vector<SOCKET> remoteSockets_;
+    size_t nextSendingPeer_;
+
+public:
+    std::vector<SOCKET> nodeSockets;
+
+    LoopbackPeers(
+        ): listenSocket_(socket(AF_INET, SOCK_STREAM, IPPROTO_TCP))
+        , remoteSockets_()
+        , nextSendingPeer_(0)
+        , nodeSockets()
+    {
+        const int availableDescriptors = RaiseFileDescriptorLimit(2 * numberOfPeers + 64);
+        const int peersToConnect = std::min(numberOfPeers, (availableDescriptors - 64) / 2);
+
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t addressLength = sizeof(address);
+        if (bind(listenSocket_, (struct sockaddr*)&address, addressLength) != 0 ||
+            listen(listenSocket_, SOMAXCONN) != 0 ||
+            getsockname(listenSocket_, (struct sockaddr*)&address, &addressLength) != 0)
+            return;
+
+        for (int peer = 0; peer < peersToConnect; ++peer) {
+            SOCKET remoteSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            if (remoteSocket == INVALID_SOCKET)
+                break;
+            if (connect(remoteSocket, (struct sockaddr*)&address, sizeof(address)) != 0) {
+                CloseSocket(remoteSocket);
+                break;
+            }
+            SOCKET nodeSocket = accept(listenSocket_, NULL, NULL);
+            if (nodeSocket == INVALID_SOCKET) {
+                CloseSocket(remoteSocket);
+                break;
+            }
+            SetSocketNonBlocking(nodeSocket, true);
+            remoteSockets_.push_back(remoteSocket);
+            nodeSockets.push_back(nodeSocket);
+        }
+    }
+    ~LoopbackPeers()
+    {
+        for (SOCKET& hSocket : remoteSockets_)
+            CloseSocket(hSocket);
+        for (SOCKET& hSocket : nodeSockets)
+            CloseSocket(hSocket);
+        CloseSocket(listenSocket_);
+    }
+
+    /** A few peers send a message; the rest stay idle, as most peers do. */
+    void SendFromSomePeers()
+    {
+        const char message = 'x';
+        for (int peer = 0; peer < numberOfSendingPeersPerRound && !remoteSockets_.empty(); ++peer) {
+            send(remoteSockets_[nextSendingPeer_], &message, sizeof(message), MSG_NOSIGNAL);
+            nextSendingPeer_ = (nextSendingPeer_ + 97) % remoteSockets_.size();
+        }
+    }
+};
+
+int ReceiveFrom(SOCKET hSocket)
+{
+    char buffer[64];
+    return std::max<int>(0, recv(hSocket, buffer, sizeof(buffer), MSG_DONTWAIT));
+}
+}
+
+// Level-triggered: every peer socket is handed to the kernel on each round,
+// as SocketsProcessor does with select() (poll() avoids its FD_SETSIZE cap).
+static void SocketMultiplexer_PollAllPeers(benchmark::State& state)
+{
+    LoopbackPeers peers;
+    std::vector<struct pollfd> pollFds(peers.nodeSockets.size());
+    state.SetItemsPerIteration(peers.nodeSockets.size());
+    while (state.KeepRunning()) {
+        peers.SendFromSomePeers();
+        int bytesReceived = 0;
+        while (bytesReceived < numberOfSendingPeersPerRound) {
+            for (size_t index = 0; index < pollFds.size(); ++index) {
+                pollFds[index].fd = peers.nodeSockets[index];
+                pollFds[index].events = POLLIN;
+                pollFds[index].revents = 0;
+            }
+            if (poll(pollFds.data(), pollFds.size(), 50) <= 0)
+                break;
+            for (const struct pollfd& pollFd : pollFds) {
+                if (pollFd.revents & POLLIN)
+                    bytesReceived += ReceiveFrom(pollFd.fd);
+            }
+        }
+    }
+}
+
+// Edge-triggered: sockets are registered once and only serviced sockets are
+// re-checked, as EpollSocketsProcessor does.
+static void SocketMultiplexer_EpollAllPeers(benchmark::State& state)
+{
+    LoopbackPeers peers;
+    EpollSocketMultiplexer multiplexer;
+    for (SOCKET hSocket : peers.nodeSockets)
+        multiplexer.add(hSocket);
+    multiplexer.wait(0);
+    state.SetItemsPerIteration(peers.nodeSockets.size());
+    while (state.KeepRunning()) {
+        peers.SendFromSomePeers();
+        int bytesReceived = 0;
+        while (bytesReceived < numberOfSendingPeersPerRound) {
+            if (multiplexer.wait(50) < 0)
+                break;
+            bool serviced = false;
+            for (SOCKET hSocket : peers.nodeSockets) {
+                if (!multiplexer.isReadable(hSocket))
+                    continue;
+                bytesReceived += ReceiveFrom(hSocket);
+                multiplexer.markServiced(hSocket);
+                serviced = true;
+            }
+            if (!serviced)
+                break;
+        }
+    }
+}
+
+BENCHMARK(SocketMultiplexer_PollAllPeers);
+BENCHMARK(SocketMultiplexer_EpollAllPeers);
+#endif// HAVE_SYS_EPOLL_H
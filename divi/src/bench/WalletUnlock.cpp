@@ -0,0 +1,94 @@
+// Copyright (c) 2015 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include <script/script.h>
+#include <script/standard.h>
+#include <crypter.h>
+#include <hash.h>
+#include <key.h>
+
+#include <vector>
+
+// A large exchange or staking wallet
+static const unsigned numberOfKeys = 100000;
+
+class EncryptedKeyStore : public CCryptoKeyStore
+{
+public:
+    using CCryptoKeyStore::EncryptKeys;
+    using CCryptoKeyStore::Unlock;
+};
+
+// The key store is only filled once; deriving 100k public keys takes seconds
+static EncryptedKeyStore& KeyStoreWithManyKeys(CKeyingMaterial& masterKey, CKeyID& stakingKeyID)
+{
+    static EncryptedKeyStore keyStore;
+    static CKeyID firstKeyID;
+    if (!keyStore.IsCrypted()) {
+        for (unsigned index = 0; index < numberOfKeys; ++index) {
+            CKey key;
+            key.MakeNewKey(true);
+            if (index == 0) firstKeyID = key.GetPubKey().GetID();
+            keyStore.AddKeyPubKey(key, key.GetPubKey());
+        }
+        CKeyingMaterial encryptionKey(WALLET_CRYPTO_KEY_SIZE, 0x07);
+        keyStore.EncryptKeys(encryptionKey);
+    }
+    masterKey = CKeyingMaterial(WALLET_CRYPTO_KEY_SIZE, 0x07);
+    stakingKeyID = firstKeyID;
+    return keyStore;
+}
+
+// A timed unlock expiring and the operator unlocking again; the passphrase
+// key derivation is left out as it does not depend on the number of keys.
+static void WalletUnlock_100kKeys(benchmark::State& state)
+{
+    CKeyingMaterial masterKey;
+    CKeyID stakingKeyID;
+    EncryptedKeyStore& keyStore = KeyStoreWithManyKeys(masterKey, stakingKeyID);
+    while (state.KeepRunning()) {
+        keyStore.Unlock(masterKey);
+        keyStore.Lock();
+    }
+}
+
+// An unlock followed by the first block signature of the session.
+static void WalletUnlock_100kKeysThenSign(benchmark::State& state)
+{
+    CKeyingMaterial masterKey;
+    CKeyID stakingKeyID;
+    EncryptedKeyStore& keyStore = KeyStoreWithManyKeys(masterKey, stakingKeyID);
+    const uint256 blockHash = Hash(stakingKeyID.begin(), stakingKeyID.end());
+    std::vector<unsigned char> signature;
+    while (state.KeepRunning()) {
+        keyStore.Unlock(masterKey);
+        CKey key;
+        keyStore.GetKey(stakingKeyID, key);
+        key.Sign(blockHash, signature);
+        keyStore.Lock();
+    }
+}
+
+// Later signatures with a key already used since the unlock.
+static void WalletUnlock_SignWhileUnlocked(benchmark::State& state)
+{
+    CKeyingMaterial masterKey;
+    CKeyID stakingKeyID;
+    EncryptedKeyStore& keyStore = KeyStoreWithManyKeys(masterKey, stakingKeyID);
+    const uint256 blockHash = Hash(stakingKeyID.begin(), stakingKeyID.end());
+    std::vector<unsigned char> signature;
+    keyStore.Unlock(masterKey);
+    while (state.KeepRunning()) {
+        CKey key;
+        keyStore.GetKey(stakingKeyID, key);
+        key.Sign(blockHash, signature);
+    }
+    keyStore.Lock();
+}
+
+BENCHMARK(WalletUnlock_100kKeys);
+BENCHMARK(WalletUnlock_100kKeysThenSign);
+BENCHMARK(WalletUnlock_SignWhileUnlocked);
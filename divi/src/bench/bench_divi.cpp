@@ -0,0 +1,21 @@
+// Copyright (c) 2015 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include <Logging.h>
+#include <util.h>
+
+#include <string>
+
+int
+main(int argc, char** argv)
+{
+    SetupEnvironment();
+    fPrintToDebugLog = false; // don't want to write to debug.log file
+
+    // An optional argument restricts the run to benchmarks whose name contains it
+    const std::string filter = argc > 1 ? std::string(argv[1]) : std::string();
+    benchmark::BenchRunner::RunAll(1.0, filter);
+}
@@ -1,5 +1,38 @@
 #include <blockmap.h>
 
+BlockIndexArena::BlockIndexArena(
+    ): chunks_()
+    , usedInLastChunk_(0u)
+{
+}
+
+CBlockIndex* BlockIndexArena::allocate()
+{
+    if(chunks_.empty() || usedInLastChunk_ == blockIndicesPerChunk)
+    {
+        chunks_.emplace_back(new CBlockIndex[blockIndicesPerChunk]);
+        usedInLastChunk_ = 0u;
+    }
+    return &chunks_.back()[usedInLastChunk_++];
+}
+
+void BlockIndexArena::clear()
+{
+    chunks_.clear();
+    usedInLastChunk_ = 0u;
+}
+
+size_t BlockIndexArena::size() const
+{
+    if(chunks_.empty()) return 0u;
+    return (chunks_.size() - 1u) * blockIndicesPerChunk + usedInLastChunk_;
+}
+
+size_t BlockIndexArena::allocatedBytes() const
+{
+    return chunks_.size() * blockIndicesPerChunk * sizeof(CBlockIndex);
+}
+
 CBlockIndex* BlockMap::GetUniqueBlockIndexForHash(uint256 blockHash)
 {
     if (blockHash == 0)
@@ -11,10 +44,26 @@ CBlockIndex* BlockMap::GetUniqueBlockIndexForHash(uint256 blockHash)
         return (*mi).second;
 
     // Create new
-    CBlockIndex* pindexNew = new CBlockIndex();
-    if (!pindexNew)
-        throw std::runtime_error("LoadBlockIndex() : new CBlockIndex failed");
+    CBlockIndex* pindexNew = arena_.allocate();
     mi = insert(std::make_pair(blockHash, pindexNew)).first;
     pindexNew->phashBlock = &((*mi).first);
     return pindexNew;
-}
\ No newline at end of file
+}
+
+CBlockIndex* BlockMap::AllocateBlockIndex(const CBlock& block)
+{
+    CBlockIndex* pindexNew = arena_.allocate();
+    *pindexNew = CBlockIndex(block);
+    return pindexNew;
+}
+
+void BlockMap::DestroyBlockIndices()
+{
+    clear();
+    arena_.clear();
+}
+
+const BlockIndexArena& BlockMap::arena() const
+{
+    return arena_;
+}
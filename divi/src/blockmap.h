@@ -2,14 +2,46 @@
 #define BLOCK_MAP_H
 #include "chain.h"
 #include <boost/unordered_map.hpp>
+#include <memory>
 #include <stdexcept>
+#include <vector>
 
 struct BlockHasher {
     size_t operator()(const uint256& hash) const { return hash.GetLow64(); }
 };
+
+/** Owns block index entries, handing them out from large contiguous chunks
+ *  instead of one heap allocation each. Entries stay at a fixed address
+ *  until the arena is cleared. */
+class BlockIndexArena
+{
+private:
+    static const size_t blockIndicesPerChunk = 16384;
+    std::vector<std::unique_ptr<CBlockIndex[]> > chunks_;
+    size_t usedInLastChunk_;
+
+public:
+    BlockIndexArena();
+    BlockIndexArena(const BlockIndexArena&) = delete;
+    BlockIndexArena& operator=(const BlockIndexArena&) = delete;
+
+    CBlockIndex* allocate();
+    void clear();
+
+    size_t size() const;
+    size_t allocatedBytes() const;
+};
+
 class BlockMap: public boost::unordered_map<uint256, CBlockIndex*, BlockHasher>
 {
+private:
+    BlockIndexArena arena_;
+
 public:
     CBlockIndex* GetUniqueBlockIndexForHash(uint256 blockHash);
+    CBlockIndex* AllocateBlockIndex(const CBlock& block);
+    /** Clears the map and releases every entry allocated through it. */
+    void DestroyBlockIndices();
+    const BlockIndexArena& arena() const;
 };
-#endif // BLOCK_MAP_H
\ No newline at end of file
+#endif // BLOCK_MAP_H
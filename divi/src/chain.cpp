@@ -6,6 +6,12 @@
 #include "chain.h"
 
 #include "util.h"
+
+#include <new>
+#include <type_traits>
+
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
 using namespace std;
 
 /**
@@ -62,6 +68,144 @@ const CBlockIndex* CChain::FindFork(const CBlockIndex* pindex) const
     return pindex;
 }
 
+namespace
+{
+/** Hands out stake data slots from large chunks and keeps released slots on
+ *  a free list for reuse, so a slot costs exactly its size. Chunks are only
+ *  released at exit, as the block index does not shrink while running. */
+class StakeDataPool
+{
+private:
+    union Slot
+    {
+        Slot* next;
+        std::aligned_storage<sizeof(CBlockIndexStakeData), alignof(CBlockIndexStakeData)>::type storage;
+    };
+    static const size_t slotsPerChunk = 16384;
+
+    boost::mutex mutex_;
+    std::vector<std::unique_ptr<Slot[]> > chunks_;
+    size_t usedInLastChunk_;
+    Slot* freeSlots_;
+
+public:
+    StakeDataPool(
+        ): mutex_()
+        , chunks_()
+        , usedInLastChunk_(0u)
+        , freeSlots_(NULL)
+    {
+    }
+
+    CBlockIndexStakeData* allocate(const CBlockIndexStakeData& value)
+    {
+        Slot* slot;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex_);
+            if (freeSlots_) {
+                slot = freeSlots_;
+                freeSlots_ = slot->next;
+            } else {
+                if (chunks_.empty() || usedInLastChunk_ == slotsPerChunk) {
+                    chunks_.emplace_back(new Slot[slotsPerChunk]);
+                    usedInLastChunk_ = 0u;
+                }
+                slot = &chunks_.back()[usedInLastChunk_++];
+            }
+        }
+        return new (&slot->storage) CBlockIndexStakeData(value);
+    }
+
+    void release(CBlockIndexStakeData* data)
+    {
+        data->~CBlockIndexStakeData();
+        Slot* slot = reinterpret_cast<Slot*>(data);
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        slot->next = freeSlots_;
+        freeSlots_ = slot;
+    }
+};
+
+StakeDataPool& GetStakeDataPool()
+{
+    // Never destroyed, so entries outliving other statics can still release
+    static StakeDataPool* pool = new StakeDataPool();
+    return *pool;
+}
+} // anonymous namespace
+
+CBlockIndexStakeDataStorage::CBlockIndexStakeDataStorage(
+    ): data_(NULL)
+{
+}
+
+CBlockIndexStakeDataStorage::CBlockIndexStakeDataStorage(
+    const CBlockIndexStakeDataStorage& other
+    ): data_(other.data_? GetStakeDataPool().allocate(*other.data_) : NULL)
+{
+}
+
+CBlockIndexStakeDataStorage::CBlockIndexStakeDataStorage(
+    CBlockIndexStakeDataStorage&& other
+    ): data_(other.data_)
+{
+    other.data_ = NULL;
+}
+
+CBlockIndexStakeDataStorage::~CBlockIndexStakeDataStorage()
+{
+    SetNull();
+}
+
+CBlockIndexStakeDataStorage& CBlockIndexStakeDataStorage::operator=(const CBlockIndexStakeDataStorage& other)
+{
+    if (this == &other)
+        return *this;
+    if (!other.data_)
+        SetNull();
+    else if (data_)
+        *data_ = *other.data_;
+    else
+        data_ = GetStakeDataPool().allocate(*other.data_);
+    return *this;
+}
+
+CBlockIndexStakeDataStorage& CBlockIndexStakeDataStorage::operator=(CBlockIndexStakeDataStorage&& other)
+{
+    if (this == &other)
+        return *this;
+    SetNull();
+    data_ = other.data_;
+    other.data_ = NULL;
+    return *this;
+}
+
+bool CBlockIndexStakeDataStorage::IsNull() const
+{
+    return data_ == NULL;
+}
+
+const CBlockIndexStakeData& CBlockIndexStakeDataStorage::Get() const
+{
+    static const CBlockIndexStakeData noStakeData;
+    return data_? *data_ : noStakeData;
+}
+
+CBlockIndexStakeData& CBlockIndexStakeDataStorage::GetMutable()
+{
+    if (!data_)
+        data_ = GetStakeDataPool().allocate(CBlockIndexStakeData());
+    return *data_;
+}
+
+void CBlockIndexStakeDataStorage::SetNull()
+{
+    if (data_) {
+        GetStakeDataPool().release(data_);
+        data_ = NULL;
+    }
+}
+
 uint256 CBlockIndex::GetBlockTrust() const
 {
     uint256 bnTarget;
@@ -12,6 +12,7 @@
 #include "uint256.h"
 #include "LotteryCoinstakes.h"
 
+#include <memory>
 #include <vector>
 
 #include <boost/foreach.hpp>
@@ -98,6 +99,52 @@ enum BlockStatus {
     BLOCK_FAILED_MASK = BLOCK_FAILED_VALID | BLOCK_FAILED_CHILD,
 };
 
+/** Proof-of-stake data of a block index entry. It is only read when a block
+ *  is connected or its index entry flushed, never while walking the index,
+ *  and proof-of-work entries have none, so it is kept out of CBlockIndex. */
+struct CBlockIndexStakeData
+{
+    COutPoint prevoutStake;
+    unsigned int nStakeTime;
+    uint256 hashProofOfStake;
+
+    CBlockIndexStakeData()
+    {
+        SetNull();
+    }
+
+    void SetNull()
+    {
+        prevoutStake.SetNull();
+        nStakeTime = 0;
+        hashProofOfStake = uint256();
+    }
+};
+
+/** Owns the stake data of a block index entry. The data is taken from a
+ *  shared pool of fixed size slots on first write, so only proof-of-stake
+ *  entries carry any and none of them pays for a heap allocation of its
+ *  own. Copying an entry copies the data into a slot of the destination. */
+class CBlockIndexStakeDataStorage
+{
+private:
+    CBlockIndexStakeData* data_;
+
+public:
+    CBlockIndexStakeDataStorage();
+    CBlockIndexStakeDataStorage(const CBlockIndexStakeDataStorage& other);
+    CBlockIndexStakeDataStorage(CBlockIndexStakeDataStorage&& other);
+    ~CBlockIndexStakeDataStorage();
+    CBlockIndexStakeDataStorage& operator=(const CBlockIndexStakeDataStorage& other);
+    CBlockIndexStakeDataStorage& operator=(CBlockIndexStakeDataStorage&& other);
+
+    bool IsNull() const;
+    const CBlockIndexStakeData& Get() const;
+    CBlockIndexStakeData& GetMutable();
+    //! Returns the slot to the pool
+    void SetNull();
+};
+
 /** The block chain is a tree shaped structure starting with the
  * genesis block at the root, with each block potentially having multiple
  * candidates to be the next block. A blockindex may have multiple pprev pointing
@@ -106,82 +153,91 @@ enum BlockStatus {
 class  CBlockIndex
 {
 public:
+    // Fields touched while walking the index (chain selection, GetAncestor,
+    // locators, median time past) come first so a traversal stays within the
+    // leading cache lines of each entry. Fields only read when a block is
+    // connected or flushed to disk follow, and the proof-of-stake data is
+    // stored out of line, see CBlockIndexStakeData.
+
     //! pointer to the hash of the block, if any. memory is owned by this CBlockIndex
     const uint256* phashBlock;
 
     //! pointer to the index of the predecessor of this block
     CBlockIndex* pprev;
 
-    //! pointer to the index of the next block
-    CBlockIndex* pnext;
-
     //! pointer to the index of some further predecessor of this block
     CBlockIndex* pskip;
 
-    //ppcoin: trust score of block chain
-    uint256 bnChainTrust;
-
     //! height of the entry in the chain. The genesis block has height 0
     int nHeight;
 
-    //! Which # file this block is stored in (blk?????.dat)
-    int nFile;
+    //! Verification status of this block. See enum BlockStatus
+    unsigned int nStatus;
 
-    //! Byte offset within blk?????.dat where this block's data is stored
-    unsigned int nDataPos;
+    unsigned int nTime;
+    unsigned int nBits;
 
-    //! Byte offset within rev?????.dat where this block's undo data is stored
-    unsigned int nUndoPos;
+    unsigned int nFlags; // ppcoin: block index flags
+    enum {
+        BLOCK_PROOF_OF_STAKE = (1 << 0), // is proof-of-stake block
+        BLOCK_STAKE_ENTROPY = (1 << 1),  // entropy bit for stake modifier
+        BLOCK_STAKE_MODIFIER = (1 << 2), // regenerated stake modifier
+    };
+
+    //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
+    uint32_t nSequenceId;
 
     //! (memory only) Total amount of work (expected number of hashes) in the chain up to and including this block
     uint256 nChainWork;
 
-    //! Number of transactions in this block.
-    //! Note: in a potential headers-first mode, this number cannot be relied upon
-    unsigned int nTx;
-
     //! (memory only) Number of transactions in the chain up to and including this block.
     //! This value will be non-zero only if and only if transactions for this block and all its parents are available.
     //! Change to 64-bit type when necessary; won't happen before 2030
     unsigned int nChainTx;
 
-    //! Verification status of this block. See enum BlockStatus
-    unsigned int nStatus;
+    //! Number of transactions in this block.
+    //! Note: in a potential headers-first mode, this number cannot be relied upon
+    unsigned int nTx;
 
-    unsigned int nFlags; // ppcoin: block index flags
-    enum {
-        BLOCK_PROOF_OF_STAKE = (1 << 0), // is proof-of-stake block
-        BLOCK_STAKE_ENTROPY = (1 << 1),  // entropy bit for stake modifier
-        BLOCK_STAKE_MODIFIER = (1 << 2), // regenerated stake modifier
-    };
+    //! pointer to the index of the next block
+    CBlockIndex* pnext;
 
-    // proof-of-stake specific fields
-    uint256 GetBlockTrust() const;
-    uint64_t nStakeModifier;             // hash modifier for proof-of-stake
-    unsigned int nStakeModifierChecksum; // checksum of index; in-memeory only
-    COutPoint prevoutStake;
-    unsigned int nStakeTime;
-    uint256 hashProofOfStake;
-    int64_t nMint;
-    int64_t nMoneySupply;
+    //! Which # file this block is stored in (blk?????.dat)
+    int nFile;
+
+    //! Byte offset within blk?????.dat where this block's data is stored
+    unsigned int nDataPos;
+
+    //! Byte offset within rev?????.dat where this block's undo data is stored
+    unsigned int nUndoPos;
 
     //! block header
     int nVersion;
-    uint256 hashMerkleRoot;
-    unsigned int nTime;
-    unsigned int nBits;
     unsigned int nNonce;
+    uint256 hashMerkleRoot;
     uint256 nAccumulatorCheckpoint;
 
-    //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
-    uint32_t nSequenceId;
+    // proof-of-stake specific fields
+    uint256 GetBlockTrust() const;
+    unsigned int nStakeModifierChecksum; // checksum of index; in-memeory only
+    uint64_t nStakeModifier;             // hash modifier for proof-of-stake
+    int64_t nMint;
+    int64_t nMoneySupply;
 
+    //! Lottery winners as of this block; the list itself is shared with the
+    //! ancestor that stored it, see LotteryCoinstakeData
     LotteryCoinstakeData vLotteryWinnersCoinstakes;
 
+private:
+    CBlockIndexStakeDataStorage stakeData_;
+
+public:
+
     void SetNull()
     {
         phashBlock = NULL;
         pprev = NULL;
+        pnext = NULL;
         pskip = NULL;
         nHeight = 0;
         nFile = 0;
@@ -198,8 +254,8 @@ public:
         nFlags = 0;
         nStakeModifier = 0;
         nStakeModifierChecksum = 0;
-        prevoutStake.SetNull();
-        nStakeTime = 0;
+        stakeData_.SetNull();
+        vLotteryWinnersCoinstakes.clear();
 
         nVersion = 0;
         hashMerkleRoot = uint256();
@@ -207,7 +263,6 @@ public:
         nBits = 0;
         nNonce = 0;
         nAccumulatorCheckpoint = 0;
-        vLotteryWinnersCoinstakes.clear();
     }
 
     CBlockIndex()
@@ -228,24 +283,37 @@ public:
             nAccumulatorCheckpoint = block.nAccumulatorCheckpoint;
 
         //Proof of Stake
-        bnChainTrust = uint256();
         nMint = 0;
         nMoneySupply = 0;
         nFlags = 0;
         nStakeModifier = 0;
         nStakeModifierChecksum = 0;
-        hashProofOfStake = uint256();
 
         if (block.IsProofOfStake()) {
             SetProofOfStake();
-            prevoutStake = block.vtx[1].vin[0].prevout;
-            nStakeTime = block.nTime;
-        } else {
-            prevoutStake.SetNull();
-            nStakeTime = 0;
+            CBlockIndexStakeData& stakeData = MutableStakeData();
+            stakeData.prevoutStake = block.vtx[1].vin[0].prevout;
+            stakeData.nStakeTime = block.nTime;
         }
+    }
 
-        vLotteryWinnersCoinstakes.clear();
+    //! Whether stake data was written to this entry
+    bool HasStakeData() const
+    {
+        return !stakeData_.IsNull();
+    }
+
+    //! The stake data of this entry, all null if none was written
+    const CBlockIndexStakeData& StakeData() const
+    {
+        return stakeData_.Get();
+    }
+
+    //! Takes a slot for the stake data on first use; only call it for
+    //! proof-of-stake entries
+    CBlockIndexStakeData& MutableStakeData()
+    {
+        return stakeData_.GetMutable();
     }
 
 
@@ -388,21 +456,54 @@ public:
 /** Used to marshal pointers into hashes for db storage. */
 class CDiskBlockIndex : public CBlockIndex
 {
+private:
+    //! Stake data of the entry this was built from, written in place of a copy
+    const CBlockIndexStakeData* sourceStakeData_;
+
 public:
     uint256 hashPrev;
     uint256 hashNext;
 
     CDiskBlockIndex()
+        : sourceStakeData_(NULL)
     {
         hashPrev = uint256();
         hashNext = uint256();
     }
 
-    explicit CDiskBlockIndex(CBlockIndex* pindex) : CBlockIndex(*pindex)
-    {
+    //! Copies the fields stored on disk; the entry must outlive this
+    explicit CDiskBlockIndex(const CBlockIndex* pindex)
+        : sourceStakeData_(pindex->HasStakeData()? &pindex->StakeData() : NULL)
+    {
+        phashBlock = pindex->phashBlock;
+        pprev = pindex->pprev;
+        nHeight = pindex->nHeight;
+        nStatus = pindex->nStatus;
+        nTx = pindex->nTx;
+        nFile = pindex->nFile;
+        nDataPos = pindex->nDataPos;
+        nUndoPos = pindex->nUndoPos;
+        nMint = pindex->nMint;
+        nMoneySupply = pindex->nMoneySupply;
+        nFlags = pindex->nFlags;
+        nStakeModifier = pindex->nStakeModifier;
+        vLotteryWinnersCoinstakes = pindex->vLotteryWinnersCoinstakes;
+        nVersion = pindex->nVersion;
+        hashMerkleRoot = pindex->hashMerkleRoot;
+        nTime = pindex->nTime;
+        nBits = pindex->nBits;
+        nNonce = pindex->nNonce;
+        nAccumulatorCheckpoint = pindex->nAccumulatorCheckpoint;
+
         hashPrev = (pprev ? pprev->GetBlockHash() : uint256());
     }
 
+    //! The stake data written for this entry
+    const CBlockIndexStakeData& StakeDataToWrite() const
+    {
+        return sourceStakeData_? *sourceStakeData_ : StakeData();
+    }
+
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
@@ -427,13 +528,11 @@ public:
         READWRITE(nFlags);
         READWRITE(nStakeModifier);
         if (IsProofOfStake()) {
-            READWRITE(prevoutStake);
-            READWRITE(nStakeTime);
-            READWRITE(hashProofOfStake);
-        } else {
-            const_cast<CDiskBlockIndex*>(this)->prevoutStake.SetNull();
-            const_cast<CDiskBlockIndex*>(this)->nStakeTime = 0;
-            const_cast<CDiskBlockIndex*>(this)->hashProofOfStake = uint256();
+            CBlockIndexStakeData& stakeData = ser_action.ForRead()?
+                MutableStakeData() : const_cast<CBlockIndexStakeData&>(StakeDataToWrite());
+            READWRITE(stakeData.prevoutStake);
+            READWRITE(stakeData.nStakeTime);
+            READWRITE(stakeData.hashProofOfStake);
         }
 
         READWRITE(vLotteryWinnersCoinstakes);
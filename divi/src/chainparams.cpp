@@ -516,6 +516,7 @@ public:
         fDefaultConsistencyChecks = true;
         fDifficultyRetargeting = false;
         fMineBlocksOnDemand = true;
+        fHeadersFirstSyncingActive = true;
     }
     const CCheckpointData& Checkpoints() const
     {
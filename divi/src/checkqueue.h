@@ -6,6 +6,9 @@
 #define BITCOIN_CHECKQUEUE_H
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
 #include <vector>
 
 #include <boost/foreach.hpp>
@@ -25,135 +28,197 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Every worker (the master included) owns a deque of verifications that
+  * the master fills round-robin. Workers take jobs from the back of their
+  * own deque and, once it runs dry, steal half of another worker's deque
+  * from the front, so no single lock is shared by all of them. Completion
+  * is tracked by one atomic counter of outstanding verifications.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
-    boost::mutex mutex;
-
-    //! Worker threads block on this when out of work
-    boost::condition_variable condWorker;
+    struct WorkerDeque
+    {
+        boost::mutex mutex;
+        std::deque<T> checks;
+        //! Size of the deque as last seen under its mutex, to skip empty deques without locking.
+        std::atomic<size_t> approximateSize;
 
-    //! Master thread blocks on this when out of work
-    boost::condition_variable condMaster;
+        WorkerDeque() : mutex(), checks(), approximateSize(0) {}
+    };
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
+    //! Deque 0 belongs to the master, the others are shared out to worker threads as they register.
+    std::vector<std::unique_ptr<WorkerDeque> > deques;
 
-    //! The number of workers (including the master) that are idle.
-    int nIdle;
+    //! The number of worker threads that have registered, excluding the master.
+    std::atomic<unsigned int> nRegistered;
 
-    //! The total number of workers (including the master).
-    int nTotal;
+    //! Rotates the deque receiving the next batch of verifications.
+    std::atomic<unsigned int> nNextDeque;
 
-    //! The temporary evaluation result.
-    bool fAllOk;
+    //! The evaluation result so far; checks are skipped once it is false.
+    std::atomic<bool> fAllOk;
 
     /**
-     * Number of verifications that haven't completed yet.
-     * This includes elements that are not anymore in queue, but still in
-     * worker's own batches.
+     * Number of verifications that haven't completed yet, including the
+     * ones that have already been taken out of a deque.
      */
-    unsigned int nTodo;
+    std::atomic<unsigned int> nTodo;
+
+    //! Protects nWorkGeneration and pairs with the condition variables below.
+    boost::mutex mutexIdle;
 
-    //! Whether we're shutting down.
-    bool fQuit;
+    //! Bumped whenever work is added, so that idle workers don't miss it.
+    uint64_t nWorkGeneration;
 
-    //! The maximum number of elements to be processed in one batch
+    //! Worker threads block on this when out of work
+    boost::condition_variable condWorker;
+
+    //! Master thread blocks on this when out of work
+    boost::condition_variable condMaster;
+
+    //! The maximum number of elements stolen at once
     unsigned int nBatchSize;
 
-    /** Internal function that does bulk of the verification work. */
-    bool Loop(bool fMaster = false)
+    unsigned int NumberOfActiveDeques() const
     {
-        boost::condition_variable& cond = fMaster ? condMaster : condWorker;
-        std::vector<T> vChecks;
-        vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
-        do {
+        return std::min<unsigned int>(nRegistered.load(), deques.size() - 1) + 1;
+    }
+
+    bool PopOwn(unsigned int nSelf, T& check)
+    {
+        WorkerDeque& own = *deques[nSelf];
+        if (own.approximateSize.load(std::memory_order_relaxed) == 0)
+            return false;
+        boost::unique_lock<boost::mutex> lock(own.mutex);
+        if (own.checks.empty())
+            return false;
+        check.swap(own.checks.back());
+        own.checks.pop_back();
+        own.approximateSize.store(own.checks.size(), std::memory_order_relaxed);
+        return true;
+    }
+
+    bool Steal(unsigned int nSelf, T& check)
+    {
+        const unsigned int nDeques = NumberOfActiveDeques();
+        std::vector<T> vStolen;
+        for (unsigned int nOffset = 1; nOffset < nDeques; nOffset++) {
+            WorkerDeque& victim = *deques[(nSelf + nOffset) % nDeques];
+            if (victim.approximateSize.load(std::memory_order_relaxed) == 0)
+                continue;
             {
-                boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master he can exit and return the result
-                        condMaster.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty()) {
-                    if ((fMaster || fQuit) && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        if (fMaster)
-                            fAllOk = true;
-                        // return the current status
-                        return fRet;
-                    }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
+                boost::unique_lock<boost::mutex> lock(victim.mutex);
+                if (victim.checks.empty())
+                    continue;
+                const size_t nSteal = std::max<size_t>(1, std::min<size_t>(nBatchSize, victim.checks.size() / 2));
+                vStolen.resize(nSteal);
+                for (size_t i = 0; i < nSteal; i++) {
+                    vStolen[i].swap(victim.checks.front());
+                    victim.checks.pop_front();
                 }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
+                victim.approximateSize.store(victim.checks.size(), std::memory_order_relaxed);
+            }
+            check.swap(vStolen.front());
+            if (vStolen.size() > 1) {
+                // Keep the rest where it can be stolen again by whoever runs out next
+                WorkerDeque& own = *deques[nSelf];
+                boost::unique_lock<boost::mutex> lock(own.mutex);
+                for (size_t i = 1; i < vStolen.size(); i++) {
+                    own.checks.push_back(T());
+                    own.checks.back().swap(vStolen[i]);
                 }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
+                own.approximateSize.store(own.checks.size(), std::memory_order_relaxed);
             }
-            // execute work
-            BOOST_FOREACH (T& check, vChecks)
-                if (fOk)
-                    fOk = check();
-            vChecks.clear();
-        } while (true);
+            return true;
+        }
+        return false;
+    }
+
+    /** Run one verification from the own deque or a stolen one; false if there was nothing to do. */
+    bool RunCheck(unsigned int nSelf)
+    {
+        T check;
+        if (!PopOwn(nSelf, check) && !Steal(nSelf, check))
+            return false;
+        if (fAllOk.load(std::memory_order_relaxed) && !check())
+            fAllOk.store(false);
+        if (nTodo.fetch_sub(1) == 1) {
+            // We processed the last element; inform the master he can exit and return the result
+            boost::unique_lock<boost::mutex> lock(mutexIdle);
+            condMaster.notify_one();
+        }
+        return true;
     }
 
 public:
     //! Create a new check queue
-    CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), fQuit(false), nBatchSize(nBatchSizeIn) {}
+    CCheckQueue(unsigned int nBatchSizeIn, unsigned int nMaxWorkersIn = 64)
+        : deques(), nRegistered(0), nNextDeque(0), fAllOk(true), nTodo(0), mutexIdle(), nWorkGeneration(0), nBatchSize(std::max(1U, nBatchSizeIn))
+    {
+        for (unsigned int i = 0; i <= nMaxWorkersIn; i++)
+            deques.emplace_back(new WorkerDeque());
+    }
 
     //! Worker thread
     void Thread()
     {
-        Loop();
+        // Threads beyond the number of deques share one, which is safe as every deque has its own lock
+        const unsigned int nSelf = 1 + nRegistered.fetch_add(1) % (deques.size() - 1);
+        while (true) {
+            uint64_t nGeneration;
+            {
+                boost::unique_lock<boost::mutex> lock(mutexIdle);
+                nGeneration = nWorkGeneration;
+            }
+            while (RunCheck(nSelf)) {
+            }
+            boost::unique_lock<boost::mutex> lock(mutexIdle);
+            while (nGeneration == nWorkGeneration)
+                condWorker.wait(lock); // wait
+        }
     }
 
     //! Wait until execution finishes, and return whether all evaluations where successful.
     bool Wait()
     {
-        return Loop(true);
+        while (true) {
+            while (RunCheck(0)) {
+            }
+            boost::unique_lock<boost::mutex> lock(mutexIdle);
+            if (nTodo.load() == 0)
+                break;
+            condMaster.wait(lock);
+        }
+        // reset the status for new work later
+        return fAllOk.exchange(true);
     }
 
     //! Add a batch of checks to the queue
     void Add(std::vector<T>& vChecks)
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        BOOST_FOREACH (T& check, vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
+        if (vChecks.empty())
+            return;
+        nTodo.fetch_add(vChecks.size());
+        const unsigned int nDeques = NumberOfActiveDeques();
+        const size_t nChunkSize = (vChecks.size() + nDeques - 1) / nDeques;
+        for (size_t nStart = 0; nStart < vChecks.size(); nStart += nChunkSize) {
+            WorkerDeque& target = *deques[nNextDeque.fetch_add(1) % nDeques];
+            boost::unique_lock<boost::mutex> lock(target.mutex);
+            const size_t nEnd = std::min(vChecks.size(), nStart + nChunkSize);
+            for (size_t i = nStart; i < nEnd; i++) {
+                target.checks.push_back(T());
+                vChecks[i].swap(target.checks.back());
+            }
+            target.approximateSize.store(target.checks.size(), std::memory_order_relaxed);
         }
-        nTodo += vChecks.size();
+        boost::unique_lock<boost::mutex> lock(mutexIdle);
+        nWorkGeneration++;
         if (vChecks.size() == 1)
             condWorker.notify_one();
-        else if (vChecks.size() > 1)
+        else
             condWorker.notify_all();
     }
 
@@ -163,8 +228,7 @@ public:
 
     bool IsIdle()
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        return (nTotal == nIdle && nTodo == 0 && fAllOk == true);
+        return nTodo.load() == 0 && fAllOk.load();
     }
 };
 
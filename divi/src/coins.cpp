@@ -213,6 +213,7 @@ CCoinsMap::const_iterator CCoinsViewCache::FetchCoins(const uint256& txid) const
         return cacheCoins.end();
     CCoinsMap::iterator ret = cacheCoins.insert(std::make_pair(txid, CCoinsCacheEntry())).first;
     tmp.swap(ret->second.coins);
+    ret->second.nParentOutputs = ret->second.coins.vout.size();
     if (ret->second.coins.IsPruned()) {
         // The parent only has an empty entry for this txid; we can consider our
         // version as fresh.
@@ -244,12 +245,37 @@ CCoinsModifier CCoinsViewCache::ModifyCoins(const uint256& txid)
             // The parent view only has a pruned entry for this; mark it as fresh.
             ret.first->second.flags = CCoinsCacheEntry::FRESH;
         }
+        ret.first->second.nParentOutputs = ret.first->second.coins.vout.size();
     }
-    // Assume that whenever ModifyCoins is called, the entry will be modified.
+    // Assume that whenever ModifyCoins is called, the entry will be modified,
+    // in arbitrary ways.
     ret.first->second.flags |= CCoinsCacheEntry::DIRTY;
+    ret.first->second.flags &= ~CCoinsCacheEntry::SPENDS_ONLY;
+    ret.first->second.vSpentOutputs.clear();
     return CCoinsModifier(*this, ret.first);
 }
 
+bool CCoinsViewCache::SpendCoin(const COutPoint& outpoint, CTxInUndo& undo)
+{
+    assert(!hasModifier);
+    const CCoinsViewCache& constThis = *this;
+    if (constThis.FetchCoins(outpoint.hash) == cacheCoins.end())
+        return false;
+    CCoinsMap::iterator it = cacheCoins.find(outpoint.hash);
+    CCoinsCacheEntry& entry = it->second;
+    if (!entry.coins.Spend(outpoint.n, undo))
+        return false;
+
+    if (!(entry.flags & CCoinsCacheEntry::DIRTY))
+        entry.flags |= CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::SPENDS_ONLY;
+    if (entry.flags & CCoinsCacheEntry::SPENDS_ONLY)
+        entry.vSpentOutputs.push_back(outpoint.n);
+
+    if ((entry.flags & CCoinsCacheEntry::FRESH) && entry.coins.IsPruned())
+        cacheCoins.erase(it);
+    return true;
+}
+
 const CCoins* CCoinsViewCache::AccessCoins(const uint256& txid) const
 {
     CCoinsMap::const_iterator it = FetchCoins(txid);
@@ -298,6 +324,7 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlockIn
                     CCoinsCacheEntry& entry = cacheCoins[it->first];
                     entry.coins.swap(it->second.coins);
                     entry.flags = CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH;
+                    entry.nParentOutputs = 0;
                 }
             } else {
                 if ((itUs->second.flags & CCoinsCacheEntry::FRESH) && it->second.coins.IsPruned()) {
@@ -306,9 +333,20 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlockIn
                     // it from the parent.
                     cacheCoins.erase(itUs);
                 } else {
-                    // A normal modification.
+                    // A normal modification. Spends-only changes stay spends-only
+                    // as long as our own entry wasn't modified in other ways.
+                    const bool fSpendsOnly =
+                        (it->second.flags & CCoinsCacheEntry::SPENDS_ONLY) &&
+                        (!(itUs->second.flags & CCoinsCacheEntry::DIRTY) || (itUs->second.flags & CCoinsCacheEntry::SPENDS_ONLY));
                     itUs->second.coins.swap(it->second.coins);
                     itUs->second.flags |= CCoinsCacheEntry::DIRTY;
+                    if (fSpendsOnly) {
+                        itUs->second.flags |= CCoinsCacheEntry::SPENDS_ONLY;
+                        itUs->second.vSpentOutputs.insert(itUs->second.vSpentOutputs.end(), it->second.vSpentOutputs.begin(), it->second.vSpentOutputs.end());
+                    } else {
+                        itUs->second.flags &= ~CCoinsCacheEntry::SPENDS_ONLY;
+                        itUs->second.vSpentOutputs.clear();
+                    }
                 }
             }
         }
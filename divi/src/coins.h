@@ -253,13 +253,16 @@ public:
 struct CCoinsCacheEntry {
     CCoins coins; // The actual cached data.
     unsigned char flags;
+    uint32_t nParentOutputs; // Size of coins.vout when the entry was fetched from the parent view.
+    std::vector<uint32_t> vSpentOutputs; // Outputs spent since the entry was fetched, while SPENDS_ONLY is set.
 
     enum Flags {
         DIRTY = (1 << 0), // This cache entry is potentially different from the version in the parent view.
         FRESH = (1 << 1), // The parent view does not have this entry (or it is pruned).
+        SPENDS_ONLY = (1 << 2), // The entry only differs from the parent view by the outputs in vSpentOutputs.
     };
 
-    CCoinsCacheEntry() : coins(), flags(0) {}
+    CCoinsCacheEntry() : coins(), flags(0), nParentOutputs(0), vSpentOutputs() {}
 };
 
 typedef boost::unordered_map<uint256, CCoinsCacheEntry, CCoinsKeyHasher> CCoinsMap;
@@ -403,6 +406,13 @@ public:
      */
     CCoinsModifier ModifyCoins(const uint256& txid);
 
+    /**
+     * Spend a single output and construct its undo information. Unlike
+     * ModifyCoins, only the spent output is recorded as changed, so that a
+     * per-outpoint backend doesn't need to rewrite the whole transaction.
+     */
+    bool SpendCoin(const COutPoint& outpoint, CTxInUndo& undo);
+
     /**
      * Push the modifications applied to this cache to its base.
      * Failure to call this method before destruction will cause the changes to be forgotten.
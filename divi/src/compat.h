@@ -92,7 +92,8 @@ size_t strnlen_int(const char* start, size_t max_len);
 
 bool static inline IsSelectableSocket(SOCKET s)
 {
-#ifdef WIN32
+#if defined(WIN32) || defined(HAVE_SYS_EPOLL_H)
+    // Linux builds wait on sockets with epoll and poll(), which have no FD_SETSIZE limit
     return true;
 #else
     return (s < FD_SETSIZE);
@@ -211,6 +211,7 @@ bool CCryptoKeyStore::Lock(bool fAllowMixing)
     if(!fAllowMixing) {
         LOCK(cs_KeyStore);
         vMasterKey.clear();
+        unlockedKeys_.clear();
     }
 
     fOnlyMixingAllowed = fAllowMixing;
@@ -225,27 +226,21 @@ bool CCryptoKeyStore::Unlock(const CKeyingMaterial& vMasterKeyIn, bool fForMixin
         if (!SetCrypted())
             return false;
 
+        // One key tells whether the master key is right; the others are checked
+        // by GetKey as they get decrypted, so unlocking takes the same time however
+        // many keys the wallet holds
         bool keyPass = false;
         bool keyFail = false;
         CryptedKeyMap::const_iterator mi = mapCryptedKeys.begin();
-        for (; mi != mapCryptedKeys.end(); ++mi)
+        if (mi != mapCryptedKeys.end())
         {
             const CPubKey &vchPubKey = (*mi).second.first;
             const std::vector<unsigned char> &vchCryptedSecret = (*mi).second.second;
             CKey key;
-            if (!DecryptKey(vMasterKeyIn, vchCryptedSecret, vchPubKey, key))
-            {
+            if (DecryptKey(vMasterKeyIn, vchCryptedSecret, vchPubKey, key))
+                keyPass = true;
+            else
                 keyFail = true;
-                break;
-            }
-            keyPass = true;
-            if (fDecryptionThoroughlyChecked)
-                break;
-        }
-        if (keyPass && keyFail)
-        {
-            LogPrintf("The wallet is probably corrupted: Some keys decrypt but not all.\n");
-            assert(false);
         }
         if (keyFail || (!keyPass && cryptedHDChain.IsNull()))
             return false;
@@ -265,7 +260,6 @@ bool CCryptoKeyStore::Unlock(const CKeyingMaterial& vMasterKeyIn, bool fForMixin
                 return false;
             }
         }
-        fDecryptionThoroughlyChecked = true;
     }
     fOnlyMixingAllowed = fForMixingOnly;
     NotifyStatusChanged(this);
@@ -316,9 +310,21 @@ bool CCryptoKeyStore::GetKey(const CKeyID &address, CKey& keyOut) const
         CryptedKeyMap::const_iterator mi = mapCryptedKeys.find(address);
         if (mi != mapCryptedKeys.end())
         {
+            if (vMasterKey.empty())
+                return false;
+            if (unlockedKeys_.getKey(address, keyOut))
+                return true;
+
             const CPubKey &vchPubKey = (*mi).second.first;
             const std::vector<unsigned char> &vchCryptedSecret = (*mi).second.second;
-            return DecryptKey(vMasterKey, vchCryptedSecret, vchPubKey, keyOut);
+            if (!DecryptKey(vMasterKey, vchCryptedSecret, vchPubKey, keyOut))
+            {
+                // Unlock checked the master key against another key
+                LogPrintf("The wallet is probably corrupted: Some keys decrypt but not all.\n");
+                return false;
+            }
+            unlockedKeys_.addKey(address, keyOut);
+            return true;
         }
     }
     return false;
@@ -9,6 +9,7 @@
 #include "keystore.h"
 #include "serialize.h"
 #include <MasterKey.h>
+#include <UnlockedKeyCache.h>
 
 class uint256;
 
@@ -94,13 +95,13 @@ private:
     //! if fUseCrypto is false, vMasterKey must be empty
     bool fUseCrypto;
 
-    //! keeps track of whether Unlock has run a thorough check before
-    bool fDecryptionThoroughlyChecked;
-
     //! if fOnlyMixingAllowed is true, only mixing should be allowed in unlocked wallet
     bool fOnlyMixingAllowed;
 
 protected:
+    //! keys used since the last unlock, wiped by Lock
+    mutable UnlockedKeyCache unlockedKeys_;
+
     bool SetCrypted();
 
     //! will encrypt previously unencrypted keys
@@ -114,7 +115,7 @@ protected:
     bool Unlock(const CKeyingMaterial& vMasterKeyIn, bool fForMixingOnly = false);
 
 public:
-    CCryptoKeyStore() : fUseCrypto(false), fDecryptionThoroughlyChecked(false), fOnlyMixingAllowed(false)
+    CCryptoKeyStore() : fUseCrypto(false), fOnlyMixingAllowed(false), unlockedKeys_()
     {
     }
 
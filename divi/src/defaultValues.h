@@ -22,6 +22,24 @@ constexpr int64_t MIN_DB_CACHE_SIZE = 4;
 constexpr CAmount DEFAULT_TRANSACTION_MAXFEE = 100 * COIN;
 
 constexpr bool DEFAULT_USE_HD_WALLET = true;
+/** Default for -wallettxlog, keeping wallet transactions in an append-only log next to the wallet file */
+constexpr bool DEFAULT_WALLET_TX_LOG = false;
+/** -walletloadthreads default (number of threads decoding wallet records on load, 0 = auto) */
+constexpr int DEFAULT_WALLET_LOAD_THREADS = 1;
+/** Maximum number of threads decoding wallet records on load */
+constexpr int MAX_WALLET_LOAD_THREADS = 16;
+/** Number of wallet records a load thread takes at a time */
+constexpr unsigned int WALLET_LOAD_BATCH_SIZE = 128;
+/** Default for -deferkeyverification, checking loaded key pairs in the background once the node is up */
+constexpr bool DEFAULT_DEFER_KEY_VERIFICATION = false;
+/** -keypoolthreads default (number of threads deriving HD keys when the key pool is topped up, 0 = auto) */
+constexpr int DEFAULT_KEYPOOL_THREADS = 0;
+/** Maximum number of threads deriving HD keys for the key pool */
+constexpr int MAX_KEYPOOL_THREADS = 16;
+/** Number of HD keys a key pool derivation thread takes at a time */
+constexpr unsigned int KEYPOOL_DERIVATION_BATCH_SIZE = 64;
+/** Number of key pool keys written in one database transaction, and made available together, during a top-up */
+constexpr unsigned int KEYPOOL_TOPUP_BATCH_SIZE = 1000;
 
 constexpr unsigned int DEFAULT_TX_RELAY_FEE_PER_KILOBYTE = 10000;
 
@@ -50,6 +68,16 @@ constexpr unsigned int MAX_TX_SIGOPS_CURRENT = MAX_BLOCK_SIGOPS_CURRENT / 5;
 constexpr unsigned int MAX_TX_SIGOPS_LEGACY = MAX_BLOCK_SIGOPS_LEGACY / 5;
 /** Default for -maxorphantx, maximum number of orphan transactions kept in memory */
 constexpr unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 100;
+/** Default for -maxmempool, maximum memory usage of the transaction memory pool in megabytes */
+constexpr int64_t DEFAULT_MAX_MEMPOOL_SIZE = 300;
+/** Default for -persistmempool, saving the memory pool on shutdown and reloading it on startup */
+constexpr bool DEFAULT_PERSIST_MEMPOOL = true;
+/** Default for -msghandlerthreads, the number of threads peers are spread across for message processing */
+constexpr unsigned int DEFAULT_MESSAGE_HANDLER_THREADS = 1;
+/** Maximum for -msghandlerthreads */
+constexpr unsigned int MAX_MESSAGE_HANDLER_THREADS = 16;
+/** Default for -blockservecache, megabytes of serialized blocks kept in memory for serving to peers */
+constexpr int64_t DEFAULT_BLOCK_SERVE_CACHE_SIZE = 32;
 /** The maximum size of a blk?????.dat file (since 0.8) */
 constexpr unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
 /** The pre-allocation chunk size for blk?????.dat files (since 0.8) */
@@ -64,6 +92,13 @@ constexpr unsigned int LOCKTIME_THRESHOLD = 500000000; // Tue Nov  5 00:53:20 19
 constexpr int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 constexpr int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** -sigcachemaxmb default and upper bound (signature cache size in MiB) */
+constexpr int64_t DEFAULT_SIG_CACHE_MAX_MB = 32;
+constexpr int64_t MAX_SIG_CACHE_MAX_MB = 1024;
+/** Maximum number of threads searching for a proof-of-stake kernel */
+constexpr int MAX_STAKING_THREADS = 16;
+/** -stakingthreads default (number of kernel search threads, 0 = auto) */
+constexpr int DEFAULT_STAKING_THREADS = 1;
 /** Number of blocks that can be requested at any given time from a single peer. */
 constexpr int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -76,6 +111,16 @@ constexpr unsigned int MAX_HEADERS_RESULTS = 2000;
  *  degree of disordering of blocks on disk (which make reindexing and in the future perhaps pruning
  *  harder). We'll probably want to make this a per-peer adaptive value at some point. */
 constexpr unsigned int BLOCK_DOWNLOAD_WINDOW = 1024;
+/** Number of unvalidated headers headers-first sync accepts ahead of the active tip. */
+constexpr unsigned int MAX_HEADERS_AHEAD_OF_TIP = 4 * BLOCK_DOWNLOAD_WINDOW;
+/** Number of blocks read ahead from block files during -reindex and -loadblock, whose headers are hashed in parallel. */
+constexpr unsigned int EXTERNAL_BLOCK_BATCH_SIZE = 64;
+/** Maximum size of the blocks kept during headers-first sync because they arrived before their parent. */
+constexpr unsigned int MAX_BUFFERED_DOWNLOAD_BYTES = 64 * 1000 * 1000;
+/** Number of times a block of the downloaded header chain may stall or be reported missing before the chain is abandoned. */
+constexpr unsigned int MAX_BLOCK_DOWNLOAD_STALLS = 3;
+/** Time in seconds during which headers-first sync stays off after a header chain had to be abandoned. */
+constexpr int64_t HEADERS_FIRST_RETRY_INTERVAL = 10 * 60;
 /** Time to wait (in seconds) between writing blockchain state to disk. */
 constexpr unsigned int DATABASE_WRITE_INTERVAL = 3600;
 /** Maximum length of reject messages. */
@@ -29,6 +29,7 @@
 #include "miner.h"
 #include "net.h"
 #include "rpcserver.h"
+#include "script/sigcache.h"
 #include "script/standard.h"
 #include "spork.h"
 #include "sporkdb.h"
@@ -46,6 +47,7 @@
 #include <ActiveChainManager.h>
 #include <BlockDiskAccessor.h>
 #include <TransactionInputChecker.h>
+#include <BlockHeaderHashing.h>
 #include <txmempool.h>
 #include <WalletRescanner.h>
 #include <StartAndShutdownSignals.h>
@@ -55,6 +57,7 @@
 #include "wallet.h"
 #include "walletdb.h"
 #include <WalletTx.h>
+#include <DeferredKeyVerifier.h>
 #endif
 
 #include <fstream>
@@ -314,6 +317,8 @@ void PrepareShutdown()
     SaveMasternodeDataToDisk();
     UnregisterNodeSignals(GetNodeSignals());
     SaveFeeEstimatesFromMempool();
+    if (settings.GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL))
+        DumpMempool();
     FlushStateAndDeallocateShallowDatabases();
 
 #ifdef ENABLE_WALLET
@@ -510,6 +515,11 @@ void ThreadImport(std::vector<boost::filesystem::path> vImportFiles)
     }
 }
 
+void ThreadLoadMempool()
+{
+    RenameThread("divi-loadmempool");
+    LoadMempool();
+}
 
 /** Sanity checks
  *  Ensure that DIVI is running in a usable environment with all
@@ -664,6 +674,8 @@ void StartScriptVerificationThreads(boost::thread_group& threadGroup)
     if (nScriptCheckThreads) {
         for (int i = 0; i < nScriptCheckThreads - 1; i++)
             threadGroup.create_thread(&TransactionInputChecker::ThreadScriptCheck);
+        for (int i = 0; i < nScriptCheckThreads - 1; i++)
+            threadGroup.create_thread(&ThreadBlockHeaderHashing);
     }
 }
 
@@ -834,6 +846,12 @@ BlockLoadingStatus TryToLoadBlocks(std::string& strLoadError)
         if (fReindex)
             pblocktree->WriteReindexing(true);
 
+        uiInterface.InitMessage(translate("Upgrading coin database..."));
+        if (!pcoinsdbview->Upgrade()) {
+            strLoadError = translate("Error upgrading coin database");
+            return BlockLoadingStatus::RETRY_LOADING;
+        }
+
         // DIVI: load previous sessions sporks if we have them.
         uiInterface.InitMessage(translate("Loading sporks..."));
         GetSporkManager().LoadSporksFromDB();
@@ -1262,6 +1280,7 @@ bool InitializeDivi(boost::thread_group& threadGroup)
     CreatePidFile(GetPidFile(settings), getpid());
 #endif
     PrintInitialLogHeader(fDisableWallet,numberOfFileDescriptors,strDataDir);
+    InitSignatureCache();
     StartScriptVerificationThreads(threadGroup);
 
     if(!SetSporkKey())
@@ -1407,6 +1426,9 @@ bool InitializeDivi(boost::thread_group& threadGroup)
             MilliSleep(10);
     }
 
+    if (settings.GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL))
+        threadGroup.create_thread(&ThreadLoadMempool);
+
     // ********************************************************* Step 10: setup ObfuScation
     std::string errorMessage;
     if(!LoadMasternodeDataFromDisk(uiMessenger,GetDataDir().string()) )
@@ -1464,6 +1486,11 @@ bool InitializeDivi(boost::thread_group& threadGroup)
         {
             pwalletMain->PruneWallet();
         }
+        // Check the key pairs loaded with -deferkeyverification now that RPC is up
+        if (pwalletMain->GetDeferredKeyVerifier().state() == DeferredKeyVerifier::PENDING)
+        {
+            threadGroup.create_thread(boost::bind(&CWallet::VerifyDeferredKeys, pwalletMain));
+        }
         // Run a thread to flush wallet periodically
         if (settings.GetBoolArg("-flushwallet", true))
         {
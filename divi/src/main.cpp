@@ -49,6 +49,7 @@
 #include <SuperblockSubsidyContainer.h>
 #include <BlockIncentivesPopulator.h>
 #include <BlockIndexLotteryUpdater.h>
+#include <atomic>
 #include <sstream>
 #include "Settings.h"
 #include <boost/algorithm/string/replace.hpp>
@@ -64,15 +65,20 @@
 #include <TransactionOpCounting.h>
 #include <OrphanTransactions.h>
 #include <MasternodeModule.h>
+#include <MasternodeHelpers.h>
 #include <IndexDatabaseUpdates.h>
 #include <BlockTransactionChecker.h>
 #include <NodeState.h>
 #include <PeerBanningService.h>
 #include <utilstrencodings.h>
 #include <NodeStateRegistry.h>
+#include <BlockDownloadWindow.h>
+#include <BlockHeaderHashing.h>
 #include <Node.h>
 #include <TransactionSearchIndexes.h>
 #include <ProofOfStakeModule.h>
+#include <MessageLatencyHistograms.h>
+#include <SerializedBlockCache.h>
 
 using namespace boost;
 using namespace std;
@@ -550,6 +556,27 @@ bool CheckFeesPaidAreAcceptable(
     return true;
 }
 
+static size_t GetMaxMempoolBytes()
+{
+    return static_cast<size_t>(std::max<int64_t>(0, settings.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE))) * 1000000;
+}
+
+static SerializedBlockCache& ServedBlockCache()
+{
+    // Sized on first use, which comes after the configuration has been read
+    static SerializedBlockCache servedBlockCache(
+        static_cast<size_t>(std::max<int64_t>(0, settings.GetArg("-blockservecache", DEFAULT_BLOCK_SERVE_CACHE_SIZE))) * 1000000);
+    return servedBlockCache;
+}
+const SerializedBlockCache& GetSerializedBlockCache()
+{
+    return ServedBlockCache();
+}
+static SharedNetworkMessage SerializeBlockMessage(const CBlock& block)
+{
+    return NetworkMessageSerializer::SerializeMessage(PROTOCOL_VERSION, "block", block);
+}
+
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransaction& tx, bool fLimitFree, bool* pfMissingInputs, bool ignoreFees)
 {
     AssertLockHeld(cs_main);
@@ -675,6 +702,14 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
             return false;
         }
 
+        // Once the pool has had to evict, newcomers must outbid the evicted packages
+        const CAmount mempoolRejectFee = pool.GetMinFee(GetMaxMempoolBytes()).GetFee(entry.GetTxSize());
+        if (!ignoreFees && mempoolRejectFee > 0 && nFees < mempoolRejectFee)
+        {
+            return state.DoS(0, error("%s : mempool min fee not met %s, %d < %d",__func__, hash, nFees, mempoolRejectFee),
+                             REJECT_INSUFFICIENTFEE, "mempool min fee not met");
+        }
+
         // Check against previous transactions
         // This is done last to help prevent CPU exhaustion denial-of-service attacks.
         if (!CheckInputs(tx, state, view, mapBlockIndex, true, STANDARD_SCRIPT_VERIFY_FLAGS, true)) {
@@ -696,6 +731,11 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
 
         // Store transaction in memory
         pool.addUnchecked(hash, entry, view);
+
+        // Make room if needed, possibly evicting the transaction we just added
+        pool.TrimToSize(GetMaxMempoolBytes());
+        if (!pool.exists(hash))
+            return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "mempool full");
     }
 
     g_signals.SyncTransaction(tx, NULL,TransactionSyncType::MEMPOOL_TX_ADD);
@@ -708,6 +748,21 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState& state, const CTransa
 // CBlock and CBlockIndex
 //
 
+int GetBestHeaderHeight()
+{
+    AssertLockHeld(cs_main);
+    // Headers-first sync keeps its headers out of the block index, see BlockDownloadWindow
+    const int windowHeight = GetBlockDownloadWindow().isActive()? GetBlockDownloadWindow().lastHeaderHeight() : -1;
+    return std::max(pindexBestHeader ? pindexBestHeader->nHeight : -1, windowHeight);
+}
+
+static int64_t GetBestHeaderTime()
+{
+    AssertLockHeld(cs_main);
+    const int64_t windowTime = GetBlockDownloadWindow().lastHeaderTime();
+    return std::max(pindexBestHeader ? pindexBestHeader->GetBlockTime() : 0, windowTime);
+}
+
 bool IsInitialBlockDownload()	//2446
 {
     LOCK(cs_main);
@@ -716,6 +771,7 @@ bool IsInitialBlockDownload()	//2446
     static bool lockIBDState = false;
     if (lockIBDState)
         return false;
+    // Only the block index counts here: the headers of the download window are only validated along with their blocks
     bool state = (chainActive.Height() < pindexBestHeader->nHeight - 24 * 6 ||
                   pindexBestHeader->GetBlockTime() < GetTime() - 6 * 60 * 60); // ~144 blocks behind -> 2 x fork detection time
     if (!state)
@@ -1075,6 +1131,102 @@ bool ConnectBlock(
     return true;
 }
 
+static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+static std::atomic<bool> fMempoolLoaded(false);
+
+/** Held while mempool.dat.new is written, as periodic flushes write it without cs_main. */
+static CCriticalSection cs_mempoolDump;
+
+static bool WriteMempoolSnapshot(const std::vector<CMempoolSnapshotEntry>& snapshot, int64_t nStart)
+{
+    LOCK(cs_mempoolDump);
+    const boost::filesystem::path pathMempool = GetDataDir() / "mempool.dat";
+    const boost::filesystem::path pathMempoolNew = GetDataDir() / "mempool.dat.new";
+    CAutoFile fileout(fopen(pathMempoolNew.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull())
+        return error("%s : Failed to open file %s", __func__, pathMempoolNew.string());
+
+    try {
+        fileout << MEMPOOL_DUMP_VERSION;
+        fileout << snapshot;
+    } catch (const std::exception& e) {
+        return error("%s : Serialize or I/O error - %s", __func__, e.what());
+    }
+    FileCommit(fileout.Get());
+    fileout.fclose();
+    if (!RenameOver(pathMempoolNew, pathMempool))
+        return error("%s : Failed to rename %s", __func__, pathMempoolNew.string());
+
+    LogPrint("mempool", "Dumped %u mempool transactions in %dms\n", snapshot.size(), GetTimeMillis() - nStart);
+    return true;
+}
+
+bool DumpMempool()
+{
+    if (!fMempoolLoaded)
+        return false;
+
+    const int64_t nStart = GetTimeMillis();
+    return WriteMempoolSnapshot(mempool.GetSnapshot(), nStart);
+}
+
+bool LoadMempool()
+{
+    const boost::filesystem::path pathMempool = GetDataDir() / "mempool.dat";
+    CAutoFile filein(fopen(pathMempool.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull()) {
+        // Missing on first startup, or after running with -persistmempool=0
+        fMempoolLoaded = true;
+        return true;
+    }
+
+    const int64_t nStart = GetTimeMillis();
+    unsigned nAccepted = 0;
+    unsigned nFailed = 0;
+    try {
+        uint64_t version;
+        filein >> version;
+        if (version != MEMPOOL_DUMP_VERSION)
+            return error("%s : Unknown mempool.dat version %d", __func__, version);
+
+        std::vector<CMempoolSnapshotEntry> snapshot;
+        filein >> snapshot;
+        for (const CMempoolSnapshotEntry& snapshotEntry : snapshot) {
+            boost::this_thread::interruption_point();
+            if (ShutdownRequested())
+                return false;
+
+            // The delta has to be in place for the fee checks on acceptance
+            const uint256 hash = snapshotEntry.tx.GetHash();
+            const bool fWasPrioritised = mempool.IsPrioritizedTransaction(hash);
+            if (snapshotEntry.nFeeDelta != 0)
+                mempool.PrioritiseTransaction(hash, snapshotEntry.nFeeDelta);
+
+            // Take cs_main per transaction so relayed transactions are not held up by the reload
+            CValidationState state;
+            LOCK(cs_main);
+            if (AcceptToMemoryPool(mempool, state, snapshotEntry.tx, false, nullptr)) {
+                ++nAccepted;
+            } else {
+                ++nFailed;
+                // Do not leave a delta behind for a transaction that is not in the pool
+                if (snapshotEntry.nFeeDelta != 0) {
+                    if (fWasPrioritised)
+                        mempool.PrioritiseTransaction(hash, -snapshotEntry.nFeeDelta);
+                    else
+                        mempool.ClearPrioritisation(hash);
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+
+    LogPrintf("Imported mempool transactions from disk: %u succeeded, %u failed, %dms\n", nAccepted, nFailed, GetTimeMillis() - nStart);
+    fMempoolLoaded = true;
+    return true;
+}
+
 /**
  * Update the on-disk chain state.
  * The caches and indexes are flushed if either they're too large, forceWrite is set, or
@@ -1082,9 +1234,12 @@ bool ConnectBlock(
  */
 bool static FlushStateToDisk(CBlockTreeDB& blockTreeDB, CValidationState& state, FlushStateMode mode)
 {
-    LOCK(cs_main);
     static int64_t nLastWrite = 0;
+    bool fDumpMempool = false;
+    int64_t nMempoolSnapshotStart = 0;
+    std::vector<CMempoolSnapshotEntry> mempoolSnapshot;
     try {
+        LOCK(cs_main);
         if ((mode == FLUSH_STATE_ALWAYS) ||
                 ((mode == FLUSH_STATE_PERIODIC || mode == FLUSH_STATE_IF_NEEDED) && pcoinsTip->GetCacheSize() > nCoinCacheSize) ||
                 (mode == FLUSH_STATE_PERIODIC && GetTimeMicros() > nLastWrite + DATABASE_WRITE_INTERVAL * 1000000)) {
@@ -1099,25 +1254,23 @@ bool static FlushStateToDisk(CBlockTreeDB& blockTreeDB, CValidationState& state,
             }
             // First make sure all block and undo data is flushed to disk.
             FlushBlockFile();
-            // Then update all block file information (which may refer to block and undo files).
-            bool fileschanged = false;
-            for (std::set<int>::iterator it = setDirtyFileInfo.begin(); it != setDirtyFileInfo.end();) {
-                if (!blockTreeDB.WriteBlockFileInfo(*it, vinfoBlockFile[*it])) {
-                    return state.Abort("Failed to write to block index");
-                }
-                fileschanged = true;
-                setDirtyFileInfo.erase(it++);
+            // Then update all block file information (which may refer to block and undo files)
+            // and the dirty block index entries, in a single synced batch.
+            std::vector<std::pair<int, const CBlockFileInfo*> > vFiles;
+            vFiles.reserve(setDirtyFileInfo.size());
+            for (int nFile : setDirtyFileInfo) {
+                vFiles.push_back(std::make_pair(nFile, &vinfoBlockFile[nFile]));
             }
-            if (fileschanged && !blockTreeDB.WriteLastBlockFile(nLastBlockFile)) {
-                return state.Abort("Failed to write to block index");
+            std::vector<const CBlockIndex*> vBlocks;
+            vBlocks.reserve(setDirtyBlockIndex.size());
+            for (const CBlockIndex* pindex : setDirtyBlockIndex) {
+                vBlocks.push_back(pindex);
             }
-            for (std::set<CBlockIndex*>::iterator it = setDirtyBlockIndex.begin(); it != setDirtyBlockIndex.end();) {
-                if (!blockTreeDB.WriteBlockIndex(CDiskBlockIndex(*it))) {
-                    return state.Abort("Failed to write to block index");
-                }
-                setDirtyBlockIndex.erase(it++);
+            if (!blockTreeDB.WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
+                return state.Abort("Failed to write to block index");
             }
-            blockTreeDB.Sync();
+            setDirtyFileInfo.clear();
+            setDirtyBlockIndex.clear();
             // Finally flush the chainstate (which may refer to block index entries).
             if (!pcoinsTip->Flush())
                 return state.Abort("Failed to write to coin database");
@@ -1125,11 +1278,20 @@ bool static FlushStateToDisk(CBlockTreeDB& blockTreeDB, CValidationState& state,
             if (mode != FLUSH_STATE_IF_NEEDED) {
                 g_signals.SetBestChain(chainActive.GetLocator());
             }
+            // Keep mempool.dat recent enough to survive an unclean shutdown; only the
+            // snapshot is taken here, the file is written once cs_main is released
+            if (mode == FLUSH_STATE_PERIODIC && fMempoolLoaded && settings.GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
+                nMempoolSnapshotStart = GetTimeMillis();
+                mempoolSnapshot = mempool.GetSnapshot();
+                fDumpMempool = true;
+            }
             nLastWrite = GetTimeMicros();
         }
     } catch (const std::runtime_error& e) {
         return state.Abort(std::string("System error while flushing: ") + e.what());
     }
+    if (fDumpMempool)
+        WriteMempoolSnapshot(mempoolSnapshot, nMempoolSnapshotStart);
     return true;
 }
 
@@ -1209,6 +1371,7 @@ bool static DisconnectTip(CValidationState& state)
     mempool.check(pcoinsTip, mapBlockIndex);
     // Update chainActive and related variables.
     UpdateTip(pindexDelete->pprev);
+    UpdateCollateralHeightsForDisconnectedBlock(disconnectedBlock.first);
     // Let wallets know transactions went from 1-confirmed to
     // 0-confirmed or conflicted:
     for(const CTransaction& tx: blockTransactions) {
@@ -1284,6 +1447,10 @@ bool static ConnectTip(CValidationState& state, CBlockIndex* pindexNew, CBlock*
     mempool.check(pcoinsTip, mapBlockIndex);
     // Update chainActive & related variables.
     UpdateTip(pindexNew);
+    UpdateCollateralHeightsForConnectedBlock(*pblock, pindexNew);
+    // Peers will ask for a new tip as soon as it is announced
+    if (ServedBlockCache().isEnabled() && !IsInitialBlockDownload())
+        ServedBlockCache().insert(pindexNew->GetBlockHash(), SerializeBlockMessage(*pblock));
     // Tell wallet about transactions that went from mempool
     // to conflicted:
     for(const CTransaction& tx: txConflicted) {
@@ -1595,8 +1762,7 @@ CBlockIndex* AddToBlockIndex(const CBlock& block)
         return it->second;
 
     // Construct new block index object
-    CBlockIndex* pindexNew = new CBlockIndex(block);
-    assert(pindexNew);
+    CBlockIndex* pindexNew = mapBlockIndex.AllocateBlockIndex(block);
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
@@ -1613,9 +1779,6 @@ CBlockIndex* AddToBlockIndex(const CBlock& block)
         //update previous block pointer
         pindexNew->pprev->pnext = pindexNew;
 
-        // ppcoin: compute chain trust score
-        pindexNew->bnChainTrust = (pindexNew->pprev ? pindexNew->pprev->bnChainTrust : 0) + pindexNew->GetBlockTrust();
-
         // ppcoin: compute stake entropy bit for stake modifier
         if (!pindexNew->SetStakeEntropyBit(pindexNew->GetStakeEntropyBit()))
             LogPrintf("AddToBlockIndex() : SetStakeEntropyBit() failed \n");
@@ -1624,7 +1787,7 @@ CBlockIndex* AddToBlockIndex(const CBlock& block)
         if (pindexNew->IsProofOfStake()) {
             if (!mapProofOfStake.count(hash))
                 LogPrintf("AddToBlockIndex() : hashProofOfStake not found in map \n");
-            pindexNew->hashProofOfStake = mapProofOfStake[hash];
+            pindexNew->MutableStakeData().hashProofOfStake = mapProofOfStake[hash];
         }
 
         // ppcoin: compute stake modifier
@@ -2119,8 +2282,12 @@ bool ProcessNewBlockFoundByMe(CBlock* pblock, bool& shouldKeepKey)
 
 bool static LoadBlockIndexDB(string& strError)
 {
+    const int64_t nStart = GetTimeMillis();
     if (!pblocktree->LoadBlockIndexGuts(mapBlockIndex))
         return false;
+    LogPrintf("%s: loaded %u block index entries (%u kB in arena, %u bytes each) in %dms\n", __func__,
+        (unsigned)mapBlockIndex.size(), (unsigned)(mapBlockIndex.arena().allocatedBytes() >> 10),
+        (unsigned)sizeof(CBlockIndex), GetTimeMillis() - nStart);
 
     boost::this_thread::interruption_point();
 
@@ -2303,11 +2470,7 @@ bool static LoadBlockIndexDB(string& strError)
 
 void UnloadBlockIndex()
 {
-    for(auto& blockHashAndBlockIndex: mapBlockIndex)
-    {
-        delete blockHashAndBlockIndex.second;
-    }
-    mapBlockIndex.clear();
+    mapBlockIndex.DestroyBlockIndices();
     setBlockIndexCandidates.clear();
     chainActive.SetTip(NULL);
     pindexBestInvalid = NULL;
@@ -2369,6 +2532,49 @@ bool InitBlockIndex()
 }
 
 
+/** Reads the next block from an external block file, skipping garbage between blocks.
+ *  Returns false at the end of the file.  */
+static bool ReadNextExternalBlock(CBufferedFile& blkdat, uint64_t& nRewind, CBlock& block, uint64_t& nBlockPos)
+{
+    while (!blkdat.eof()) {
+        boost::this_thread::interruption_point();
+
+        blkdat.SetPos(nRewind);
+        nRewind++;         // start one byte further next time, in case of failure
+        blkdat.SetLimit(); // remove former limit
+        unsigned int nSize = 0;
+        try {
+            // locate a header
+            unsigned char buf[MESSAGE_START_SIZE];
+            blkdat.FindByte(Params().MessageStart()[0]);
+            nRewind = blkdat.GetPos() + 1;
+            blkdat >> FLATDATA(buf);
+            if (memcmp(buf, Params().MessageStart(), MESSAGE_START_SIZE))
+                continue;
+            // read size
+            blkdat >> nSize;
+            if (nSize < 80 || nSize > MAX_BLOCK_SIZE_CURRENT)
+                continue;
+        } catch (const std::exception&) {
+            // no valid block header found; don't complain
+            return false;
+        }
+        try {
+            // read block
+            nBlockPos = blkdat.GetPos();
+            blkdat.SetLimit(nBlockPos + nSize);
+            blkdat.SetPos(nBlockPos);
+            block.SetNull();
+            blkdat >> block;
+            nRewind = blkdat.GetPos();
+            return true;
+        } catch (std::exception& e) {
+            LogPrintf("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
+    }
+    return false;
+}
+
 bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos* dbp)
 {
     // Map of disk positions for blocks with unknown parent (only used for reindex)
@@ -2380,84 +2586,79 @@ bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos* dbp)
         // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
         CBufferedFile blkdat(fileIn, 2 * MAX_BLOCK_SIZE_CURRENT, MAX_BLOCK_SIZE_CURRENT + 8, SER_DISK, CLIENT_VERSION);
         uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
-            boost::this_thread::interruption_point();
-
-            blkdat.SetPos(nRewind);
-            nRewind++;         // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[MESSAGE_START_SIZE];
-                blkdat.FindByte(Params().MessageStart()[0]);
-                nRewind = blkdat.GetPos() + 1;
-                blkdat >> FLATDATA(buf);
-                if (memcmp(buf, Params().MessageStart(), MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SIZE_CURRENT)
-                    continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
+        // Blocks are read ahead in batches so that their headers can be hashed in parallel
+        std::vector<CBlock> blocks(EXTERNAL_BLOCK_BATCH_SIZE);
+        std::vector<uint64_t> blockPositions(EXTERNAL_BLOCK_BATCH_SIZE);
+        std::vector<CBlock*> blocksToHash;
+        bool fEndOfFile = false;
+        bool fError = false;
+        while (!fEndOfFile && !fError) {
+            size_t nBlocks = 0;
+            blocksToHash.clear();
+            while (nBlocks < blocks.size()) {
+                if (!ReadNextExternalBlock(blkdat, nRewind, blocks[nBlocks], blockPositions[nBlocks])) {
+                    fEndOfFile = true;
+                    break;
+                }
+                blocksToHash.push_back(&blocks[nBlocks]);
+                ++nBlocks;
             }
-            try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
+            MemoizeBlockHashesInParallel(blocksToHash);
+
+            for (size_t nBlock = 0; nBlock < nBlocks && !fError; ++nBlock) {
+                boost::this_thread::interruption_point();
+
+                CBlock& block = blocks[nBlock];
                 if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                CBlock block;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
-
-                // detect out of order blocks, and store them for later
-                uint256 hash = block.GetHash();
-                if (hash != Params().HashGenesisBlock() && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
-                    LogPrint("reindex", "%s: Out of order block %s, parent %s not known\n", __func__, hash,
-                             block.hashPrevBlock);
-                    if (dbp)
-                        mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
-                    continue;
-                }
+                    dbp->nPos = blockPositions[nBlock];
+                try {
+                    // detect out of order blocks, and store them for later
+                    uint256 hash = block.GetHash();
+                    if (hash != Params().HashGenesisBlock() && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
+                        LogPrint("reindex", "%s: Out of order block %s, parent %s not known\n", __func__, hash,
+                                 block.hashPrevBlock);
+                        if (dbp)
+                            mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
+                        continue;
+                    }
 
-                // process in case the block isn't known yet
-                if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
-                    CValidationState state;
-                    if (ProcessNewBlock(state, NULL, &block, dbp))
-                        nLoaded++;
-                    if (state.IsError())
-                        break;
-                } else if (hash != Params().HashGenesisBlock() && mapBlockIndex[hash]->nHeight % 1000 == 0) {
-                    LogPrintf("Block Import: already had block %s at height %d\n", hash, mapBlockIndex[hash]->nHeight);
-                }
+                    // process in case the block isn't known yet
+                    if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
+                        CValidationState state;
+                        if (ProcessNewBlock(state, NULL, &block, dbp))
+                            nLoaded++;
+                        if (state.IsError()) {
+                            fError = true;
+                            break;
+                        }
+                    } else if (hash != Params().HashGenesisBlock() && mapBlockIndex[hash]->nHeight % 1000 == 0) {
+                        LogPrintf("Block Import: already had block %s at height %d\n", hash, mapBlockIndex[hash]->nHeight);
+                    }
 
-                // Recursively process earlier encountered successors of this block
-                deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
-                        if (ReadBlockFromDisk(block, it->second)) {
-                            LogPrintf("%s: Processing out of order child %s of %s\n", __func__, block.GetHash(), head);
-                            CValidationState dummy;
-                            if (ProcessNewBlock(dummy, NULL, &block, &it->second)) {
-                                nLoaded++;
-                                queue.push_back(block.GetHash());
+                    // Recursively process earlier encountered successors of this block
+                    deque<uint256> queue;
+                    queue.push_back(hash);
+                    while (!queue.empty()) {
+                        uint256 head = queue.front();
+                        queue.pop_front();
+                        std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
+                        while (range.first != range.second) {
+                            std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
+                            if (ReadBlockFromDisk(block, it->second)) {
+                                LogPrintf("%s: Processing out of order child %s of %s\n", __func__, block.GetHash(), head);
+                                CValidationState dummy;
+                                if (ProcessNewBlock(dummy, NULL, &block, &it->second)) {
+                                    nLoaded++;
+                                    queue.push_back(block.GetHash());
+                                }
                             }
+                            range.first++;
+                            mapBlocksUnknownParent.erase(it);
                         }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
                     }
+                } catch (std::exception& e) {
+                    LogPrintf("%s : Deserialize or I/O error - %s", __func__, e.what());
                 }
-            } catch (std::exception& e) {
-                LogPrintf("%s : Deserialize or I/O error - %s", __func__, e.what());
             }
         }
     } catch (std::runtime_error& e) {
@@ -2733,6 +2934,83 @@ static bool PushKnownInventory(CNode* pfrom, const CInv& inv)
     return pushed;
 }
 
+/** Headers-first sync: keeps a block whose parent is still being downloaded. */
+static bool BufferBlockAheadOfParent(CNode* pfrom, const CBlock& block)
+{
+    LOCK(cs_main);
+    BlockDownloadWindow& window = GetBlockDownloadWindow();
+    if (!window.bufferBlock(block, pfrom->GetId(), ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION)))
+        return false;
+    MarkBlockAsReceived(block.GetHash());
+    return true;
+}
+
+/** Processes the buffered blocks building on a block that was just accepted. */
+static void ProcessBufferedDescendants(uint256 parentHash)
+{
+    CBlock block;
+    NodeId nodeId;
+    while (true) {
+        {
+            LOCK(cs_main);
+            BlockDownloadWindow& window = GetBlockDownloadWindow();
+            window.markReceived(parentHash);
+            if (!mapBlockIndex.count(parentHash) || !window.takeBufferedChild(parentHash, block, nodeId))
+                return;
+        }
+        CValidationState state;
+        if (!ProcessNewBlock(state, NULL, &block)) {
+            LOCK(cs_main);
+            int nDoS;
+            if (state.IsInvalid(nDoS) && nDoS > 0)
+                Misbehaving(nodeId, nDoS);
+            // The header chain leads to a block we cannot accept; start over from the tip
+            GetBlockDownloadWindow().reset(chainActive.Height(), chainActive.Tip()->GetBlockHash());
+            return;
+        }
+        parentHash = block.GetHash();
+    }
+}
+
+static bool HeadersFirstSyncIsEnabled()
+{
+    static const bool headersFirstSync = settings.GetBoolArg("-headersfirst", Params().HeadersFirstSyncingActive());
+    return headersFirstSync;
+}
+
+/** Checks the parts of a header that can be verified before its block arrives.
+ *  The kernel of a proof-of-stake header is in its coinstake, so those are
+ *  only fully validated once the block has been downloaded.  */
+static bool CheckDownloadedHeader(const CBlockHeader& header, const uint256& hash, int nHeight, CValidationState& state)
+{
+    const bool isProofOfWork = nHeight <= Params().LAST_POW_BLOCK();
+    if (isProofOfWork && !CheckProofOfWork(hash, header.nBits, Params()))
+        return state.DoS(50, error("%s : proof of work failed", __func__), REJECT_INVALID, "high-hash");
+
+    if (header.GetBlockTime() > GetAdjustedTime() + (isProofOfWork ? 7200 : settings.MaxFutureBlockDrift()))
+        return state.Invalid(error("%s : block timestamp too far in the future", __func__), REJECT_INVALID, "time-too-new");
+
+    if (!checkpointsVerifier.CheckBlock(nHeight, hash))
+        return state.DoS(100, error("%s : rejected by checkpoint lock-in at %d", __func__, nHeight),
+                         REJECT_CHECKPOINT, "checkpoint mismatch");
+
+    if (header.nVersion < 3)
+        return state.Invalid(error("%s : rejected nVersion=%d block", __func__, header.nVersion),
+                             REJECT_OBSOLETE, "bad-version");
+    return true;
+}
+
+static void RequestHeadersFromPeer(CNode* pto)
+{
+    AssertLockHeld(cs_main);
+    // Peers that do not know headers-first sync answer getheaders like getblocks
+    const BlockDownloadWindow& window = GetBlockDownloadWindow();
+    CBlockLocator locator = chainActive.GetLocator();
+    if (window.isActive())
+        locator.vHave.insert(locator.vHave.begin(), window.lastHeaderHash());
+    pto->PushMessage("getheaders", locator, uint256(0));
+}
+
 static std::pair<const CBlockIndex*, bool> GetBlockIndexOfRequestedBlock(NodeId nodeId, const uint256& blockHash)
 {
     bool send = false;
@@ -2760,20 +3038,54 @@ static std::pair<const CBlockIndex*, bool> GetBlockIndexOfRequestedBlock(NodeId
     return std::make_pair(pindex,send);
 }
 
-static void PushCorrespondingBlockToPeer(CNode* pfrom, const CBlockIndex* blockToPush,bool isBlock)
+static SharedNetworkMessage GetBlockMessageToServe(const CBlockIndex* blockToPush)
 {
-    // Send block from disk
-    CBlock block;
-    if (!ReadBlockFromDisk(block, blockToPush))
+    SerializedBlockCache& blockCache = ServedBlockCache();
+    SharedNetworkMessage blockMessage = blockCache.get(blockToPush->GetBlockHash());
+    if (!blockMessage) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, blockToPush))
+            assert(!"cannot load block from disk");
+        blockMessage = SerializeBlockMessage(block);
+        blockCache.insert(blockToPush->GetBlockHash(), blockMessage);
+    }
+    return blockMessage;
+}
+
+static void ReadBlockToServe(const CBlockIndex* blockToPush, CBlock& block)
+{
+    const SharedNetworkMessage blockMessage = ServedBlockCache().get(blockToPush->GetBlockHash());
+    if (blockMessage) {
+        CDataStream blockData(
+            blockMessage->data() + CMessageHeader::HEADER_SIZE, blockMessage->data() + blockMessage->size(),
+            SER_NETWORK, PROTOCOL_VERSION);
+        blockData >> block;
+    } else if (!ReadBlockFromDisk(block, blockToPush)) {
         assert(!"cannot load block from disk");
+    }
+}
+
+static void PushCorrespondingBlockToPeer(CNode* pfrom, const CBlockIndex* blockToPush,bool isBlock)
+{
     if (isBlock)
     {
-        pfrom->PushMessage("block", block);
+        // Send block from memory, or from disk if it was not requested recently
+        if (ServedBlockCache().isEnabled()) {
+            pfrom->PushSerializedMessage(GetBlockMessageToServe(blockToPush));
+        } else {
+            CBlock block;
+            if (!ReadBlockFromDisk(block, blockToPush))
+                assert(!"cannot load block from disk");
+            pfrom->PushMessage("block", block);
+        }
     }
     else // MSG_FILTERED_BLOCK)
     {
         LOCK(pfrom->cs_filter);
         if (pfrom->pfilter) {
+            // Merkle blocks depend on the peer's filter, so only the block itself is shared
+            CBlock block;
+            ReadBlockToServe(blockToPush, block);
             CMerkleBlock merkleBlock(block, *pfrom->pfilter);
             pfrom->PushMessage("merkleblock", merkleBlock);
             // CMerkleBlock just contains hashes, so also push any transactions in the block the client did not see
@@ -2824,7 +3136,10 @@ void static ProcessGetData(CNode* pfrom, std::deque<CInv>& requestsForData)
                         // and we want it right after the last block so they don't
                         // wait for other stuff first.
                         std::vector<CInv> vInv;
-                        vInv.push_back(CInv(MSG_BLOCK, chainActive.Tip()->GetBlockHash()));
+                        {
+                            LOCK(cs_main);
+                            vInv.push_back(CInv(MSG_BLOCK, chainActive.Tip()->GetBlockHash()));
+                        }
                         pfrom->PushMessage("inv", vInv);
                         pfrom->hashContinue = 0;
                     }
@@ -3069,43 +3384,39 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
             return error("message inv size() = %u", vInv.size());
         }
 
+        // Bookkeeping of what the peer knows needs no chain state.
+        for(const CInv& inv: vInv)
+            pfrom->AddInventoryKnown(inv);
+
         std::vector<CInv> vToFetch;
-        std::vector<const CInv*> blockInventory;
-        blockInventory.reserve(vInv.size());
-        for (unsigned int nInv = 0; nInv < vInv.size(); nInv++) {
-            const CInv& inv = vInv[nInv];
+        {
+            LOCK(cs_main);
+            for (unsigned int nInv = 0; nInv < vInv.size(); nInv++) {
+                const CInv& inv = vInv[nInv];
 
-            boost::this_thread::interruption_point();
-            pfrom->AddInventoryKnown(inv);
+                boost::this_thread::interruption_point();
 
-            bool fAlreadyHave = AlreadyHave(inv);
-            LogPrint("net", "got inv: %s  %s peer=%d\n", inv, fAlreadyHave ? "have" : "new", pfrom->id);
+                bool fAlreadyHave = AlreadyHave(inv);
+                LogPrint("net", "got inv: %s  %s peer=%d\n", inv, fAlreadyHave ? "have" : "new", pfrom->id);
 
-            if (!fAlreadyHave && !fImporting && !fReindex && inv.GetType() != MSG_BLOCK)
-                pfrom->AskFor(inv);
+                if (!fAlreadyHave && !fImporting && !fReindex && inv.GetType() != MSG_BLOCK)
+                    pfrom->AskFor(inv);
 
 
-            if (inv.GetType() == MSG_BLOCK) {
-                UpdateBlockAvailability(mapBlockIndex,pfrom->GetNodeState(), inv.GetHash());
-                if (!fAlreadyHave && !fImporting && !fReindex) {
-                    // Add this to the list of blocks to request
-                    blockInventory.push_back(&inv);
+                if (inv.GetType() == MSG_BLOCK) {
+                    UpdateBlockAvailability(mapBlockIndex,pfrom->GetNodeState(), inv.GetHash());
+                    // Blocks on the headers-first chain are requested by the download window
+                    if (!fAlreadyHave && !fImporting && !fReindex && !BlockIsInFlight(inv.GetHash()) &&
+                        GetBlockDownloadWindow().heightOf(inv.GetHash()) < 0) {
+                        // Add this to the list of blocks to request
+                        vToFetch.push_back(inv);
+                        LogPrint("net", "getblocks (%d) %s to peer=%d\n", GetBestHeaderHeight(), inv.GetHash(), pfrom->id);
+                    }
                 }
-            }
 
-            if (pfrom->GetSendBufferStatus()==NodeBufferStatus::IS_OVERFLOWED) {
-                Misbehaving(pfrom->GetNodeState(), 50);
-                return error("Peer %d has exceeded send buffer size", pfrom->GetId());
-            }
-        }
-        {
-            LOCK(cs_main);
-            for(const CInv* blockInventoryReference: blockInventory)
-            {
-                if(!BlockIsInFlight(blockInventoryReference->GetHash()))
-                {
-                    vToFetch.push_back(*blockInventoryReference);
-                    LogPrint("net", "getblocks (%d) %s to peer=%d\n", pindexBestHeader->nHeight, blockInventoryReference->GetHash(), pfrom->id);
+                if (pfrom->GetSendBufferStatus()==NodeBufferStatus::IS_OVERFLOWED) {
+                    Misbehaving(pfrom->GetNodeState(), 50);
+                    return error("Peer %d has exceeded send buffer size", pfrom->GetId());
                 }
             }
         }
@@ -3125,7 +3436,7 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
         pfrom->RecordRequestForData(vInv);
         pfrom->RespondToRequestForData();
     }
-    else if (strCommand == "getblocks" || strCommand == "getheaders")
+    else if (strCommand == "getblocks")
     {
         CBlockLocator locator;
         uint256 hashStop;
@@ -3170,17 +3481,16 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
         if (!vInv.empty())
             pfrom->PushMessage("inv", vInv);
     }
-    else if (strCommand == "headers" && Params().HeadersFirstSyncingActive())
+    else if (strCommand == "getheaders")
     {
         CBlockLocator locator;
         uint256 hashStop;
         vRecv >> locator >> hashStop;
 
+        // Headers of whatever part of the chain we have are served even during
+        // initial download; a short answer only tells the peer where we are.
         LOCK(cs_main);
 
-        if (IsInitialBlockDownload())
-            return true;
-
         CBlockIndex* pindex = NULL;
         if (locator.IsNull()) {
             // If locator is null, return the hashStop block
@@ -3314,7 +3624,7 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
                 Misbehaving(pfrom->GetNodeState(), nDoS);
         }
     }
-    else if (strCommand == "headers" && Params().HeadersFirstSyncingActive() && !fImporting && !fReindex) // Ignore headers received while importing
+    else if (strCommand == "headers" && !fImporting && !fReindex) // Ignore headers received while importing
     {
         std::vector<CBlockHeader> headers;
 
@@ -3329,59 +3639,71 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
             vRecv >> headers[n];
             ReadCompactSize(vRecv); // ignore tx count; assume it is 0.
         }
+        if (!HeadersFirstSyncIsEnabled())
+            return true;
+
+        // Hash the whole batch across the verification threads
+        const std::vector<uint256> hashes = HashBlockHeadersInParallel(headers);
 
         LOCK(cs_main);
 
-        if (nCount == 0) {
+        BlockDownloadWindow& window = GetBlockDownloadWindow();
+        if (nCount == 0 || window.isSuspended(GetTimeMicros())) {
             // Nothing interesting. Stop asking this peers for more headers.
             return true;
         }
-        CBlockIndex* pindexLast = NULL;
-        for(const CBlockHeader& header: headers) {
-            CValidationState state;
-            if (pindexLast != NULL && header.hashPrevBlock != pindexLast->GetBlockHash()) {
-                Misbehaving(pfrom->GetNodeState(), 20);
-                return error("non-continuous headers sequence");
+        window.updateTip(chainActive.Height(), chainActive.Tip()->GetBlockHash());
+        unsigned int nAppended = 0;
+        bool fDeferred = false;
+        for(unsigned int n = 0; n < nCount; n++) {
+            const CBlockHeader& header = headers[n];
+            const uint256& hash = hashes[n];
+            // Skip what we already have, e.g. when a peer answers from an older locator
+            const BlockMap::iterator mi = mapBlockIndex.find(hash);
+            if ((mi != mapBlockIndex.end() && chainActive.Contains(mi->second)) || window.heightOf(hash) >= 0)
+                continue;
+            if (header.hashPrevBlock != window.lastHeaderHash()) {
+                LogPrint("net", "headers from peer=%d do not build on our header chain at %s\n", pfrom->id, hash);
+                break;
             }
 
-            /*TODO: this has a CBlock cast on it so that it will compile. There should be a solution for this
-             * before headers are reimplemented on mainnet
-             */
-            if (!AcceptBlockHeader((CBlock)header, state, &pindexLast)) {
+            CValidationState state;
+            if (!CheckDownloadedHeader(header, hash, window.lastHeaderHeight() + 1, state)) {
                 int nDoS;
-                if (state.IsInvalid(nDoS)) {
-                    if (nDoS > 0)
-                        Misbehaving(pfrom->GetNodeState(), nDoS);
-                    std::string strError = "invalid header received " + header.GetHash().ToString();
-                    return error(strError.c_str());
-                }
+                if (state.IsInvalid(nDoS) && nDoS > 0)
+                    Misbehaving(pfrom->GetNodeState(), nDoS);
+                return error("invalid header received %s", hash);
             }
+            if (!window.appendHeader(hash, header.hashPrevBlock, header.GetBlockTime(), pfrom->GetId())) {
+                LogPrint("net", "header chain is %u headers ahead of the tip, asking peer=%d for more later\n", MAX_HEADERS_AHEAD_OF_TIP, pfrom->id);
+                fDeferred = true;
+                break;
+            }
+            ++nAppended;
         }
+        LogPrint("net", "received %u new headers up to height %d from peer=%d\n", nAppended, window.lastHeaderHeight(), pfrom->id);
+        UpdateBlockAvailability(mapBlockIndex, pfrom->GetNodeState(), hashes.back());
 
-        if (pindexLast)
-            UpdateBlockAvailability(mapBlockIndex,pfrom->GetNodeState(), pindexLast->GetBlockHash());
-
-        if (nCount == MAX_HEADERS_RESULTS && pindexLast) {
+        if (nCount == MAX_HEADERS_RESULTS && nAppended > 0 && !fDeferred) {
             // Headers message had its maximum size; the peer may have more headers.
-            // TODO: optimize: if pindexLast is an ancestor of chainActive.Tip or pindexBestHeader, continue
-            // from there instead.
-            LogPrintf("more getheaders (%d) to end to peer=%d (startheight:%d)\n", pindexLast->nHeight, pfrom->id, pfrom->nStartingHeight);
-            pfrom->PushMessage("getheaders", chainActive.GetLocator(pindexLast), uint256(0));
+            LogPrintf("more getheaders (%d) to end to peer=%d (startheight:%d)\n", window.lastHeaderHeight(), pfrom->id, pfrom->nStartingHeight);
+            RequestHeadersFromPeer(pfrom);
         }
-
-        CheckBlockIndex();
     }
     else if (strCommand == "block" && !fImporting && !fReindex) // Ignore blocks received while importing
     {
         CBlock block;
         vRecv >> block;
+        block.MemoizeHash();
         uint256 hashBlock = block.GetHash();
         CInv inv(MSG_BLOCK, hashBlock);
         LogPrint("net", "received block %s peer=%d\n", inv.GetHash(), pfrom->id);
 
         //sometimes we will be sent their most recent block and its not the one we want, in that case tell where we are
         if (!mapBlockIndex.count(block.hashPrevBlock)) {
-            if (find(pfrom->vBlockRequested.begin(), pfrom->vBlockRequested.end(), hashBlock) != pfrom->vBlockRequested.end()) {
+            if (BufferBlockAheadOfParent(pfrom, block)) {
+                LogPrint("net", "buffered block %s until its parent arrives peer=%d\n", hashBlock, pfrom->id);
+            } else if (find(pfrom->vBlockRequested.begin(), pfrom->vBlockRequested.end(), hashBlock) != pfrom->vBlockRequested.end()) {
                 //we already asked for this block, so lets work backwards and ask for the previous block
                 pfrom->PushMessage("getblocks", chainActive.GetLocator(), block.hashPrevBlock);
                 pfrom->vBlockRequested.push_back(block.hashPrevBlock);
@@ -3395,7 +3717,8 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
 
             CValidationState state;
             if (!mapBlockIndex.count(block.GetHash())) {
-                ProcessNewBlock(state, pfrom, &block);
+                if (ProcessNewBlock(state, pfrom, &block))
+                    ProcessBufferedDescendants(hashBlock);
                 int nDoS;
                 if(state.IsInvalid(nDoS)) {
                     pfrom->PushMessage("reject", strCommand, state.GetRejectCode(),
@@ -3422,7 +3745,10 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
     // getaddr message mitigates the attack.
     else if ((strCommand == "getaddr") && (pfrom->fInbound))
     {
-        pfrom->vAddrToSend.clear();
+        {
+            LOCK(pfrom->cs_addrRelay);
+            pfrom->vAddrToSend.clear();
+        }
         std::vector<CAddress> vAddr = addrman.GetAddr();
         for(const CAddress& addr: vAddr)
                 pfrom->PushAddress(addr);
@@ -3497,6 +3823,24 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
         pfrom->pfilter = new CBloomFilter();
         pfrom->fRelayTxes = true;
     }
+    else if (strCommand == "notfound")
+    {
+        std::vector<CInv> vInv;
+        vRecv >> vInv;
+        if (vInv.size() > MAX_INV_SZ) {
+            Misbehaving(pfrom->GetNodeState(), 20);
+            return error("message notfound size() = %u", vInv.size());
+        }
+
+        LOCK(cs_main);
+        const int64_t nNow = GetTimeMicros();
+        for (const CInv& inv: vInv) {
+            if (inv.GetType() == MSG_BLOCK && GetBlockDownloadWindow().markNotFound(inv.GetHash(), pfrom->GetId(), nNow)) {
+                MarkBlockAsReceived(inv.GetHash());
+                LogPrint("net", "peer=%d does not have block %s of the header chain\n", pfrom->id, inv.GetHash());
+            }
+        }
+    }
     else if (strCommand == "reject")
     {
         if (fDebug) {
@@ -3528,6 +3872,39 @@ bool static ProcessMessage(CNode* pfrom, std::string strCommand, CDataStream& vR
     return true;
 }
 
+/** Messages whose handlers only touch the sending peer, the address manager
+ *  or state with its own locks, and take cs_main themselves around the parts
+ *  that read chain state. Everything else may assume it is the only message
+ *  being processed. */
+static bool MessageNeedsSerializedProcessing(const std::string& strCommand)
+{
+    static const std::set<std::string> selfLockingCommands = {
+        "verack", "ping", "pong", "addr", "getaddr", "inv", "getdata", "notfound",
+        "getblocks", "getheaders", "headers", "filterload", "filteradd", "filterclear", "reject"};
+    return selfLockingCommands.count(strCommand) == 0;
+}
+
+/** When peers are sharded across several message handler threads, messages
+ *  that need chain or other shared state are serialized on cs_main, as if a
+ *  single thread handled all peers. The rest bypasses cs_main, and so do
+ *  masternode pings that fail the lock-free prechecks. */
+static bool ProcessMessageOnShard(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, int64_t nTimeReceived)
+{
+    if (!MessageProcessingIsSharded() || !MessageNeedsSerializedProcessing(strCommand))
+        return ProcessMessage(pfrom, strCommand, vRecv, nTimeReceived);
+    if (pfrom->nVersion != 0 && !PrecheckMasternodeMessage(pfrom, strCommand, vRecv))
+        return true;
+
+    LOCK(cs_main);
+    return ProcessMessage(pfrom, strCommand, vRecv, nTimeReceived);
+}
+
+static MessageLatencyHistograms messageLatencyHistograms;
+const MessageLatencyHistograms& GetMessageLatencyHistograms()
+{
+    return messageLatencyHistograms;
+}
+
 enum NetworkMessageState
 {
     SKIP_MESSAGE,
@@ -3611,8 +3988,10 @@ bool ProcessReceivedMessages(CNode* pfrom)
 
         // Process message
         bool fRet = false;
+        const int64_t nProcessingStart = GetTimeMicros();
         try {
-            fRet = ProcessMessage(pfrom, strCommand, msg.vRecv, msg.nTime);
+            fRet = ProcessMessageOnShard(pfrom, strCommand, msg.vRecv, msg.nTime);
+            messageLatencyHistograms.record(strCommand, nProcessingStart - msg.nTime, GetTimeMicros() - nProcessingStart);
             boost::this_thread::interruption_point();
         } catch (std::ios_base::failure& e) {
             pfrom->PushMessage("reject", strCommand, REJECT_MALFORMED, string("error parsing message"));
@@ -3650,6 +4029,7 @@ bool ProcessReceivedMessages(CNode* pfrom)
 
 static void SendAddresses(CNode* pto)
 {
+    LOCK(pto->cs_addrRelay);
     std::vector<CAddress> vAddr;
     vAddr.reserve(pto->vAddrToSend.size());
     for(const CAddress& addr: pto->vAddrToSend) {
@@ -3705,9 +4085,14 @@ static void BeginSyncingWithPeer(CNode* pto)
     CNodeState* state = pto->GetNodeState();
     if (!state->Syncing() && !pto->fClient && !fReindex) {
         // Only actively request headers from a single peer, unless we're close to end of initial download.
-        if ( !CNodeState::NodeSyncStarted() || pindexBestHeader->GetBlockTime() > GetAdjustedTime() - 6 * 60 * 60) { // NOTE: was "close to today" and 24h in Bitcoin
+        LOCK(cs_main);
+        if ( !CNodeState::NodeSyncStarted() || GetBestHeaderTime() > GetAdjustedTime() - 6 * 60 * 60) { // NOTE: was "close to today" and 24h in Bitcoin
             state->RecordNodeStartedToSync();
-            pto->PushMessage("getblocks", chainActive.GetLocator(chainActive.Tip()), uint256(0));
+            if (HeadersFirstSyncIsEnabled() && !GetBlockDownloadWindow().isSuspended(GetTimeMicros())) {
+                RequestHeadersFromPeer(pto);
+            } else {
+                pto->PushMessage("getblocks", chainActive.GetLocator(chainActive.Tip()), uint256(0));
+            }
         }
     }
 }
@@ -3789,6 +4174,43 @@ static void CollectBlockDataToRequest(int64_t nNow, CNode* pto, std::vector<CInv
         }
     }
 }
+/** Gives up on a header chain whose block at the given height keeps stalling or
+ *  is reported missing by the peers it is requested from, and syncs with
+ *  getblocks until HEADERS_FIRST_RETRY_INTERVAL has passed.  */
+static void AbandonHeaderChain(int64_t nNow, int nHeight, CNode* pto)
+{
+    AssertLockHeld(cs_main);
+    BlockDownloadWindow& window = GetBlockDownloadWindow();
+    const NodeId source = window.headerSourceOf(nHeight);
+    LogPrintf("No peer supplied block %d of the header chain from peer=%d, falling back to getblocks\n", nHeight, source);
+    if (source >= 0)
+        Misbehaving(source, 20);
+    window.suspend(chainActive.Height(), chainActive.Tip()->GetBlockHash(), nNow + 1000000 * HEADERS_FIRST_RETRY_INTERVAL);
+    pto->PushMessage("getblocks", chainActive.GetLocator(), uint256(0));
+}
+static void CollectWindowBlocksToRequest(int64_t nNow, CNode* pto, std::vector<CInv>& vGetData)
+{
+    BlockDownloadWindow& window = GetBlockDownloadWindow();
+    for (NodeId staller: window.releaseStalledBlocks(nNow))
+        LogPrint("net", "Peer=%d is stalling the block download window, requesting its blocks elsewhere\n", staller);
+    const int nUnsuppliableHeight = window.lowestUnsuppliableHeight();
+    if (nUnsuppliableHeight >= 0) {
+        AbandonHeaderChain(nNow, nUnsuppliableHeight, pto);
+        return;
+    }
+
+    if (pto->IsFlaggedForDisconnection() || pto->fClient)
+        return;
+    const int nBlocksInFlight = GetNumberOfBlocksInFlight(pto->GetId());
+    if (nBlocksInFlight >= MAX_BLOCKS_IN_TRANSIT_PER_PEER)
+        return;
+    for (const BlockDownloadWindow::BlockToRequest& block:
+            window.assignBlocks(pto->GetId(), pto->nStartingHeight, MAX_BLOCKS_IN_TRANSIT_PER_PEER - nBlocksInFlight, nNow)) {
+        vGetData.push_back(CInv(MSG_BLOCK, block.hash));
+        MarkBlockAsInFlight(pto->GetId(), block.hash);
+        LogPrint("net", "Requesting block %s (%d) peer=%d\n", block.hash, block.height, pto->id);
+    }
+}
 void CollectNonBlockDataToRequestAndRequestIt(CNode* pto, int64_t nNow, std::vector<CInv>& vGetData)
 {
     while (!pto->IsFlaggedForDisconnection() && !pto->mapAskFor.empty() && (*pto->mapAskFor.begin()).first <= nNow)
@@ -3857,36 +4279,45 @@ void PeriodicallyRebroadcastMempoolTxs()
         RebroadcastSomeMempoolTxs();
 }
 
-bool SendMessages(CNode* pto, bool fSendTrickle)
+/** Data already queued for the peer, guarded by the peer's own locks. */
+void RequestDataFrom(CNode* pto)
 {
-    {
-        if (fSendTrickle) {
-            SendAddresses(pto);
-        }
+    if (pindexBestHeader == NULL)
+        pindexBestHeader = chainActive.Tip();
 
-        CheckForBanAndDisconnectIfNotWhitelisted(pto);
-        CommunicateRejectedBlocksToPeer(pto);
-
-        if (pindexBestHeader == NULL)
-            pindexBestHeader = chainActive.Tip();
+    // Start block sync
+    const CNodeState* state = pto->GetNodeState();
+    bool fFetch = state->fPreferredDownload || (!CNodeState::HavePreferredDownloadPeers() && !pto->fClient && !pto->fOneShot); // Download if this is a nice peer, or we have no nice peers and this one might do.
+    if(fFetch)
+    {
+        BeginSyncingWithPeer(pto);
+    }
+    if(!fReindex) PeriodicallyRebroadcastMempoolTxs();
+    int64_t nNow = GetTimeMicros();
+    std::vector<CInv> vGetData;
+    {
+        LOCK(cs_main);
+        RequestDisconnectionFromNodeIfStalling(nNow,pto);
+        BlockDownloadWindow& window = GetBlockDownloadWindow();
+        window.updateTip(chainActive.Height(), chainActive.Tip()->GetBlockHash());
+        if (window.takeDeferredHeaderRequest(pto->GetId()) && !window.isSuspended(nNow))
+            RequestHeadersFromPeer(pto);
+        if (window.isActive())
+            CollectWindowBlocksToRequest(nNow,pto,vGetData);
+        if (!window.isActive() && fFetch)
+            CollectBlockDataToRequest(nNow,pto,vGetData);
+    }
+    CollectNonBlockDataToRequestAndRequestIt(pto,nNow,vGetData);
+}
 
-        // Start block sync
-        const CNodeState* state = pto->GetNodeState();
-        bool fFetch = state->fPreferredDownload || (!CNodeState::HavePreferredDownloadPeers() && !pto->fClient && !pto->fOneShot); // Download if this is a nice peer, or we have no nice peers and this one might do.
-        if(fFetch)
-        {
-            BeginSyncingWithPeer(pto);
-        }
-        if(!fReindex) PeriodicallyRebroadcastMempoolTxs();
-        SendInventoryToPeer(pto,fSendTrickle);
-        int64_t nNow = GetTimeMicros();
-        std::vector<CInv> vGetData;
-        {
-            LOCK(cs_main);
-            RequestDisconnectionFromNodeIfStalling(nNow,pto);
-            if(fFetch) CollectBlockDataToRequest(nNow,pto,vGetData);
-        }
-        CollectNonBlockDataToRequestAndRequestIt(pto,nNow,vGetData);
+bool SendMessages(CNode* pto, bool fSendTrickle)
+{
+    if (fSendTrickle) {
+        SendAddresses(pto);
     }
+
+    CheckForBanAndDisconnectIfNotWhitelisted(pto);
+    CommunicateRejectedBlocksToPeer(pto);
+    SendInventoryToPeer(pto,fSendTrickle);
     return true;
 }
@@ -30,6 +30,8 @@ class CNode;
 struct CNodeSignals;
 class CTxMemPool;
 class CCoinsViewCache;
+class MessageLatencyHistograms;
+class SerializedBlockCache;
 
 enum FlushStateMode {
     FLUSH_STATE_IF_NEEDED,
@@ -70,6 +72,10 @@ bool InitBlockIndex();
 bool LoadBlockIndex(std::string& strError);
 /** Unload database information */
 void UnloadBlockIndex();
+/** Write the memory pool to mempool.dat, once any earlier copy has been reloaded */
+bool DumpMempool();
+/** Re-submit the transactions in mempool.dat to the memory pool */
+bool LoadMempool();
 /** Process protocol messages received from a given node */
 bool ProcessReceivedMessages(CNode* pfrom);
 /**
@@ -79,10 +85,21 @@ bool ProcessReceivedMessages(CNode* pfrom);
  * @param[in]   fSendTrickle    When true send the trickled data, otherwise trickle the data until true.
  */
 bool SendMessages(CNode* pto, bool fSendTrickle);
+/**
+ * Start block sync with a given node and request the blocks and data it announced.
+ * Waits for cs_main, so it must not be called while holding the node's send lock.
+ */
+void RequestDataFrom(CNode* pto);
 void RespondToRequestForDataFrom(CNode* pfrom);
+/** Latencies of the protocol messages processed so far, per message type */
+const MessageLatencyHistograms& GetMessageLatencyHistograms();
+/** Recently connected and served blocks kept ready to send to peers */
+const SerializedBlockCache& GetSerializedBlockCache();
 // ***TODO*** probably not the right place for these 2
 /** Check whether a block hash satisfies the proof-of-work requirement specified by nBits */
 
+/** Height of the best header known, including those of a headers-first sync not yet in the block index. Requires cs_main. */
+int GetBestHeaderHeight();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Format a string that describes several potential problems detected by the core */
@@ -19,6 +19,7 @@
 #include "netfulfilledman.h"
 #include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
 #include <algorithm>
 #include <numeric>
 #include <I_BlockSubsidyProvider.h>
@@ -28,6 +29,7 @@
 #include <version.h>
 #include <MasternodePaymentData.h>
 #include <MasternodeHelpers.h>
+#include <MasternodeScoringEngine.h>
 #include <MasternodeNetworkMessageManager.h>
 #include <timedata.h>
 #include <NodeStateRegistry.h>
@@ -43,6 +45,9 @@ constexpr int MN_WINNER_MINIMUM_AGE = 8000;    // Age in seconds. This should be
  *  with wrong claims).  */
 static constexpr unsigned MAX_RANKING_CHECK_NUM = 20;
 
+/** Number of scoring hashes (blocks) we keep the masternode scores for.  */
+static constexpr unsigned SCORE_TABLE_CACHE_SIZE = 64;
+
 /** Number of entries (blocks) we keep in the cache of ranked masternodes.  */
 static constexpr unsigned RANKING_CACHE_SIZE = 2500;
 /**
@@ -144,6 +149,7 @@ CMasternodePayments::CMasternodePayments(
     CMasternodeSync& masternodeSynchronization,
     const CChain& activeChain
     ): rankingCache(new RankingCache)
+    , scoringEngine(new MasternodeScoringEngine(SCORE_TABLE_CACHE_SIZE, boost::thread::hardware_concurrency()))
     , nSyncedFromPeer(0)
     , nLastBlockHeight(0)
     , networkFulfilledRequestManager_(networkFulfilledRequestManager)
@@ -159,6 +165,7 @@ CMasternodePayments::CMasternodePayments(
 CMasternodePayments::~CMasternodePayments()
 {
     rankingCache.reset();
+    scoringEngine.reset();
 }
 
 bool CMasternodePayments::CanVote(const COutPoint& outMasternode, const uint256& scoringBlockHash) const
@@ -203,7 +210,7 @@ void CMasternodePayments::FillBlockPayee(const CBlockIndex* pindexPrev, CMutable
 bool CMasternodePayments::CheckMasternodeWinnerCandidate(CNode* pfrom, CMasternodePaymentWinner& winner) const
 {
     const int chainTipHeight = activeChain_.Height();
-    if (paymentData_.getPaymentWinnerForHash(winner.GetHash()) != nullptr) {
+    if (paymentData_.winnerIsKnown(winner.GetHash())) {
         LogPrint("mnpayments", "mnw - Already seen - %s bestHeight %d\n", winner.GetHash(), chainTipHeight);
         masternodeSynchronization_.RecordMasternodeWinnerUpdate(winner.GetHash());
         return false;
@@ -432,17 +439,31 @@ MnPaymentQueueData CMasternodePayments::GetMasternodePaymentQueue(const CBlockIn
     return GetMasternodePaymentQueue(scoringBlockHash, nBlockHeight);
 }
 
+namespace
+{
+
+MasternodeScoringEngine::ScoreTablePtr ScoreAllMasternodes(
+    MasternodeScoringEngine& scoringEngine,
+    const std::vector<CMasternode>& masternodes,
+    const uint256& scoringBlockHash)
+{
+    std::vector<MasternodeScoringEngine::Candidate> candidates;
+    candidates.reserve(masternodes.size());
+    for (const CMasternode& mn : masternodes)
+        candidates.emplace_back(mn.vin.prevout, static_cast<MasternodeTier>(mn.nTier));
+    return scoringEngine.getScores(scoringBlockHash, candidates);
+}
+
 void ComputeMasternodesAndScores(
     const CMasternodePayments& masternodePayments,
-    std::vector<CMasternode>& masternodes,
-    const uint256& scoringBlockHash,
+    const std::vector<CMasternode>& masternodes,
+    const MasternodeScoreTable& scores,
     const int nMnCount,
     const int nBlockHeight,
     const bool fFilterSigTime,
-    std::vector<CMasternode*>& masternodeQueue,
-    std::map<const CMasternode*, uint256>& masternodeScores)
+    std::vector<std::pair<uint256, const CMasternode*>>& masternodeQueue)
 {
-    BOOST_FOREACH (CMasternode& mn, masternodes)
+    for (const CMasternode& mn : masternodes)
     {
         if (!mn.IsEnabled()) continue;
 
@@ -465,114 +486,81 @@ void ComputeMasternodesAndScores(
         //make sure it has as many confirmations as there are masternodes
         if (ComputeMasternodeInputAge(mn) < nMnCount) continue;
 
-        masternodeQueue.push_back(&mn);
-        masternodeScores[&mn] = mn.CalculateScore(scoringBlockHash);
+        masternodeQueue.emplace_back(scores.scoreOf(mn.vin.prevout), &mn);
     }
 }
 
+/** Checks if the given masternode is deemed "ok" based on the minimum
+ *  masternode age for winners, the minimum protocol version and being active
+ *  at all.  If so, returns true and sets its score.  */
+bool CheckAndGetScore(const CMasternode& mn, const MasternodeScoreTable& scores,
+                      const int minProtocol, int64_t& score)
+{
+    if (mn.protocolVersion < minProtocol) {
+        LogPrint("masternode", "Skipping Masternode with obsolete version %d\n", mn.protocolVersion);
+        return false;
+    }
+
+    const int64_t nAge = GetAdjustedTime() - mn.sigTime;
+    const int64_t minimumAge = Params().NetworkID() != CBaseChainParams::REGTEST? MN_WINNER_MINIMUM_AGE : 60 * 25;
+    if (nAge < minimumAge)
+    {
+        LogPrint("masternode", "Skipping just activated Masternode. Age: %ld\n", nAge);
+        return false;
+    }
+
+    if (!mn.IsEnabled ())
+        return false;
+
+    score = scores.scoreOf(mn.vin.prevout).GetCompact(false);
+
+    return true;
+}
+
+} // anonymous namespace
+
 MnPaymentQueueData CMasternodePayments::GetMasternodePaymentQueue(const uint256& scoringBlockHash, const int nBlockHeight) const
 {
     LOCK2(networkMessageManager_.cs_process_message,networkMessageManager_.cs);
     MnPaymentQueueData queueData;
-    std::vector< CMasternode* > masternodeQueue;
-    std::map<const CMasternode*, uint256> masternodeScores;
-    std::vector<CMasternode> filteredMasternodes;
+    std::vector<std::pair<uint256, const CMasternode*>> masternodeQueue;
 
     masternodeManager_.Check();
+    const std::vector<CMasternode>& masternodes = networkMessageManager_.masternodes;
+    const MasternodeScoringEngine::ScoreTablePtr scores = ScoreAllMasternodes(*scoringEngine, masternodes, scoringBlockHash);
     const int protocolVersion = ActiveProtocol();
     const int mnCount = std::count_if(
-        networkMessageManager_.masternodes.begin(),
-        networkMessageManager_.masternodes.end(),
+        masternodes.begin(),
+        masternodes.end(),
         [protocolVersion](const CMasternode& mn)
         {
             return !(mn.protocolVersion < protocolVersion || !mn.IsEnabled());
         });
-    ComputeMasternodesAndScores(
-        *this,
-        networkMessageManager_.masternodes,
-        scoringBlockHash,
-        mnCount,
-        nBlockHeight,
-        true,
-        masternodeQueue,
-        masternodeScores);
+    ComputeMasternodesAndScores(*this, masternodes, *scores, mnCount, nBlockHeight, true, masternodeQueue);
     //when the network is in the process of upgrading, don't penalize nodes that recently restarted
     if (static_cast<int>(masternodeQueue.size()) < mnCount / 3)
     {
-        ComputeMasternodesAndScores(
-            *this,
-            networkMessageManager_.masternodes,
-            scoringBlockHash,
-            mnCount,
-            nBlockHeight,
-            false,
-            masternodeQueue,
-            masternodeScores);
+        ComputeMasternodesAndScores(*this, masternodes, *scores, mnCount, nBlockHeight, false, masternodeQueue);
     }
 
-
     std::sort(masternodeQueue.begin(), masternodeQueue.end(),
-        [&masternodeScores](const CMasternode* a, const CMasternode* b)
+        [](const std::pair<uint256, const CMasternode*>& a, const std::pair<uint256, const CMasternode*>& b)
         {
-            if(!b) return true;
-            if(!a) return false;
-
-            uint256 aScore = masternodeScores[a];
-            uint256 bScore = masternodeScores[b];
-            return (aScore > bScore);
+            return (a.first > b.first);
         }   );
 
     queueData.topTwentyMNPayees.reserve(2 * MNPAYMENTS_SIGNATURES_TOTAL);
     queueData.queueSize = masternodeQueue.size();
-    for(CMasternode* pmn: masternodeQueue)
+    for (const auto& scoredMasternode : masternodeQueue)
     {
-        if(pmn != nullptr && queueData.topTwentyMNPayees.size() < 2 * MNPAYMENTS_SIGNATURES_TOTAL)
-        {
-            queueData.topTwentyMNPayees.push_back(GetScriptForDestination(pmn->pubKeyCollateralAddress.GetID()));
-        }
-        else
-        {
+        if (queueData.topTwentyMNPayees.size() >= 2 * MNPAYMENTS_SIGNATURES_TOTAL)
             break;
-        }
-    }
-    return queueData;
-}
-
-
-namespace
-{
 
-/** Checks if the given masternode is deemed "ok" based on the minimum
- *  masternode age for winners, the minimum protocol version and being active
- *  at all.  If so, returns true and sets its score.  */
-bool CheckAndGetScore(CMasternode& mn,
-                      const uint256& scoringBlockHash, const int minProtocol,
-                      int64_t& score)
-{
-    if (mn.protocolVersion < minProtocol) {
-        LogPrint("masternode", "Skipping Masternode with obsolete version %d\n", mn.protocolVersion);
-        return false;
+        queueData.topTwentyMNPayees.push_back(GetScriptForDestination(scoredMasternode.second->pubKeyCollateralAddress.GetID()));
     }
-
-    const int64_t nAge = GetAdjustedTime() - mn.sigTime;
-    const int64_t minimumAge = Params().NetworkID() != CBaseChainParams::REGTEST? MN_WINNER_MINIMUM_AGE : 60 * 25;
-    if (nAge < minimumAge)
-    {
-        LogPrint("masternode", "Skipping just activated Masternode. Age: %ld\n", nAge);
-        return false;
-    }
-
-    if (!mn.IsEnabled ())
-        return false;
-
-    const uint256 n = mn.CalculateScore(scoringBlockHash);
-    score = n.GetCompact(false);
-
-    return true;
+    return queueData;
 }
 
-} // anonymous namespace
-
 unsigned CMasternodePayments::GetMasternodeRank(const CTxIn& vin, const uint256& scoringBlockHash, int minProtocol, const unsigned nCheckNum) const
 {
     assert(nCheckNum <= MAX_RANKING_CHECK_NUM);
@@ -586,9 +574,11 @@ unsigned CMasternodePayments::GetMasternodeRank(const CTxIn& vin, const uint256&
         {
             LOCK(networkMessageManager_.cs);
             masternodeManager_.Check();
-            for (auto& mn : networkMessageManager_.masternodes) {
+            const MasternodeScoringEngine::ScoreTablePtr scores =
+                ScoreAllMasternodes(*scoringEngine, networkMessageManager_.masternodes, scoringBlockHash);
+            for (const auto& mn : networkMessageManager_.masternodes) {
                 int64_t score;
-                if (!CheckAndGetScore(mn, scoringBlockHash, minProtocol, score))
+                if (!CheckAndGetScore(mn, *scores, minProtocol, score))
                     continue;
 
                 rankedNodes.emplace_back(score, mn.vin.prevout.hash);
@@ -622,4 +612,5 @@ unsigned CMasternodePayments::GetMasternodeRank(const CTxIn& vin, const uint256&
 void CMasternodePayments::ResetRankingCache()
 {
     rankingCache.reset(new RankingCache);
+    scoringEngine->clear();
 }
@@ -30,6 +30,7 @@ class MasternodeNetworkMessageManager;
 class CChain;
 class CNetFulfilledRequestManager;
 class CNode;
+class MasternodeScoringEngine;
 //
 // Masternode Payments Class
 // Keeps track of who should get paid for which blocks
@@ -50,6 +51,9 @@ private:
     // if some masternode is in the top-20 for a recent block height.
     class RankingCache;
     std::unique_ptr<RankingCache> rankingCache;
+    // Masternode scores for recent scoring hashes, shared by the payment
+    // queue and the rank computation.
+    std::unique_ptr<MasternodeScoringEngine> scoringEngine;
 
     int nSyncedFromPeer;
     int nLastBlockHeight;
@@ -12,6 +12,7 @@
 #include <script/standard.h>
 #include <chainparams.h>
 #include <streams.h>
+#include <hash.h>
 #include <net.h>
 
 CAmount CMasternode::GetTierCollateralAmount(const MasternodeTier tier)
@@ -163,11 +164,17 @@ static uint256 CalculateScoreHelper(CHashWriter hashWritter, int round)
 //
 uint256 CMasternode::CalculateScore(const uint256& scoringBlockHash) const
 {
-    const uint256 aux = vin.prevout.hash + vin.prevout.n;
-    const size_t nHashRounds = GetHashRoundsForTierMasternodes(static_cast<MasternodeTier>(nTier));
-
     CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
     ss << scoringBlockHash;
+    return CalculateScore(ss, vin.prevout, static_cast<MasternodeTier>(nTier));
+}
+
+uint256 CMasternode::CalculateScore(const CHashWriter& scoringBlockHasher, const COutPoint& collateral, MasternodeTier tier)
+{
+    const uint256 aux = collateral.hash + collateral.n;
+    const size_t nHashRounds = GetHashRoundsForTierMasternodes(tier);
+
+    CHashWriter ss(scoringBlockHasher);
     ss << aux;
 
     uint256 r;
@@ -21,6 +21,7 @@
 #define MASTERNODE_REMOVAL_SECONDS (130 * 60)
 #define MASTERNODE_CHECK_SECONDS 5
 
+class CHashWriter;
 class CMasternode;
 class CMasternodeBroadcast;
 class CMasternodePing;
@@ -86,6 +87,10 @@ public:
      *  the target block height.  */
     uint256 CalculateScore(const uint256& scoringBlockHash) const;
 
+    /** Same as CalculateScore, but starts from a hasher that already holds
+     *  the scoring hash so that it can be shared between masternodes.  */
+    static uint256 CalculateScore(const CHashWriter& scoringBlockHasher, const COutPoint& collateral, MasternodeTier tier);
+
     bool IsEnabled() const;
 
     static CAmount GetTierCollateralAmount(MasternodeTier tier);
@@ -532,6 +532,29 @@ bool CMasternodeMan::ProcessPing(CNode* pfrom, const CMasternodePing& mnp)
     return false;
 }
 
+bool CMasternodeMan::PrecheckPing(const CMasternodePing& mnp, int& nDoS)
+{
+    if (networkMessageManager_.pingIsKnown(mnp.GetHash())) return false;
+
+    if (mnp.sigTime > GetAdjustedTime() + 60 * 60 || mnp.sigTime <= GetAdjustedTime() - 60 * 60) {
+        nDoS = 1;
+        return false;
+    }
+
+    CMasternode mn;
+    if (!GetMNCopy(mnp.vin, mn)) return true;
+
+    std::string errorMessage = "";
+    if (!CObfuScationSigner::VerifySignature<CMasternodePing>(mnp,mn.pubKeyMasternode,errorMessage))
+    {
+        LogPrint("masternode", "%s - Got bad Masternode address signature %s (%s)\n",
+                 __func__, mnp.vin.prevout.hash, errorMessage);
+        nDoS = 33;
+        return false;
+    }
+    return true;
+}
+
 bool CMasternodeMan::ProcessMNBroadcastsAndPings(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv)
 {
     if (strCommand == "mnb") { //Masternode Broadcast
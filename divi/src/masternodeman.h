@@ -94,6 +94,13 @@ public:
     bool GetMNCopy(const CTxIn& vin, CMasternode& mn);
 
     bool ProcessMNBroadcastsAndPings(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv);
+
+    /** Checks of a ping that need neither chain state nor the message
+     *  processing lock: whether it was seen already, its signature time and,
+     *  if the masternode is known, its signature.
+     *
+     *  Returns false if the ping can be dropped without further processing.  */
+    bool PrecheckPing(const CMasternodePing& mnp, int& nDoS);
     void ManageLocalMasternode();
     std::string ToString() const;
 };
@@ -48,6 +48,12 @@
 #include <I_CommunicationRegistrar.h>
 #include <NodeState.h>
 #include <SocketChannel.h>
+#include <EpollSocketMultiplexer.h>
+#include <defaultValues.h>
+
+#include <atomic>
+#include <memory>
+#include <set>
 
 #ifdef WIN32
 #include <string.h>
@@ -329,7 +335,8 @@ CNode* CreateNode(SOCKET socket, Args&&... args)
     return pnode;
 }
 
-map<CInv, CDataStream> mapRelay;
+// Relayed transactions are serialized once and the same buffer is queued to every peer asking for them
+map<CInv, SharedNetworkMessage> mapRelay;
 deque<pair<int64_t, CInv> > vRelayExpiration;
 CCriticalSection cs_mapRelay;
 
@@ -339,7 +346,17 @@ CCriticalSection cs_vOneShots;
 std::vector<std::string> vAddedNodes;
 CCriticalSection cs_vAddedNodes;
 
-boost::condition_variable messageHandlerCondition;
+/** Peers are spread across the message handler threads by node id, and
+ *  each thread waits on its own wakeup signal. */
+static std::vector<std::unique_ptr<CWakeupSignal>> messageHandlerWakeups;
+static CWakeupSignal& GetMessageHandlerWakeup(NodeId nodeId)
+{
+    return *messageHandlerWakeups[static_cast<unsigned>(nodeId) % messageHandlerWakeups.size()];
+}
+bool MessageProcessingIsSharded()
+{
+    return messageHandlerWakeups.size() > 1u;
+}
 
 static CAddrMan addrman;
 CAddrMan& GetNetworkAddressManager()
@@ -509,6 +526,7 @@ void RegisterNodeSignals(CNodeSignals& nodeSignals)
     nodeSignals.FinalizeNode.connect(&FinalizeNode);
     nodeSignals.ProcessReceivedMessages.connect(&ProcessReceivedMessages);
     nodeSignals.SendMessages.connect(&SendMessages);
+    nodeSignals.RequestDataFrom.connect(&RequestDataFrom);
     nodeSignals.RespondToRequestForDataFrom.connect(&RespondToRequestForDataFrom);
     nodeSignals.AdvertizeLocalAddress.connect(&AdvertizeLocal);
 }
@@ -519,6 +537,7 @@ void UnregisterNodeSignals(CNodeSignals& nodeSignals)
     nodeSignals.FinalizeNode.disconnect(&FinalizeNode);
     nodeSignals.ProcessReceivedMessages.disconnect(&ProcessReceivedMessages);
     nodeSignals.SendMessages.disconnect(&SendMessages);
+    nodeSignals.RequestDataFrom.disconnect(&RequestDataFrom);
     nodeSignals.RespondToRequestForDataFrom.connect(&RespondToRequestForDataFrom);
     nodeSignals.AdvertizeLocalAddress.connect(&AdvertizeLocal);
 }
@@ -669,6 +688,62 @@ public:
     }
 };
 
+/** Accepts one pending connection on a listening socket.  Returns false if
+ *  there was no connection to accept.  */
+static bool AcceptConnection(
+    const ListenSocket& hListenSocket,
+    bool requireSelectableSocket,
+    CCriticalSection& nodesLock,
+    std::vector<CNode*>& nodes)
+{
+    struct sockaddr_storage sockaddr;
+    socklen_t len = sizeof(sockaddr);
+    SOCKET hSocket = accept(hListenSocket.socket, (struct sockaddr*)&sockaddr, &len);
+    CAddress addr;
+    int nInbound = 0;
+
+    if (hSocket != INVALID_SOCKET)
+        if (!addr.SetSockAddr((const struct sockaddr*)&sockaddr))
+            LogPrintf("Warning: Unknown socket family\n");
+
+    bool whitelisted = hListenSocket.whitelisted || IsWhitelistedRange(addr);
+    {
+        LOCK(nodesLock);
+        BOOST_FOREACH (CNode* pnode, nodes)
+            if (pnode->fInbound)
+                nInbound++;
+    }
+
+    if (hSocket == INVALID_SOCKET) {
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK)
+            LogPrintf("socket error accept failed: %s\n", NetworkErrorString(nErr));
+        return false;
+    } else if (requireSelectableSocket && !IsSelectableSocket(hSocket)) {
+        LogPrintf("connection from %s dropped: non-selectable socket\n", addr);
+        CloseSocket(hSocket);
+    } else if (nInbound >= nMaxConnections - MAX_OUTBOUND_CONNECTIONS) {
+        LogPrint("net", "connection from %s dropped (full)\n", addr);
+        CloseSocket(hSocket);
+    } else if (PeerBanningService::IsBanned(GetTime(),addr) && !whitelisted) {
+        LogPrintf("connection from %s dropped (banned)\n", addr);
+        CloseSocket(hSocket);
+    } else {
+        CreateNode(hSocket,&GetNodeSignals(),GetNetworkAddressManager(), addr, "", true, whitelisted);
+    }
+    return true;
+}
+
+/** select() only watches descriptors below FD_SETSIZE, except on Windows. */
+static bool SelectCanWatchSocket(SOCKET hSocket)
+{
+#ifdef WIN32
+    return true;
+#else
+    return hSocket < FD_SETSIZE;
+#endif
+}
+
 class SocketsProcessor final: public I_CommunicationRegistrar<SOCKET>
 {
 private:
@@ -723,6 +798,8 @@ public:
     {
         for (const ListenSocket& hListenSocket: listeningSockets_)
         {
+            if (!SelectCanWatchSocket(hListenSocket.socket))
+                continue;
             FD_SET(hListenSocket.socket, &fdsetRecv);
             hSocketMax = max(hSocketMax, hListenSocket.socket);
             have_fds = true;
@@ -750,8 +827,15 @@ public:
         {
             if (!pnode->CommunicationChannelIsValid())
                 continue;
-            have_fds = true;
             SOCKET nodeSocket = NodeManager::Instance().getSocketByNodeId(pnode->GetId());
+            if (!SelectCanWatchSocket(nodeSocket))
+            {
+                // Accepted while the epoll handler was expected to service it
+                LogPrintf("disconnecting peer=%d: socket not selectable\n", pnode->GetId());
+                pnode->CloseCommsAndDisconnect();
+                continue;
+            }
+            have_fds = true;
             RegisterForErrors(nodeSocket);
             CommsMode mode = pnode->SelectCommunicationMode();
             switch (mode)
@@ -793,52 +877,220 @@ public:
         for(const ListenSocket& hListenSocket: listeningSockets_)
         {
             if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
-            {
-                struct sockaddr_storage sockaddr;
-                socklen_t len = sizeof(sockaddr);
-                SOCKET hSocket = accept(hListenSocket.socket, (struct sockaddr*)&sockaddr, &len);
-                CAddress addr;
-                int nInbound = 0;
+                AcceptConnection(hListenSocket, true, nodesLock, nodes);
+        }
+    }
 
-                if (hSocket != INVALID_SOCKET)
-                    if (!addr.SetSockAddr((const struct sockaddr*)&sockaddr))
-                        LogPrintf("Warning: Unknown socket family\n");
+    bool SocketReceiveDataFromPeer(CNode* pnode, CWakeupSignal& messageHandlerWakeup)
+    {
+        if (!pnode->CommunicationChannelIsValid())
+            return false;
+        SOCKET nodeSocket = NodeManager::Instance().getSocketByNodeId(pnode->GetId());
+        const bool socketHasError = IsRegisteredForErrors(nodeSocket);
+        if (IsRegisteredForReceive(nodeSocket) || socketHasError)
+            return pnode->TryReceiveData(messageHandlerWakeup, socketHasError);
+        return true;
+    }
+    bool SocketSendDataToPeer(CNode* pnode)
+    {
+        if (!pnode->CommunicationChannelIsValid())
+            return false;
+        SOCKET nodeSocket = NodeManager::Instance().getSocketByNodeId(pnode->GetId());
+        if (IsRegisteredForSend(nodeSocket))
+            return pnode->TrySendData();
 
-                bool whitelisted = hListenSocket.whitelisted || IsWhitelistedRange(addr);
-                {
-                    LOCK(nodesLock);
-                    BOOST_FOREACH (CNode* pnode, nodes)
-                        if (pnode->fInbound)
-                            nInbound++;
-                }
+        return true;
+    }
+};
 
-                if (hSocket == INVALID_SOCKET) {
-                    int nErr = WSAGetLastError();
-                    if (nErr != WSAEWOULDBLOCK)
-                        LogPrintf("socket error accept failed: %s\n", NetworkErrorString(nErr));
-                } else if (!IsSelectableSocket(hSocket)) {
-                    LogPrintf("connection from %s dropped: non-selectable socket\n", addr);
-                    CloseSocket(hSocket);
-                } else if (nInbound >= nMaxConnections - MAX_OUTBOUND_CONNECTIONS) {
-                    LogPrint("net", "connection from %s dropped (full)\n", addr);
-                    CloseSocket(hSocket);
-                } else if (PeerBanningService::IsBanned(GetTime(),addr) && !whitelisted) {
-                    LogPrintf("connection from %s dropped (banned)\n", addr);
-                    CloseSocket(hSocket);
-                } else {
-                    CreateNode(hSocket,&GetNodeSignals(),GetNetworkAddressManager(), addr, "", true, whitelisted);
-                }
+#ifdef HAVE_SYS_EPOLL_H
+/** Linux counterpart of SocketsProcessor.  It lives as long as the socket
+ *  handler thread, registers every socket with epoll once and only waits
+ *  when no registered socket is known to be ready.  */
+class EpollSocketsProcessor final: public I_CommunicationRegistrar<SOCKET>
+{
+private:
+    /** Bounds the connections accepted per listening socket and iteration so
+     *  a connection flood cannot starve connected peers. */
+    static constexpr int maximumAcceptsPerIteration = 64;
+    /** Matches the select() timeout of SocketsProcessor. */
+    static constexpr int waitTimeoutMilliseconds = 50;
+
+    /** What a socket is currently serviced for.  Errors and hangups are
+     *  serviced in every mode, otherwise a peer draining its send buffer to
+     *  an unwritable socket would keep reporting the same event forever. */
+    struct SocketRegistration
+    {
+        NodeId nodeId;
+        CommsMode mode;
+        uint64_t lastSeenIteration;
+    };
+
+    EpollSocketMultiplexer multiplexer_;
+    std::map<SOCKET, SocketRegistration> registrationBySocket_;
+    uint64_t iteration_;
+    std::vector<ListenSocket>& listeningSockets_;
+
+    SocketRegistration& Register(SOCKET hSocket, NodeId nodeId)
+    {
+        const auto it = registrationBySocket_.find(hSocket);
+        if (it != registrationBySocket_.end() && it->second.nodeId == nodeId)
+        {
+            it->second.lastSeenIteration = iteration_;
+            return it->second;
+        }
+        // New socket, or a closed socket's descriptor got reused by a new peer
+        multiplexer_.remove(hSocket);
+        multiplexer_.add(hSocket);
+        const SocketRegistration registration = {nodeId, BUSY, iteration_};
+        return registrationBySocket_[hSocket] = registration;
+    }
+    void SetMode(SOCKET hSocket, CommsMode mode)
+    {
+        const auto it = registrationBySocket_.find(hSocket);
+        if (it != registrationBySocket_.end())
+            it->second.mode = mode;
+    }
+    const SocketRegistration* FindRegistration(SOCKET hSocket) const
+    {
+        const auto it = registrationBySocket_.find(hSocket);
+        return it != registrationBySocket_.end()? &it->second : nullptr;
+    }
+    bool HasActionableSocket() const
+    {
+        for(const std::pair<const SOCKET, SocketRegistration>& registered: registrationBySocket_)
+        {
+            const SOCKET hSocket = registered.first;
+            if (multiplexer_.hasError(hSocket))
+                return true;
+            if (registered.second.mode == SEND && multiplexer_.isWritable(hSocket))
+                return true;
+            if (registered.second.mode == RECEIVE && multiplexer_.isReadable(hSocket))
+                return true;
+        }
+        return false;
+    }
+public:
+    EpollSocketsProcessor(
+        std::vector<ListenSocket>& listeningSockets
+        ): multiplexer_()
+        , registrationBySocket_()
+        , iteration_(0u)
+        , listeningSockets_(listeningSockets)
+    {
+    }
+
+    bool IsValid() const
+    {
+        return multiplexer_.isValid();
+    }
+
+    virtual void RegisterForErrors(SOCKET hSocket)
+    {
+        // Every registered socket is watched for errors
+    }
+    virtual void RegisterForSend(SOCKET hSocket)
+    {
+        SetMode(hSocket, SEND);
+    }
+    virtual void RegisterForReceive(SOCKET hSocket)
+    {
+        SetMode(hSocket, RECEIVE);
+    }
+    virtual bool IsRegisteredForErrors(SOCKET hSocket) const
+    {
+        return FindRegistration(hSocket) != nullptr && multiplexer_.hasError(hSocket);
+    }
+    virtual bool IsRegisteredForSend(SOCKET hSocket) const
+    {
+        const SocketRegistration* registration = FindRegistration(hSocket);
+        return registration && registration->mode == SEND && multiplexer_.isWritable(hSocket);
+    }
+    virtual bool IsRegisteredForReceive(SOCKET hSocket) const
+    {
+        const SocketRegistration* registration = FindRegistration(hSocket);
+        return registration && registration->mode == RECEIVE && multiplexer_.isReadable(hSocket);
+    }
+
+    void ProcessListeningSockets()
+    {
+        ++iteration_;
+        for (const ListenSocket& hListenSocket: listeningSockets_)
+        {
+            if (hListenSocket.socket == INVALID_SOCKET)
+                continue;
+            Register(hListenSocket.socket, -1).mode = RECEIVE;
+        }
+    }
+    // Same send/receive policy as SocketsProcessor. Registrations persist
+    // across iterations: a peer's socket is handed to epoll when first seen
+    // and only its mode is refreshed afterwards.  Sockets of peers that went
+    // away are dropped.
+    void AssignNodesToSendOrReceiveTasks(CCriticalSection& nodesLock, std::vector<CNode*>& nodes)
+    {
+        {
+            LOCK(nodesLock);
+            for(CNode* pnode: nodes)
+            {
+                if (!pnode->CommunicationChannelIsValid())
+                    continue;
+                SOCKET nodeSocket = NodeManager::Instance().getSocketByNodeId(pnode->GetId());
+                Register(nodeSocket, pnode->GetId()).mode = pnode->SelectCommunicationMode();
             }
         }
+        auto it = registrationBySocket_.begin();
+        while (it != registrationBySocket_.end())
+        {
+            if (it->second.lastSeenIteration == iteration_)
+            {
+                ++it;
+                continue;
+            }
+            multiplexer_.remove(it->first);
+            it = registrationBySocket_.erase(it);
+        }
+    }
+    int CheckSocketCanBeSelected()
+    {
+        return multiplexer_.wait(HasActionableSocket()? 0 : waitTimeoutMilliseconds);
+    }
+    void ProcessSocketErrorCode(int socketErrorCode)
+    {
+        if (socketErrorCode == SOCKET_ERROR)
+        {
+            int nErr = WSAGetLastError();
+            LogPrintf("socket epoll error %s\n", NetworkErrorString(nErr));
+            MilliSleep(waitTimeoutMilliseconds);
+        }
+    }
+    void AcceptNewConnections(CCriticalSection& nodesLock, std::vector<CNode*>& nodes)
+    {
+        for(const ListenSocket& hListenSocket: listeningSockets_)
+        {
+            if (hListenSocket.socket == INVALID_SOCKET ||
+                !(IsRegisteredForReceive(hListenSocket.socket) || IsRegisteredForErrors(hListenSocket.socket)))
+                continue;
+            // Edge triggered: drain the backlog instead of taking one connection per wakeup.
+            for (int accepted = 0; accepted < maximumAcceptsPerIteration; ++accepted)
+            {
+                if (!AcceptConnection(hListenSocket, false, nodesLock, nodes))
+                    break;
+            }
+            multiplexer_.markServiced(hListenSocket.socket);
+        }
     }
 
-    bool SocketReceiveDataFromPeer(CNode* pnode, boost::condition_variable& messageHandlerCondition)
+    bool SocketReceiveDataFromPeer(CNode* pnode, CWakeupSignal& messageHandlerWakeup)
     {
         if (!pnode->CommunicationChannelIsValid())
             return false;
         SOCKET nodeSocket = NodeManager::Instance().getSocketByNodeId(pnode->GetId());
-        if (IsRegisteredForReceive(nodeSocket) || IsRegisteredForErrors(nodeSocket))
-            return pnode->TryReceiveData(messageHandlerCondition);
+        const bool socketHasError = IsRegisteredForErrors(nodeSocket);
+        if (IsRegisteredForReceive(nodeSocket) || socketHasError)
+        {
+            multiplexer_.markServiced(nodeSocket);
+            return pnode->TryReceiveData(messageHandlerWakeup, socketHasError);
+        }
         return true;
     }
     bool SocketSendDataToPeer(CNode* pnode)
@@ -847,14 +1099,56 @@ public:
             return false;
         SOCKET nodeSocket = NodeManager::Instance().getSocketByNodeId(pnode->GetId());
         if (IsRegisteredForSend(nodeSocket))
+        {
+            multiplexer_.markServiced(nodeSocket);
             return pnode->TrySendData();
+        }
 
         return true;
     }
 };
+#endif
+
+template <typename Processor>
+static void ServiceSockets(Processor& socketsProcessor)
+{
+    socketsProcessor.ProcessListeningSockets();
+    socketsProcessor.AssignNodesToSendOrReceiveTasks(cs_vNodes,vNodes);
+
+    int nSelect = socketsProcessor.CheckSocketCanBeSelected();
+    boost::this_thread::interruption_point();
+    socketsProcessor.ProcessSocketErrorCode(nSelect);
+    socketsProcessor.AcceptNewConnections(cs_vNodes,vNodes);
+
+    //
+    // Service each socket
+    //
+    ThreadSafeNodesCopy safeNodesCopy(cs_vNodes,vNodes);
+    for(const NodeRef& pnode: safeNodesCopy.Nodes())
+    {
+        boost::this_thread::interruption_point();
+
+        if(!socketsProcessor.SocketReceiveDataFromPeer(pnode.get(),GetMessageHandlerWakeup(pnode->GetId())) || !socketsProcessor.SocketSendDataToPeer(pnode.get()))
+            continue;
+
+        //
+        // Inactivity checking
+        //
+        pnode->CheckForInnactivity();
+    }
+    safeNodesCopy.ClearCopy();
+}
 
 void ThreadSocketHandler()
 {
+#ifdef HAVE_SYS_EPOLL_H
+    std::unique_ptr<EpollSocketsProcessor> epollSocketsProcessor(
+        new EpollSocketsProcessor(NodeManager::Instance().listeningSockets()));
+    if (!epollSocketsProcessor->IsValid()) {
+        LogPrintf("%s: epoll unavailable (%s), falling back to select\n", __func__, NetworkErrorString(WSAGetLastError()));
+        epollSocketsProcessor.reset();
+    }
+#endif
     unsigned int nPrevNodeCount = 0;
     while (true) {
         //
@@ -868,56 +1162,63 @@ void ThreadSocketHandler()
             uiInterface.NotifyNumConnectionsChanged(nPrevNodeCount);
         }
 
+#ifdef HAVE_SYS_EPOLL_H
+        if (epollSocketsProcessor) {
+            ServiceSockets(*epollSocketsProcessor);
+            continue;
+        }
+#endif
         SocketsProcessor socketsProcessor(NodeManager::Instance().listeningSockets());
-        socketsProcessor.ProcessListeningSockets();
-        socketsProcessor.AssignNodesToSendOrReceiveTasks(cs_vNodes,vNodes);
-
-        int nSelect = socketsProcessor.CheckSocketCanBeSelected();
-        boost::this_thread::interruption_point();
-        socketsProcessor.ProcessSocketErrorCode(nSelect);
-        socketsProcessor.AcceptNewConnections(cs_vNodes,vNodes);
+        ServiceSockets(socketsProcessor);
+    }
+}
 
-        //
-        // Service each socket
-        //
-        ThreadSafeNodesCopy safeNodesCopy(cs_vNodes,vNodes);
-        for(const NodeRef& pnode: safeNodesCopy.Nodes())
-        {
-            boost::this_thread::interruption_point();
+/** We periodically rebroadcast our address.  This is the last time
+ *  we did a broadcast.  */
+static std::atomic<int64_t> nLastAddressRebroadcast(0);
 
-            if(!socketsProcessor.SocketReceiveDataFromPeer(pnode.get(),messageHandlerCondition) || !socketsProcessor.SocketSendDataToPeer(pnode.get()))
-                continue;
+static void RebroadcastLocalAddressDaily(const std::vector<NodeRef>& vNodesCopy)
+{
+    int64_t nLastRebroadcast = nLastAddressRebroadcast.load();
+    if (IsInitialBlockDownload() || GetTime() <= nLastRebroadcast + 24 * 60 * 60)
+        return;
+    // Only the thread that moves the timestamp on does the rebroadcast
+    if (!nLastAddressRebroadcast.compare_exchange_strong(nLastRebroadcast, GetTime()))
+        return;
 
-            //
-            // Inactivity checking
-            //
-            pnode->CheckForInnactivity();
-        }
-        safeNodesCopy.ClearCopy();
+    for (const NodeRef& nodeRef : vNodesCopy)
+    {
+        NodeRef nodeToAdvertiseAddressTo = NodeReferenceFactory::makeUniqueNodeReference(nodeRef.get());
+        nodeToAdvertiseAddressTo->AdvertizeLocalAddress(nLastRebroadcast);
+        boost::this_thread::interruption_point();
     }
 }
 
-void ThreadMessageHandler()
+void ThreadMessageHandler(unsigned shard)
 {
-    boost::mutex condition_mutex;
-    boost::unique_lock<boost::mutex> lock(condition_mutex);
-
-    /* We periodically rebroadcast our address.  This is the last time
-       we did a broadcast.  */
-    int64_t nLastRebroadcast = 0;
+    const unsigned numberOfShards = messageHandlerWakeups.size();
+    CWakeupSignal& messageHandlerWakeup = *messageHandlerWakeups[shard];
 
     SetThreadPriority(THREAD_PRIORITY_BELOW_NORMAL);
     while (true) {
         ThreadSafeNodesCopy safeNodesCopy(cs_vNodes,vNodes);
         const std::vector<NodeRef>& vNodesCopy = safeNodesCopy.Nodes();
+        std::vector<CNode*> shardNodes;
+        for(const NodeRef& pnode: vNodesCopy)
+        {
+            if (static_cast<unsigned>(pnode->GetId()) % numberOfShards == shard)
+                shardNodes.push_back(pnode.get());
+        }
 
-        bool rebroadcast = (!IsInitialBlockDownload() && (GetTime() > nLastRebroadcast + 24 * 60 * 60));
+        // Whichever handler thread comes first rebroadcasts for all nodes
+        if (!vNodesCopy.empty())
+            RebroadcastLocalAddressDaily(vNodesCopy);
 
         // Poll the connected nodes for messages
-        CNode* pnodeTrickle = vNodesCopy.empty()? nullptr: vNodesCopy[GetRand(vNodesCopy.size())].get();
+        CNode* pnodeTrickle = shardNodes.empty()? nullptr: shardNodes[GetRand(shardNodes.size())];
         bool fSleep = true;
 
-        for(const NodeRef& pnode: vNodesCopy)
+        for(CNode* pnode: shardNodes)
         {
             if (pnode->IsFlaggedForDisconnection())
                 continue;
@@ -933,25 +1234,11 @@ void ThreadMessageHandler()
             }
             boost::this_thread::interruption_point();
 
-            // Rebroadcasting is done for all nodes after the ping
-            // of the first; this is to mimic previous behaviour.
-            if (rebroadcast)
-            {
-                for (const NodeRef& nodeRef : vNodesCopy)
-                {
-                    NodeRef nodeToAdvertiseAddressTo = NodeReferenceFactory::makeUniqueNodeReference(nodeRef.get());
-                    nodeToAdvertiseAddressTo->AdvertizeLocalAddress(nLastRebroadcast);
-                    boost::this_thread::interruption_point();
-                }
-
-                nLastRebroadcast = GetTime();
-                rebroadcast = false;
-            }
-
             // Send messages
             if (pnode->CanSendMessagesToPeer())
             {
-                pnode->ProcessSendMessages(pnode.get() == pnodeTrickle);
+                pnode->ProcessSendMessages(pnode == pnodeTrickle);
+                pnode->ProcessDataRequests();
             }
             boost::this_thread::interruption_point();
         }
@@ -959,7 +1246,7 @@ void ThreadMessageHandler()
         safeNodesCopy.ClearCopy();
 
         if (fSleep)
-            messageHandlerCondition.timed_wait(lock, boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(100));
+            messageHandlerWakeup.waitFor(100);
     }
 }
 
@@ -1515,6 +1802,14 @@ void StartNode(boost::thread_group& threadGroup,const bool& reindexFlag, CWallet
     // Map ports with UPnP
     MapPort(settings.GetBoolArg("-upnp", DEFAULT_UPNP));
 
+    const int64_t numberOfMessageHandlerThreads =
+        std::max<int64_t>(1, std::min<int64_t>(settings.GetArg("-msghandlerthreads", DEFAULT_MESSAGE_HANDLER_THREADS), MAX_MESSAGE_HANDLER_THREADS));
+    messageHandlerWakeups.clear();
+    for (int64_t shard = 0; shard < numberOfMessageHandlerThreads; ++shard)
+        messageHandlerWakeups.emplace_back(new CWakeupSignal());
+    if (numberOfMessageHandlerThreads > 1)
+        LogPrintf("Processing peer messages on %d threads\n", numberOfMessageHandlerThreads);
+
     // Send and receive from sockets, accept connections
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "net", &ThreadSocketHandler));
 
@@ -1525,8 +1820,9 @@ void StartNode(boost::thread_group& threadGroup,const bool& reindexFlag, CWallet
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "opencon", &ThreadOpenConnections));
 
     // Process messages
-    threadGroup.create_thread(
-        boost::bind(&TraceThread<void (*)()>, "msghand", &ThreadMessageHandler) );
+    for (unsigned shard = 0; shard < messageHandlerWakeups.size(); ++shard)
+        threadGroup.create_thread(
+            boost::bind(&TraceThread<void (*)(unsigned), unsigned>, "msghand", &ThreadMessageHandler, shard) );
 
     // Dump network addresses
     threadGroup.create_thread(boost::bind(&LoopForever<void (*)()>, "dumpaddr", &DumpAddresses, DUMP_ADDRESSES_INTERVAL * 1000));
@@ -1643,15 +1939,15 @@ void RelayAllAlertsTo(CNode* peer)
 bool RepeatRelayedInventory(CNode* pfrom, const CInv& inv)
 {
     LOCK(cs_mapRelay);
-    std::map<CInv, CDataStream>::iterator mi = mapRelay.find(inv);
+    std::map<CInv, SharedNetworkMessage>::iterator mi = mapRelay.find(inv);
     if (mi != mapRelay.end()) {
-        pfrom->PushMessage(inv.GetCommand(), (*mi).second);
+        pfrom->PushSerializedMessage((*mi).second);
         return true;
     }
     return false;
 }
 
-static void RelayTransactionToAllPeers(const CTransaction& tx, const CDataStream& ss)
+static void RelayTransactionToAllPeers(const CTransaction& tx, const SharedNetworkMessage& message)
 {
     CInv inv(MSG_TX, tx.GetHash());
     {
@@ -1664,7 +1960,7 @@ static void RelayTransactionToAllPeers(const CTransaction& tx, const CDataStream
         }
 
         // Save original serialized message so newer versions are preserved
-        mapRelay.insert(std::make_pair(inv, ss));
+        mapRelay.insert(std::make_pair(inv, message));
         vRelayExpiration.push_back(std::make_pair(GetTime() + 15 * 60, inv));
     }
     LOCK(cs_vNodes);
@@ -1685,10 +1981,7 @@ static void RelayTransactionToAllPeers(const CTransaction& tx, const CDataStream
 }
 void RelayTransactionToAllPeers(const CTransaction& tx)
 {
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    ss.reserve(10000);
-    ss << tx;
-    RelayTransactionToAllPeers(tx, ss);
+    RelayTransactionToAllPeers(tx, NetworkMessageSerializer::SerializeMessage(PROTOCOL_VERSION, "tx", tx));
 }
 
 
@@ -1802,10 +2095,17 @@ void SetNetworkingParameters()
     if (settings.GetBoolArg("-peerbloomfilters", DEFAULT_PEERBLOOMFILTERS))
         EnableBloomFilters();
 
+    nMaxConnections = settings.GetArg("-maxconnections", 125);
+#ifndef HAVE_SYS_EPOLL_H
+    // select() cannot service descriptors beyond FD_SETSIZE
     const int reservedFileDescriptors = MIN_CORE_FILEDESCRIPTORS;
     int nBind = std::max((int)settings.ParameterIsSet("-bind") + (int)settings.ParameterIsSet("-whitebind"), 1);
-    nMaxConnections = settings.GetArg("-maxconnections", 125);
-    nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - reservedFileDescriptors)), 0);
+    nMaxConnections = std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - reservedFileDescriptors));
+#else
+    // epoll is only bounded by the file descriptor limit, so leave the descriptors LevelDB and the wallet need
+    nMaxConnections = std::min(nMaxConnections, RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS) - MIN_CORE_FILEDESCRIPTORS);
+#endif
+    nMaxConnections = std::max(nMaxConnections, 0);
 }
 
 bool InitializeP2PNetwork(UIMessenger& uiMessenger)
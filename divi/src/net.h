@@ -47,6 +47,8 @@ bool OpenNetworkConnection(const CAddress& addrConnect, const char* strDest = NU
 void StartNode(boost::thread_group& threadGroup,const bool& reindexFlag, CWallet* pwalletMain);
 bool StopNode();
 void CleanupP2PConnections();
+/** Whether peers are spread across more than one message handler thread */
+bool MessageProcessingIsSharded();
 
 CAddrMan& GetNetworkAddressManager();
 CNodeSignals& GetNodeSignals();
@@ -26,6 +26,7 @@
 #include <arpa/inet.h>
 #endif
 #include <fcntl.h>
+#include <poll.h>
 #endif
 
 #include <boost/algorithm/string/case_conv.hpp> // for to_lower()
@@ -251,6 +252,26 @@ struct timeval MillisToTimeval(int64_t nTimeout)
  *
  * @note This function requires that hSocket is in non-blocking mode.
  */
+/** Waits up to the timeout for the socket to become readable or writable.
+ *  Returns like select(): SOCKET_ERROR, 0 on timeout or a positive count.  */
+int static WaitForSocket(SOCKET hSocket, bool forWriting, int64_t timeoutMilliseconds)
+{
+#ifdef WIN32
+    struct timeval timeout = MillisToTimeval(timeoutMilliseconds);
+    fd_set fdset;
+    FD_ZERO(&fdset);
+    FD_SET(hSocket, &fdset);
+    return select(hSocket + 1, forWriting ? NULL : &fdset, forWriting ? &fdset : NULL, NULL, &timeout);
+#else
+    // poll() has no FD_SETSIZE limit on the descriptor
+    struct pollfd pollFd;
+    pollFd.fd = hSocket;
+    pollFd.events = forWriting ? POLLOUT : POLLIN;
+    pollFd.revents = 0;
+    return poll(&pollFd, 1, static_cast<int>(timeoutMilliseconds));
+#endif
+}
+
 bool static InterruptibleRecv(char* data, size_t len, int timeout, SOCKET& hSocket)
 {
     int64_t curTime = GetTimeMillis();
@@ -271,11 +292,7 @@ bool static InterruptibleRecv(char* data, size_t len, int timeout, SOCKET& hSock
                 if (!IsSelectableSocket(hSocket)) {
                     return false;
                 }
-                struct timeval tval = MillisToTimeval(std::min(endTime - curTime, maxWait));
-                fd_set fdset;
-                FD_ZERO(&fdset);
-                FD_SET(hSocket, &fdset);
-                int nRet = select(hSocket + 1, &fdset, NULL, NULL, &tval);
+                int nRet = WaitForSocket(hSocket, false, std::min(endTime - curTime, maxWait));
                 if (nRet == SOCKET_ERROR) {
                     return false;
                 }
@@ -472,11 +489,7 @@ bool static ConnectSocketDirectly(const CService& addrConnect, SOCKET& hSocketRe
         int nErr = WSAGetLastError();
         // WSAEINVAL is here because some legacy version of winsock uses it
         if (nErr == WSAEINPROGRESS || nErr == WSAEWOULDBLOCK || nErr == WSAEINVAL) {
-            struct timeval timeout = MillisToTimeval(nTimeout);
-            fd_set fdset;
-            FD_ZERO(&fdset);
-            FD_SET(hSocket, &fdset);
-            int nRet = select(hSocket + 1, NULL, &fdset, NULL, &timeout);
+            int nRet = WaitForSocket(hSocket, true, nTimeout);
             if (nRet == 0) {
                 LogPrint("net", "connection to %s timeout\n", addrConnect);
                 CloseSocket(hSocket);
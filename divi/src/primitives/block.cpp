@@ -11,6 +11,9 @@
 #include "utilstrencodings.h"
 #include "Logging.h"
 
+#include <assert.h>
+#include <string.h>
+
 uint256 CBlockHeader::GetHash() const
 {
     if(nVersion < 4)
@@ -19,6 +22,22 @@ uint256 CBlockHeader::GetHash() const
     return Hash(BEGIN(nVersion), END(nAccumulatorCheckpoint));
 }
 
+void CBlock::MemoizeHash()
+{
+    const char* headerBegin = BEGIN(nVersion);
+    assert(static_cast<size_t>(END(nAccumulatorCheckpoint) - headerBegin) == HASHED_HEADER_SIZE);
+    hashMemo_ = CBlockHeader::GetHash();
+    memcpy(hashedHeader_, headerBegin, HASHED_HEADER_SIZE);
+    hashMemoIsValid_ = true;
+}
+
+uint256 CBlock::GetHash() const
+{
+    if(hashMemoIsValid_ && memcmp(hashedHeader_, BEGIN(nVersion), HASHED_HEADER_SIZE) == 0)
+        return hashMemo_;
+    return CBlockHeader::GetHash();
+}
+
 uint256 CBlock::BuildMerkleTree(bool* fMutated) const
 {
     /* WARNING! If you're reading this because you're learning about crypto
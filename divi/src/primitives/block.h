@@ -81,6 +81,14 @@ public:
 
 class CBlock : public CBlockHeader
 {
+private:
+    // memory only: the header fields MemoizeHash() hashed and their hash.
+    // Changing any field makes the fields differ from hashedHeader_ again.
+    static const size_t HASHED_HEADER_SIZE = sizeof(int32_t) + 3 * sizeof(uint256) + 3 * sizeof(uint32_t);
+    unsigned char hashedHeader_[HASHED_HEADER_SIZE];
+    uint256 hashMemo_;
+    bool hashMemoIsValid_;
+
 public:
     // network and disk
     std::vector<CTransaction> vtx;
@@ -122,8 +130,16 @@ public:
         vMerkleTree.clear();
         payee = CScript();
         vchBlockSig.clear();
+        hashMemoIsValid_ = false;
     }
 
+    /** Remembers the hash of the current header fields.  Only the owner of the
+     *  block may call this; GetHash() itself never writes, so const blocks can
+     *  be shared between threads.  */
+    void MemoizeHash();
+    /** The memoized hash while the header fields are unchanged, else the hash computed afresh. */
+    uint256 GetHash() const;
+
     CBlockHeader GetBlockHeader() const
     {
         CBlockHeader block;
@@ -25,6 +25,7 @@
 #include <utilstrencodings.h>
 #include <txmempool.h>
 #include <blockmap.h>
+#include <script/sigcache.h>
 
 using namespace json_spirit;
 using namespace std;
@@ -40,7 +41,6 @@ extern bool fAddressIndex;
 extern BlockMap mapBlockIndex;
 extern CCriticalSection cs_main;
 extern CTxMemPool mempool;
-extern CBlockIndex* pindexBestHeader;
 extern CChain chainActive;
 
 double GetDifficulty(const CBlockIndex* blockindex)
@@ -530,10 +530,11 @@ Value getblockchaininfo(const Array& params, bool fHelp)
             "\nExamples:\n" +
             HelpExampleCli("getblockchaininfo", "") + HelpExampleRpc("getblockchaininfo", ""));
 
+    LOCK(cs_main);
     Object obj;
     obj.push_back(Pair("chain", Params().NetworkIDString()));
     obj.push_back(Pair("blocks", (int)chainActive.Height()));
-    obj.push_back(Pair("headers", pindexBestHeader ? pindexBestHeader->nHeight : -1));
+    obj.push_back(Pair("headers", GetBestHeaderHeight()));
     obj.push_back(Pair("bestblockhash", chainActive.Tip()->GetBlockHash().GetHex()));
     obj.push_back(Pair("difficulty", (double)GetDifficulty()));
     obj.push_back(Pair("verificationprogress", checkpointsVerifier.GuessVerificationProgress(chainActive.Tip())));
@@ -649,6 +650,9 @@ Value getmempoolinfo(const Array& params, bool fHelp)
             "{\n"
             "  \"size\": xxxxx                (numeric) Current tx count\n"
             "  \"bytes\": xxxxx               (numeric) Sum of all tx sizes\n"
+            "  \"sigcachebytes\": xxxxx       (numeric) Memory reserved by the signature cache\n"
+            "  \"sigcachelookups\": xxxxx     (numeric) Signature cache lookups since startup\n"
+            "  \"sigcachehitrate\": x.xxx     (numeric) Fraction of signature cache lookups that were hits\n"
             "}\n"
             "\nExamples:\n" +
             HelpExampleCli("getmempoolinfo", "") + HelpExampleRpc("getmempoolinfo", ""));
@@ -657,6 +661,11 @@ Value getmempoolinfo(const Array& params, bool fHelp)
     ret.push_back(Pair("size", (int64_t)mempool.size()));
     ret.push_back(Pair("bytes", (int64_t)mempool.GetTotalTxSize()));
 
+    const SignatureCacheStats sigCacheStats = GetSignatureCacheStats();
+    ret.push_back(Pair("sigcachebytes", (int64_t)sigCacheStats.sizeInBytes));
+    ret.push_back(Pair("sigcachelookups", (int64_t)sigCacheStats.lookups));
+    ret.push_back(Pair("sigcachehitrate", sigCacheStats.lookups > 0 ? (double)sigCacheStats.hits / sigCacheStats.lookups : 0.0));
+
     return ret;
 }
 
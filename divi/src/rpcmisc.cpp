@@ -35,6 +35,7 @@
 #include <FeeAndPriorityCalculator.h>
 #include <PeerBanningService.h>
 #include <IndexDatabaseUpdateCollector.h>
+#include <CachedPoSStakeModifierService.h>
 #include <TransactionSearchIndexes.h>
 
 #include <Settings.h>
@@ -1141,6 +1142,10 @@ Value getstakingstatus(const Array& params, bool fHelp)
             "  \"enoughcoins\": true|false,        (boolean) if available coins are greater than reserve balance\n"
             "  \"mnsync\": true|false,             (boolean) if masternode data is synced\n"
             "  \"staking status\": true|false,     (boolean) if the wallet is staking or not\n"
+            "  \"stakemodifiercache\": {           (object) stake modifier lookups since startup\n"
+            "    \"hits\": n,                      (numeric) lookups answered from the cache\n"
+            "    \"misses\": n                     (numeric) lookups that had to walk the block index\n"
+            "  }\n"
             "}\n"
             "\nExamples:\n" +
             HelpExampleCli("getstakingstatus", "") + HelpExampleRpc("getstakingstatus", ""));
@@ -1162,6 +1167,14 @@ Value getstakingstatus(const Array& params, bool fHelp)
     constexpr char stakeSplitSettingLookup[] = "-stakesplitthreshold";
     CAmount stakeSplit = static_cast<CAmount>(settings.GetArg(stakeSplitSettingLookup,100000)* COIN);
     obj.push_back(Pair("stake split threshold",ValueFromAmount(stakeSplit) ));
+
+    uint64_t stakeModifierCacheHits = 0;
+    uint64_t stakeModifierCacheMisses = 0;
+    GetStakeModifierCacheStatistics(stakeModifierCacheHits, stakeModifierCacheMisses);
+    Object stakeModifierCache;
+    stakeModifierCache.push_back(Pair("hits", stakeModifierCacheHits));
+    stakeModifierCache.push_back(Pair("misses", stakeModifierCacheMisses));
+    obj.push_back(Pair("stakemodifiercache", stakeModifierCache));
     return obj;
 }
 #endif // ENABLE_WALLET
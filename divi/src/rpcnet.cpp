@@ -23,6 +23,9 @@
 #include <QueuedBlock.h>
 #include <NodeState.h>
 #include <NodeStateRegistry.h>
+#include <MessageLatencyHistograms.h>
+#include <SerializedBlockCache.h>
+#include <utilstrencodings.h>
 
 #include <boost/foreach.hpp>
 
@@ -323,6 +326,58 @@ Value getnettotals(const Array& params, bool fHelp)
     return obj;
 }
 
+static Object LatencyHistogramToJSON(const LatencyHistogram& histogram)
+{
+    Object obj;
+    obj.push_back(Pair("averageus", histogram.numberOfSamples > 0u ? histogram.totalMicros / static_cast<int64_t>(histogram.numberOfSamples) : 0));
+    obj.push_back(Pair("medianus", histogram.percentileMicros(0.5)));
+    obj.push_back(Pair("p90us", histogram.percentileMicros(0.9)));
+    obj.push_back(Pair("p99us", histogram.percentileMicros(0.99)));
+    obj.push_back(Pair("maxus", histogram.maximumMicros));
+    Object buckets;
+    for (unsigned bucket = 0; bucket < LatencyHistogram::NUMBER_OF_BUCKETS; ++bucket) {
+        if (histogram.counts[bucket] == 0u)
+            continue;
+        buckets.push_back(Pair(strprintf("%d", LatencyHistogram::bucketUpperBoundMicros(bucket)), histogram.counts[bucket]));
+    }
+    obj.push_back(Pair("histogram", buckets));
+    return obj;
+}
+
+Value getmessagestats(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() > 0)
+        throw runtime_error(
+            "getmessagestats\n"
+            "\nReturns latency statistics of the processed network messages, per message type.\n"
+            "Latencies are in microseconds. Histogram buckets are keyed by their exclusive\n"
+            "upper bound, which doubles from bucket to bucket.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"command\": {           (object) Statistics of one message type\n"
+            "    \"count\": n,          (numeric) Number of messages processed\n"
+            "    \"queued\": {          (object) Time between receiving the message and processing it\n"
+            "      \"averageus\": n, \"medianus\": n, \"p90us\": n, \"p99us\": n, \"maxus\": n,\n"
+            "      \"histogram\": { \"upperbound\": n, ... }\n"
+            "    },\n"
+            "    \"processing\": { ... } (object) Time spent processing the message, as above\n"
+            "  },\n"
+            "  ...\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getmessagestats", "") + HelpExampleRpc("getmessagestats", ""));
+
+    Object obj;
+    for (const auto& latencyByCommand : GetMessageLatencyHistograms().snapshot()) {
+        Object commandStats;
+        commandStats.push_back(Pair("count", latencyByCommand.second.processing.numberOfSamples));
+        commandStats.push_back(Pair("queued", LatencyHistogramToJSON(latencyByCommand.second.queued)));
+        commandStats.push_back(Pair("processing", LatencyHistogramToJSON(latencyByCommand.second.processing)));
+        obj.push_back(Pair(SanitizeString(latencyByCommand.first), commandStats));
+    }
+    return obj;
+}
+
 static Array GetNetworksInfo()
 {
     Array networks;
@@ -374,7 +429,15 @@ Value getnetworkinfo(const Array& params, bool fHelp)
             "    \"score\": xxx                         (numeric) relative score\n"
             "  }\n"
             "  ,...\n"
-            "  ]\n"
+            "  ],\n"
+            "  \"blockservecache\": {                 (object) blocks kept in memory for sending to peers\n"
+            "    \"blocks\": xxx,                      (numeric) number of cached blocks\n"
+            "    \"bytes\": xxx,                       (numeric) size of the cached blocks\n"
+            "    \"maxbytes\": xxx,                    (numeric) cache size limit (-blockservecache)\n"
+            "    \"hits\": xxx,                        (numeric) block requests served from memory\n"
+            "    \"misses\": xxx,                      (numeric) block requests read from disk\n"
+            "    \"hitrate\": x.xxx                    (numeric) fraction of block requests served from memory\n"
+            "  }\n"
             "}\n"
             "\nExamples:\n" +
             HelpExampleCli("getnetworkinfo", "") + HelpExampleRpc("getnetworkinfo", ""));
@@ -400,5 +463,14 @@ Value getnetworkinfo(const Array& params, bool fHelp)
         localAddresses.push_back(rec);
     }
     obj.push_back(Pair("localaddresses", localAddresses));
+    const SerializedBlockCache::Statistics blockCacheStatistics = GetSerializedBlockCache().getStatistics();
+    Object blockCache;
+    blockCache.push_back(Pair("blocks", (uint64_t)blockCacheStatistics.numberOfBlocks));
+    blockCache.push_back(Pair("bytes", (uint64_t)blockCacheStatistics.usedBytes));
+    blockCache.push_back(Pair("maxbytes", (uint64_t)blockCacheStatistics.maximumBytes));
+    blockCache.push_back(Pair("hits", blockCacheStatistics.hits));
+    blockCache.push_back(Pair("misses", blockCacheStatistics.misses));
+    blockCache.push_back(Pair("hitrate", blockCacheStatistics.hitRate()));
+    obj.push_back(Pair("blockservecache", blockCache));
     return obj;
 }
@@ -30,6 +30,7 @@
 #include <MinimumFeeCoinSelectionAlgorithm.h>
 #include <SignatureSizeEstimator.h>
 #include <FeeAndPriorityCalculator.h>
+#include <DeferredKeyVerifier.h>
 #include <numeric>
 
 #include "json/json_spirit_utils.h"
@@ -2310,7 +2311,8 @@ Value keypoolrefill(const Array& params, bool fHelp)
     }
 
     EnsureWalletIsUnlocked();
-    pwalletMain->TopUpKeyPool(kpSize);
+    // Not run under cs_wallet, so wait for a top-up already running and then finish it
+    pwalletMain->TopUpKeyPool(kpSize, true);
 
     if (pwalletMain->GetKeyPoolSize() < kpSize)
         throw JSONRPCError(RPC_WALLET_ERROR, "Error refreshing keypool.");
@@ -2478,6 +2480,36 @@ Value walletverify(const json_spirit::Array& params, bool fHelp)
     return true;
 }
 
+Value getkeyverificationstatus(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+                "getkeyverificationstatus\n"
+                "\nReturns the progress of verifying the key pairs that were loaded without verification (-deferkeyverification).\n"
+                "\nResult:\n"
+                "{\n"
+                "  \"status\": \"xxxx\",       (string) none/pending/running/complete/failed\n"
+                "  \"keys\": n,              (numeric) the number of key pairs loaded without verification\n"
+                "  \"verified\": n,          (numeric) the number of those checked so far\n"
+                "  \"failed\": [             (array) addresses whose private key does not match their public key\n"
+                "    \"address\", ...\n"
+                "  ]\n"
+                "}\n"
+                "\nExamples:\n" +
+                HelpExampleCli("getkeyverificationstatus", "") + HelpExampleRpc("getkeyverificationstatus", ""));
+
+    const DeferredKeyVerifier& verifier = pwalletMain->GetDeferredKeyVerifier();
+    Object obj;
+    obj.push_back(Pair("status", DeferredKeyVerifier::describe(verifier.state())));
+    obj.push_back(Pair("keys", (uint64_t)verifier.numberOfKeys()));
+    obj.push_back(Pair("verified", (uint64_t)verifier.numberOfVerifiedKeys()));
+    Array failed;
+    for (const CKeyID& keyID : verifier.failedKeys())
+        failed.push_back(CBitcoinAddress(keyID).ToString());
+    obj.push_back(Pair("failed", failed));
+    return obj;
+}
+
 Value encryptwallet(const Array& params, bool fHelp)
 {
     if (!pwalletMain->IsCrypted() && (fHelp || params.size() != 1))
@@ -5,13 +5,19 @@
 
 #include "sigcache.h"
 
+#include "crypto/sha256.h"
+#include "defaultValues.h"
 #include "pubkey.h"
 #include "random.h"
 #include "uint256.h"
 #include "util.h"
 
-#include <boost/thread.hpp>
-#include <boost/tuple/tuple_comparison.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
 #include "Settings.h"
 extern Settings& settings;
 namespace {
@@ -20,64 +26,226 @@ namespace {
  * Valid signature cache, to avoid doing expensive ECDSA signature checking
  * twice for every transaction (once when accepted into memory pool, and
  * again when accepted into the block chain)
+ *
+ * Entries are salted SHA256 digests of (signature hash, public key, signature)
+ * stored in a fixed-size table. Each digest may live in one of a few candidate
+ * slots derived from it; inserts displace occupants cuckoo-style along a short
+ * chain and drop whatever is left at its end. Lookups take no lock: every slot
+ * carries a sequence counter that is odd while a (serialized) writer updates it.
  */
 class CSignatureCache
 {
 private:
-     //! sigdata_type is (signature hash, signature, public key):
-    typedef boost::tuple<uint256, std::vector<unsigned char>, CPubKey> sigdata_type;
-    std::set< sigdata_type> setValid;
-    boost::shared_mutex cs_sigcache;
+    static constexpr unsigned NUMBER_OF_CANDIDATE_SLOTS = 8;
+    static constexpr unsigned MAX_DISPLACEMENTS = 16;
+    static constexpr unsigned MAX_READ_ATTEMPTS = 4;
+
+    struct Slot
+    {
+        std::atomic<uint32_t> sequence;
+        std::atomic<uint64_t> words[4];
+    };
+    typedef std::array<uint64_t, 4> EntryKey;
+
+    CSHA256 saltedHasher_;
+    std::unique_ptr<Slot[]> slots_;
+    size_t numberOfSlots_;
+    std::mutex writeMutex_;
+    FastRandomContext evictionRandomness_;
+    std::atomic<uint64_t> lookups_;
+    std::atomic<uint64_t> hits_;
+
+    EntryKey ComputeEntry(const uint256& hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubKey) const
+    {
+        unsigned char digest[CSHA256::OUTPUT_SIZE];
+        CSHA256(saltedHasher_)
+            .Write(hash.begin(), 32)
+            .Write(pubKey.begin(), pubKey.size())
+            .Write(vchSig.data(), vchSig.size())
+            .Finalize(digest);
+        EntryKey entry;
+        std::memcpy(entry.data(), digest, sizeof(digest));
+        return entry;
+    }
+
+    size_t CandidateSlot(const EntryKey& entry, unsigned candidate) const
+    {
+        const uint64_t bits = static_cast<uint32_t>(entry[candidate / 2] >> (32 * (candidate % 2)));
+        return static_cast<size_t>((bits * numberOfSlots_) >> 32);
+    }
+
+    static bool IsEmpty(const EntryKey& entry)
+    {
+        return (entry[0] | entry[1] | entry[2] | entry[3]) == 0;
+    }
+
+    /** Consistent snapshot of a slot, or false if writers kept it busy. */
+    static bool ReadSlot(const Slot& slot, EntryKey& entry)
+    {
+        for (unsigned attempt = 0; attempt < MAX_READ_ATTEMPTS; ++attempt) {
+            const uint32_t sequenceBefore = slot.sequence.load(std::memory_order_acquire);
+            if (sequenceBefore & 1) continue;
+            for (unsigned word = 0; word < 4; ++word)
+                entry[word] = slot.words[word].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == sequenceBefore)
+                return true;
+        }
+        return false;
+    }
+
+    /** Only called with writeMutex_ held, so reads of the slot need no checks. */
+    static EntryKey SwapSlot(Slot& slot, const EntryKey& entry)
+    {
+        EntryKey previous;
+        const uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (unsigned word = 0; word < 4; ++word) {
+            previous[word] = slot.words[word].load(std::memory_order_relaxed);
+            slot.words[word].store(entry[word], std::memory_order_relaxed);
+        }
+        slot.sequence.store(sequence + 2, std::memory_order_release);
+        return previous;
+    }
+
+    static EntryKey PeekSlot(const Slot& slot)
+    {
+        EntryKey entry;
+        for (unsigned word = 0; word < 4; ++word)
+            entry[word] = slot.words[word].load(std::memory_order_relaxed);
+        return entry;
+    }
 
 public:
+    CSignatureCache(
+        ): saltedHasher_()
+        , slots_()
+        , numberOfSlots_(0)
+        , writeMutex_()
+        , evictionRandomness_()
+        , lookups_(0)
+        , hits_(0)
+    {
+        uint256 salt = GetRandHash();
+        saltedHasher_.Write(salt.begin(), 32);
+        Setup(static_cast<size_t>(DEFAULT_SIG_CACHE_MAX_MB) << 20);
+    }
+
+    static size_t BytesPerEntry()
+    {
+        return sizeof(Slot);
+    }
+
+    /** Resize the table to fit in maxBytes; zero disables the cache. Not safe
+     *  while other threads use the cache. */
+    size_t Setup(size_t maxBytes)
+    {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        numberOfSlots_ = maxBytes / sizeof(Slot);
+        if (numberOfSlots_ > 0)
+            numberOfSlots_ = std::max<size_t>(numberOfSlots_, NUMBER_OF_CANDIDATE_SLOTS);
+        slots_.reset(numberOfSlots_ > 0 ? new Slot[numberOfSlots_] : nullptr);
+        for (size_t index = 0; index < numberOfSlots_; ++index) {
+            slots_[index].sequence.store(0, std::memory_order_relaxed);
+            for (unsigned word = 0; word < 4; ++word)
+                slots_[index].words[word].store(0, std::memory_order_relaxed);
+        }
+        lookups_ = 0;
+        hits_ = 0;
+        return numberOfSlots_ * sizeof(Slot);
+    }
+
     bool
     Get(const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubKey)
     {
-        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
-
-        sigdata_type k(hash, vchSig, pubKey);
-        std::set<sigdata_type>::iterator mi = setValid.find(k);
-        if (mi != setValid.end())
-            return true;
+        if (numberOfSlots_ == 0) return false;
+        lookups_.fetch_add(1, std::memory_order_relaxed);
+        const EntryKey entry = ComputeEntry(hash, vchSig, pubKey);
+        for (unsigned candidate = 0; candidate < NUMBER_OF_CANDIDATE_SLOTS; ++candidate) {
+            EntryKey stored;
+            if (ReadSlot(slots_[CandidateSlot(entry, candidate)], stored) && stored == entry) {
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
         return false;
     }
 
     void Set(const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubKey)
     {
-        // DoS prevention: limit cache size to less than 10MB
-        // (~200 bytes per cache entry times 50,000 entries)
-        // Since there are a maximum of 20,000 signature operations per block
-        // 50,000 is a reasonable default.
-        int64_t nMaxCacheSize = settings.GetArg("-maxsigcachesize", 50000);
-        if (nMaxCacheSize <= 0) return;
-
-        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
-
-        while (static_cast<int64_t>(setValid.size()) > nMaxCacheSize)
-        {
-            // Evict a random entry. Random because that helps
-            // foil would-be DoS attackers who might try to pre-generate
-            // and re-use a set of valid signatures just-slightly-greater
-            // than our cache size.
-            uint256 randomHash = GetRandHash();
-            std::vector<unsigned char> unused;
-            std::set<sigdata_type>::iterator it =
-                setValid.lower_bound(sigdata_type(randomHash, unused, unused));
-            if (it == setValid.end())
-                it = setValid.begin();
-            setValid.erase(*it);
+        if (numberOfSlots_ == 0) return;
+        EntryKey entry = ComputeEntry(hash, vchSig, pubKey);
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        for (unsigned displacement = 0; displacement <= MAX_DISPLACEMENTS; ++displacement) {
+            size_t candidateSlots[NUMBER_OF_CANDIDATE_SLOTS];
+            for (unsigned candidate = 0; candidate < NUMBER_OF_CANDIDATE_SLOTS; ++candidate) {
+                candidateSlots[candidate] = CandidateSlot(entry, candidate);
+                const EntryKey stored = PeekSlot(slots_[candidateSlots[candidate]]);
+                if (stored == entry) return;
+                if (IsEmpty(stored)) {
+                    SwapSlot(slots_[candidateSlots[candidate]], entry);
+                    return;
+                }
+            }
+            // All candidates are taken: evict a random one, which helps foil
+            // would-be DoS attackers, and try to relocate the evicted entry.
+            const size_t victim = candidateSlots[evictionRandomness_.rand32(NUMBER_OF_CANDIDATE_SLOTS)];
+            entry = SwapSlot(slots_[victim], entry);
         }
+    }
 
-        sigdata_type k(hash, vchSig, pubKey);
-        setValid.insert(k);
+    SignatureCacheStats GetStats() const
+    {
+        SignatureCacheStats stats;
+        stats.numberOfSlots = numberOfSlots_;
+        stats.sizeInBytes = numberOfSlots_ * sizeof(Slot);
+        stats.lookups = lookups_.load(std::memory_order_relaxed);
+        stats.hits = hits_.load(std::memory_order_relaxed);
+        return stats;
     }
 };
 
+CSignatureCache& GetSignatureCache()
+{
+    static CSignatureCache signatureCache;
+    return signatureCache;
+}
+
+}
+
+void InitSignatureCache()
+{
+    const int64_t maximumBytes = MAX_SIG_CACHE_MAX_MB << 20;
+    int64_t requestedBytes = DEFAULT_SIG_CACHE_MAX_MB << 20;
+    if (settings.ParameterIsSet("-sigcachemaxmb")) {
+        const int64_t requestedMiB = std::max<int64_t>(settings.GetArg("-sigcachemaxmb", DEFAULT_SIG_CACHE_MAX_MB), 0);
+        requestedBytes = std::min(requestedMiB, MAX_SIG_CACHE_MAX_MB) << 20;
+    } else if (settings.ParameterIsSet("-maxsigcachesize")) {
+        // Deprecated option counting entries; kept so existing configurations keep their meaning
+        const int64_t bytesPerEntry = static_cast<int64_t>(CSignatureCache::BytesPerEntry());
+        const int64_t requestedEntries = std::max<int64_t>(settings.GetArg("-maxsigcachesize", 0), 0);
+        requestedBytes = std::min(requestedEntries, maximumBytes / bytesPerEntry) * bytesPerEntry;
+        LogPrintf("-maxsigcachesize is deprecated, use -sigcachemaxmb to size the signature cache in MiB\n");
+    }
+
+    const size_t usedBytes = GetSignatureCache().Setup(static_cast<size_t>(std::min(requestedBytes, maximumBytes)));
+    if (usedBytes == 0) {
+        LogPrintf("Signature cache disabled\n");
+        return;
+    }
+    LogPrintf("Using %u KiB for signature cache, able to store %u elements\n",
+        usedBytes >> 10, GetSignatureCache().GetStats().numberOfSlots);
+}
+
+SignatureCacheStats GetSignatureCacheStats()
+{
+    return GetSignatureCache().GetStats();
 }
 
 bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
-    static CSignatureCache signatureCache;
+    CSignatureCache& signatureCache = GetSignatureCache();
 
     if (signatureCache.Get(sighash, vchSig, pubkey))
         return true;
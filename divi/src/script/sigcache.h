@@ -8,10 +8,24 @@
 
 #include "script/SignatureCheckers.h"
 
+#include <stdint.h>
 #include <vector>
 
 class CPubKey;
 
+struct SignatureCacheStats
+{
+    size_t numberOfSlots;
+    size_t sizeInBytes;
+    uint64_t lookups;
+    uint64_t hits;
+};
+
+/** Size the signature cache according to -sigcachemaxmb (or the deprecated entry
+ *  count -maxsigcachesize); zero disables it. Call once at startup. */
+void InitSignatureCache();
+SignatureCacheStats GetSignatureCacheStats();
+
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
 private:
@@ -43,21 +43,34 @@ extern bool ActivateBestChain(CValidationState& state, CBlock* pblock = NULL, bo
 CAmount nTransactionValueMultiplier = 10000; // 1 / 0.0001 = 10000;
 unsigned int nTransactionSizeMultiplier = 300;
 std::map<uint256, CSporkMessage> mapSporks;
+/** Guards mapSporks, which the inv and getdata handlers read without cs_main. */
+static CCriticalSection cs_mapSporks;
 CSporkManager sporkManager;
 
+static void RecordSpork(const CSporkMessage& spork)
+{
+    LOCK(cs_mapSporks);
+    mapSporks[spork.GetHash()] = spork;
+}
 bool ShareSporkDataWithPeer(CNode* peer, const uint256& inventoryHash)
 {
-    if (mapSporks.count(inventoryHash)) {
-        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-        ss.reserve(1000);
-        ss << mapSporks[inventoryHash];
-        peer->PushMessage("spork", ss);
-        return true;
+    CSporkMessage spork;
+    {
+        LOCK(cs_mapSporks);
+        const auto it = mapSporks.find(inventoryHash);
+        if (it == mapSporks.end())
+            return false;
+        spork = it->second;
     }
-    return false;
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss.reserve(1000);
+    ss << spork;
+    peer->PushMessage("spork", ss);
+    return true;
 }
 bool SporkDataIsKnown(const uint256& inventoryHash)
 {
+    LOCK(cs_mapSporks);
     return mapSporks.count(inventoryHash);
 }
 void ProcessSpork(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv)
@@ -221,7 +234,7 @@ void CSporkManager::LoadSporksFromDB()
         }
 
         // add spork to memory
-        mapSporks[spork.GetHash()] = spork;
+        RecordSpork(spork);
         AddActiveSpork(spork);
         LogPrintf("%s : loaded spork %s with value %d\n", __func__, GetSporkNameByID(spork.nSporkID), spork.strValue);
     }
@@ -267,7 +280,7 @@ void CSporkManager::ProcessSpork(CNode* pfrom, const std::string& strCommand, CD
 
         pfrom->nSporksSynced++;
 
-        mapSporks[hash] = spork;
+        RecordSpork(spork);
 
         if(AddActiveSpork(spork)) {
             //does a task if needed
@@ -433,7 +446,7 @@ bool CSporkManager::UpdateSpork(int nSporkID, std::string strValue)
 
     if(spork.Sign(sporkPrivKey, sporkPubKey)) {
         spork.Relay();
-        mapSporks[spork.GetHash()] = spork;
+        RecordSpork(spork);
         AddActiveSpork(spork);
         return true;
     }
@@ -254,6 +254,38 @@ public:
     }
 };
 
+/** Wakes a thread sleeping in waitFor().  Unlike a bare condition variable,
+ *  a notification sent while the thread is busy is not lost but makes its
+ *  next waitFor() return right away.  */
+class CWakeupSignal
+{
+private:
+    boost::condition_variable condition;
+    boost::mutex mutex;
+    bool fNotified;
+
+public:
+    CWakeupSignal() : fNotified(false) {}
+
+    void notify()
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            fNotified = true;
+        }
+        condition.notify_one();
+    }
+
+    /** Returns true if woken up, false after the timeout expired. */
+    bool waitFor(int64_t milliseconds)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        const bool fWoken = fNotified || condition.timed_wait(lock, boost::posix_time::milliseconds(milliseconds), [this] { return fNotified; });
+        fNotified = false;
+        return fWoken;
+    }
+};
+
 /** RAII-style semaphore lock */
 class CSemaphoreGrant
 {
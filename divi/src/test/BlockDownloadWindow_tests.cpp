@@ -0,0 +1,281 @@
+#include <BlockDownloadWindow.h>
+
+#include <test_only.h>
+
+namespace
+{
+constexpr int64_t STALLING_TIMEOUT = 2000000;
+constexpr NodeId HEADER_SOURCE = 7;
+constexpr unsigned MAXIMUM_HEADERS_AHEAD = 20u;
+
+class BlockDownloadWindowTestFixture
+{
+public:
+    std::vector<CBlock> blocks;
+    BlockDownloadWindow window;
+
+    BlockDownloadWindowTestFixture(
+        ): blocks()
+        , window(8u, STALLING_TIMEOUT, 1000u, 3u, MAXIMUM_HEADERS_AHEAD)
+    {
+        for(unsigned height = 0u; height <= MAXIMUM_HEADERS_AHEAD + 4u; ++height)
+        {
+            CBlock block;
+            block.nVersion = 4;
+            block.nTime = 1000u + height;
+            block.nNonce = height;
+            if(!blocks.empty()) block.hashPrevBlock = blocks.back().GetHash();
+            blocks.push_back(block);
+        }
+        window.reset(0, blocks[0].GetHash());
+    }
+
+    bool appendHeader(const CBlock& block)
+    {
+        return window.appendHeader(block.GetHash(), block.hashPrevBlock, block.GetBlockTime(), HEADER_SOURCE);
+    }
+
+    void appendHeadersUpToHeight(int height)
+    {
+        for(int nextHeight = window.lastHeaderHeight() + 1; nextHeight <= height; ++nextHeight)
+        {
+            BOOST_CHECK(appendHeader(blocks[nextHeight]));
+        }
+    }
+};
+
+std::vector<int> heightsOf(const std::vector<BlockDownloadWindow::BlockToRequest>& blocksToRequest)
+{
+    std::vector<int> heights;
+    for(const BlockDownloadWindow::BlockToRequest& block: blocksToRequest)
+    {
+        heights.push_back(block.height);
+    }
+    return heights;
+}
+}
+
+BOOST_FIXTURE_TEST_SUITE(BlockDownloadWindow_tests, BlockDownloadWindowTestFixture)
+
+BOOST_AUTO_TEST_CASE(willOnlyAcceptHeadersBuildingOnTheLastOne)
+{
+    BOOST_CHECK(!window.isActive());
+    BOOST_CHECK(!appendHeader(blocks[2]));
+    appendHeadersUpToHeight(3);
+    BOOST_CHECK(window.isActive());
+    BOOST_CHECK(!appendHeader(blocks[3]));
+    BOOST_CHECK_EQUAL(window.lastHeaderHeight(), 3);
+    BOOST_CHECK(window.lastHeaderHash() == blocks[3].GetHash());
+    BOOST_CHECK_EQUAL(window.lastHeaderTime(), blocks[3].GetBlockTime());
+    BOOST_CHECK_EQUAL(window.heightOf(blocks[2].GetHash()), 2);
+    BOOST_CHECK_EQUAL(window.heightOf(blocks[5].GetHash()), -1);
+}
+
+BOOST_AUTO_TEST_CASE(willSpreadBlocksAcrossPeersWithinTheWindow)
+{
+    appendHeadersUpToHeight(20);
+    const auto firstPeerBlocks = window.assignBlocks(1, 20, 3u, 0);
+    const auto secondPeerBlocks = window.assignBlocks(2, 20, 16u, 0);
+    const auto thirdPeerBlocks = window.assignBlocks(3, 20, 16u, 0);
+
+    BOOST_CHECK(heightsOf(firstPeerBlocks) == std::vector<int>({1, 2, 3}));
+    BOOST_CHECK(heightsOf(secondPeerBlocks) == std::vector<int>({4, 5, 6, 7, 8}));
+    BOOST_CHECK(thirdPeerBlocks.empty());
+    BOOST_CHECK(firstPeerBlocks[0].hash == blocks[1].GetHash());
+    BOOST_CHECK_EQUAL(window.numberOfBlocksInFlight(1), 3u);
+    BOOST_CHECK_EQUAL(window.numberOfBlocksInFlight(2), 5u);
+}
+
+BOOST_AUTO_TEST_CASE(willNotAskPeersForBlocksBeyondTheirHeight)
+{
+    appendHeadersUpToHeight(20);
+    BOOST_CHECK(heightsOf(window.assignBlocks(1, 2, 16u, 0)) == std::vector<int>({1, 2}));
+}
+
+BOOST_AUTO_TEST_CASE(willMoveTheWindowAlongWithTheTip)
+{
+    appendHeadersUpToHeight(20);
+    window.assignBlocks(1, 20, 16u, 0);
+    window.updateTip(3, blocks[3].GetHash());
+
+    BOOST_CHECK_EQUAL(window.numberOfBlocksInFlight(1), 5u);
+    BOOST_CHECK(heightsOf(window.assignBlocks(2, 20, 16u, 0)) == std::vector<int>({9, 10, 11}));
+
+    window.updateTip(20, blocks[20].GetHash());
+    BOOST_CHECK(!window.isActive());
+    BOOST_CHECK_EQUAL(window.numberOfBlocksInFlight(1), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(willResetWhenTheTipLeavesTheHeaderChain)
+{
+    appendHeadersUpToHeight(20);
+    window.assignBlocks(1, 20, 16u, 0);
+    CBlock otherBlock = blocks[1];
+    otherBlock.nNonce = 12345u;
+    window.updateTip(1, otherBlock.GetHash());
+
+    BOOST_CHECK(!window.isActive());
+    BOOST_CHECK(window.lastHeaderHash() == otherBlock.GetHash());
+    BOOST_CHECK_EQUAL(window.numberOfBlocksInFlight(1), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(willHandStalledBlocksToAnotherPeer)
+{
+    appendHeadersUpToHeight(20);
+    window.assignBlocks(1, 20, 2u, 0);
+    window.assignBlocks(2, 20, 2u, 0);
+    BOOST_CHECK(window.bufferBlock(blocks[3], 2, 100u));
+
+    BOOST_CHECK(window.releaseStalledBlocks(STALLING_TIMEOUT).empty());
+    const std::vector<NodeId> stallers = window.releaseStalledBlocks(STALLING_TIMEOUT + 1);
+    BOOST_CHECK(stallers == std::vector<NodeId>({1}));
+    BOOST_CHECK_EQUAL(window.numberOfBlocksInFlight(1), 0u);
+    BOOST_CHECK_EQUAL(window.numberOfBlocksInFlight(2), 1u);
+
+    BOOST_CHECK(heightsOf(window.assignBlocks(1, 20, 2u, STALLING_TIMEOUT + 2)) == std::vector<int>({5, 6}));
+    BOOST_CHECK(heightsOf(window.assignBlocks(3, 20, 2u, STALLING_TIMEOUT + 2)) == std::vector<int>({1, 2}));
+}
+
+BOOST_AUTO_TEST_CASE(willOnlyReleaseBlocksThatHoldUpTheWindow)
+{
+    appendHeadersUpToHeight(20);
+    window.assignBlocks(1, 20, 1u, 0);
+    window.assignBlocks(2, 20, 4u, 0);
+    BOOST_CHECK(window.bufferBlock(blocks[3], 2, 100u));
+
+    BOOST_CHECK(window.releaseStalledBlocks(10 * STALLING_TIMEOUT) == std::vector<NodeId>({1, 2}));
+    BOOST_CHECK_EQUAL(window.numberOfBlocksInFlight(1), 0u);
+    BOOST_CHECK_EQUAL(window.numberOfBlocksInFlight(2), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(willGiveStalledBlocksBackWhenNobodyElseTakesThem)
+{
+    appendHeadersUpToHeight(20);
+    window.assignBlocks(1, 20, 1u, 0);
+    window.releaseStalledBlocks(STALLING_TIMEOUT + 1);
+
+    BOOST_CHECK(heightsOf(window.assignBlocks(1, 1, 1u, STALLING_TIMEOUT + 2)).empty());
+    BOOST_CHECK(heightsOf(window.assignBlocks(1, 1, 1u, 2 * STALLING_TIMEOUT + 1)) == std::vector<int>({1}));
+}
+
+BOOST_AUTO_TEST_CASE(willHandOutBufferedBlocksInChainOrder)
+{
+    appendHeadersUpToHeight(20);
+    window.assignBlocks(1, 20, 4u, 0);
+    BOOST_CHECK(window.bufferBlock(blocks[3], 1, 100u));
+    BOOST_CHECK(window.bufferBlock(blocks[2], 1, 200u));
+    BOOST_CHECK(!window.bufferBlock(blocks[12], 1, 100u));
+    BOOST_CHECK_EQUAL(window.bufferedBytes(), 300u);
+    BOOST_CHECK_EQUAL(window.numberOfBlocksInFlight(1), 2u);
+
+    CBlock block;
+    NodeId nodeId = -1;
+    BOOST_CHECK(!window.takeBufferedChild(blocks[0].GetHash(), block, nodeId));
+    BOOST_CHECK(window.takeBufferedChild(blocks[1].GetHash(), block, nodeId));
+    BOOST_CHECK(block.GetHash() == blocks[2].GetHash());
+    BOOST_CHECK_EQUAL(nodeId, 1);
+    BOOST_CHECK(window.takeBufferedChild(blocks[2].GetHash(), block, nodeId));
+    BOOST_CHECK(block.GetHash() == blocks[3].GetHash());
+    BOOST_CHECK(!window.takeBufferedChild(blocks[3].GetHash(), block, nodeId));
+    BOOST_CHECK_EQUAL(window.bufferedBytes(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(willOnlyFillGapsOnceTheBufferIsFull)
+{
+    appendHeadersUpToHeight(20);
+    window.assignBlocks(1, 20, 1u, 0);
+    window.assignBlocks(2, 20, 3u, 0);
+    BOOST_CHECK(window.bufferBlock(blocks[4], 2, 1000u));
+    window.removePeer(1);
+    window.removePeer(2);
+
+    BOOST_CHECK(heightsOf(window.assignBlocks(3, 20, 16u, 0)) == std::vector<int>({1, 2, 3}));
+}
+
+BOOST_AUTO_TEST_CASE(willForgetDownloadsFromRemovedPeers)
+{
+    appendHeadersUpToHeight(20);
+    window.assignBlocks(1, 20, 2u, 0);
+    window.assignBlocks(2, 20, 2u, 0);
+    window.removePeer(1);
+
+    BOOST_CHECK_EQUAL(window.numberOfBlocksInFlight(1), 0u);
+    BOOST_CHECK_EQUAL(window.numberOfBlocksInFlight(2), 2u);
+    BOOST_CHECK(heightsOf(window.assignBlocks(3, 20, 2u, 0)) == std::vector<int>({1, 2}));
+}
+
+BOOST_AUTO_TEST_CASE(willFlagBlocksThatStallOnSeveralPeers)
+{
+    appendHeadersUpToHeight(20);
+    window.assignBlocks(1, 20, 1u, 0);
+    window.releaseStalledBlocks(STALLING_TIMEOUT + 1);
+    BOOST_CHECK(heightsOf(window.assignBlocks(2, 20, 1u, STALLING_TIMEOUT + 2)) == std::vector<int>({1}));
+    window.releaseStalledBlocks(2 * STALLING_TIMEOUT + 3);
+    BOOST_CHECK_EQUAL(window.lowestUnsuppliableHeight(), -1);
+
+    BOOST_CHECK(heightsOf(window.assignBlocks(3, 20, 1u, 2 * STALLING_TIMEOUT + 4)) == std::vector<int>({1}));
+    BOOST_CHECK(!window.markNotFound(blocks[1].GetHash(), 2, 2 * STALLING_TIMEOUT + 5));
+    BOOST_CHECK(window.markNotFound(blocks[1].GetHash(), 3, 2 * STALLING_TIMEOUT + 5));
+    BOOST_CHECK_EQUAL(window.numberOfBlocksInFlight(3), 0u);
+    BOOST_CHECK_EQUAL(window.lowestUnsuppliableHeight(), 1);
+    BOOST_CHECK_EQUAL(window.headerSourceOf(1), HEADER_SOURCE);
+}
+
+BOOST_AUTO_TEST_CASE(willForgetStallsOnceTheBlockArrives)
+{
+    appendHeadersUpToHeight(20);
+    for(NodeId nodeId = 1; nodeId <= 2; ++nodeId)
+    {
+        window.assignBlocks(nodeId, 20, 1u, 0);
+        BOOST_CHECK(window.markNotFound(blocks[1].GetHash(), nodeId, 0));
+    }
+    window.markReceived(blocks[1].GetHash());
+    BOOST_CHECK(heightsOf(window.assignBlocks(3, 20, 1u, 0)) == std::vector<int>({1}));
+    BOOST_CHECK(window.markNotFound(blocks[1].GetHash(), 3, 0));
+
+    BOOST_CHECK_EQUAL(window.lowestUnsuppliableHeight(), -1);
+}
+
+BOOST_AUTO_TEST_CASE(willDropTheHeaderChainWhileSuspended)
+{
+    appendHeadersUpToHeight(20);
+    window.assignBlocks(1, 20, 4u, 0);
+    window.suspend(0, blocks[0].GetHash(), 100);
+
+    BOOST_CHECK(!window.isActive());
+    BOOST_CHECK_EQUAL(window.numberOfBlocksInFlight(1), 0u);
+    BOOST_CHECK_EQUAL(window.lastHeaderTime(), 0);
+    BOOST_CHECK_EQUAL(window.headerSourceOf(1), -1);
+    BOOST_CHECK(window.isSuspended(99));
+    BOOST_CHECK(!window.isSuspended(100));
+}
+
+BOOST_AUTO_TEST_CASE(willRefuseHeadersTooFarAheadOfTheTip)
+{
+    appendHeadersUpToHeight(20);
+    BOOST_CHECK(!appendHeader(blocks[21]));
+    BOOST_CHECK_EQUAL(window.lastHeaderHeight(), 20);
+    BOOST_CHECK(!window.takeDeferredHeaderRequest(HEADER_SOURCE));
+
+    window.updateTip(9, blocks[9].GetHash());
+    BOOST_CHECK(!window.takeDeferredHeaderRequest(HEADER_SOURCE));
+    window.updateTip(10, blocks[10].GetHash());
+    BOOST_CHECK(!window.takeDeferredHeaderRequest(HEADER_SOURCE + 1));
+    BOOST_CHECK(window.takeDeferredHeaderRequest(HEADER_SOURCE));
+    BOOST_CHECK(!window.takeDeferredHeaderRequest(HEADER_SOURCE));
+
+    appendHeadersUpToHeight(24);
+    BOOST_CHECK_EQUAL(window.lastHeaderHeight(), 24);
+}
+
+BOOST_AUTO_TEST_CASE(willLetAnyPeerTakeTheDeferredHeaderRequestOfARemovedPeer)
+{
+    appendHeadersUpToHeight(20);
+    BOOST_CHECK(!appendHeader(blocks[21]));
+    window.updateTip(10, blocks[10].GetHash());
+    window.removePeer(HEADER_SOURCE);
+
+    BOOST_CHECK(window.takeDeferredHeaderRequest(HEADER_SOURCE + 1));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
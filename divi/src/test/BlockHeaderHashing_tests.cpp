@@ -0,0 +1,121 @@
+#include <BlockHeaderHashing.h>
+#include <primitives/block.h>
+
+#include <test_only.h>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+namespace
+{
+CBlockHeader CreateHeader(int32_t version, uint32_t nonce)
+{
+    CBlockHeader header;
+    header.nVersion = version;
+    header.hashPrevBlock = uint256(1000u + nonce);
+    header.nTime = 1538000000u + nonce;
+    header.nBits = 0x1e0ffff0;
+    header.nNonce = nonce;
+    return header;
+}
+
+uint256 HashFromScratch(const CBlock& block)
+{
+    return block.GetBlockHeader().GetHash();
+}
+}
+
+BOOST_AUTO_TEST_SUITE(BlockHeaderHashing_tests)
+
+BOOST_AUTO_TEST_CASE(willRecomputeTheHashWhenAnyFieldChanges)
+{
+    for(int32_t version: {3, 4})
+    {
+        CBlock block(CreateHeader(version, 7u));
+        const uint256 originalHash = block.GetHash();
+        block.MemoizeHash();
+        BOOST_CHECK(block.GetHash() == originalHash);
+        BOOST_CHECK(CBlock(block).GetHash() == originalHash);
+
+        block.nNonce++;
+        BOOST_CHECK(block.GetHash() != originalHash);
+        BOOST_CHECK(block.GetHash() == HashFromScratch(block));
+        block.nNonce--;
+        BOOST_CHECK(block.GetHash() == originalHash);
+
+        block.hashMerkleRoot = uint256(1);
+        BOOST_CHECK(block.GetHash() == HashFromScratch(block));
+        block.nAccumulatorCheckpoint = uint256(2);
+        BOOST_CHECK(block.GetHash() == HashFromScratch(block));
+        BOOST_CHECK(block.GetHash() != originalHash);
+
+        block.SetNull();
+        BOOST_CHECK(block.GetHash() == HashFromScratch(block));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(willHashBatchesLikeSingleHeaders)
+{
+    CCheckQueue<BlockHeaderHashCheck> queue(8);
+    boost::thread_group threads;
+    for(unsigned threadIndex = 0; threadIndex < 3; ++threadIndex)
+    {
+        threads.create_thread(boost::bind(&CCheckQueue<BlockHeaderHashCheck>::Thread, &queue));
+    }
+
+    std::vector<CBlockHeader> headers;
+    for(uint32_t nonce = 0; nonce < 200u; ++nonce)
+    {
+        headers.push_back(CreateHeader(nonce % 2 == 0? 3 : 4, nonce));
+    }
+    const std::vector<uint256> hashes = HashBlockHeaders(&queue, headers);
+    const std::vector<uint256> fewHashes = HashBlockHeaders(nullptr, std::vector<CBlockHeader>(headers.begin(), headers.begin() + 3));
+
+    BOOST_REQUIRE_EQUAL(hashes.size(), headers.size());
+    BOOST_REQUIRE_EQUAL(fewHashes.size(), 3u);
+    for(size_t index = 0; index < headers.size(); ++index)
+    {
+        BOOST_CHECK(hashes[index] == headers[index].GetHash());
+        if(index < fewHashes.size())
+            BOOST_CHECK(fewHashes[index] == headers[index].GetHash());
+    }
+
+    threads.interrupt_all();
+    threads.join_all();
+}
+
+BOOST_AUTO_TEST_CASE(willMemoizeTheHashesOfABatchOfBlocks)
+{
+    CCheckQueue<BlockHeaderHashCheck> queue(8);
+    boost::thread_group threads;
+    for(unsigned threadIndex = 0; threadIndex < 3; ++threadIndex)
+    {
+        threads.create_thread(boost::bind(&CCheckQueue<BlockHeaderHashCheck>::Thread, &queue));
+    }
+
+    std::vector<CBlock> blocks;
+    for(uint32_t nonce = 0; nonce < 200u; ++nonce)
+    {
+        blocks.push_back(CBlock(CreateHeader(nonce % 2 == 0? 3 : 4, nonce)));
+    }
+    std::vector<CBlock*> blocksToHash;
+    for(CBlock& block: blocks)
+    {
+        blocksToHash.push_back(&block);
+    }
+    MemoizeBlockHashes(&queue, blocksToHash);
+
+    for(CBlock& block: blocks)
+    {
+        const uint256 memoizedHash = block.GetHash();
+        BOOST_CHECK(memoizedHash == HashFromScratch(block));
+        block.nTime++;
+        BOOST_CHECK(block.GetHash() != memoizedHash);
+        BOOST_CHECK(block.GetHash() == HashFromScratch(block));
+    }
+
+    threads.interrupt_all();
+    threads.join_all();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
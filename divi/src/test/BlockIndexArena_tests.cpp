@@ -0,0 +1,131 @@
+#include <blockmap.h>
+#include <chain.h>
+#include <clientversion.h>
+#include <streams.h>
+
+#include <test_only.h>
+
+namespace
+{
+void FillStakeData(CBlockIndex& blockIndex, unsigned seed)
+{
+    blockIndex.SetProofOfStake();
+    CBlockIndexStakeData& stakeData = blockIndex.MutableStakeData();
+    stakeData.prevoutStake = COutPoint(uint256(seed), seed % 7u);
+    stakeData.nStakeTime = 1538000000u + seed;
+    stakeData.hashProofOfStake = uint256(1000u + seed);
+}
+
+bool StakeDataMatches(const CBlockIndexStakeData& stakeData, unsigned seed)
+{
+    return stakeData.prevoutStake == COutPoint(uint256(seed), seed % 7u) &&
+        stakeData.nStakeTime == 1538000000u + seed &&
+        stakeData.hashProofOfStake == uint256(1000u + seed);
+}
+
+bool StakeDataMatches(const CBlockIndex& blockIndex, unsigned seed)
+{
+    return blockIndex.HasStakeData() && StakeDataMatches(blockIndex.StakeData(), seed);
+}
+}
+
+BOOST_AUTO_TEST_SUITE(BlockIndexArena_tests)
+
+BOOST_AUTO_TEST_CASE(willReportNullStakeDataUntilItIsWritten)
+{
+    CBlockIndex blockIndex;
+    BOOST_CHECK(!blockIndex.HasStakeData());
+    BOOST_CHECK(blockIndex.StakeData().prevoutStake.IsNull());
+    BOOST_CHECK(blockIndex.StakeData().hashProofOfStake == uint256());
+
+    FillStakeData(blockIndex, 3u);
+    BOOST_CHECK(StakeDataMatches(blockIndex, 3u));
+
+    blockIndex.SetNull();
+    BOOST_CHECK(!blockIndex.HasStakeData());
+    BOOST_CHECK(blockIndex.StakeData().prevoutStake.IsNull());
+    BOOST_CHECK_EQUAL(blockIndex.StakeData().nStakeTime, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(willNotShareStakeDataBetweenCopies)
+{
+    CBlockIndex original;
+    FillStakeData(original, 5u);
+
+    CBlockIndex copy(original);
+    BOOST_CHECK(StakeDataMatches(copy, 5u));
+    BOOST_CHECK(&copy.StakeData() != &original.StakeData());
+
+    FillStakeData(copy, 6u);
+    BOOST_CHECK(StakeDataMatches(original, 5u));
+
+    copy = original;
+    BOOST_CHECK(StakeDataMatches(copy, 5u));
+    BOOST_CHECK(&copy.StakeData() != &original.StakeData());
+
+    copy = CBlockIndex();
+    BOOST_CHECK(!copy.HasStakeData());
+    BOOST_CHECK(StakeDataMatches(original, 5u));
+}
+
+BOOST_AUTO_TEST_CASE(willOnlyGiveProofOfStakeArenaEntriesStakeData)
+{
+    BlockMap blockIndicesByHash;
+    std::vector<CBlockIndex*> blockIndices;
+    for(unsigned seed = 1u; seed <= 20000u; ++seed)
+    {
+        CBlockIndex* blockIndex = blockIndicesByHash.GetUniqueBlockIndexForHash(uint256(seed));
+        if(seed % 2u == 0u) FillStakeData(*blockIndex, seed);
+        blockIndices.push_back(blockIndex);
+    }
+    BOOST_CHECK_EQUAL(blockIndicesByHash.arena().size(), 20000u);
+
+    const CBlockIndexStakeData* slot = &blockIndices[1]->StakeData();
+    CBlockIndex replacement;
+    FillStakeData(replacement, 42u);
+    *blockIndices[1] = replacement;
+    BOOST_CHECK(&blockIndices[1]->StakeData() == slot);
+    BOOST_CHECK(StakeDataMatches(*blockIndices[1], 42u));
+
+    for(unsigned seed = 3u; seed <= 20000u; ++seed)
+    {
+        const CBlockIndex& blockIndex = *blockIndices[seed - 1u];
+        if(seed % 2u == 0u)
+            BOOST_CHECK(StakeDataMatches(blockIndex, seed));
+        else
+            BOOST_CHECK(!blockIndex.HasStakeData());
+    }
+    blockIndicesByHash.DestroyBlockIndices();
+}
+
+BOOST_AUTO_TEST_CASE(willRoundTripStakeDataThroughTheDiskIndex)
+{
+    CBlockIndex blockIndex;
+    uint256 hash(9u);
+    blockIndex.phashBlock = &hash;
+    FillStakeData(blockIndex, 9u);
+    blockIndex.vLotteryWinnersCoinstakes =
+        LotteryCoinstakeData(9, LotteryCoinstakes(1, std::make_pair(uint256(9u), CScript())));
+
+    CDataStream stream(SER_DISK, CLIENT_VERSION);
+    const CDiskBlockIndex indexToWrite(&blockIndex);
+    BOOST_CHECK(!indexToWrite.HasStakeData());
+    BOOST_CHECK(StakeDataMatches(indexToWrite.StakeDataToWrite(), 9u));
+    stream << indexToWrite;
+    CDiskBlockIndex diskIndex;
+    stream >> diskIndex;
+    BOOST_CHECK(StakeDataMatches(diskIndex, 9u));
+    BOOST_CHECK_EQUAL(diskIndex.vLotteryWinnersCoinstakes.height(), 9);
+    BOOST_CHECK_EQUAL(diskIndex.vLotteryWinnersCoinstakes.getLotteryCoinstakes().size(), 1u);
+
+    CBlockIndex proofOfWorkIndex;
+    proofOfWorkIndex.phashBlock = &hash;
+    stream << CDiskBlockIndex(&proofOfWorkIndex);
+    CDiskBlockIndex proofOfWorkDiskIndex;
+    stream >> proofOfWorkDiskIndex;
+    BOOST_CHECK(!proofOfWorkDiskIndex.HasStakeData());
+    BOOST_CHECK(proofOfWorkDiskIndex.StakeData().prevoutStake.IsNull());
+    BOOST_CHECK(proofOfWorkDiskIndex.StakeData().hashProofOfStake == uint256());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,111 @@
+#include <test_only.h>
+#include <CachedPoSStakeModifierService.h>
+#include <chain.h>
+#include <blockmap.h>
+#include <FakeBlockIndexChain.h>
+#include <random.h>
+#include <StakingData.h>
+#include <MockPoSStakeModifierService.h>
+
+using ::testing::NiceMock;
+using ::testing::Exactly;
+using ::testing::Return;
+using ::testing::_;
+
+class CachedPoSStakeModifierServiceTestFixture
+{
+public:
+    FakeBlockIndexWithHashes fakeChain;
+    NiceMock<MockPoSStakeModifierService> decoratedStakeModifierService;
+    CachedPoSStakeModifierService cachedStakeModifierService;
+
+    CachedPoSStakeModifierServiceTestFixture(
+        ): fakeChain(10, 1600000000, 4)
+        , decoratedStakeModifierService()
+        , cachedStakeModifierService(decoratedStakeModifierService, *fakeChain.activeChain)
+    {
+    }
+
+    StakingData stakingDataAtTip() const
+    {
+        StakingData stakingData;
+        stakingData.blockHashOfChainTipBlock_ = fakeChain.activeChain->Tip()->GetBlockHash();
+        stakingData.blockHashOfFirstConfirmationBlock_ = (*fakeChain.activeChain)[1]->GetBlockHash();
+        stakingData.utxoBeingStaked_ = COutPoint(GetRandHash(), 0);
+        return stakingData;
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(CachedPoSStakeModifierService_tests,CachedPoSStakeModifierServiceTestFixture)
+
+BOOST_AUTO_TEST_CASE(willOnlyQueryDecoratedServiceOnceForTheSameTipAndConfirmationBlock)
+{
+    StakingData stakingData = stakingDataAtTip();
+    EXPECT_CALL(decoratedStakeModifierService, getStakeModifier(_))
+        .Times(Exactly(1))
+        .WillOnce(Return(std::make_pair(uint64_t(0x12345),true)));
+
+    for(unsigned lookup = 0; lookup < 3; ++lookup)
+    {
+        std::pair<uint64_t,bool> stakeModifier = cachedStakeModifierService.getStakeModifier(stakingData);
+        BOOST_CHECK(stakeModifier.second);
+        BOOST_CHECK_EQUAL(stakeModifier.first, uint64_t(0x12345));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(willShareCachedStakeModifierBetweenUtxosFromTheSameConfirmationBlock)
+{
+    StakingData firstUtxo = stakingDataAtTip();
+    StakingData secondUtxo = stakingDataAtTip();
+    EXPECT_CALL(decoratedStakeModifierService, getStakeModifier(_))
+        .Times(Exactly(1))
+        .WillOnce(Return(std::make_pair(uint64_t(0x12345),true)));
+
+    cachedStakeModifierService.getStakeModifier(firstUtxo);
+    BOOST_CHECK_EQUAL(cachedStakeModifierService.getStakeModifier(secondUtxo).first, uint64_t(0x12345));
+}
+
+BOOST_AUTO_TEST_CASE(willNotCacheFailedLookups)
+{
+    StakingData stakingData = stakingDataAtTip();
+    EXPECT_CALL(decoratedStakeModifierService, getStakeModifier(_))
+        .Times(Exactly(2))
+        .WillRepeatedly(Return(std::make_pair(uint64_t(0),false)));
+
+    BOOST_CHECK(!cachedStakeModifierService.getStakeModifier(stakingData).second);
+    BOOST_CHECK(!cachedStakeModifierService.getStakeModifier(stakingData).second);
+}
+
+BOOST_AUTO_TEST_CASE(willDropCachedStakeModifiersWhenTheActiveTipChanges)
+{
+    StakingData stakingData = stakingDataAtTip();
+    EXPECT_CALL(decoratedStakeModifierService, getStakeModifier(_))
+        .Times(Exactly(2))
+        .WillOnce(Return(std::make_pair(uint64_t(0x12345),true)))
+        .WillOnce(Return(std::make_pair(uint64_t(0x54321),true)));
+
+    BOOST_CHECK_EQUAL(cachedStakeModifierService.getStakeModifier(stakingData).first, uint64_t(0x12345));
+    fakeChain.addBlocks(1, 4);
+    BOOST_CHECK_EQUAL(cachedStakeModifierService.getStakeModifier(stakingData).first, uint64_t(0x54321));
+}
+
+BOOST_AUTO_TEST_CASE(willCountCacheHitsAndMisses)
+{
+    uint64_t hitsBefore = 0;
+    uint64_t missesBefore = 0;
+    GetStakeModifierCacheStatistics(hitsBefore, missesBefore);
+
+    StakingData stakingData = stakingDataAtTip();
+    ON_CALL(decoratedStakeModifierService, getStakeModifier(_))
+        .WillByDefault(Return(std::make_pair(uint64_t(0x12345),true)));
+    cachedStakeModifierService.getStakeModifier(stakingData);
+    cachedStakeModifierService.getStakeModifier(stakingData);
+
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    GetStakeModifierCacheStatistics(hits, misses);
+    BOOST_CHECK_EQUAL(hits - hitsBefore, 1u);
+    BOOST_CHECK_EQUAL(misses - missesBefore, 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,86 @@
+#include <CollateralHeightIndex.h>
+
+#include <primitives/block.h>
+#include <test_only.h>
+
+namespace
+{
+CTransaction CreateCollateralTransaction(unsigned nonce)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(uint256(nonce), 0);
+    tx.vout.resize(2);
+    tx.vout[0].nValue = 100000 * COIN;
+    tx.vout[1].nValue = nonce;
+    return tx;
+}
+
+CBlock CreateBlockContaining(const CTransaction& tx)
+{
+    CBlock block;
+    block.vtx.push_back(tx);
+    return block;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(CollateralHeightIndex_tests)
+
+BOOST_AUTO_TEST_CASE(willOnlyKnowRecordedCollaterals)
+{
+    CollateralHeightIndex index;
+    const COutPoint confirmed(CreateCollateralTransaction(1).GetHash(), 0);
+    const COutPoint unconfirmed(CreateCollateralTransaction(2).GetHash(), 0);
+    index.record(confirmed, 42);
+    index.record(unconfirmed, CollateralHeightIndex::UNCONFIRMED);
+
+    int confirmationHeight = 0;
+    BOOST_CHECK(index.lookup(confirmed, confirmationHeight));
+    BOOST_CHECK_EQUAL(confirmationHeight, 42);
+    BOOST_CHECK(index.lookup(unconfirmed, confirmationHeight));
+    BOOST_CHECK_EQUAL(confirmationHeight, CollateralHeightIndex::UNCONFIRMED);
+    BOOST_CHECK(!index.lookup(COutPoint(confirmed.hash, 1), confirmationHeight));
+    BOOST_CHECK_EQUAL(index.size(), 2u);
+
+    index.clear();
+    BOOST_CHECK(!index.lookup(confirmed, confirmationHeight));
+}
+
+BOOST_AUTO_TEST_CASE(willConfirmUnconfirmedCollateralsWhenTheirBlockConnects)
+{
+    CollateralHeightIndex index;
+    const CTransaction tx = CreateCollateralTransaction(1);
+    const COutPoint collateral(tx.GetHash(), 0);
+    const COutPoint otherCollateral(CreateCollateralTransaction(2).GetHash(), 0);
+    index.record(collateral, CollateralHeightIndex::UNCONFIRMED);
+    index.record(otherCollateral, CollateralHeightIndex::UNCONFIRMED);
+
+    index.blockConnected(CreateBlockContaining(tx), 100);
+
+    int confirmationHeight = 0;
+    BOOST_CHECK(index.lookup(collateral, confirmationHeight));
+    BOOST_CHECK_EQUAL(confirmationHeight, 100);
+    BOOST_CHECK(index.lookup(otherCollateral, confirmationHeight));
+    BOOST_CHECK_EQUAL(confirmationHeight, CollateralHeightIndex::UNCONFIRMED);
+}
+
+BOOST_AUTO_TEST_CASE(willUnconfirmCollateralsWhenTheirBlockDisconnects)
+{
+    CollateralHeightIndex index;
+    const CTransaction tx = CreateCollateralTransaction(1);
+    const COutPoint collateral(tx.GetHash(), 0);
+    const COutPoint otherCollateral(CreateCollateralTransaction(2).GetHash(), 0);
+    index.record(collateral, 100);
+    index.record(otherCollateral, 99);
+
+    index.blockDisconnected(CreateBlockContaining(tx));
+
+    int confirmationHeight = 0;
+    BOOST_CHECK(index.lookup(collateral, confirmationHeight));
+    BOOST_CHECK_EQUAL(confirmationHeight, CollateralHeightIndex::UNCONFIRMED);
+    BOOST_CHECK(index.lookup(otherCollateral, confirmationHeight));
+    BOOST_CHECK_EQUAL(confirmationHeight, 99);
+    BOOST_CHECK_EQUAL(index.size(), 2u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,75 @@
+#include <DeferredKeyVerifier.h>
+
+#include <key.h>
+#include <script/script.h>
+#include <script/standard.h>
+#include <keystore.h>
+
+#include <test_only.h>
+
+namespace
+{
+CKey CreateKey()
+{
+    CKey key;
+    key.MakeNewKey(true);
+    return key;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(DeferredKeyVerifier_tests)
+
+BOOST_AUTO_TEST_CASE(willOnlyVerifyWhenVerificationWasDeferred)
+{
+    CBasicKeyStore keyStore;
+    DeferredKeyVerifier verifier;
+    BOOST_CHECK_EQUAL(verifier.state(), DeferredKeyVerifier::NOTHING_DEFERRED);
+
+    verifier.verify(keyStore);
+    BOOST_CHECK_EQUAL(verifier.state(), DeferredKeyVerifier::NOTHING_DEFERRED);
+    BOOST_CHECK_EQUAL(verifier.numberOfVerifiedKeys(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(willCompleteWhenEveryKeyPairMatches)
+{
+    CBasicKeyStore keyStore;
+    DeferredKeyVerifier verifier;
+    for(unsigned keyIndex = 0; keyIndex < 3; ++keyIndex)
+    {
+        const CKey key = CreateKey();
+        BOOST_CHECK(keyStore.AddKeyPubKey(key, key.GetPubKey()));
+        verifier.deferVerification(key.GetPubKey());
+    }
+    BOOST_CHECK_EQUAL(verifier.state(), DeferredKeyVerifier::PENDING);
+
+    verifier.verify(keyStore);
+    BOOST_CHECK_EQUAL(verifier.state(), DeferredKeyVerifier::COMPLETE);
+    BOOST_CHECK_EQUAL(verifier.numberOfKeys(), 3u);
+    BOOST_CHECK_EQUAL(verifier.numberOfVerifiedKeys(), 3u);
+    BOOST_CHECK(verifier.failedKeys().empty());
+}
+
+BOOST_AUTO_TEST_CASE(willReportKeyPairsThatDoNotMatchOrAreMissing)
+{
+    CBasicKeyStore keyStore;
+    DeferredKeyVerifier verifier;
+    const CKey goodKey = CreateKey();
+    const CKey storedKey = CreateKey();
+    const CPubKey mismatchedPubKey = CreateKey().GetPubKey();
+    const CPubKey missingPubKey = CreateKey().GetPubKey();
+    BOOST_CHECK(keyStore.AddKeyPubKey(goodKey, goodKey.GetPubKey()));
+    BOOST_CHECK(keyStore.AddKeyPubKey(storedKey, mismatchedPubKey));
+    verifier.deferVerification(goodKey.GetPubKey());
+    verifier.deferVerification(mismatchedPubKey);
+    verifier.deferVerification(missingPubKey);
+
+    verifier.verify(keyStore);
+    BOOST_CHECK_EQUAL(verifier.state(), DeferredKeyVerifier::FAILED);
+    BOOST_CHECK_EQUAL(verifier.numberOfVerifiedKeys(), 3u);
+    const std::vector<CKeyID> failedKeys = verifier.failedKeys();
+    BOOST_REQUIRE_EQUAL(failedKeys.size(), 2u);
+    BOOST_CHECK(failedKeys[0] == mismatchedPubKey.GetID());
+    BOOST_CHECK(failedKeys[1] == missingPubKey.GetID());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
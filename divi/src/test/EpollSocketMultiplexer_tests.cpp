@@ -0,0 +1,157 @@
+#include <EpollSocketMultiplexer.h>
+
+#include <test_only.h>
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/socket.h>
+
+namespace
+{
+class SocketPair
+{
+public:
+    SOCKET local;
+    SOCKET remote;
+
+    SocketPair(): local(INVALID_SOCKET), remote(INVALID_SOCKET)
+    {
+        int sockets[2];
+        BOOST_REQUIRE(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sockets) == 0);
+        local = sockets[0];
+        remote = sockets[1];
+    }
+    ~SocketPair()
+    {
+        closeRemote();
+        if(local != INVALID_SOCKET) close(local);
+    }
+    void closeRemote()
+    {
+        if(remote != INVALID_SOCKET) close(remote);
+        remote = INVALID_SOCKET;
+    }
+    void sendToLocal(size_t numberOfBytes)
+    {
+        std::vector<char> data(numberOfBytes, 'x');
+        BOOST_REQUIRE(send(remote, data.data(), data.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(numberOfBytes));
+    }
+    size_t receiveAtLocal(size_t maximumNumberOfBytes)
+    {
+        std::vector<char> data(maximumNumberOfBytes);
+        const ssize_t received = recv(local, data.data(), data.size(), 0);
+        return received > 0? static_cast<size_t>(received) : 0u;
+    }
+};
+}
+
+BOOST_AUTO_TEST_SUITE(EpollSocketMultiplexer_tests)
+
+BOOST_AUTO_TEST_CASE(willReportDataPendingBeforeRegistration)
+{
+    SocketPair sockets;
+    sockets.sendToLocal(10);
+
+    EpollSocketMultiplexer multiplexer;
+    BOOST_REQUIRE(multiplexer.isValid());
+    BOOST_CHECK(multiplexer.add(sockets.local));
+    BOOST_CHECK(multiplexer.contains(sockets.local));
+    BOOST_CHECK(!multiplexer.isReadable(sockets.local));
+
+    multiplexer.wait(0);
+    BOOST_CHECK(multiplexer.isReadable(sockets.local));
+    BOOST_CHECK(multiplexer.isWritable(sockets.local));
+    BOOST_CHECK(!multiplexer.hasError(sockets.local));
+}
+
+BOOST_AUTO_TEST_CASE(willReportNewDataAfterSocketWasDrained)
+{
+    SocketPair sockets;
+    EpollSocketMultiplexer multiplexer;
+    BOOST_REQUIRE(multiplexer.add(sockets.local));
+    multiplexer.wait(0);
+    BOOST_CHECK(!multiplexer.isReadable(sockets.local));
+
+    sockets.sendToLocal(10);
+    BOOST_CHECK_EQUAL(multiplexer.wait(100), 1);
+    BOOST_CHECK(multiplexer.isReadable(sockets.local));
+
+    BOOST_CHECK_EQUAL(sockets.receiveAtLocal(10), 10u);
+    multiplexer.markServiced(sockets.local);
+    multiplexer.wait(0);
+    BOOST_CHECK(!multiplexer.isReadable(sockets.local));
+
+    sockets.sendToLocal(5);
+    multiplexer.wait(100);
+    BOOST_CHECK(multiplexer.isReadable(sockets.local));
+}
+
+BOOST_AUTO_TEST_CASE(willKeepSocketReadableAfterPartialRead)
+{
+    SocketPair sockets;
+    EpollSocketMultiplexer multiplexer;
+    BOOST_REQUIRE(multiplexer.add(sockets.local));
+    sockets.sendToLocal(100);
+    multiplexer.wait(100);
+    BOOST_CHECK(multiplexer.isReadable(sockets.local));
+
+    // No new edge is raised for the remaining bytes.
+    BOOST_CHECK_EQUAL(sockets.receiveAtLocal(40), 40u);
+    multiplexer.markServiced(sockets.local);
+    multiplexer.wait(0);
+    BOOST_CHECK(multiplexer.isReadable(sockets.local));
+
+    BOOST_CHECK_EQUAL(sockets.receiveAtLocal(100), 60u);
+    multiplexer.markServiced(sockets.local);
+    multiplexer.wait(0);
+    BOOST_CHECK(!multiplexer.isReadable(sockets.local));
+}
+
+BOOST_AUTO_TEST_CASE(willKeepReadinessUntilSocketIsServiced)
+{
+    SocketPair sockets;
+    EpollSocketMultiplexer multiplexer;
+    BOOST_REQUIRE(multiplexer.add(sockets.local));
+    sockets.sendToLocal(10);
+    multiplexer.wait(100);
+
+    BOOST_CHECK_EQUAL(multiplexer.wait(0), 0);
+    BOOST_CHECK(multiplexer.isReadable(sockets.local));
+}
+
+BOOST_AUTO_TEST_CASE(willFlagErrorWhenPeerHangsUp)
+{
+    SocketPair sockets;
+    EpollSocketMultiplexer multiplexer;
+    BOOST_REQUIRE(multiplexer.add(sockets.local));
+    multiplexer.wait(0);
+    BOOST_CHECK(!multiplexer.hasError(sockets.local));
+
+    sockets.closeRemote();
+    multiplexer.wait(100);
+    BOOST_CHECK(multiplexer.hasError(sockets.local));
+    BOOST_CHECK(multiplexer.isReadable(sockets.local));
+}
+
+BOOST_AUTO_TEST_CASE(willForgetRemovedSockets)
+{
+    SocketPair sockets;
+    EpollSocketMultiplexer multiplexer;
+    BOOST_REQUIRE(multiplexer.add(sockets.local));
+    BOOST_CHECK(!multiplexer.add(sockets.local));
+    BOOST_CHECK_EQUAL(multiplexer.size(), 1u);
+
+    multiplexer.remove(sockets.local);
+    BOOST_CHECK(!multiplexer.contains(sockets.local));
+    BOOST_CHECK_EQUAL(multiplexer.size(), 0u);
+
+    sockets.sendToLocal(10);
+    BOOST_CHECK_EQUAL(multiplexer.wait(0), 0);
+    BOOST_CHECK(!multiplexer.isReadable(sockets.local));
+
+    BOOST_CHECK(multiplexer.add(sockets.local));
+    multiplexer.wait(0);
+    BOOST_CHECK(multiplexer.isReadable(sockets.local));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+#endif// HAVE_SYS_EPOLL_H
@@ -0,0 +1,201 @@
+// Copyright (c) 2021 The Divi developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "wallet.h"
+#include <defaultValues.h>
+#include <sync.h>
+#include <utiltime.h>
+
+#include <atomic>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+#include <test/FakeBlockIndexChain.h>
+#include <test/FakeWallet.h>
+
+namespace
+{
+
+class KeyPoolTopUpTestFixture
+{
+
+protected:
+
+  FakeBlockIndexWithHashes fakeChain;
+  FakeWallet fakeWallet;
+  CWallet& wallet;
+
+  KeyPoolTopUpTestFixture()
+    : fakeChain(1, 1600000000, 1)
+    , fakeWallet(fakeChain)
+    , wallet(static_cast<CWallet&>(fakeWallet))
+  {}
+
+  /** Reads the extended public key of the wallet's external chain and
+   *  the index of the next key to hand out from it.  */
+  static void GetExternalChain(CWallet& w, uint256& hdChainId, CExtPubKey& chainKey, uint32_t& nextChildIndex)
+  {
+    LOCK(w.cs_wallet);
+    BOOST_REQUIRE(w.GetHDChainExtPubKey(0, false, hdChainId, chainKey, nextChildIndex));
+  }
+
+  /** Derives the given number of keys of the chain, starting at firstChildIndex.  */
+  static std::vector<CExtPubKey> DeriveKeys(const CExtPubKey& chainKey, uint32_t firstChildIndex, unsigned numberOfKeys)
+  {
+    std::vector<CExtPubKey> keys(numberOfKeys);
+    for (unsigned i = 0; i < numberOfKeys; ++i)
+      BOOST_REQUIRE(chainKey.Derive(keys[i], firstChildIndex + i));
+    return keys;
+  }
+
+  static std::set<CKeyID> KeyPoolKeys(const CWallet& w)
+  {
+    std::set<CKeyID> keyIds;
+    w.GetAllReserveKeys(keyIds);
+    return keyIds;
+  }
+
+};
+
+} // anonymous namespace
+
+BOOST_FIXTURE_TEST_SUITE(KeyPoolTopUp_tests, KeyPoolTopUpTestFixture)
+
+BOOST_AUTO_TEST_CASE(willCommitKeysPoolEntriesAndChainCounterTogether)
+{
+  std::string filename;
+  std::vector<CExtPubKey> keys;
+  uint32_t nextChildIndex;
+  {
+    FakeWallet otherFakeWallet(fakeChain);
+    CWallet& otherWallet = otherFakeWallet;
+    filename = otherWallet.dbFilename();
+
+    uint256 hdChainId;
+    CExtPubKey chainKey;
+    GetExternalChain(otherWallet, hdChainId, chainKey, nextChildIndex);
+    keys = DeriveKeys(chainKey, nextChildIndex, 5);
+
+    const unsigned poolSize = otherWallet.GetKeyPoolSize();
+    BOOST_CHECK_EQUAL(otherWallet.AddHDKeysToKeyPool(hdChainId, 0, false, keys, 10), 5u);
+    BOOST_CHECK_EQUAL(otherWallet.GetKeyPoolSize(), poolSize + 5u);
+  }
+
+  FakeWallet reloadedFakeWallet(fakeChain, filename);
+  CWallet& reloadedWallet = reloadedFakeWallet;
+  const std::set<CKeyID> keyPoolKeys = KeyPoolKeys(reloadedWallet);
+  for (const CExtPubKey& key : keys)
+  {
+    BOOST_CHECK(reloadedWallet.HaveKey(key.pubkey.GetID()));
+    BOOST_CHECK(keyPoolKeys.count(key.pubkey.GetID()) > 0u);
+  }
+
+  uint256 hdChainId;
+  CExtPubKey chainKey;
+  uint32_t reloadedNextChildIndex;
+  GetExternalChain(reloadedWallet, hdChainId, chainKey, reloadedNextChildIndex);
+  BOOST_CHECK_EQUAL(reloadedNextChildIndex, nextChildIndex + 5u);
+}
+
+BOOST_AUTO_TEST_CASE(willNotAddKeysDerivedForAReplacedChain)
+{
+  uint256 hdChainId;
+  CExtPubKey chainKey;
+  uint32_t nextChildIndex;
+  GetExternalChain(wallet, hdChainId, chainKey, nextChildIndex);
+  const std::vector<CExtPubKey> keys = DeriveKeys(chainKey, nextChildIndex, 5);
+
+  const unsigned poolSize = wallet.GetKeyPoolSize();
+  BOOST_CHECK_EQUAL(wallet.AddHDKeysToKeyPool(uint256(1), 0, false, keys, 10), 0u);
+  BOOST_CHECK_EQUAL(wallet.GetKeyPoolSize(), poolSize);
+
+  uint32_t unchangedNextChildIndex;
+  GetExternalChain(wallet, hdChainId, chainKey, unchangedNextChildIndex);
+  BOOST_CHECK_EQUAL(unchangedNextChildIndex, nextChildIndex);
+}
+
+BOOST_AUTO_TEST_CASE(willSkipKeysBelowTheChainCounter)
+{
+  uint256 hdChainId;
+  CExtPubKey chainKey;
+  uint32_t nextChildIndex;
+  GetExternalChain(wallet, hdChainId, chainKey, nextChildIndex);
+  const std::vector<CExtPubKey> keys = DeriveKeys(chainKey, nextChildIndex, 5);
+
+  // A key handed out while the batch was derived takes the first index
+  CPubKey generatedKey;
+  {
+    LOCK(wallet.cs_wallet);
+    generatedKey = wallet.GenerateNewKey(0, false);
+  }
+  BOOST_CHECK(generatedKey == keys[0].pubkey);
+
+  const unsigned poolSize = wallet.GetKeyPoolSize();
+  BOOST_CHECK_EQUAL(wallet.AddHDKeysToKeyPool(hdChainId, 0, false, keys, 10), 4u);
+  BOOST_CHECK_EQUAL(wallet.GetKeyPoolSize(), poolSize + 4u);
+
+  const std::set<CKeyID> keyPoolKeys = KeyPoolKeys(wallet);
+  BOOST_CHECK(keyPoolKeys.count(keys[0].pubkey.GetID()) == 0u);
+  for (unsigned i = 1; i < keys.size(); ++i)
+    BOOST_CHECK(keyPoolKeys.count(keys[i].pubkey.GetID()) > 0u);
+
+  // Every key is below the counter now
+  BOOST_CHECK_EQUAL(wallet.AddHDKeysToKeyPool(hdChainId, 0, false, keys, 10), 0u);
+  BOOST_CHECK_EQUAL(wallet.GetKeyPoolSize(), poolSize + 4u);
+}
+
+BOOST_AUTO_TEST_CASE(willHandOutKeysWhileATopUpIsRunning)
+{
+  const unsigned targetSize = 3 * KEYPOOL_TOPUP_BATCH_SIZE;
+  const unsigned initialPoolSize = wallet.GetKeyPoolSize();
+  std::atomic<bool> topUpSucceeded(false);
+  std::atomic<bool> topUpFinished(false);
+  boost::thread topUpThread([&]()
+  {
+    topUpSucceeded = wallet.TopUpKeyPool(targetSize, true);
+    topUpFinished = true;
+  });
+
+  // Wait for the first batch to be added
+  while (wallet.GetKeyPoolSize() <= initialPoolSize && !topUpFinished)
+    MilliSleep(1);
+
+  CPubKey key;
+  {
+    // The top-up cannot add another batch while this is held
+    LOCK(wallet.cs_wallet);
+    const unsigned poolSize = wallet.GetKeyPoolSize();
+    BOOST_CHECK(poolSize < 2 * targetSize);
+    BOOST_CHECK(wallet.GetKeyFromPool(key, false));
+    BOOST_CHECK_EQUAL(wallet.GetKeyPoolSize(), poolSize - 1u);
+  }
+  topUpThread.join();
+
+  BOOST_CHECK(topUpSucceeded);
+  BOOST_CHECK(KeyPoolKeys(wallet).count(key.GetID()) == 0u);
+  BOOST_CHECK(wallet.GetKeyPoolSize() >= 2 * targetSize - 1u);
+}
+
+BOOST_AUTO_TEST_CASE(willWaitForARunningTopUpWhenAsked)
+{
+  const unsigned targetSize = 2 * KEYPOOL_TOPUP_BATCH_SIZE;
+  std::atomic<unsigned> numberOfFilledPools(0);
+  auto refill = [&]()
+  {
+    if (wallet.TopUpKeyPool(targetSize, true) && wallet.GetKeyPoolSize() >= targetSize)
+      ++numberOfFilledPools;
+  };
+  boost::thread firstRefill(refill);
+  boost::thread secondRefill(refill);
+  firstRefill.join();
+  secondRefill.join();
+
+  BOOST_CHECK_EQUAL(numberOfFilledPools.load(), 2u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
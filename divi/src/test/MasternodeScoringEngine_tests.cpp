@@ -0,0 +1,94 @@
+#include <MasternodeScoringEngine.h>
+
+#include <hash.h>
+#include <masternode.h>
+#include <random.h>
+#include <version.h>
+#include <test_only.h>
+
+namespace
+{
+std::vector<MasternodeScoringEngine::Candidate> CreateCandidates(unsigned numberOfCandidates)
+{
+    std::vector<MasternodeScoringEngine::Candidate> candidates;
+    for(unsigned index = 0; index < numberOfCandidates; ++index)
+    {
+        const MasternodeTier tier = static_cast<MasternodeTier>(index % static_cast<unsigned>(MasternodeTier::INVALID));
+        candidates.emplace_back(COutPoint(GetRandHash(), index % 3), tier);
+    }
+    return candidates;
+}
+
+uint256 ComputeScoreDirectly(const uint256& scoringBlockHash, const MasternodeScoringEngine::Candidate& candidate)
+{
+    CMasternode masternode;
+    masternode.vin = CTxIn(candidate.first);
+    masternode.nTier = candidate.second;
+    return masternode.CalculateScore(scoringBlockHash);
+}
+}
+
+BOOST_AUTO_TEST_SUITE(MasternodeScoringEngine_tests)
+
+BOOST_AUTO_TEST_CASE(willScoreCandidatesLikeTheMasternodeItself)
+{
+    const uint256 scoringBlockHash = GetRandHash();
+    const std::vector<MasternodeScoringEngine::Candidate> candidates = CreateCandidates(300u);
+
+    // Enough candidates to be spread across the pool, and the single-threaded path
+    for(unsigned numberOfThreads: {4u, 1u})
+    {
+        MasternodeScoringEngine engine(4u, numberOfThreads);
+        const MasternodeScoringEngine::ScoreTablePtr scores = engine.getScores(scoringBlockHash, candidates);
+        BOOST_REQUIRE_EQUAL(scores->size(), candidates.size());
+        for(const MasternodeScoringEngine::Candidate& candidate: candidates)
+        {
+            BOOST_CHECK(scores->scoreOf(candidate.first) == ComputeScoreDirectly(scoringBlockHash, candidate));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(willOnlyScoreNewCandidatesForAKnownScoringHash)
+{
+    MasternodeScoringEngine engine(4u, 1u);
+    const uint256 scoringBlockHash = GetRandHash();
+    std::vector<MasternodeScoringEngine::Candidate> candidates = CreateCandidates(10u);
+
+    const MasternodeScoringEngine::ScoreTablePtr firstScores = engine.getScores(scoringBlockHash, candidates);
+    BOOST_CHECK(engine.getScores(scoringBlockHash, candidates) == firstScores);
+
+    const std::vector<MasternodeScoringEngine::Candidate> newCandidates = CreateCandidates(5u);
+    candidates.insert(candidates.end(), newCandidates.begin(), newCandidates.end());
+    const MasternodeScoringEngine::ScoreTablePtr extendedScores = engine.getScores(scoringBlockHash, candidates);
+    BOOST_CHECK_EQUAL(firstScores->size(), 10u);
+    BOOST_CHECK_EQUAL(extendedScores->size(), 15u);
+    for(const MasternodeScoringEngine::Candidate& candidate: candidates)
+    {
+        BOOST_CHECK(extendedScores->contains(candidate.first));
+    }
+    BOOST_CHECK_EQUAL(engine.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(willEvictLeastRecentlyUsedScoreTables)
+{
+    MasternodeScoringEngine engine(2u, 1u);
+    const std::vector<MasternodeScoringEngine::Candidate> candidates = CreateCandidates(3u);
+    const uint256 firstHash = GetRandHash();
+    const uint256 secondHash = GetRandHash();
+    const uint256 thirdHash = GetRandHash();
+
+    const MasternodeScoringEngine::ScoreTablePtr firstScores = engine.getScores(firstHash, candidates);
+    engine.getScores(secondHash, candidates);
+    BOOST_CHECK(engine.getScores(firstHash, candidates) == firstScores);
+    engine.getScores(thirdHash, candidates);
+    BOOST_CHECK_EQUAL(engine.size(), 2u);
+
+    // The second table was least recently used and has to be recomputed, the first one not:
+    BOOST_CHECK(engine.getScores(firstHash, candidates) == firstScores);
+
+    engine.clear();
+    BOOST_CHECK_EQUAL(engine.size(), 0u);
+    BOOST_CHECK(engine.getScores(firstHash, candidates) != firstScores);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,72 @@
+#include <MessageLatencyHistograms.h>
+
+#include <test_only.h>
+
+#include <sstream>
+
+BOOST_AUTO_TEST_SUITE(MessageLatencyHistograms_tests)
+
+BOOST_AUTO_TEST_CASE(willPlaceLatenciesInPowerOfTwoBuckets)
+{
+    BOOST_CHECK_EQUAL(LatencyHistogram::bucketIndex(0), 0u);
+    BOOST_CHECK_EQUAL(LatencyHistogram::bucketIndex(1), 1u);
+    BOOST_CHECK_EQUAL(LatencyHistogram::bucketIndex(3), 2u);
+    BOOST_CHECK_EQUAL(LatencyHistogram::bucketIndex(4), 3u);
+    BOOST_CHECK_EQUAL(LatencyHistogram::bucketIndex(1000), 10u);
+    BOOST_CHECK_EQUAL(LatencyHistogram::bucketIndex(int64_t(1) << 40), LatencyHistogram::NUMBER_OF_BUCKETS - 1);
+    BOOST_CHECK_EQUAL(LatencyHistogram::bucketUpperBoundMicros(10), 1024);
+}
+
+BOOST_AUTO_TEST_CASE(willSummarizeRecordedLatencies)
+{
+    LatencyHistogram histogram;
+    for(int64_t micros = 1; micros <= 100; ++micros)
+    {
+        histogram.record(micros);
+    }
+    histogram.record(-5);
+
+    BOOST_CHECK_EQUAL(histogram.numberOfSamples, 101u);
+    BOOST_CHECK_EQUAL(histogram.totalMicros, 5050);
+    BOOST_CHECK_EQUAL(histogram.maximumMicros, 100);
+    BOOST_CHECK_EQUAL(histogram.counts[0], 1u);
+    BOOST_CHECK_EQUAL(histogram.percentileMicros(0.5), 64);
+    BOOST_CHECK_EQUAL(histogram.percentileMicros(0.99), 100);
+}
+
+BOOST_AUTO_TEST_CASE(willTrackEachMessageTypeSeparately)
+{
+    MessageLatencyHistograms histograms;
+    histograms.record("ping", 10, 1);
+    histograms.record("ping", 20, 2);
+    histograms.record("block", 1000, 50000);
+
+    const auto snapshot = histograms.snapshot();
+    BOOST_CHECK_EQUAL(snapshot.size(), 2u);
+    BOOST_CHECK_EQUAL(snapshot.at("ping").queued.numberOfSamples, 2u);
+    BOOST_CHECK_EQUAL(snapshot.at("ping").queued.totalMicros, 30);
+    BOOST_CHECK_EQUAL(snapshot.at("ping").processing.maximumMicros, 2);
+    BOOST_CHECK_EQUAL(snapshot.at("block").processing.maximumMicros, 50000);
+
+    histograms.clear();
+    BOOST_CHECK(histograms.snapshot().empty());
+}
+
+BOOST_AUTO_TEST_CASE(willBoundTheNumberOfTrackedMessageTypes)
+{
+    MessageLatencyHistograms histograms;
+    for(unsigned command = 0; command < 2 * MessageLatencyHistograms::MAXIMUM_NUMBER_OF_COMMANDS; ++command)
+    {
+        std::ostringstream commandName;
+        commandName << "junk" << command;
+        histograms.record(commandName.str(), 1, 1);
+    }
+
+    const auto snapshot = histograms.snapshot();
+    BOOST_CHECK_EQUAL(snapshot.size(), MessageLatencyHistograms::MAXIMUM_NUMBER_OF_COMMANDS + 1u);
+    BOOST_CHECK_EQUAL(
+        snapshot.at(MessageLatencyHistograms::OTHER_COMMANDS).processing.numberOfSamples,
+        MessageLatencyHistograms::MAXIMUM_NUMBER_OF_COMMANDS);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
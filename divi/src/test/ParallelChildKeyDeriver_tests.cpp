@@ -0,0 +1,51 @@
+#include <ParallelChildKeyDeriver.h>
+
+#include <key.h>
+
+#include <test_only.h>
+
+namespace
+{
+CExtKey CreateChainKey()
+{
+    const std::vector<unsigned char> seed(32, 0x2a);
+    CExtKey masterKey;
+    masterKey.SetMaster(&seed[0], seed.size());
+    CExtKey chainKey;
+    BOOST_REQUIRE(masterKey.Derive(chainKey, 1));
+    return chainKey;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(ParallelChildKeyDeriver_tests)
+
+BOOST_AUTO_TEST_CASE(willDeriveTheSameKeysAsPrivateDerivationInIndexOrder)
+{
+    const CExtKey chainKey = CreateChainKey();
+    ParallelChildKeyDeriver deriver(4u);
+
+    const std::vector<CExtPubKey> children = deriver.derive(chainKey.Neuter(), 7u, 300u);
+    BOOST_REQUIRE_EQUAL(children.size(), 300u);
+    for(unsigned childOffset = 0; childOffset < children.size(); ++childOffset)
+    {
+        CExtKey child;
+        BOOST_REQUIRE(chainKey.Derive(child, 7u + childOffset));
+        BOOST_CHECK(children[childOffset] == child.Neuter());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(willDeriveOnTheCallingThreadAloneAndAcrossCalls)
+{
+    const CExtKey chainKey = CreateChainKey();
+    ParallelChildKeyDeriver deriver(1u);
+
+    const std::vector<CExtPubKey> firstChildren = deriver.derive(chainKey.Neuter(), 0u, 5u);
+    const std::vector<CExtPubKey> nextChildren = deriver.derive(chainKey.Neuter(), 5u, 5u);
+    BOOST_REQUIRE_EQUAL(firstChildren.size(), 5u);
+    BOOST_REQUIRE_EQUAL(nextChildren.size(), 5u);
+    BOOST_CHECK_EQUAL(firstChildren[4].nChild, 4u);
+    BOOST_CHECK_EQUAL(nextChildren[0].nChild, 5u);
+    BOOST_CHECK(deriver.derive(chainKey.Neuter(), 10u, 0u).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
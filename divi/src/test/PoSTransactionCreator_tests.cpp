@@ -9,7 +9,11 @@
 #include "ProofOfStakeModule.h"
 #include "script/standard.h"
 #include "Settings.h"
+#include "StakableCoin.h"
+#include "uint256.h"
+#include "wallet.h"
 #include "WalletTx.h"
+#include "utiltime.h"
 
 #include "test/FakeBlockIndexChain.h"
 #include "test/FakeWallet.h"
@@ -22,6 +26,7 @@
 #include <gmock/gmock.h>
 
 #include <map>
+#include <set>
 
 extern Settings& settings;
 
@@ -100,6 +105,41 @@ protected:
     return CreatePoS(mtx, txTime);
   }
 
+  /** Calls CreateProofOfStake on a fresh PoSTransactionCreator that searches
+   *  for kernels with the given number of staking threads and difficulty.  */
+  bool CreatePoSWithStakingThreads(unsigned stakingThreads, uint32_t blockBits, CMutableTransaction& txCoinStake, unsigned& nTxNewTime)
+  {
+    settings.SetParameter("-stakingthreads", std::to_string(stakingThreads));
+    PoSTransactionCreator threadedTxCreator(
+        settings, chainParams, *fakeChain.activeChain, *fakeChain.blockIndexByHash,
+        blockSubsidyProvider, blockIncentivesPopulator,
+        posModule.proofOfStakeGenerator(), wallet, hashedBlockTimestamps);
+    settings.ForceRemoveArg("-stakingthreads");
+    return threadedTxCreator.CreateProofOfStake(fakeChain.activeChain->Tip(), blockBits, txCoinStake, nTxNewTime);
+  }
+
+  /** Finds the hardest difficulty at which a serial search finds a kernel
+   *  for some coin other than the first in staking order, so that only some
+   *  of the wallet's coins meet the target.  */
+  bool FindSelectiveDifficulty(uint32_t& blockBits)
+  {
+    std::set<StakableCoin> stakableCoins;
+    static_cast<CWallet&>(wallet).SelectStakeCoins(stakableCoins);
+    if (stakableCoins.size() < 2u)
+      return false;
+
+    for (unsigned shift = 255; shift > 0; --shift)
+    {
+      blockBits = uint256(~uint256(0) >> shift).GetCompact();
+      CMutableTransaction coinstake;
+      unsigned time = 0;
+      if (CreatePoSWithStakingThreads(1, blockBits, coinstake, time) &&
+          !coinstake.vin.empty() && coinstake.vin[0].prevout != stakableCoins.begin()->utxo)
+        return true;
+    }
+    return false;
+  }
+
 };
 
 BOOST_FIXTURE_TEST_SUITE(PoSTransactionCreator_tests, PoSTransactionCreatorTestFixture)
@@ -120,6 +160,54 @@ BOOST_AUTO_TEST_CASE(checksForConfirmationsAndAge)
   BOOST_CHECK(CreatePoS());
 }
 
+BOOST_AUTO_TEST_CASE(parallelKernelSearchPicksSameCoinAsSerialSearch)
+{
+  for (unsigned i = 0; i < 24; ++i)
+  {
+    const auto& tx = wallet.AddDefaultTx(walletScript, outputIndex, (100 + i) * COIN);
+    wallet.FakeAddToChain(tx);
+  }
+  wallet.AddConfirmations(20, 1000);
+  SetMockTime(GetTime());
+
+  uint32_t blockBits = 0;
+  BOOST_REQUIRE(FindSelectiveDifficulty(blockBits));
+
+  CMutableTransaction serialCoinstake;
+  unsigned serialTime = 0;
+  BOOST_CHECK(CreatePoSWithStakingThreads(1, blockBits, serialCoinstake, serialTime));
+
+  for (unsigned stakingThreads : {2u, 4u, 8u})
+  {
+    CMutableTransaction parallelCoinstake;
+    unsigned parallelTime = 0;
+    BOOST_CHECK(CreatePoSWithStakingThreads(stakingThreads, blockBits, parallelCoinstake, parallelTime));
+
+    BOOST_REQUIRE(!serialCoinstake.vin.empty() && !parallelCoinstake.vin.empty());
+    BOOST_CHECK(serialCoinstake.vin[0].prevout == parallelCoinstake.vin[0].prevout);
+    BOOST_CHECK_EQUAL(serialTime, parallelTime);
+  }
+  SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_CASE(parallelKernelSearchFailsWhenNoCoinMeetsTheTarget)
+{
+  for (unsigned i = 0; i < 8; ++i)
+  {
+    const auto& tx = wallet.AddDefaultTx(walletScript, outputIndex, (100 + i) * COIN);
+    wallet.FakeAddToChain(tx);
+  }
+  wallet.AddConfirmations(20, 1000);
+  SetMockTime(GetTime());
+
+  const uint32_t impossibleBits = uint256(1).GetCompact();
+  CMutableTransaction coinstake;
+  unsigned time = 0;
+  BOOST_CHECK(!CreatePoSWithStakingThreads(1, impossibleBits, coinstake, time));
+  BOOST_CHECK(!CreatePoSWithStakingThreads(4, impossibleBits, coinstake, time));
+  SetMockTime(0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } // anonymous namespace
@@ -13,7 +13,11 @@
 #include <ProofOfStakeGenerator.h>
 #include <I_ProofOfStakeCalculator.h>
 #include <MockPoSStakeModifierService.h>
+#include <StakeKernelHasher.h>
+#include <streams.h>
+#include <hash.h>
 #include <sstream>
+#include <limits>
 
 #include <gmock/gmock.h>
 
@@ -90,6 +94,23 @@ BOOST_AUTO_TEST_CASE(willRecoverCorrectTimestampIfSuccessAndRecoverZeroOtherwise
     BOOST_CHECK(HashproofCreationResult::FailedGeneration().timestamp() == 0u);
 }
 
+BOOST_AUTO_TEST_CASE(kernelHasherMatchesFullySerializedKernelHash)
+{
+    for(unsigned trial = 0; trial < 16; ++trial)
+    {
+        uint64_t stakeModifier = GetRand(std::numeric_limits<uint64_t>::max());
+        unsigned coinstakeStartTime = GetRandInt(1<<30);
+        COutPoint utxo(GetRandHash(),GetRandInt(100));
+        StakeKernelHasher hasher(stakeModifier, coinstakeStartTime, utxo);
+        for(unsigned hashproofTimestamp = coinstakeStartTime; hashproofTimestamp < coinstakeStartTime + 8; ++hashproofTimestamp)
+        {
+            CDataStream ss(SER_GETHASH, 0);
+            ss << stakeModifier << coinstakeStartTime << utxo.n << utxo.hash << hashproofTimestamp;
+            BOOST_CHECK(hasher.computeHash(hashproofTimestamp) == Hash(ss.begin(), ss.end()));
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(willEnsureBackwardCompatibilityWithMainnetHashproofs)
 {
     struct PoSTestCase
@@ -0,0 +1,136 @@
+#include <Node.h>
+
+#include <test_only.h>
+
+#include <algorithm>
+#include <limits>
+#include <string.h>
+
+namespace
+{
+/** Accepts a limited number of bytes per call, like a socket whose send buffer fills up. */
+class FakeCommunicationChannel final: public I_CommunicationChannel
+{
+public:
+    mutable std::vector<char> sentData;
+    mutable unsigned numberOfSendCalls;
+    size_t maximumBytesPerCall;
+
+    FakeCommunicationChannel(
+        ): sentData()
+        , numberOfSendCalls(0u)
+        , maximumBytesPerCall(std::numeric_limits<size_t>::max())
+    {
+    }
+
+    virtual int sendData(const void* buffer, size_t len) const
+    {
+        ConstDataBuffer singleBuffer = {buffer, len};
+        return sendData(&singleBuffer, 1u);
+    }
+    virtual int sendData(const ConstDataBuffer* buffers, size_t numberOfBuffers) const
+    {
+        ++numberOfSendCalls;
+        if(maximumBytesPerCall == 0u) return -1;
+        size_t bytesSent = 0u;
+        for(size_t index = 0u; index < numberOfBuffers && bytesSent < maximumBytesPerCall; ++index)
+        {
+            const char* data = static_cast<const char*>(buffers[index].data);
+            const size_t bytesToSend = std::min(buffers[index].len, maximumBytesPerCall - bytesSent);
+            sentData.insert(sentData.end(), data, data + bytesToSend);
+            bytesSent += bytesToSend;
+        }
+        return static_cast<int>(bytesSent);
+    }
+    virtual int receiveData(void* buffer, size_t len) const { return 0; }
+    virtual void close() {}
+    virtual bool isValid() const { return true; }
+    virtual bool hasErrors(bool logErrors) const { return false; }
+};
+
+class QueuedMessageConnectionTestFixture
+{
+public:
+    bool fSuccessfullyConnected;
+    CommunicationLogger dataLogger;
+    FakeCommunicationChannel channel;
+    QueuedMessageConnection connection;
+
+    QueuedMessageConnectionTestFixture(
+        ): fSuccessfullyConnected(false)
+        , dataLogger()
+        , channel()
+        , connection(channel,fSuccessfullyConnected,dataLogger)
+    {
+    }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(QueuedMessageConnection_tests, QueuedMessageConnectionTestFixture)
+
+BOOST_AUTO_TEST_CASE(willSendSharedMessagesIdenticalToDirectlyPushedOnes)
+{
+    const std::vector<int> payload = {1, 2, 3, 5, 8};
+    unsigned messageDataSize = 0u;
+    connection.PushMessageAndRecordDataSize(messageDataSize, "ping", payload);
+    const std::vector<char> directlyPushed = channel.sentData;
+    channel.sentData.clear();
+
+    const SharedNetworkMessage message = NetworkMessageSerializer::SerializeMessage(INIT_PROTO_VERSION, "ping", payload);
+    connection.PushSerializedMessage(message);
+
+    BOOST_CHECK(!directlyPushed.empty());
+    BOOST_CHECK(channel.sentData == directlyPushed);
+    BOOST_CHECK(*message == directlyPushed);
+    BOOST_CHECK_EQUAL(messageDataSize, message->size() - CMessageHeader::HEADER_SIZE);
+    BOOST_CHECK_EQUAL(NetworkMessageSerializer::GetCommand(*message), "ping");
+}
+
+BOOST_AUTO_TEST_CASE(willShareOneBufferAcrossConnections)
+{
+    FakeCommunicationChannel otherChannel;
+    QueuedMessageConnection otherConnection(otherChannel,fSuccessfullyConnected,dataLogger);
+    channel.maximumBytesPerCall = 0u;
+    otherChannel.maximumBytesPerCall = 0u;
+
+    const SharedNetworkMessage message = NetworkMessageSerializer::SerializeMessage(INIT_PROTO_VERSION, "tx", std::string(1000, 'x'));
+    connection.PushSerializedMessage(message);
+    otherConnection.PushSerializedMessage(message);
+    BOOST_CHECK_EQUAL(message.use_count(), 3);
+
+    channel.maximumBytesPerCall = std::numeric_limits<size_t>::max();
+    otherChannel.maximumBytesPerCall = std::numeric_limits<size_t>::max();
+    BOOST_CHECK_EQUAL(connection.SelectCommunicationMode(), CommsMode::SEND);
+    BOOST_CHECK_EQUAL(otherConnection.SelectCommunicationMode(), CommsMode::SEND);
+    connection.TrySendData();
+    otherConnection.TrySendData();
+    BOOST_CHECK(channel.sentData == *message);
+    BOOST_CHECK(otherChannel.sentData == *message);
+    BOOST_CHECK_EQUAL(message.use_count(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(willGatherQueuedMessagesAcrossPartialSends)
+{
+    channel.maximumBytesPerCall = 0u;
+    std::vector<char> expectedData;
+    for(unsigned messageIndex = 0u; messageIndex < 100u; ++messageIndex)
+    {
+        const SharedNetworkMessage message =
+            NetworkMessageSerializer::SerializeMessage(INIT_PROTO_VERSION, "inv", std::string(messageIndex, 'a' + messageIndex % 26));
+        connection.PushSerializedMessage(message);
+        expectedData.insert(expectedData.end(), message->begin(), message->end());
+    }
+    BOOST_CHECK(channel.sentData.empty());
+
+    channel.maximumBytesPerCall = 77u;
+    channel.numberOfSendCalls = 0u;
+    while(connection.SelectCommunicationMode() == CommsMode::SEND && channel.numberOfSendCalls < expectedData.size())
+    {
+        connection.TrySendData();
+    }
+    BOOST_CHECK(connection.SelectCommunicationMode() != CommsMode::SEND);
+    BOOST_CHECK(channel.sentData == expectedData);
+    BOOST_CHECK_EQUAL(channel.numberOfSendCalls, (expectedData.size() + 76u) / 77u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,64 @@
+#include <RescanTransactionFilter.h>
+
+#include <key.h>
+#include <primitives/transaction.h>
+#include <script/standard.h>
+#include <test_only.h>
+
+namespace
+{
+CPubKey CreatePubKey(bool compressed = true)
+{
+    CKey key;
+    key.MakeNewKey(compressed);
+    return key.GetPubKey();
+}
+}
+
+BOOST_AUTO_TEST_SUITE(RescanTransactionFilter_tests)
+
+BOOST_AUTO_TEST_CASE(willMatchPayToKeyHashAndPayToPubKeyScriptsOfKnownKeys)
+{
+    RescanTransactionFilter filter;
+    const CPubKey knownPubKey = CreatePubKey();
+    const CPubKey knownUncompressedPubKey = CreatePubKey(false);
+    filter.addKeyOrScriptHash(knownPubKey.GetID());
+    filter.addKeyOrScriptHash(knownUncompressedPubKey.GetID());
+
+    BOOST_CHECK(filter.scriptMayBeRelevant(GetScriptForDestination(knownPubKey.GetID())));
+    BOOST_CHECK(filter.scriptMayBeRelevant(CScript() << ToByteVector(knownPubKey) << OP_CHECKSIG));
+    BOOST_CHECK(filter.scriptMayBeRelevant(CScript() << ToByteVector(knownUncompressedPubKey) << OP_CHECKSIG));
+
+    const CPubKey unknownPubKey = CreatePubKey();
+    BOOST_CHECK(!filter.scriptMayBeRelevant(GetScriptForDestination(unknownPubKey.GetID())));
+    BOOST_CHECK(!filter.scriptMayBeRelevant(CScript() << ToByteVector(unknownPubKey) << OP_CHECKSIG));
+}
+
+BOOST_AUTO_TEST_CASE(willMatchPayToScriptHashAndMultisigScriptsInvolvingKnownData)
+{
+    RescanTransactionFilter filter;
+    const CPubKey knownPubKey = CreatePubKey();
+    filter.addKeyOrScriptHash(knownPubKey.GetID());
+    const CScript redeemScript = GetScriptForMultisig(1, std::vector<CPubKey>({CreatePubKey(), CreatePubKey()}));
+    filter.addKeyOrScriptHash(CScriptID(redeemScript));
+
+    BOOST_CHECK(filter.scriptMayBeRelevant(GetScriptForDestination(CScriptID(redeemScript))));
+    BOOST_CHECK(filter.scriptMayBeRelevant(GetScriptForMultisig(2, std::vector<CPubKey>({CreatePubKey(), knownPubKey}))));
+    BOOST_CHECK(!filter.scriptMayBeRelevant(GetScriptForMultisig(2, std::vector<CPubKey>({CreatePubKey(), CreatePubKey()}))));
+}
+
+BOOST_AUTO_TEST_CASE(willMatchKnownScriptsExactly)
+{
+    RescanTransactionFilter filter;
+    const CScript watchedScript = GetScriptForDestination(CreatePubKey().GetID());
+    filter.addScript(watchedScript);
+
+    CMutableTransaction tx;
+    tx.vout.resize(2);
+    tx.vout[0].scriptPubKey = GetScriptForDestination(CreatePubKey().GetID());
+    BOOST_CHECK(!filter.outputsMayBeRelevant(tx));
+    tx.vout[1].scriptPubKey = watchedScript;
+    BOOST_CHECK(filter.outputsMayBeRelevant(tx));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,76 @@
+#include <SerializedBlockCache.h>
+
+#include <test_only.h>
+
+namespace
+{
+SharedNetworkMessage CreateMessageOfSize(size_t numberOfBytes)
+{
+    return std::make_shared<const NetworkMessageBuffer>(numberOfBytes, 'x');
+}
+}
+
+BOOST_AUTO_TEST_SUITE(SerializedBlockCache_tests)
+
+BOOST_AUTO_TEST_CASE(willCountHitsAndMisses)
+{
+    SerializedBlockCache cache(1000u);
+    const SharedNetworkMessage message = CreateMessageOfSize(100u);
+    BOOST_CHECK(!cache.get(uint256(1)));
+    cache.insert(uint256(1), message);
+    BOOST_CHECK(cache.get(uint256(1)) == message);
+    BOOST_CHECK(cache.get(uint256(1)) == message);
+
+    const SerializedBlockCache::Statistics statistics = cache.getStatistics();
+    BOOST_CHECK_EQUAL(statistics.hits, 2u);
+    BOOST_CHECK_EQUAL(statistics.misses, 1u);
+    BOOST_CHECK_EQUAL(statistics.numberOfBlocks, 1u);
+    BOOST_CHECK_EQUAL(statistics.usedBytes, 100u);
+    BOOST_CHECK_CLOSE(statistics.hitRate(), 2.0 / 3.0, 0.0001);
+}
+
+BOOST_AUTO_TEST_CASE(willEvictLeastRecentlyUsedBlocksToStayWithinByteLimit)
+{
+    SerializedBlockCache cache(300u);
+    cache.insert(uint256(1), CreateMessageOfSize(100u));
+    cache.insert(uint256(2), CreateMessageOfSize(100u));
+    cache.insert(uint256(3), CreateMessageOfSize(100u));
+    BOOST_CHECK(cache.get(uint256(1)));
+
+    cache.insert(uint256(4), CreateMessageOfSize(150u));
+    BOOST_CHECK(cache.contains(uint256(1)));
+    BOOST_CHECK(!cache.contains(uint256(2)));
+    BOOST_CHECK(!cache.contains(uint256(3)));
+    BOOST_CHECK(cache.contains(uint256(4)));
+    BOOST_CHECK_EQUAL(cache.getStatistics().usedBytes, 250u);
+}
+
+BOOST_AUTO_TEST_CASE(willNotCacheBlocksLargerThanTheCache)
+{
+    SerializedBlockCache cache(300u);
+    cache.insert(uint256(1), CreateMessageOfSize(100u));
+    cache.insert(uint256(2), CreateMessageOfSize(301u));
+    BOOST_CHECK(cache.contains(uint256(1)));
+    BOOST_CHECK(!cache.contains(uint256(2)));
+
+    SerializedBlockCache disabledCache(0u);
+    BOOST_CHECK(!disabledCache.isEnabled());
+    disabledCache.insert(uint256(1), CreateMessageOfSize(1u));
+    BOOST_CHECK_EQUAL(disabledCache.getStatistics().numberOfBlocks, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(willKeepTheFirstMessageCachedForABlock)
+{
+    SerializedBlockCache cache(300u);
+    const SharedNetworkMessage firstMessage = CreateMessageOfSize(100u);
+    cache.insert(uint256(1), firstMessage);
+    cache.insert(uint256(1), CreateMessageOfSize(100u));
+    BOOST_CHECK(cache.get(uint256(1)) == firstMessage);
+    BOOST_CHECK_EQUAL(cache.getStatistics().usedBytes, 100u);
+
+    cache.clear();
+    BOOST_CHECK(!cache.contains(uint256(1)));
+    BOOST_CHECK_EQUAL(cache.getStatistics().usedBytes, 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
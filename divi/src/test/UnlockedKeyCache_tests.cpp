@@ -0,0 +1,126 @@
+#include <UnlockedKeyCache.h>
+
+#include <script/script.h>
+#include <script/standard.h>
+#include <crypter.h>
+
+#include <test_only.h>
+
+namespace
+{
+CKey CreateKey(bool compressed)
+{
+    CKey key;
+    key.MakeNewKey(compressed);
+    return key;
+}
+
+class EncryptedKeyStore: public CCryptoKeyStore
+{
+public:
+    using CCryptoKeyStore::EncryptKeys;
+    using CCryptoKeyStore::Unlock;
+
+    size_t numberOfUnlockedKeys() const
+    {
+        return unlockedKeys_.numberOfKeys();
+    }
+};
+
+CExtKey CreateChainKey()
+{
+    const std::vector<unsigned char> seed(32, 0x2a);
+    CExtKey chainKey;
+    chainKey.SetMaster(&seed[0], seed.size());
+    return chainKey;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(UnlockedKeyCache_tests)
+
+BOOST_AUTO_TEST_CASE(willReturnTheKeysThatWereAdded)
+{
+    UnlockedKeyCache cache;
+    std::vector<CKey> keys;
+    for(unsigned keyIndex = 0; keyIndex < 100; ++keyIndex)
+    {
+        keys.push_back(CreateKey(keyIndex % 2 == 0));
+        cache.addKey(keys.back().GetPubKey().GetID(), keys.back());
+    }
+    BOOST_CHECK_EQUAL(cache.numberOfKeys(), 100u);
+
+    for(const CKey& key: keys)
+    {
+        CKey cachedKey;
+        BOOST_REQUIRE(cache.getKey(key.GetPubKey().GetID(), cachedKey));
+        BOOST_CHECK(cachedKey == key);
+        BOOST_CHECK_EQUAL(cachedKey.IsCompressed(), key.IsCompressed());
+    }
+    CKey unknownKey;
+    BOOST_CHECK(!cache.getKey(CreateKey(true).GetPubKey().GetID(), unknownKey));
+}
+
+BOOST_AUTO_TEST_CASE(willKeepHDChainKeysPerChainAccountAndChange)
+{
+    UnlockedKeyCache cache;
+    const CExtKey chainKey = CreateChainKey();
+    cache.addHDChainKey(uint256(1), 0u, false, chainKey);
+
+    CExtKey cachedChainKey;
+    BOOST_REQUIRE(cache.getHDChainKey(uint256(1), 0u, false, cachedChainKey));
+    BOOST_CHECK(cachedChainKey == chainKey);
+    BOOST_CHECK(!cache.getHDChainKey(uint256(1), 0u, true, cachedChainKey));
+    BOOST_CHECK(!cache.getHDChainKey(uint256(1), 1u, false, cachedChainKey));
+    BOOST_CHECK(!cache.getHDChainKey(uint256(2), 0u, false, cachedChainKey));
+}
+
+BOOST_AUTO_TEST_CASE(willForgetEverythingWhenCleared)
+{
+    UnlockedKeyCache cache;
+    const CKey key = CreateKey(true);
+    cache.addKey(key.GetPubKey().GetID(), key);
+    cache.addHDChainKey(uint256(1), 0u, false, CreateChainKey());
+
+    cache.clear();
+    CKey cachedKey;
+    CExtKey cachedChainKey;
+    BOOST_CHECK_EQUAL(cache.numberOfKeys(), 0u);
+    BOOST_CHECK(!cache.getKey(key.GetPubKey().GetID(), cachedKey));
+    BOOST_CHECK(!cache.getHDChainKey(uint256(1), 0u, false, cachedChainKey));
+
+    cache.addKey(key.GetPubKey().GetID(), key);
+    BOOST_CHECK(cache.getKey(key.GetPubKey().GetID(), cachedKey));
+}
+
+BOOST_AUTO_TEST_CASE(keyStoreWillDecryptKeysOnFirstUseAndWipeThemWhenLocked)
+{
+    EncryptedKeyStore keyStore;
+    std::vector<CKey> keys;
+    for(unsigned keyIndex = 0; keyIndex < 3; ++keyIndex)
+    {
+        keys.push_back(CreateKey(true));
+        BOOST_CHECK(keyStore.AddKeyPubKey(keys.back(), keys.back().GetPubKey()));
+    }
+    CKeyingMaterial masterKey(WALLET_CRYPTO_KEY_SIZE, 0x07);
+    BOOST_REQUIRE(keyStore.EncryptKeys(masterKey));
+    BOOST_REQUIRE(keyStore.IsLocked());
+
+    CKey decryptedKey;
+    BOOST_CHECK(!keyStore.GetKey(keys[0].GetPubKey().GetID(), decryptedKey));
+    BOOST_CHECK(!keyStore.Unlock(CKeyingMaterial(WALLET_CRYPTO_KEY_SIZE, 0x08)));
+    BOOST_REQUIRE(keyStore.Unlock(masterKey));
+    BOOST_CHECK_EQUAL(keyStore.numberOfUnlockedKeys(), 0u);
+
+    for(unsigned repeat = 0; repeat < 2; ++repeat)
+    {
+        BOOST_REQUIRE(keyStore.GetKey(keys[1].GetPubKey().GetID(), decryptedKey));
+        BOOST_CHECK(decryptedKey == keys[1]);
+    }
+    BOOST_CHECK_EQUAL(keyStore.numberOfUnlockedKeys(), 1u);
+
+    BOOST_REQUIRE(keyStore.Lock());
+    BOOST_CHECK_EQUAL(keyStore.numberOfUnlockedKeys(), 0u);
+    BOOST_CHECK(!keyStore.GetKey(keys[1].GetPubKey().GetID(), decryptedKey));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,167 @@
+#include <WalletTransactionLog.h>
+
+#include <clientversion.h>
+#include <random.h>
+#include <tinyformat.h>
+#include <util.h>
+
+#include <test_only.h>
+
+#include <boost/filesystem.hpp>
+#include <fstream>
+
+namespace
+{
+class WalletTransactionLogTestFixture
+{
+public:
+    const boost::filesystem::path directory;
+    const boost::filesystem::path logPath;
+
+    WalletTransactionLogTestFixture(
+        ): directory(GetTempPath() / strprintf("test_divi_txlog_%i", GetRand(100000000)))
+        , logPath(directory / "wallet.dat.txlog")
+    {
+        boost::filesystem::create_directories(directory);
+    }
+    ~WalletTransactionLogTestFixture()
+    {
+        boost::filesystem::remove_all(directory);
+    }
+
+    static CDataStream Record(const std::string& contents)
+    {
+        CDataStream record(SER_DISK, CLIENT_VERSION);
+        record << contents;
+        return record;
+    }
+
+    static std::vector<std::pair<uint256, std::string>> ReadAll(const WalletTransactionLog& log, unsigned& numberOfCorruptRecords)
+    {
+        std::vector<std::pair<uint256, std::string>> records;
+        BOOST_CHECK(log.ForEachRecord(
+            [&records](const uint256& key, CDataStream& record)
+            {
+                std::string contents;
+                record >> contents;
+                records.emplace_back(key, contents);
+            },
+            numberOfCorruptRecords));
+        return records;
+    }
+
+    void AppendBytesTo(const boost::filesystem::path& path, const std::string& bytes) const
+    {
+        std::ofstream file(path.string().c_str(), std::ios::binary | std::ios::app);
+        file << bytes;
+    }
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(WalletTransactionLog_tests, WalletTransactionLogTestFixture)
+
+BOOST_AUTO_TEST_CASE(willReadTheLatestCopyOfEveryRecordAfterReopening)
+{
+    {
+        WalletTransactionLog log(logPath);
+        BOOST_REQUIRE(log.Open());
+        BOOST_CHECK(log.Append(uint256(1), Record("first")));
+        BOOST_CHECK(log.Append(uint256(2), Record("second")));
+        BOOST_CHECK(log.Append(uint256(1), Record("first, updated")));
+        BOOST_CHECK_EQUAL(log.numberOfRecords(), 2u);
+        BOOST_CHECK(log.staleBytes() > 0u);
+    }
+
+    WalletTransactionLog log(logPath);
+    BOOST_REQUIRE(log.Open());
+    unsigned numberOfCorruptRecords = 1u;
+    const auto records = ReadAll(log, numberOfCorruptRecords);
+    BOOST_CHECK_EQUAL(numberOfCorruptRecords, 0u);
+    BOOST_REQUIRE_EQUAL(records.size(), 2u);
+    BOOST_CHECK(records[0].first == uint256(2) && records[0].second == "second");
+    BOOST_CHECK(records[1].first == uint256(1) && records[1].second == "first, updated");
+}
+
+BOOST_AUTO_TEST_CASE(willDropTornWritesAndRebuildALostIndex)
+{
+    {
+        WalletTransactionLog log(logPath);
+        BOOST_REQUIRE(log.Open());
+        BOOST_CHECK(log.Append(uint256(1), Record("first")));
+        BOOST_CHECK(log.Append(uint256(2), Record("second")));
+    }
+    // A record cut short in the log and an index entry cut short in the index
+    AppendBytesTo(logPath, std::string(40, '\x07'));
+    AppendBytesTo(logPath.string() + ".idx", std::string(20, '\x07'));
+    {
+        WalletTransactionLog log(logPath);
+        BOOST_REQUIRE(log.Open());
+        unsigned numberOfCorruptRecords = 0u;
+        BOOST_CHECK_EQUAL(ReadAll(log, numberOfCorruptRecords).size(), 2u);
+        BOOST_CHECK(log.Append(uint256(3), Record("third")));
+    }
+
+    boost::filesystem::remove(logPath.string() + ".idx");
+    WalletTransactionLog log(logPath);
+    BOOST_REQUIRE(log.Open());
+    unsigned numberOfCorruptRecords = 0u;
+    const auto records = ReadAll(log, numberOfCorruptRecords);
+    BOOST_REQUIRE_EQUAL(records.size(), 3u);
+    BOOST_CHECK(records[2].first == uint256(3) && records[2].second == "third");
+    BOOST_CHECK(boost::filesystem::exists(logPath.string() + ".idx"));
+}
+
+BOOST_AUTO_TEST_CASE(willSkipRecordsFailingTheirChecksum)
+{
+    {
+        WalletTransactionLog log(logPath);
+        BOOST_REQUIRE(log.Open());
+        BOOST_CHECK(log.Append(uint256(1), Record("first")));
+        BOOST_CHECK(log.Append(uint256(2), Record("second")));
+    }
+    {
+        // Overwrite the last byte of the last record
+        std::fstream file(logPath.string().c_str(), std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(-1, std::ios::end);
+        file.put('x');
+    }
+
+    WalletTransactionLog log(logPath);
+    BOOST_REQUIRE(log.Open());
+    unsigned numberOfCorruptRecords = 0u;
+    const auto records = ReadAll(log, numberOfCorruptRecords);
+    BOOST_CHECK_EQUAL(numberOfCorruptRecords, 1u);
+    BOOST_REQUIRE_EQUAL(records.size(), 1u);
+    BOOST_CHECK(records[0].second == "first");
+}
+
+BOOST_AUTO_TEST_CASE(willCompactALogHoldingMostlyStaleRecords)
+{
+    const std::string largeContents(100000, 'a');
+    {
+        WalletTransactionLog log(logPath);
+        BOOST_REQUIRE(log.Open());
+        BOOST_CHECK(log.Append(uint256(1), Record("first")));
+        for(unsigned copy = 0; copy < 12; ++copy)
+        {
+            BOOST_CHECK(log.Append(uint256(2), Record(largeContents)));
+        }
+        BOOST_CHECK(log.staleBytes() > 1000000u);
+    }
+    const uintmax_t sizeBeforeCompaction = boost::filesystem::file_size(logPath);
+
+    WalletTransactionLog log(logPath);
+    BOOST_REQUIRE(log.Open());
+    BOOST_CHECK_EQUAL(log.staleBytes(), 0u);
+    BOOST_CHECK(boost::filesystem::file_size(logPath) < sizeBeforeCompaction / 10);
+    BOOST_CHECK(log.Append(uint256(3), Record("third")));
+
+    unsigned numberOfCorruptRecords = 0u;
+    const auto records = ReadAll(log, numberOfCorruptRecords);
+    BOOST_REQUIRE_EQUAL(records.size(), 3u);
+    BOOST_CHECK(records[0].second == "first");
+    BOOST_CHECK(records[1].second == largeContents);
+    BOOST_CHECK(records[2].second == "third");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,72 @@
+#include <WalletUtxoIndex.h>
+
+#include <test_only.h>
+
+namespace
+{
+const unsigned spendableCoins = 1u << 0;
+const unsigned stakableCoins = 1u << 1;
+const unsigned ownedVaultCoins = 1u << 2;
+
+typedef WalletUtxoIndex::IndexedOutput IndexedOutput;
+}
+
+BOOST_AUTO_TEST_SUITE(WalletUtxoIndex_tests)
+
+BOOST_AUTO_TEST_CASE(willGroupTransactionsByTheCoinTypesOfTheirOutputs)
+{
+    WalletUtxoIndex index;
+    index.update(uint256(1), {IndexedOutput(0u, spendableCoins | stakableCoins, true)});
+    index.update(uint256(2), {IndexedOutput(1u, ownedVaultCoins | stakableCoins, true), IndexedOutput(3u, ownedVaultCoins, false)});
+    index.update(uint256(3), {IndexedOutput(0u, spendableCoins, true)});
+
+    BOOST_CHECK(index.transactionsWithCoinType(0u) == std::set<uint256>({uint256(1), uint256(3)}));
+    BOOST_CHECK(index.transactionsWithCoinType(1u) == std::set<uint256>({uint256(1), uint256(2)}));
+    BOOST_CHECK(index.transactionsWithCoinType(2u) == std::set<uint256>({uint256(2)}));
+    BOOST_CHECK_EQUAL(index.numberOfTransactions(), 3u);
+    BOOST_CHECK_EQUAL(index.numberOfOutputs(), 4u);
+
+    const std::vector<IndexedOutput>& outputs = index.outputsOf(uint256(2));
+    BOOST_REQUIRE_EQUAL(outputs.size(), 2u);
+    BOOST_CHECK_EQUAL(outputs[1].outputIndex, 3u);
+    BOOST_CHECK(!outputs[1].isSpendable);
+}
+
+BOOST_AUTO_TEST_CASE(willReplaceTheOutputsOfAReindexedTransaction)
+{
+    WalletUtxoIndex index;
+    index.update(uint256(1), {IndexedOutput(0u, spendableCoins | stakableCoins, true), IndexedOutput(1u, spendableCoins, true)});
+
+    // Output 0 got spent
+    index.update(uint256(1), {IndexedOutput(1u, spendableCoins, true)});
+    BOOST_CHECK(index.transactionsWithCoinType(1u).empty());
+    BOOST_CHECK_EQUAL(index.transactionsWithCoinType(0u).size(), 1u);
+    BOOST_CHECK_EQUAL(index.numberOfOutputs(), 1u);
+
+    // All outputs spent
+    index.update(uint256(1), {});
+    BOOST_CHECK(index.transactionsWithCoinType(0u).empty());
+    BOOST_CHECK(index.outputsOf(uint256(1)).empty());
+    BOOST_CHECK_EQUAL(index.numberOfTransactions(), 0u);
+    BOOST_CHECK_EQUAL(index.numberOfOutputs(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(willForgetRemovedAndClearedTransactions)
+{
+    WalletUtxoIndex index;
+    index.update(uint256(1), {IndexedOutput(0u, spendableCoins, true)});
+    index.update(uint256(2), {IndexedOutput(0u, stakableCoins, true)});
+
+    index.remove(uint256(1));
+    index.remove(uint256(5));
+    BOOST_CHECK(index.transactionsWithCoinType(0u).empty());
+    BOOST_CHECK_EQUAL(index.numberOfTransactions(), 1u);
+    BOOST_CHECK_EQUAL(index.numberOfOutputs(), 1u);
+
+    index.clear();
+    BOOST_CHECK(index.transactionsWithCoinType(1u).empty());
+    BOOST_CHECK_EQUAL(index.numberOfTransactions(), 0u);
+    BOOST_CHECK_EQUAL(index.numberOfOutputs(), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,129 @@
+// Copyright (c) 2012-2014 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "checkqueue.h"
+
+#include <atomic>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+namespace
+{
+std::atomic<unsigned> numberOfChecksRun(0);
+
+class FakeCheck
+{
+private:
+    bool result;
+
+public:
+    FakeCheck() : result(true) {}
+    explicit FakeCheck(bool resultIn) : result(resultIn) {}
+
+    bool operator()()
+    {
+        numberOfChecksRun++;
+        return result;
+    }
+
+    void swap(FakeCheck& other)
+    {
+        std::swap(result, other.result);
+    }
+};
+
+class CheckQueueWithWorkers
+{
+private:
+    boost::thread_group threads;
+
+public:
+    CCheckQueue<FakeCheck> queue;
+
+    CheckQueueWithWorkers(unsigned numberOfWorkers, unsigned maxNumberOfWorkers = 64)
+        : threads(), queue(16, maxNumberOfWorkers)
+    {
+        for (unsigned i = 0; i < numberOfWorkers; i++)
+            threads.create_thread(boost::bind(&CCheckQueue<FakeCheck>::Thread, &queue));
+    }
+
+    ~CheckQueueWithWorkers()
+    {
+        threads.interrupt_all();
+        threads.join_all();
+    }
+};
+
+std::vector<FakeCheck> CreateChecks(unsigned numberOfChecks, bool result = true)
+{
+    return std::vector<FakeCheck>(numberOfChecks, FakeCheck(result));
+}
+}
+
+BOOST_AUTO_TEST_SUITE(checkqueue_tests)
+
+BOOST_AUTO_TEST_CASE(willRunEveryCheckAddedBeforeWaitReturns)
+{
+    CheckQueueWithWorkers workers(4);
+    for (unsigned round = 0; round < 100; round++) {
+        numberOfChecksRun = 0;
+        unsigned numberOfChecks = 0;
+        {
+            CCheckQueueControl<FakeCheck> control(&workers.queue);
+            for (unsigned batch = 0; batch < 20; batch++) {
+                std::vector<FakeCheck> checks = CreateChecks(1 + (round * batch) % 37);
+                numberOfChecks += checks.size();
+                control.Add(checks);
+            }
+            BOOST_CHECK(control.Wait());
+        }
+        BOOST_CHECK_EQUAL(numberOfChecksRun.load(), numberOfChecks);
+        BOOST_CHECK(workers.queue.IsIdle());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(willReportAFailedCheckAndRecoverForTheNextBatch)
+{
+    CheckQueueWithWorkers workers(3);
+    {
+        CCheckQueueControl<FakeCheck> control(&workers.queue);
+        std::vector<FakeCheck> checks = CreateChecks(500);
+        checks[250] = FakeCheck(false);
+        control.Add(checks);
+        BOOST_CHECK(!control.Wait());
+    }
+    {
+        CCheckQueueControl<FakeCheck> control(&workers.queue);
+        std::vector<FakeCheck> checks = CreateChecks(500);
+        control.Add(checks);
+        BOOST_CHECK(control.Wait());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(willRunChecksWhenThereAreMoreWorkersThanDeques)
+{
+    CheckQueueWithWorkers workers(6, 2);
+    numberOfChecksRun = 0;
+    CCheckQueueControl<FakeCheck> control(&workers.queue);
+    std::vector<FakeCheck> checks = CreateChecks(1000);
+    control.Add(checks);
+    BOOST_CHECK(control.Wait());
+    BOOST_CHECK_EQUAL(numberOfChecksRun.load(), 1000u);
+}
+
+BOOST_AUTO_TEST_CASE(masterWillRunChecksOnItsOwnWithoutWorkers)
+{
+    CheckQueueWithWorkers workers(0);
+    numberOfChecksRun = 0;
+    CCheckQueueControl<FakeCheck> control(&workers.queue);
+    std::vector<FakeCheck> checks = CreateChecks(100);
+    control.Add(checks);
+    BOOST_CHECK(control.Wait());
+    BOOST_CHECK_EQUAL(numberOfChecksRun.load(), 100u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
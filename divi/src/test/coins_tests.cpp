@@ -4,11 +4,14 @@
 
 #include "coins.h"
 #include "random.h"
+#include "txdb.h"
 #include "uint256.h"
+#include <blockmap.h>
 
 #include <vector>
 #include <map>
 
+#include <boost/scoped_ptr.hpp>
 #include <boost/test/unit_test.hpp>
 
 FastRandomContext random_source;
@@ -61,6 +64,41 @@ public:
 
     bool GetStats(CCoinsStats& stats) const override { return false; }
 };
+
+/** In-memory coin database, exposing its records to check the on-disk layout */
+class CCoinsViewDBTest : public CCoinsViewDB
+{
+public:
+    explicit CCoinsViewDBTest(const BlockMap& blockIndicesByHash): CCoinsViewDB(blockIndicesByHash, 1 << 23, true) {}
+
+    void WriteLegacyCoins(const uint256& txid, const CCoins& coins)
+    {
+        db.Write(std::make_pair('c', txid), coins);
+    }
+
+    size_t NumberOfRecords(char prefix)
+    {
+        boost::scoped_ptr<leveldb::Iterator> pcursor(db.NewIterator());
+        size_t numberOfRecords = 0;
+        for (pcursor->Seek(std::string(1, prefix)); pcursor->Valid() && pcursor->key()[0] == prefix; pcursor->Next()) {
+            ++numberOfRecords;
+        }
+        return numberOfRecords;
+    }
+};
+
+BlockMap emptyBlockIndex;
+
+size_t NumberOfUnspentOutputs(const CCoins& coins)
+{
+    size_t numberOfOutputs = 0;
+    for (const CTxOut& out : coins.vout) {
+        if (!out.IsNull()) {
+            ++numberOfOutputs;
+        }
+    }
+    return numberOfOutputs;
+}
 }
 
 BOOST_AUTO_TEST_SUITE(coins_tests)
@@ -178,4 +216,144 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
     BOOST_CHECK(missed_an_entry);
 }
 
+// Same idea as above, but spending single outputs through SpendCoin on top of the
+// coin database, which relies on the spends-only bookkeeping of the cache entries
+// to know which records to erase.
+BOOST_AUTO_TEST_CASE(coins_cache_per_outpoint_simulation_test)
+{
+    bool spent_an_output = false;
+    bool spent_a_whole_transaction = false;
+    bool flushed_spends_only_entries = false;
+
+    std::map<uint256, CCoins> result;
+
+    CCoinsViewDBTest base(emptyBlockIndex);
+    std::vector<CCoinsViewCache*> stack;
+    stack.push_back(new CCoinsViewCache(&base));
+
+    std::vector<uint256> txids;
+    txids.resize(NUM_SIMULATION_ITERATIONS / 64);
+    for (unsigned int i = 0; i < txids.size(); i++) {
+        txids[i] = GetRandHash();
+    }
+
+    for (unsigned int i = 0; i < NUM_SIMULATION_ITERATIONS; i++) {
+        uint256 txid = txids[insecure_rand() % txids.size()];
+        CCoins& coins = result[txid];
+        if (coins.IsPruned() || insecure_rand() % 20 == 0) {
+            // (Re)create the transaction with a random number of outputs.
+            CCoinsModifier entry = stack.back()->ModifyCoins(txid);
+            BOOST_CHECK(coins == *entry);
+            coins.Clear();
+            coins.nHeight = insecure_rand() % 1000000;
+            coins.vout.resize(1 + insecure_rand() % 16);
+            for (CTxOut& out : coins.vout) {
+                out.nValue = 1 + insecure_rand() % 1000;
+            }
+            *entry = coins;
+        } else {
+            const uint32_t nPos = insecure_rand() % coins.vout.size();
+            CTxInUndo undo;
+            const bool available = coins.IsAvailable(nPos);
+            BOOST_CHECK_EQUAL(stack.back()->SpendCoin(COutPoint(txid, nPos), undo), available);
+            if (available) {
+                coins.Spend(nPos);
+                spent_an_output = true;
+                if (coins.IsPruned()) {
+                    spent_a_whole_transaction = true;
+                }
+            }
+        }
+
+        if (insecure_rand() % 100 == 0) {
+            if (stack.size() > 0 && insecure_rand() % 2 == 0) {
+                stack.back()->Flush();
+                delete stack.back();
+                stack.pop_back();
+                if (stack.empty()) {
+                    flushed_spends_only_entries = true;
+                }
+            }
+            if (stack.size() == 0 || (stack.size() < 4 && insecure_rand() % 2)) {
+                CCoinsView* tip = &base;
+                if (stack.size() > 0) {
+                    tip = stack.back();
+                }
+                stack.push_back(new CCoinsViewCache(tip));
+            }
+        }
+    }
+
+    while (stack.size() > 0) {
+        stack.back()->Flush();
+        delete stack.back();
+        stack.pop_back();
+    }
+
+    size_t expectedNumberOfOutputs = 0;
+    size_t expectedNumberOfTransactions = 0;
+    for (auto it = result.begin(); it != result.end(); it++) {
+        CCoins coins;
+        if (base.GetCoins(it->first, coins)) {
+            BOOST_CHECK(coins == it->second);
+            BOOST_CHECK(base.HaveCoins(it->first));
+            ++expectedNumberOfTransactions;
+        } else {
+            BOOST_CHECK(it->second.IsPruned());
+            BOOST_CHECK(!base.HaveCoins(it->first));
+        }
+        expectedNumberOfOutputs += NumberOfUnspentOutputs(it->second);
+    }
+    BOOST_CHECK_EQUAL(base.NumberOfRecords('C'), expectedNumberOfOutputs);
+    BOOST_CHECK_EQUAL(base.NumberOfRecords('N'), expectedNumberOfTransactions);
+
+    BOOST_CHECK(spent_an_output);
+    BOOST_CHECK(spent_a_whole_transaction);
+    BOOST_CHECK(flushed_spends_only_entries);
+}
+
+BOOST_AUTO_TEST_CASE(coins_db_upgrade_splits_legacy_records_into_outputs)
+{
+    CCoinsViewDBTest db(emptyBlockIndex);
+    std::map<uint256, CCoins> legacyCoins;
+    for (unsigned int i = 0; i < 64; i++) {
+        CCoins coins;
+        coins.fCoinBase = (i % 3 == 0);
+        coins.fCoinStake = (i % 3 == 1);
+        coins.nHeight = insecure_rand() % 10000000;
+        coins.nVersion = 1 + i % 2;
+        coins.vout.resize(1 + insecure_rand() % 300);
+        for (CTxOut& out : coins.vout) {
+            out.nValue = insecure_rand() % 2 == 0 ? 1 + insecure_rand() % 100000000 : -1;
+            out.scriptPubKey = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, i) << OP_EQUALVERIFY << OP_CHECKSIG;
+        }
+        coins.vout.back().nValue = 1 + i;
+        const uint256 txid = GetRandHash();
+        db.WriteLegacyCoins(txid, coins);
+        legacyCoins[txid] = coins;
+    }
+
+    BOOST_CHECK(db.Upgrade());
+    BOOST_CHECK_EQUAL(db.NumberOfRecords('c'), 0u);
+    BOOST_CHECK_EQUAL(db.NumberOfRecords('N'), legacyCoins.size());
+
+    size_t expectedNumberOfOutputs = 0;
+    for (const std::pair<const uint256, CCoins>& legacy : legacyCoins) {
+        CCoins coins;
+        BOOST_CHECK(db.GetCoins(legacy.first, coins));
+        BOOST_CHECK(coins == legacy.second);
+        BOOST_CHECK(db.HaveCoins(legacy.first));
+        expectedNumberOfOutputs += NumberOfUnspentOutputs(legacy.second);
+    }
+    BOOST_CHECK_EQUAL(db.NumberOfRecords('C'), expectedNumberOfOutputs);
+
+    CCoins coins;
+    BOOST_CHECK(!db.GetCoins(GetRandHash(), coins));
+    BOOST_CHECK(!db.HaveCoins(GetRandHash()));
+
+    // Upgrading again finds nothing left to convert
+    BOOST_CHECK(db.Upgrade());
+    BOOST_CHECK_EQUAL(db.NumberOfRecords('C'), expectedNumberOfOutputs);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
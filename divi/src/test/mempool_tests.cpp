@@ -5,6 +5,7 @@
 #include "txmempool.h"
 
 #include "FakeBlockIndexChain.h"
+#include "utiltime.h"
 
 #include <boost/test/unit_test.hpp>
 #include <list>
@@ -17,6 +18,9 @@ protected:
   bool addressIndex = false;
   bool spentIndex = false;
 
+  /** The relay fee the test mempool refers to.  */
+  CFeeRate minRelayFee;
+
   /** A parent transaction.  */
   CMutableTransaction txParent;
 
@@ -41,8 +45,8 @@ protected:
 public:
 
   MempoolTestFixture()
-    : fakeChain(1, 1500000000, 1),
-      testPool(CFeeRate(0), addressIndex, spentIndex),
+    : minRelayFee(0), fakeChain(1, 1500000000, 1),
+      testPool(minRelayFee, addressIndex, spentIndex),
       coinsMemPool(nullptr, testPool), coins(&coinsMemPool)
   {
     CMutableTransaction mtx;
@@ -246,4 +250,194 @@ BOOST_AUTO_TEST_CASE(MempoolSpentIndex)
     BOOST_CHECK(!testPool.getSpentIndex(keyChild, value));
 }
 
+BOOST_AUTO_TEST_CASE(MempoolPackageIndexTracksDependencies)
+{
+    // Children and grandchildren arrive before the parent, as after a reorg:
+    for (int i = 0; i < 3; i++)
+    {
+        testPool.addUnchecked(txChild[i].GetHash(), CTxMemPoolEntry(txChild[i], 100, 0, 0.0, 1), coins);
+        testPool.addUnchecked(txGrandChild[i].GetHash(), CTxMemPoolEntry(txGrandChild[i], 10, 0, 0.0, 1), coins);
+    }
+    testPool.addUnchecked(txParent.GetHash(), CTxMemPoolEntry(txParent, 1000, 0, 0.0, 1), coins);
+    testPool.check(&coins, *fakeChain.blockIndexByHash);
+
+    {
+        LOCK(testPool.cs);
+        const MempoolPackageIndex& packageIndex = testPool.GetPackageIndex();
+        BOOST_CHECK_EQUAL(packageIndex.readyTransactions().size(), 1u);
+        BOOST_CHECK(packageIndex.readyTransactions().count(txParent.GetHash()));
+
+        const MempoolPackage* parent = packageIndex.find(txParent.GetHash());
+        BOOST_REQUIRE(parent);
+        BOOST_CHECK_EQUAL(parent->children.size(), 3u);
+        BOOST_CHECK_EQUAL(parent->ancestorCount, 1u);
+
+        const MempoolPackage* grandChild = packageIndex.find(txGrandChild[0].GetHash());
+        BOOST_REQUIRE(grandChild);
+        BOOST_CHECK_EQUAL(grandChild->ancestorCount, 3u);
+        BOOST_CHECK_EQUAL(grandChild->ancestorFees, 1110);
+    }
+
+    // The parent confirms; its children become ready and lose it as an ancestor:
+    std::list<CTransaction> removed;
+    testPool.remove(txParent, removed, false);
+    BOOST_CHECK_EQUAL(removed.size(), 1u);
+
+    {
+        LOCK(testPool.cs);
+        const MempoolPackageIndex& packageIndex = testPool.GetPackageIndex();
+        BOOST_CHECK_EQUAL(packageIndex.packages().size(), 6u);
+        BOOST_CHECK_EQUAL(packageIndex.readyTransactions().size(), 3u);
+        for (int i = 0; i < 3; i++)
+            BOOST_CHECK(packageIndex.readyTransactions().count(txChild[i].GetHash()));
+
+        const MempoolPackage* grandChild = packageIndex.find(txGrandChild[0].GetHash());
+        BOOST_REQUIRE(grandChild);
+        BOOST_CHECK_EQUAL(grandChild->ancestorCount, 2u);
+        BOOST_CHECK_EQUAL(grandChild->ancestorFees, 110);
+    }
+
+    testPool.clear();
+    LOCK(testPool.cs);
+    BOOST_CHECK(testPool.GetPackageIndex().packages().empty());
+    BOOST_CHECK(testPool.GetPackageIndex().readyTransactions().empty());
+}
+
+BOOST_AUTO_TEST_CASE(MempoolPackageIndexOrdersPackagesByAncestorFeeRate)
+{
+    // A cheap parent with one child paying for both:
+    testPool.addUnchecked(txParent.GetHash(), CTxMemPoolEntry(txParent, 10, 0, 0.0, 1), coins);
+    testPool.addUnchecked(txChild[0].GetHash(), CTxMemPoolEntry(txChild[0], 100000, 0, 0.0, 1), coins);
+    testPool.addUnchecked(txChild[1].GetHash(), CTxMemPoolEntry(txChild[1], 20, 0, 0.0, 1), coins);
+    testPool.addUnchecked(txGrandChild[0].GetHash(), CTxMemPoolEntry(txGrandChild[0], 30, 0, 0.0, 1), coins);
+    testPool.check(&coins, *fakeChain.blockIndexByHash);
+
+    {
+        LOCK(testPool.cs);
+        const MempoolPackageIndex& packageIndex = testPool.GetPackageIndex();
+        BOOST_CHECK(packageIndex.byAncestorFeeRate().rbegin()->second == txChild[0].GetHash());
+        BOOST_CHECK_EQUAL(packageIndex.find(txGrandChild[0].GetHash())->ancestorFees, 100040);
+        BOOST_CHECK_EQUAL(packageIndex.find(txParent.GetHash())->descendantFees, 100060);
+    }
+
+    // A fee delta moves every package the parent belongs to:
+    testPool.PrioritiseTransaction(txParent.GetHash(), 1000000);
+    testPool.check(&coins, *fakeChain.blockIndexByHash);
+    {
+        LOCK(testPool.cs);
+        const MempoolPackageIndex& packageIndex = testPool.GetPackageIndex();
+        BOOST_CHECK(packageIndex.byAncestorFeeRate().rbegin()->second == txParent.GetHash());
+        BOOST_CHECK_EQUAL(packageIndex.find(txGrandChild[0].GetHash())->ancestorFees, 1100040);
+        BOOST_CHECK_EQUAL(packageIndex.find(txChild[1].GetHash())->ancestorFees, 1000030);
+    }
+
+    // Removing the middle of a chain leaves the rest counted once:
+    std::list<CTransaction> removed;
+    testPool.remove(txChild[0], removed, false);
+    {
+        LOCK(testPool.cs);
+        const MempoolPackageIndex& packageIndex = testPool.GetPackageIndex();
+        const MempoolPackage* grandChild = packageIndex.find(txGrandChild[0].GetHash());
+        BOOST_REQUIRE(grandChild);
+        BOOST_CHECK_EQUAL(grandChild->ancestorCount, 1u);
+        BOOST_CHECK_EQUAL(grandChild->ancestorFees, 30);
+        BOOST_CHECK_EQUAL(packageIndex.find(txParent.GetHash())->descendantCount, 2u);
+    }
+    testPool.ClearPrioritisation(txParent.GetHash());
+    testPool.clear();
+}
+
+BOOST_AUTO_TEST_CASE(MempoolPackageIndexUpdatesDescendantTotalsOnRecursiveRemoval)
+{
+    testPool.addUnchecked(txParent.GetHash(), CTxMemPoolEntry(txParent, 1000, 0, 0.0, 1), coins);
+    for (int i = 0; i < 3; i++)
+    {
+        testPool.addUnchecked(txChild[i].GetHash(), CTxMemPoolEntry(txChild[i], 100, 0, 0.0, 1), coins);
+        testPool.addUnchecked(txGrandChild[i].GetHash(), CTxMemPoolEntry(txGrandChild[i], 10, 0, 0.0, 1), coins);
+    }
+    {
+        LOCK(testPool.cs);
+        const MempoolPackage* parent = testPool.GetPackageIndex().find(txParent.GetHash());
+        BOOST_REQUIRE(parent);
+        BOOST_CHECK_EQUAL(parent->descendantCount, 7u);
+        BOOST_CHECK_EQUAL(parent->descendantFees, 1330);
+    }
+
+    std::list<CTransaction> removed;
+    testPool.remove(txChild[1], removed, true);
+    BOOST_CHECK_EQUAL(removed.size(), 2u);
+    testPool.check(&coins, *fakeChain.blockIndexByHash);
+    {
+        LOCK(testPool.cs);
+        const MempoolPackage* parent = testPool.GetPackageIndex().find(txParent.GetHash());
+        BOOST_REQUIRE(parent);
+        BOOST_CHECK_EQUAL(parent->descendantCount, 5u);
+        BOOST_CHECK_EQUAL(parent->descendantFees, 1220);
+        BOOST_CHECK(!testPool.GetPackageIndex().find(txGrandChild[1].GetHash()));
+    }
+    testPool.clear();
+}
+
+BOOST_AUTO_TEST_CASE(MempoolTrimToSizeEvictsLowestFeeRatePackages)
+{
+    const CAmount grandChildFees[3] = {10, 20, 1000};
+    testPool.addUnchecked(txParent.GetHash(), CTxMemPoolEntry(txParent, 1000, 0, 0.0, 1), coins);
+    for (int i = 0; i < 3; i++)
+    {
+        testPool.addUnchecked(txChild[i].GetHash(), CTxMemPoolEntry(txChild[i], 100, 0, 0.0, 1), coins);
+        testPool.addUnchecked(txGrandChild[i].GetHash(), CTxMemPoolEntry(txGrandChild[i], grandChildFees[i], 0, 0.0, 1), coins);
+    }
+    BOOST_CHECK(testPool.DynamicMemoryUsage() > testPool.GetTotalTxSize());
+    BOOST_CHECK(testPool.GetMinFee(testPool.DynamicMemoryUsage()) == CFeeRate(0));
+
+    // Shaving off a single byte evicts exactly the cheapest leaf:
+    std::vector<uint256> evicted;
+    testPool.TrimToSize(testPool.DynamicMemoryUsage() - 1, &evicted);
+    BOOST_REQUIRE_EQUAL(evicted.size(), 1u);
+    BOOST_CHECK(evicted[0] == txGrandChild[0].GetHash());
+    const CTxMemPoolEntry evictedEntry(txGrandChild[0], grandChildFees[0], 0, 0.0, 1);
+    BOOST_CHECK(testPool.GetMinFee(testPool.DynamicMemoryUsage()) == CFeeRate(grandChildFees[0], evictedEntry.GetTxSize()));
+
+    evicted.clear();
+    testPool.TrimToSize(testPool.DynamicMemoryUsage() - 1, &evicted);
+    BOOST_REQUIRE_EQUAL(evicted.size(), 1u);
+    BOOST_CHECK(evicted[0] == txGrandChild[1].GetHash());
+    testPool.check(&coins, *fakeChain.blockIndexByHash);
+
+    // Evicting the parent takes all of its descendants along:
+    evicted.clear();
+    testPool.TrimToSize(0u, &evicted);
+    BOOST_CHECK_EQUAL(evicted.size(), 5u);
+    BOOST_CHECK_EQUAL(testPool.size(), 0u);
+    BOOST_CHECK_EQUAL(testPool.DynamicMemoryUsage(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolMinFeeDecaysAfterBlocks)
+{
+    SetMockTime(1500000000);
+    testPool.clear();
+    testPool.addUnchecked(txParent.GetHash(), CTxMemPoolEntry(txParent, 10000, 0, 0.0, 1), coins);
+    const CTxMemPoolEntry parentEntry(txParent, 10000, 0, 0.0, 1);
+    const CFeeRate evictedFeeRate(10000, parentEntry.GetTxSize());
+    testPool.TrimToSize(0u);
+    BOOST_CHECK_EQUAL(testPool.size(), 0u);
+
+    // Without a block since the eviction the minimum fee stays put:
+    const size_t sizeLimit = 1000000u;
+    SetMockTime(1500000000 + CTxMemPool::ROLLING_FEE_HALFLIFE);
+    BOOST_CHECK(testPool.GetMinFee(sizeLimit) == evictedFeeRate);
+
+    // Once a block arrives it halves every half-life, four times as fast
+    // while the pool is nearly empty:
+    std::list<CTransaction> conflicts;
+    testPool.removeConfirmedTransactions(std::vector<CTransaction>(), 2, conflicts);
+    BOOST_CHECK(testPool.GetMinFee(sizeLimit).GetFeePerK() < evictedFeeRate.GetFeePerK());
+    SetMockTime(1500000000 + CTxMemPool::ROLLING_FEE_HALFLIFE + CTxMemPool::ROLLING_FEE_HALFLIFE / 4);
+    const CAmount decayedFeePerK = testPool.GetMinFee(sizeLimit).GetFeePerK();
+    SetMockTime(1500000000 + CTxMemPool::ROLLING_FEE_HALFLIFE + CTxMemPool::ROLLING_FEE_HALFLIFE / 2);
+    BOOST_CHECK_EQUAL(testPool.GetMinFee(sizeLimit).GetFeePerK(), decayedFeePerK / 2);
+
+    SetMockTime(0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
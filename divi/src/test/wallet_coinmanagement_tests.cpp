@@ -382,6 +382,58 @@ BOOST_AUTO_TEST_CASE(willEnsureLockedCoinsDoNotCountTowardStakableBalance)
 }
 
 
+BOOST_AUTO_TEST_CASE(willKeepBalancesUpToDateAfterTheyHaveBeenQueried)
+{
+    CScript normalScript = GetScriptForDestination(wallet.GetDefaultKey().GetID());
+    BOOST_CHECK_EQUAL_MESSAGE(wallet.GetBalance(), 0,"Total balance was not the expected amount");
+    BOOST_CHECK_EQUAL_MESSAGE(wallet.GetStakingBalance(), 0,"Staking balance was not the expected amount");
+
+    CAmount firstNormalTxValue = (GetRand(1000)+1)*COIN;
+    CAmount secondNormalTxValue = (GetRand(1000)+1)*COIN;
+
+    unsigned firstTxOutputIndex=0;
+    const CWalletTx& firstNormalTx = fakeWallet.AddDefaultTx(normalScript,firstTxOutputIndex,firstNormalTxValue);
+    BOOST_CHECK_EQUAL_MESSAGE(wallet.GetBalance(), 0,"Total balance was not the expected amount");
+    fakeWallet.FakeAddToChain(firstNormalTx);
+    fakeWallet.AddBlock();
+    BOOST_CHECK_EQUAL_MESSAGE(wallet.GetBalance(), firstNormalTxValue,"Total balance was not the expected amount");
+
+    unsigned secondTxOutputIndex=0;
+    const CWalletTx& secondNormalTx = fakeWallet.AddDefaultTx(normalScript,secondTxOutputIndex,secondNormalTxValue);
+    fakeWallet.FakeAddToChain(secondNormalTx);
+    BOOST_CHECK_EQUAL_MESSAGE(wallet.GetBalance(), firstNormalTxValue+secondNormalTxValue,"Total balance was not the expected amount");
+    BOOST_CHECK_EQUAL_MESSAGE(wallet.GetStakingBalance(), firstNormalTxValue+secondNormalTxValue,"Staking balance was not the expected amount");
+
+    wallet.LockCoin(COutPoint(firstNormalTx.GetHash(),firstTxOutputIndex));
+    BOOST_CHECK_EQUAL_MESSAGE(wallet.GetStakingBalance(), secondNormalTxValue,"Staking balance was not the expected amount");
+    wallet.UnlockAllCoins();
+    BOOST_CHECK_EQUAL_MESSAGE(wallet.GetStakingBalance(), firstNormalTxValue+secondNormalTxValue,"Staking balance was not the expected amount");
+}
+
+BOOST_AUTO_TEST_CASE(willRemoveSpentOutputsFromPreviouslyQueriedBalance)
+{
+    CScript normalScript = GetScriptForDestination(wallet.GetDefaultKey().GetID());
+    CAmount normalTxValue = (GetRand(1000)+1)*COIN;
+
+    unsigned outputIndex=0;
+    const CWalletTx& normalTx = fakeWallet.AddDefaultTx(normalScript,outputIndex,normalTxValue);
+    fakeWallet.FakeAddToChain(normalTx);
+    fakeWallet.AddBlock();
+    BOOST_CHECK_EQUAL_MESSAGE(wallet.GetBalance(), normalTxValue,"Total balance was not the expected amount");
+
+    CMutableTransaction spendingTx;
+    spendingTx.vin.push_back(CTxIn(normalTx.GetHash(),outputIndex));
+    spendingTx.vout.push_back(CTxOut(normalTxValue, CScript() << OP_TRUE));
+    CWalletTx spendingWalletTx(spendingTx);
+    wallet.AddToWallet(spendingWalletTx);
+    const CWalletTx* spendingWalletTxPtr = wallet.GetWalletTx(spendingWalletTx.GetHash());
+    BOOST_CHECK_MESSAGE(spendingWalletTxPtr != nullptr,"Spending transaction was not added to the wallet");
+    fakeWallet.FakeAddToChain(*spendingWalletTxPtr);
+
+    BOOST_CHECK_EQUAL_MESSAGE(wallet.GetBalance(), 0,"Total balance was not the expected amount");
+    BOOST_CHECK_EQUAL_MESSAGE(wallet.GetSpendableBalance(), 0,"Spendable balance was not the expected amount");
+}
+
 BOOST_AUTO_TEST_CASE(willEnsureStakingBalanceAndTotalBalanceAgreeEvenIfTxsBelongToCommonBlock)
 {
     CScript normalScript = GetScriptForDestination(wallet.GetDefaultKey().GetID());
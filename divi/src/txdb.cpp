@@ -11,6 +11,7 @@
 #include <boost/thread.hpp>
 #include <blockFileInfo.h>
 #include <blockmap.h>
+#include <chain.h>
 #include <chainparams.h>
 #include <addressindex.h>
 #include <spentindex.h>
@@ -29,7 +30,9 @@ constexpr char DB_SPENTINDEX = 'p';
 constexpr char DB_ADDRESSUNSPENTINDEX = 'u';
 constexpr char DB_TXINDEX = 't';
 constexpr char DB_BARETXIDINDEX = 'T';
-constexpr char DB_COINS = 'c';
+constexpr char DB_COINS = 'c'; // legacy per-transaction records, see CCoinsViewDB::Upgrade
+constexpr char DB_COIN = 'C';
+constexpr char DB_COIN_COUNT = 'N'; // unspent outputs per transaction, so lookups are point reads
 constexpr char DB_BESTBLOCKHASH = 'B';
 constexpr char DB_BLOCKINDEX = 'b';
 constexpr char DB_BLOCKFILEINFO = 'f';
@@ -37,15 +40,160 @@ constexpr char DB_LASTBLOCKFILE = 'l';
 constexpr char DB_REINDEXINGFLAG = 'R';
 constexpr char DB_NAMEDFLAG = 'F';
 
+/** Upgrade batches are committed once they hold this many bytes */
+constexpr size_t COIN_DB_UPGRADE_BATCH_SIZE = 16 << 20;
+
+/**
+ * On-disk record of a single unspent output, keyed by its outpoint.
+ *
+ * Serialized format:
+ * - VARINT(nHeight * 4 + (fCoinBase ? 2 : 0) + (fCoinStake ? 1 : 0))
+ * - VARINT(nVersion)
+ * - the CTxOut (via CTxOutCompressor)
+ */
+class CDiskCoin
+{
+public:
+    CTxOut txout;
+    bool fCoinBase;
+    bool fCoinStake;
+    unsigned int nHeight;
+    int nVersion;
+
+    CDiskCoin() : txout(), fCoinBase(false), fCoinStake(false), nHeight(0), nVersion(0) {}
+    CDiskCoin(const CCoins& coins, unsigned int nPos)
+        : txout(coins.vout[nPos]), fCoinBase(coins.fCoinBase), fCoinStake(coins.fCoinStake), nHeight(coins.nHeight), nVersion(coins.nVersion) {}
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const
+    {
+        return ::GetSerializeSize(VARINT(nHeight * 4 + (fCoinBase ? 2 : 0) + (fCoinStake ? 1 : 0)), nType, nVersion) +
+               ::GetSerializeSize(VARINT(this->nVersion), nType, nVersion) +
+               ::GetSerializeSize(CTxOutCompressor(REF(txout)), nType, nVersion);
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const
+    {
+        ::Serialize(s, VARINT(nHeight * 4 + (fCoinBase ? 2 : 0) + (fCoinStake ? 1 : 0)), nType, nVersion);
+        ::Serialize(s, VARINT(this->nVersion), nType, nVersion);
+        ::Serialize(s, CTxOutCompressor(REF(txout)), nType, nVersion);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion)
+    {
+        unsigned int nCode = 0;
+        ::Unserialize(s, VARINT(nCode), nType, nVersion);
+        nHeight = nCode >> 2;
+        fCoinBase = nCode & 2;
+        fCoinStake = nCode & 1;
+        ::Unserialize(s, VARINT(this->nVersion), nType, nVersion);
+        ::Unserialize(s, REF(CTxOutCompressor(REF(txout))), nType, nVersion);
+    }
+};
+
+/** Iterates over the per-outpoint records of one transaction, or of all transactions */
+class CDiskCoinCursor
+{
+private:
+    boost::scoped_ptr<leveldb::Iterator> pcursor;
+
+public:
+    explicit CDiskCoinCursor(const CLevelDBWrapper& db, const uint256& txid = uint256(0))
+        : pcursor(const_cast<CLevelDBWrapper&>(db).NewIterator())
+    {
+        CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+        ssKeySet << std::make_pair(DB_COIN, COutPoint(txid, 0));
+        pcursor->Seek(ssKeySet.str());
+    }
+
+    //! Read the outpoint at the cursor; false once past the last coin record
+    bool GetOutPoint(COutPoint& outpoint) const
+    {
+        if (!pcursor->Valid())
+            return false;
+        leveldb::Slice slKey = pcursor->key();
+        if (slKey.size() == 0 || slKey[0] != DB_COIN)
+            return false;
+        CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+        std::pair<char, COutPoint> key;
+        ssKey >> key;
+        outpoint = key.second;
+        return true;
+    }
+
+    void GetCoin(CDiskCoin& coin) const
+    {
+        leveldb::Slice slValue = pcursor->value();
+        CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+        ssValue >> coin;
+    }
+
+    size_t GetValueSize() const { return pcursor->value().size(); }
+    void Next() { pcursor->Next(); }
+};
+
+//! Reassemble the CCoins of the transaction the cursor points at, advancing past its records
+bool ReadCoinsAtCursor(CDiskCoinCursor& cursor, uint256& txid, CCoins& coins, size_t* pnSerializedSize = nullptr)
+{
+    COutPoint outpoint;
+    if (!cursor.GetOutPoint(outpoint))
+        return false;
+    txid = outpoint.hash;
+    coins.Clear();
+    do {
+        CDiskCoin coin;
+        cursor.GetCoin(coin);
+        if (pnSerializedSize)
+            *pnSerializedSize += cursor.GetValueSize();
+        coins.fCoinBase = coin.fCoinBase;
+        coins.fCoinStake = coin.fCoinStake;
+        coins.nHeight = coin.nHeight;
+        coins.nVersion = coin.nVersion;
+        if (coins.vout.size() <= outpoint.n)
+            coins.vout.resize(outpoint.n + 1);
+        coins.vout[outpoint.n] = coin.txout;
+        cursor.Next();
+    } while (cursor.GetOutPoint(outpoint) && outpoint.hash == txid);
+    coins.Cleanup();
+    return true;
+}
+
 } // anonymous namespace
 
 
-void static BatchWriteCoins(CLevelDBBatch& batch, const uint256& hash, const CCoins& coins)
+void static BatchWriteCoinCount(CLevelDBBatch& batch, const uint256& hash, const CCoins& coins)
 {
-    if (coins.IsPruned())
-        batch.Erase(std::make_pair(DB_COINS, hash));
+    uint32_t nUnspentOutputs = 0;
+    for (const CTxOut& out : coins.vout) {
+        if (!out.IsNull())
+            ++nUnspentOutputs;
+    }
+    if (nUnspentOutputs > 0)
+        batch.Write(std::make_pair(DB_COIN_COUNT, hash), nUnspentOutputs);
     else
-        batch.Write(std::make_pair(DB_COINS, hash), coins);
+        batch.Erase(std::make_pair(DB_COIN_COUNT, hash));
+}
+
+void static BatchWriteCoins(CLevelDBBatch& batch, const uint256& hash, const CCoinsCacheEntry& entry)
+{
+    BatchWriteCoinCount(batch, hash, entry.coins);
+    if (entry.flags & CCoinsCacheEntry::SPENDS_ONLY) {
+        // Only the spent outputs differ from what's on disk
+        for (uint32_t nPos : entry.vSpentOutputs)
+            batch.Erase(std::make_pair(DB_COIN, COutPoint(hash, nPos)));
+        return;
+    }
+
+    const CCoins& coins = entry.coins;
+    const uint32_t nOutputsOnDisk = (entry.flags & CCoinsCacheEntry::FRESH) ? 0u : entry.nParentOutputs;
+    const uint32_t nOutputs = std::max<uint32_t>(nOutputsOnDisk, coins.vout.size());
+    for (uint32_t nPos = 0; nPos < nOutputs; ++nPos) {
+        if (nPos < coins.vout.size() && !coins.vout[nPos].IsNull())
+            batch.Write(std::make_pair(DB_COIN, COutPoint(hash, nPos)), CDiskCoin(coins, nPos));
+        else if (nPos < nOutputsOnDisk)
+            batch.Erase(std::make_pair(DB_COIN, COutPoint(hash, nPos)));
+    }
 }
 
 void static BatchWriteHashBestChain(CLevelDBBatch& batch, const uint256& hash)
@@ -65,12 +213,19 @@ CCoinsViewDB::CCoinsViewDB(
 
 bool CCoinsViewDB::GetCoins(const uint256& txid, CCoins& coins) const
 {
-    return db.Read(std::make_pair(DB_COINS, txid), coins);
+    // Misses, which are most lookups, end at the count record's bloom filter
+    // instead of positioning an iterator
+    uint32_t nUnspentOutputs = 0;
+    if (!db.Read(std::make_pair(DB_COIN_COUNT, txid), nUnspentOutputs))
+        return false;
+    CDiskCoinCursor cursor(db, txid);
+    uint256 foundTxid;
+    return ReadCoinsAtCursor(cursor, foundTxid, coins) && foundTxid == txid;
 }
 
 bool CCoinsViewDB::HaveCoins(const uint256& txid) const
 {
-    return db.Exists(std::make_pair(DB_COINS, txid));
+    return db.Exists(std::make_pair(DB_COIN_COUNT, txid));
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const
@@ -88,7 +243,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock)
     size_t changed = 0;
     for (auto it = mapCoins.begin(); it != mapCoins.end();) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
-            BatchWriteCoins(batch, it->first, it->second.coins);
+            BatchWriteCoins(batch, it->first, it->second);
             changed++;
         }
         count++;
@@ -102,50 +257,93 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock)
     return db.WriteBatch(batch);
 }
 
+bool CCoinsViewDB::Upgrade()
+{
+    boost::scoped_ptr<leveldb::Iterator> pcursor(db.NewIterator());
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << std::make_pair(DB_COINS, uint256(0));
+    pcursor->Seek(ssKeySet.str());
+    if (!pcursor->Valid() || pcursor->key().size() == 0 || pcursor->key()[0] != DB_COINS)
+        return true;
+
+    LogPrintf("Upgrading coin database to per-output records...\n");
+    size_t nTransactions = 0;
+    size_t nOutputs = 0;
+    size_t nBatchSize = 0;
+    CLevelDBBatch batch;
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        leveldb::Slice slKey = pcursor->key();
+        if (slKey.size() == 0 || slKey[0] != DB_COINS)
+            break;
+        try {
+            CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+            std::pair<char, uint256> key;
+            ssKey >> key;
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            CCoins coins;
+            ssValue >> coins;
+
+            for (uint32_t nPos = 0; nPos < coins.vout.size(); ++nPos) {
+                if (coins.vout[nPos].IsNull())
+                    continue;
+                batch.Write(std::make_pair(DB_COIN, COutPoint(key.second, nPos)), CDiskCoin(coins, nPos));
+                ++nOutputs;
+            }
+            BatchWriteCoinCount(batch, key.second, coins);
+            batch.Erase(key);
+            nBatchSize += slKey.size() + slValue.size();
+            ++nTransactions;
+        } catch (const std::exception& e) {
+            return error("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
+        if (nBatchSize > COIN_DB_UPGRADE_BATCH_SIZE) {
+            db.WriteBatch(batch);
+            batch = CLevelDBBatch();
+            nBatchSize = 0;
+            LogPrintf("Upgraded %u transactions (%u outputs) so far...\n", (unsigned int)nTransactions, (unsigned int)nOutputs);
+        }
+        pcursor->Next();
+    }
+    db.WriteBatch(batch, true);
+    LogPrintf("Coin database upgrade done: %u transactions split into %u output records\n", (unsigned int)nTransactions, (unsigned int)nOutputs);
+    return true;
+}
+
 bool CCoinsViewDB::GetStats(CCoinsStats& stats) const
 {
-    /* It seems that there are no "const iterators" for LevelDB.  Since we
-       only need read operations on it, use a const-cast to get around
-       that restriction.  */
-    boost::scoped_ptr<leveldb::Iterator> pcursor(const_cast<CLevelDBWrapper*>(&db)->NewIterator());
-    pcursor->SeekToFirst();
+    CDiskCoinCursor cursor(db);
 
     CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
     stats.hashBlock = GetBestBlock();
     ss << stats.hashBlock;
     CAmount nTotalAmount = 0;
-    while (pcursor->Valid()) {
+    while (true) {
         boost::this_thread::interruption_point();
         try {
-            leveldb::Slice slKey = pcursor->key();
-            CDataStream ssKey(slKey.data(), slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
-            char chType;
-            ssKey >> chType;
-            if (chType == DB_COINS) {
-                leveldb::Slice slValue = pcursor->value();
-                CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
-                CCoins coins;
-                ssValue >> coins;
-                uint256 txhash;
-                ssKey >> txhash;
-                ss << txhash;
-                ss << VARINT(coins.nVersion);
-                ss << (coins.fCoinBase ? 'c' : 'n');
-                ss << VARINT(coins.nHeight);
-                stats.nTransactions++;
-                for (unsigned int i = 0; i < coins.vout.size(); i++) {
-                    const CTxOut& out = coins.vout[i];
-                    if (!out.IsNull()) {
-                        stats.nTransactionOutputs++;
-                        ss << VARINT(i + 1);
-                        ss << out;
-                        nTotalAmount += out.nValue;
-                    }
+            uint256 txhash;
+            CCoins coins;
+            size_t nSerializedSize = 0;
+            if (!ReadCoinsAtCursor(cursor, txhash, coins, &nSerializedSize))
+                break;
+            ss << txhash;
+            ss << VARINT(coins.nVersion);
+            ss << (coins.fCoinBase ? 'c' : 'n');
+            ss << VARINT(coins.nHeight);
+            stats.nTransactions++;
+            for (unsigned int i = 0; i < coins.vout.size(); i++) {
+                const CTxOut& out = coins.vout[i];
+                if (!out.IsNull()) {
+                    stats.nTransactionOutputs++;
+                    ss << VARINT(i + 1);
+                    ss << out;
+                    nTotalAmount += out.nValue;
+                    stats.nSerializedSize += 32 + 4;
                 }
-                stats.nSerializedSize += 32 + slValue.size();
-                ss << VARINT(0);
             }
-            pcursor->Next();
+            stats.nSerializedSize += nSerializedSize;
+            ss << VARINT(0);
         } catch (std::exception& e) {
             return error("%s : Deserialize or I/O error - %s", __func__, e.what());
         }
@@ -165,6 +363,24 @@ bool CBlockTreeDB::WriteBlockIndex(const CDiskBlockIndex& blockindex)
     return Write(std::make_pair(DB_BLOCKINDEX, blockindex.GetBlockHash()), blockindex);
 }
 
+bool CBlockTreeDB::WriteBatchSync(
+    const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo,
+    int nLastFile,
+    const std::vector<const CBlockIndex*>& blockInfo)
+{
+    CLevelDBBatch batch;
+    for (const std::pair<int, const CBlockFileInfo*>& fileInfoEntry : fileInfo)
+    {
+        batch.Write(std::make_pair(DB_BLOCKFILEINFO, fileInfoEntry.first), *fileInfoEntry.second);
+    }
+    batch.Write(DB_LASTBLOCKFILE, nLastFile);
+    for (const CBlockIndex* blockIndex : blockInfo)
+    {
+        batch.Write(std::make_pair(DB_BLOCKINDEX, blockIndex->GetBlockHash()), CDiskBlockIndex(blockIndex));
+    }
+    return WriteBatch(batch, true);
+}
+
 bool CBlockTreeDB::WriteBlockFileInfo(int nFile, const CBlockFileInfo& info)
 {
     return Write(std::make_pair(DB_BLOCKFILEINFO, nFile), info);
@@ -286,10 +502,8 @@ bool CBlockTreeDB::LoadBlockIndexGuts(BlockMap& blockIndicesByHash)
                 pindexNew->nMoneySupply = diskindex.nMoneySupply;
                 pindexNew->nFlags = diskindex.nFlags;
                 pindexNew->nStakeModifier = diskindex.nStakeModifier;
-                pindexNew->prevoutStake = diskindex.prevoutStake;
-                pindexNew->nStakeTime = diskindex.nStakeTime;
-                pindexNew->hashProofOfStake = diskindex.hashProofOfStake;
-
+                if (diskindex.HasStakeData())
+                    pindexNew->MutableStakeData() = diskindex.StakeData();
                 pindexNew->vLotteryWinnersCoinstakes = diskindex.vLotteryWinnersCoinstakes;
                 pcursor->Next();
             } else {
@@ -17,6 +17,7 @@
 class uint256;
 class CBlockFileInfo;
 class CDiskBlockIndex;
+class CBlockIndex;
 
 
 struct CAddressIndexKey;
@@ -45,6 +46,9 @@ public:
     uint256 GetBestBlock() const override;
     bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock) override;
     bool GetStats(CCoinsStats& stats) const override;
+
+    //! Convert a chainstate still using per-transaction records to per-output records
+    bool Upgrade();
 };
 
 /** Access to the block database (blocks/index/) */
@@ -59,6 +63,11 @@ private:
 
 public:
     bool WriteBlockIndex(const CDiskBlockIndex& blockindex);
+    /** Write block file infos, the last block file number and block index entries in a single synced batch */
+    bool WriteBatchSync(
+        const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo,
+        int nLastFile,
+        const std::vector<const CBlockIndex*>& blockInfo);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo& fileinfo);
     bool WriteBlockFileInfo(int nFile, const CBlockFileInfo& fileinfo);
     bool ReadLastBlockFile(int& nFile);
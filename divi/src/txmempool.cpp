@@ -11,12 +11,14 @@
 #include "streams.h"
 #include "Logging.h"
 #include "utilmoneystr.h"
+#include "utiltime.h"
 #include "version.h"
 #include <UtxoCheckingAndUpdating.h>
 #include <chainparams.h>
 
 #include <boost/circular_buffer.hpp>
 
+#include <cmath>
 
 #include "FeeAndPriorityCalculator.h"
 #include <ValidationState.h>
@@ -29,12 +31,66 @@ bool IsMemPoolHeight(unsigned coinHeight)
     return coinHeight == CTxMemPoolEntry::MEMPOOL_HEIGHT;
 }
 
+namespace
+{
+/** Bytes the allocator hands out for a request of the given size. */
+size_t MallocUsage(size_t alloc)
+{
+    return alloc == 0u? 0u : ((alloc + 31u) >> 4) << 4;
+}
+
+/** Bytes taken by one std::map/std::set node holding payload bytes. */
+size_t TreeNodeUsage(size_t payload)
+{
+    return MallocUsage(payload + 4u * sizeof(void*));
+}
+
+size_t ScriptUsage(const CScript& script)
+{
+    return MallocUsage(script.capacity());
+}
+
+/** Heap usage of an entry's transaction plus its nodes in mapTx,
+ *  mapBareTxid, mapNextTx and the package index. */
+size_t EntryMemoryUsage(const CTxMemPoolEntry& entry)
+{
+    const CTransaction& tx = entry.GetTx();
+    size_t usage = MallocUsage(tx.vin.capacity() * sizeof(CTxIn)) + MallocUsage(tx.vout.capacity() * sizeof(CTxOut));
+    for (const CTxIn& txin : tx.vin)
+        usage += ScriptUsage(txin.scriptSig);
+    for (const CTxOut& txout : tx.vout)
+        usage += ScriptUsage(txout.scriptPubKey);
+
+    usage += TreeNodeUsage(sizeof(uint256) + sizeof(CTxMemPoolEntry));
+    usage += TreeNodeUsage(sizeof(uint256) + sizeof(const CTxMemPoolEntry*));
+    usage += tx.vin.size() * TreeNodeUsage(sizeof(COutPoint) + sizeof(CInPoint));
+    // Package record, its ready/eviction set nodes and one parent plus one
+    // child link per input in the worst case.
+    usage += TreeNodeUsage(sizeof(uint256) + sizeof(MempoolPackage));
+    usage += TreeNodeUsage(sizeof(uint256)) + TreeNodeUsage(sizeof(std::pair<CAmount, uint256>));
+    usage += 2u * tx.vin.size() * TreeNodeUsage(sizeof(uint256));
+    return usage;
+}
+
+template <typename Key, typename Value>
+size_t IndexMemoryUsage(size_t numberOfKeys)
+{
+    return numberOfKeys * (TreeNodeUsage(sizeof(Key) + sizeof(Value)) + sizeof(Key)) +
+        TreeNodeUsage(sizeof(uint256) + sizeof(std::vector<Key>));
+}
+}
+
 CTxMemPool::CTxMemPool(const CFeeRate& _minRelayFee,
                        const bool& addressIndex, const bool& spentIndex
     ): fSanityCheck(false)
     , nTransactionsUpdated(0)
     , feePolicyEstimator(new FeePolicyEstimator(25))
     , minRelayFee(_minRelayFee)
+    , totalTxSize(0u)
+    , cachedMemoryUsage(0u)
+    , lastRollingFeeUpdate(GetTime())
+    , blockSinceLastRollingFeeBump(false)
+    , rollingMinimumFeeRate(0.0)
     , fAddressIndex_(addressIndex)
     , fSpentIndex_(spentIndex)
     , mapAddress()
@@ -43,6 +99,7 @@ CTxMemPool::CTxMemPool(const CFeeRate& _minRelayFee,
     , mapSpentInserted()
     , mapDeltas()
     , mapBareTxid()
+    , packageIndex()
     , mapTx()
     , mapNextTx()
 {
@@ -105,8 +162,17 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry& entry,
         {
             mapNextTx[tx.vin[i].prevout] = CInPoint(&tx, i);
         }
+        std::vector<uint256> spendingTransactions;
+        for (auto it = mapNextTx.lower_bound(COutPoint(hash, 0)); it != mapNextTx.end() && it->first.hash == hash; ++it)
+        {
+            spendingTransactions.push_back(it->second.ptx->GetHash());
+        }
+        const auto deltas = mapDeltas.find(hash);
+        const CAmount feeDelta = deltas != mapDeltas.end()? deltas->second.second : 0;
+        packageIndex.addTransaction(hash, *entryInMap, feeDelta, spendingTransactions);
         nTransactionsUpdated++;
         totalTxSize += entry.GetTxSize();
+        cachedMemoryUsage += EntryMemoryUsage(*entryInMap);
     }
 
     // Add memory address index
@@ -163,6 +229,7 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
         }
     }
 
+    cachedMemoryUsage += IndexMemoryUsage<CMempoolAddressDeltaKey, CMempoolAddressDelta>(inserted.size());
     mapAddressInserted.insert(std::make_pair(txhash, inserted));
 }
 
@@ -190,6 +257,7 @@ bool CTxMemPool::removeAddressIndex(const uint256 txhash)
         for (std::vector<CMempoolAddressDeltaKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
             mapAddress.erase(*mit);
         }
+        cachedMemoryUsage -= IndexMemoryUsage<CMempoolAddressDeltaKey, CMempoolAddressDelta>(keys.size());
         mapAddressInserted.erase(it);
     }
 
@@ -229,6 +297,7 @@ void CTxMemPool::addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCac
 
     }
 
+    cachedMemoryUsage += IndexMemoryUsage<CSpentIndexKey, CSpentIndexValue>(inserted.size());
     mapSpentInserted.insert(std::make_pair(txhash, inserted));
 }
 
@@ -255,6 +324,7 @@ bool CTxMemPool::removeSpentIndex(const uint256& txhash)
         for (std::vector<CSpentIndexKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
             mapSpent.erase(*mit);
         }
+        cachedMemoryUsage -= IndexMemoryUsage<CSpentIndexKey, CSpentIndexValue>(keys.size());
         mapSpentInserted.erase(it);
     }
 
@@ -280,10 +350,11 @@ void CTxMemPool::remove(const CTransaction& origTx, std::list<CTransaction>& rem
                 txToRemove.push_back(it->second.ptx->GetHash());
             }
         }
+        std::set<uint256> removedHashes;
         while (!txToRemove.empty()) {
             const uint256 hash = txToRemove.front();
             txToRemove.pop_front();
-            if (!mapTx.count(hash))
+            if (!mapTx.count(hash) || !removedHashes.insert(hash).second)
                 continue;
 
             removeAddressIndex(hash);
@@ -306,7 +377,16 @@ void CTxMemPool::remove(const CTransaction& origTx, std::list<CTransaction>& rem
 
                 removed.push_back(tx);
                 totalTxSize -= mempoolTx.GetTxSize();
+                cachedMemoryUsage -= EntryMemoryUsage(mempoolTx);
             }
+        }
+        // A recursive removal takes every descendant along, which lets the
+        // index drop the whole set at once.
+        if (fRecursive)
+            packageIndex.removeTransactionsWithDescendants(removedHashes);
+        else if (!removedHashes.empty())
+            packageIndex.removeTransaction(*removedHashes.begin());
+        for (const uint256& hash : removedHashes) {
             mapTx.erase(hash);
             nTransactionsUpdated++;
         }
@@ -367,6 +447,7 @@ void CTxMemPool::removeConfirmedTransactions(const std::vector<CTransaction>& vt
             entries.push_back(&mapTx.find(hash)->second);
     }
     if(feePolicyEstimator) feePolicyEstimator->seenBlock(entries, nBlockHeight, minRelayFee);
+    blockSinceLastRollingFeeBump = true;
     BOOST_FOREACH (const CTransaction& tx, vtx) {
         std::list<CTransaction> dummy;
         remove(tx, dummy, false);
@@ -382,10 +463,48 @@ void CTxMemPool::clear()
     mapTx.clear();
     mapNextTx.clear();
     mapBareTxid.clear();
+    mapAddress.clear();
+    mapAddressInserted.clear();
+    mapSpent.clear();
+    mapSpentInserted.clear();
+    packageIndex.clear();
     totalTxSize = 0;
+    cachedMemoryUsage = 0;
+    lastRollingFeeUpdate = GetTime();
+    blockSinceLastRollingFeeBump = false;
+    rollingMinimumFeeRate = 0.0;
     ++nTransactionsUpdated;
 }
 
+void CTxMemPool::checkPackageTotals(const uint256& hash, const MempoolPackage& package) const
+{
+    std::set<uint256> ancestors;
+    packageIndex.collectAncestors(hash, ancestors);
+    CAmount ancestorFees = package.fee;
+    uint64_t ancestorSize = package.size;
+    for (const uint256& ancestorHash : ancestors) {
+        const MempoolPackage& ancestor = *packageIndex.find(ancestorHash);
+        ancestorFees += ancestor.fee;
+        ancestorSize += ancestor.size;
+    }
+    assert(package.ancestorCount == ancestors.size() + 1);
+    assert(package.ancestorFees == ancestorFees);
+    assert(package.ancestorSize == ancestorSize);
+
+    std::set<uint256> descendants;
+    packageIndex.collectDescendants(hash, descendants);
+    CAmount descendantFees = package.fee;
+    uint64_t descendantSize = package.size;
+    for (const uint256& descendantHash : descendants) {
+        const MempoolPackage& descendant = *packageIndex.find(descendantHash);
+        descendantFees += descendant.fee;
+        descendantSize += descendant.size;
+    }
+    assert(package.descendantCount == descendants.size() + 1);
+    assert(package.descendantFees == descendantFees);
+    assert(package.descendantSize == descendantSize);
+}
+
 void CTxMemPool::check(const CCoinsViewCache* pcoins, const BlockMap& blockIndexMap) const
 {
     if (!fSanityCheck)
@@ -421,6 +540,11 @@ void CTxMemPool::check(const CCoinsViewCache* pcoins, const BlockMap& blockIndex
             assert(mit->second.n == i);
             i++;
         }
+        const MempoolPackage* package = packageIndex.find(entry.first);
+        assert(package && package->entry == &entry.second);
+        assert(fDependsWait == !package->parents.empty());
+        assert(fDependsWait != (packageIndex.readyTransactions().count(entry.first) > 0));
+        checkPackageTotals(entry.first, *package);
         if (fDependsWait)
             waitingOnDependants.push_back(&entry.second);
         else {
@@ -456,6 +580,7 @@ void CTxMemPool::check(const CCoinsViewCache* pcoins, const BlockMap& blockIndex
         assert(entry.first == entry.second.ptx->vin[entry.second.n].prevout);
     }
 
+    assert(packageIndex.packages().size() == mapTx.size());
     assert(totalTxSize == checkTotal);
 }
 
@@ -547,10 +672,111 @@ void CTxMemPool::PrioritiseTransaction(const uint256 hash, const CAmount nFeeDel
         std::pair<double, CAmount>& deltas = mapDeltas[hash];
         deltas.first += proxyForPriorityDelta;
         deltas.second += nFeeDelta;
+        packageIndex.updateFeeDelta(hash, deltas.second);
     }
     LogPrintf("PrioritiseTransaction: %s priority += %f, fee += %d\n", hash. ToString(), proxyForPriorityDelta, FormatMoney(nFeeDelta));
 }
 
+void CTxMemPool::trackPackageFeeRateOnEviction(const CFeeRate& evictedPackageFeeRate)
+{
+    AssertLockHeld(cs);
+    // New transactions have to outbid what was evicted by at least the
+    // relay fee, or the pool could be churned for free.
+    const double feeRateToBeat = static_cast<double>(evictedPackageFeeRate.GetFeePerK() + minRelayFee.GetFeePerK());
+    if (feeRateToBeat > rollingMinimumFeeRate) {
+        rollingMinimumFeeRate = feeRateToBeat;
+        blockSinceLastRollingFeeBump = false;
+    }
+}
+
+void CTxMemPool::TrimToSize(size_t sizeLimit, std::vector<uint256>* evictedTxHashes)
+{
+    LOCK(cs);
+    unsigned numberOfEvictedTransactions = 0u;
+    CFeeRate highestEvictedFeeRate(0);
+    while (cachedMemoryUsage > sizeLimit) {
+        const uint256* lowestFeeRateTxHash = packageIndex.lowestDescendantFeeRateTransaction();
+        if (!lowestFeeRateTxHash) break;
+
+        const MempoolPackage& package = *packageIndex.find(*lowestFeeRateTxHash);
+        const CFeeRate packageFeeRate(package.descendantFees, package.descendantSize);
+        trackPackageFeeRateOnEviction(packageFeeRate);
+        if (packageFeeRate > highestEvictedFeeRate) highestEvictedFeeRate = packageFeeRate;
+
+        const CTransaction tx = package.entry->GetTx();
+        std::list<CTransaction> removed;
+        remove(tx, removed, true);
+        for (const CTransaction& evictedTx : removed) {
+            if (evictedTxHashes) evictedTxHashes->push_back(evictedTx.GetHash());
+            ClearPrioritisation(evictedTx.GetHash());
+        }
+        numberOfEvictedTransactions += removed.size();
+    }
+    if (numberOfEvictedTransactions > 0u) {
+        LogPrint("mempool", "Evicted %u transactions paying up to %s to stay under %u bytes\n",
+            numberOfEvictedTransactions, highestEvictedFeeRate.ToString(), (unsigned)sizeLimit);
+    }
+}
+
+CFeeRate CTxMemPool::GetMinFee(size_t sizeLimit) const
+{
+    LOCK(cs);
+    if (!blockSinceLastRollingFeeBump || rollingMinimumFeeRate == 0.0)
+        return CFeeRate(static_cast<CAmount>(rollingMinimumFeeRate));
+
+    const int64_t now = GetTime();
+    if (now > lastRollingFeeUpdate + 10) {
+        // Decay faster while the pool is far below its limit.
+        double halflife = ROLLING_FEE_HALFLIFE;
+        if (cachedMemoryUsage < sizeLimit / 4)
+            halflife /= 4;
+        else if (cachedMemoryUsage < sizeLimit / 2)
+            halflife /= 2;
+
+        rollingMinimumFeeRate = rollingMinimumFeeRate / pow(2.0, (now - lastRollingFeeUpdate) / halflife);
+        lastRollingFeeUpdate = now;
+
+        if (rollingMinimumFeeRate < minRelayFee.GetFeePerK() / 2) {
+            rollingMinimumFeeRate = 0.0;
+            return CFeeRate(0);
+        }
+    }
+    return CFeeRate(static_cast<CAmount>(rollingMinimumFeeRate));
+}
+
+std::vector<CMempoolSnapshotEntry> CTxMemPool::GetSnapshot() const
+{
+    LOCK(cs);
+    std::vector<std::pair<unsigned, const CTxMemPoolEntry*> > entriesByDepth;
+    entriesByDepth.reserve(mapTx.size());
+    for (const auto& hashAndPackage : packageIndex.packages()) {
+        const MempoolPackage& package = hashAndPackage.second;
+        entriesByDepth.push_back(std::make_pair(package.ancestorCount, package.entry));
+    }
+    // An entry always has more ancestors than any of its parents, so this
+    // puts parents first and the snapshot can be replayed in order.
+    std::stable_sort(entriesByDepth.begin(), entriesByDepth.end(),
+        [](const std::pair<unsigned, const CTxMemPoolEntry*>& a, const std::pair<unsigned, const CTxMemPoolEntry*>& b) {
+            return a.first < b.first;
+        });
+
+    std::vector<CMempoolSnapshotEntry> snapshot(entriesByDepth.size());
+    for (unsigned index = 0; index < entriesByDepth.size(); ++index) {
+        const CTxMemPoolEntry& entry = *entriesByDepth[index].second;
+        CMempoolSnapshotEntry& snapshotEntry = snapshot[index];
+        snapshotEntry.tx = entry.GetTx();
+        const auto deltas = mapDeltas.find(entry.GetTx().GetHash());
+        snapshotEntry.nFeeDelta = deltas != mapDeltas.end()? deltas->second.second : 0;
+    }
+    return snapshot;
+}
+
+const MempoolPackageIndex& CTxMemPool::GetPackageIndex() const
+{
+    AssertLockHeld(cs);
+    return packageIndex;
+}
+
 bool CTxMemPool::IsPrioritizedTransaction(const uint256 hash)
 {
     {
@@ -575,6 +801,7 @@ void CTxMemPool::ClearPrioritisation(const uint256 hash)
 {
     LOCK(cs);
     mapDeltas.erase(hash);
+    packageIndex.updateFeeDelta(hash, 0);
 }
 
 
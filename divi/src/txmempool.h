@@ -17,9 +17,11 @@
 #include "primitives/transaction.h"
 #include "sync.h"
 #include <MemPoolEntry.h>
+#include <MempoolPackageIndex.h>
 
 class BlockMap;
 class CAutoFile;
+struct CMempoolSnapshotEntry;
 
 /** Fake height value used in CCoins to signify they are only in the memory pool (since 0.8) */
 bool IsMemPoolHeight(unsigned coinHeight);
@@ -65,6 +67,13 @@ private:
 
     const CFeeRate& minRelayFee; //! Passed to constructor to avoid dependency on main
     uint64_t totalTxSize; //! sum of all mempool tx' byte sizes
+    uint64_t cachedMemoryUsage; //! estimated heap usage of the entries and all maps indexing them
+
+    /* Raised when entries are evicted to stay under the size limit and
+       halved every ROLLING_FEE_HALFLIFE seconds once blocks are found again. */
+    mutable int64_t lastRollingFeeUpdate;
+    mutable bool blockSinceLastRollingFeeBump;
+    mutable double rollingMinimumFeeRate; //! satoshis per 1000 bytes
 
     /* The mempool reads these flags, which are passed by reference in the
        constructor and refer to the globals in main (normally at least).  */
@@ -90,6 +99,9 @@ private:
      *  of mapTx in case of segwit light.  */
     std::map<uint256, const CTxMemPoolEntry*> mapBareTxid;
 
+    /** In-mempool parents/children and ancestor totals of each entry, used for block assembly. */
+    MempoolPackageIndex packageIndex;
+
     void addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view);
     bool removeAddressIndex(const uint256 txhash);
 
@@ -97,7 +109,11 @@ private:
     bool removeSpentIndex(const uint256& txhash);
 
     void removeConflicts(const CTransaction& tx, std::list<CTransaction>& removed);
+    void trackPackageFeeRateOnEviction(const CFeeRate& evictedPackageFeeRate);
+    void checkPackageTotals(const uint256& hash, const MempoolPackage& package) const;
 public:
+    static const int ROLLING_FEE_HALFLIFE = 60 * 60 * 12;
+
     mutable CCriticalSection cs;
     std::map<uint256, CTxMemPoolEntry> mapTx;
     std::map<COutPoint, CInPoint> mapNextTx;
@@ -130,6 +146,12 @@ public:
 
     bool getSpentIndex(const CSpentIndexKey &key, CSpentIndexValue &value);
 
+    /** Snapshot of the pool, parents ahead of the transactions spending them. */
+    std::vector<CMempoolSnapshotEntry> GetSnapshot() const;
+
+    /** Requires cs to be held by the caller for as long as the result is used. */
+    const MempoolPackageIndex& GetPackageIndex() const;
+
     /** Affect CreateNewBlock prioritisation of transactions */
     bool IsPrioritizedTransaction(const uint256 hash);
     void PrioritiseTransaction(const uint256 hash, const CAmount nFeeDelta);
@@ -146,6 +168,20 @@ public:
         LOCK(cs);
         return totalTxSize;
     }
+    /** Estimated number of bytes of memory the pool takes up. */
+    uint64_t DynamicMemoryUsage() const
+    {
+        LOCK(cs);
+        return cachedMemoryUsage;
+    }
+
+    /** Evicts the lowest fee rate descendant packages until the pool uses at
+     *  most sizeLimit bytes, raising the minimum fee accordingly.  */
+    void TrimToSize(size_t sizeLimit, std::vector<uint256>* evictedTxHashes = nullptr);
+
+    /** The fee rate a new transaction has to pay to enter a pool limited to
+     *  sizeLimit bytes; zero unless entries had to be evicted recently.  */
+    CFeeRate GetMinFee(size_t sizeLimit) const;
 
     bool exists(const uint256& hash)
     {
@@ -177,6 +213,24 @@ public:
     bool ReadFeeEstimates(CAutoFile& filein);
 };
 
+/** A mempool entry as stored in mempool.dat. */
+struct CMempoolSnapshotEntry
+{
+    CTransaction tx;
+    CAmount nFeeDelta;
+
+    CMempoolSnapshotEntry(): tx(), nFeeDelta(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(tx);
+        READWRITE(nFeeDelta);
+    }
+};
+
 /**
  * CCoinsView that brings transactions from a memorypool into view.
  * It does not check for spendings by memory pool transactions.
@@ -30,6 +30,12 @@
 #include <Logging.h>
 #include <StakableCoin.h>
 #include <SpentOutputTracker.h>
+#include <WalletBalanceLedger.h>
+#include <WalletUtxoIndex.h>
+#include <DeferredKeyVerifier.h>
+#include <ParallelChildKeyDeriver.h>
+#include <ThreadManagementHelpers.h>
+#include <RescanTransactionFilter.h>
 #include <WalletTx.h>
 #include <WalletTransactionRecord.h>
 #include <I_CoinSelectionAlgorithm.h>
@@ -101,9 +107,8 @@ bool CheckFinalTx(const CTransaction& tx, const CChain& activeChain, int flags =
     return IsFinalTx(tx, activeChain, nBlockHeight, nBlockTime);
 }
 
-bool IsAvailableType(const CKeyStore& keystore, const CScript& scriptPubKey, AvailableCoinsType coinType, isminetype& mine,VaultType& vaultType)
+static bool IsAvailableVaultType(AvailableCoinsType coinType, VaultType vaultType)
 {
-    mine = ::IsMine(keystore, scriptPubKey, vaultType);
     if( coinType == STAKABLE_COINS && vaultType == OWNED_VAULT)
     {
         return false;
@@ -118,6 +123,11 @@ bool IsAvailableType(const CKeyStore& keystore, const CScript& scriptPubKey, Ava
     }
     return true;
 }
+bool IsAvailableType(const CKeyStore& keystore, const CScript& scriptPubKey, AvailableCoinsType coinType, isminetype& mine,VaultType& vaultType)
+{
+    mine = ::IsMine(keystore, scriptPubKey, vaultType);
+    return IsAvailableVaultType(coinType, vaultType);
+}
 bool IsAvailableType(const CKeyStore& keystore, const CScript& scriptPubKey, AvailableCoinsType coinType)
 {
     VaultType vaultType;
@@ -187,6 +197,9 @@ CWallet::CWallet(
     , vaultManager_()
     , transactionRecord_(new WalletTransactionRecord(cs_wallet,strWalletFile) )
     , outputTracker_( new SpentOutputTracker(*transactionRecord_,confirmationNumberCalculator_) )
+    , balanceLedger_( new WalletBalanceLedger() )
+    , utxoIndex_( new WalletUtxoIndex() )
+    , deferredKeyVerifier_( new DeferredKeyVerifier() )
     , pwalletdbEncryption()
     , nWalletVersion(FEATURE_BASE)
     , nWalletMaxVersion(FEATURE_BASE)
@@ -202,6 +215,8 @@ CWallet::CWallet(
     , nLastResend(0)
     , setInternalKeyPool()
     , setExternalKeyPool()
+    , cs_KeyPoolTopUp()
+    , hdChainExtPubKeys_()
     , walletStakingOnly(false)
     , allowSpendingZeroConfirmationOutputs(false)
     , defaultKeyPoolTopUp(0)
@@ -223,6 +238,9 @@ CWallet::CWallet(
 CWallet::~CWallet()
 {
     pwalletdbEncryption.reset();
+    deferredKeyVerifier_.reset();
+    utxoIndex_.reset();
+    balanceLedger_.reset();
     outputTracker_.reset();
     transactionRecord_.reset();
     vaultManager_.reset();
@@ -328,6 +346,22 @@ bool CWallet::LoadKey(const CKey& key, const CPubKey& pubkey)
     return CCryptoKeyStore::AddKeyPubKey(key, pubkey);
 }
 
+void CWallet::DeferKeyVerification(const CPubKey& pubkey)
+{
+    deferredKeyVerifier_->deferVerification(pubkey);
+}
+
+void CWallet::VerifyDeferredKeys() const
+{
+    RenameThread("divi-keyverify");
+    deferredKeyVerifier_->verify(*this);
+}
+
+const DeferredKeyVerifier& CWallet::GetDeferredKeyVerifier() const
+{
+    return *deferredKeyVerifier_;
+}
+
 bool CWallet::VerifyHDKeys() const
 {
     for(const auto& entry : mapHdPubKeys)
@@ -686,24 +720,39 @@ bool CWallet::GetPubKey(const CKeyID &address, CPubKey& vchPubKeyOut) const
 
 bool CWallet::GetKey(const CKeyID &address, CKey& keyOut) const
 {
-    LOCK(cs_wallet);
+    // cs_KeyStore keeps Lock from wiping the unlocked keys while one is being added
+    LOCK2(cs_wallet, cs_KeyStore);
     std::map<CKeyID, CHDPubKey>::const_iterator mi = mapHdPubKeys.find(address);
     if (mi != mapHdPubKeys.end())
     {
+        // keys used since the wallet was unlocked are kept until it is locked again
+        if (unlockedKeys_.getKey(address, keyOut))
+            return true;
+
         // if the key has been found in mapHdPubKeys, derive it on the fly
         const CHDPubKey &hdPubKey = (*mi).second;
+        const bool fInternal = hdPubKey.nChangeIndex != 0;
         CHDChain hdChainCurrent;
         if (!GetHDChain(hdChainCurrent))
             throw std::runtime_error(std::string(__func__) + ": GetHDChain failed");
-        if (!DecryptHDChain(hdChainCurrent))
-            throw std::runtime_error(std::string(__func__) + ": DecryptHDChainSeed failed");
-        // make sure seed matches this chain
-        if (hdChainCurrent.GetID() != hdChainCurrent.GetSeedHash())
-            throw std::runtime_error(std::string(__func__) + ": Wrong HD chain!");
+
+        CExtKey chainKey;
+        if (!unlockedKeys_.getHDChainKey(hdChainCurrent.GetID(), hdPubKey.nAccountIndex, fInternal, chainKey))
+        {
+            if (!DecryptHDChain(hdChainCurrent))
+                throw std::runtime_error(std::string(__func__) + ": DecryptHDChainSeed failed");
+            // make sure seed matches this chain
+            if (hdChainCurrent.GetID() != hdChainCurrent.GetSeedHash())
+                throw std::runtime_error(std::string(__func__) + ": Wrong HD chain!");
+
+            hdChainCurrent.DeriveChainExtKey(hdPubKey.nAccountIndex, fInternal, chainKey);
+            unlockedKeys_.addHDChainKey(hdChainCurrent.GetID(), hdPubKey.nAccountIndex, fInternal, chainKey);
+        }
 
         CExtKey extkey;
-        hdChainCurrent.DeriveChildExtKey(hdPubKey.nAccountIndex, hdPubKey.nChangeIndex != 0, hdPubKey.extPubKey.nChild, extkey);
+        chainKey.Derive(extkey, hdPubKey.extPubKey.nChild);
         keyOut = extkey.key;
+        unlockedKeys_.addKey(address, keyOut);
 
         return true;
     }
@@ -1272,6 +1321,7 @@ int64_t CWallet::SmartWalletTxTimestampEstimation(const CWalletTx& wtx)
 void CWallet::LoadWalletTransaction(const CWalletTx& wtxIn)
 {
     outputTracker_->UpdateSpends(wtxIn, true).first->RecomputeCachedQuantities();
+    balanceLedger_->markModified(wtxIn.GetHash());
 }
 
 void CWallet::PruneWallet()
@@ -1296,6 +1346,7 @@ void CWallet::PruneWallet()
 
     transactionRecord_.reset(new PrunedWalletTransactionRecord(cs_wallet,strWalletFile,totalTxs));
     outputTracker_.reset( new SpentOutputTracker(*transactionRecord_,confirmationNumberCalculator_) );
+    balanceLedger_->invalidate();
     for(const CWalletTx& reloadedTransaction: transactionsToKeep)
     {
         LoadWalletTransaction(reloadedTransaction);
@@ -1354,6 +1405,7 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn,bool blockDisconnection)
 
     // Break debit/credit balance caches:
     wtx.RecomputeCachedQuantities();
+    balanceLedger_->markModified(hash);
 
     // Notify UI of new or updated transaction
     NotifyTransactionChanged(hash, (transactionHashIsNewToWallet) ? TransactionNotificationType::NEW : TransactionNotificationType::UPDATED);
@@ -1383,6 +1435,50 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pbl
     return false;
 }
 
+void CWallet::BuildRescanTransactionFilter(RescanTransactionFilter& filter) const
+{
+    AssertLockHeld(cs_wallet);
+    std::set<CKeyID> keyIDs;
+    GetKeys(keyIDs);
+    for(const CKeyID& keyID: keyIDs)
+    {
+        filter.addKeyOrScriptHash(keyID);
+    }
+    {
+        LOCK(cs_KeyStore);
+        for(const auto& scriptIDAndScript: mapScripts)
+        {
+            filter.addKeyOrScriptHash(scriptIDAndScript.first);
+        }
+        for(const CScript& script: setWatchOnly)
+        {
+            filter.addScript(script);
+        }
+        for(const CScript& script: setMultiSig)
+        {
+            filter.addScript(script);
+        }
+    }
+    if(vaultManager_)
+    {
+        for(const CScript& script: vaultManager_->getManagedScriptLimits())
+        {
+            filter.addScript(script);
+        }
+    }
+}
+
+bool CWallet::SpendsKnownTransaction(const CTransaction& tx) const
+{
+    AssertLockHeld(cs_wallet);
+    for(const CTxIn& input: tx.vin)
+    {
+        if(GetWalletTx(input.prevout.hash) != nullptr) return true;
+        if(vaultManager_ && vaultManager_->hasTransaction(input.prevout.hash)) return true;
+    }
+    return false;
+}
+
 void CWallet::SyncTransaction(const CTransaction& tx, const CBlock* pblock,const TransactionSyncType syncType)
 {
     LOCK2(cs_main, cs_wallet);
@@ -1395,7 +1491,10 @@ void CWallet::SyncTransaction(const CTransaction& tx, const CBlock* pblock,const
     BOOST_FOREACH (const CTxIn& txin, tx.vin) {
         CWalletTx* wtx = const_cast<CWalletTx*>(GetWalletTx(txin.prevout.hash));
         if (wtx != nullptr)
+        {
             wtx->RecomputeCachedQuantities();
+            balanceLedger_->markModified(txin.prevout.hash);
+        }
     }
 }
 void CWallet::RelayWalletTransaction(const CWalletTx& walletTransaction)
@@ -1558,56 +1657,142 @@ CAmount CWallet::GetSpendableBalance() const
     return GetBalanceByCoinType(ALL_SPENDABLE_COINS);
 }
 
-CAmount CWallet::GetBalance() const
+static int BalanceCreditFilterFlags(AvailableCoinsType coinType)
 {
-    CAmount nTotal = 0;
+    int coinTypeEncoding = static_cast<int>(coinType) << 4;
+    int creditFilterFlags = REQUIRE_UNSPENT | REQUIRE_AVAILABLE_TYPE | coinTypeEncoding;
+    if(coinType==STAKABLE_COINS) creditFilterFlags |= REQUIRE_UNLOCKED;
+    return creditFilterFlags;
+}
+
+WalletBalanceContribution CWallet::ComputeBalanceContribution(const CWalletTx& walletTransaction, bool fUseCache) const
+{
+    WalletBalanceContribution contribution;
+    contribution.dependsOnChainState =
+        confirmationNumberCalculator_.GetNumberOfBlockConfirmations(walletTransaction) < 1 ||
+        confirmationNumberCalculator_.GetBlocksToMaturity(walletTransaction) > 0 ||
+        !IsFinalTx(walletTransaction, activeChain_);
+    if (!IsTrusted(walletTransaction))
+        return contribution;
+
+    contribution.trustedAvailableCredit = GetAvailableCredit(walletTransaction, fUseCache);
+    for(unsigned coinType = 0; coinType < WalletBalanceContribution::NUMBER_OF_COIN_TYPES; ++coinType)
     {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = transactionRecord_->mapWallet.begin(); it != transactionRecord_->mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-            if (IsTrusted(*pcoin))
-                nTotal += GetAvailableCredit(*pcoin);
-        }
-        if(vaultManager_)
+        const int creditFilterFlags = BalanceCreditFilterFlags(static_cast<AvailableCoinsType>(coinType));
+        contribution.creditByCoinType[coinType] = ComputeCredit(walletTransaction,isminetype::ISMINE_SPENDABLE, creditFilterFlags);
+    }
+    return contribution;
+}
+
+void CWallet::IndexUnspentOutputs(const CWalletTx& walletTransaction) const
+{
+    std::vector<WalletUtxoIndex::IndexedOutput> outputs;
+    for(unsigned outputIndex = 0; outputIndex < walletTransaction.vout.size(); ++outputIndex)
+    {
+        const CScript& scriptPubKey = walletTransaction.vout[outputIndex].scriptPubKey;
+        VaultType vaultType;
+        const isminetype mine = ::IsMine(*this, scriptPubKey, vaultType);
+        if(mine == isminetype::ISMINE_NO || mine == isminetype::ISMINE_WATCH_ONLY || IsSpent(walletTransaction, outputIndex))
+            continue;
+
+        unsigned coinTypes = 0u;
+        for(unsigned coinType = 0; coinType < WalletUtxoIndex::NUMBER_OF_COIN_TYPES; ++coinType)
         {
-            auto utxos = vaultManager_->getManagedUTXOs();
-            for(const auto& utxo: utxos)
-            {
-                nTotal += utxo.Value();
-            }
+            if(IsAvailableVaultType(static_cast<AvailableCoinsType>(coinType), vaultType)) coinTypes |= 1u << coinType;
         }
-    }
+        if(coinTypes == 0u) continue;
 
-    return nTotal;
+        outputs.emplace_back(outputIndex, coinTypes, mine == isminetype::ISMINE_SPENDABLE);
+    }
+    utxoIndex_->update(walletTransaction.GetHash(), std::move(outputs));
 }
 
-CAmount CWallet::GetBalanceByCoinType(AvailableCoinsType coinType) const
+void CWallet::SynchronizeBalanceLedger() const
 {
-    CAmount nTotal = 0;
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+    if(balanceLedger_->requiresRebuild(activeChain_))
     {
-        LOCK2(cs_main, cs_wallet);
-        for (std::map<uint256, CWalletTx>::const_iterator it = transactionRecord_->mapWallet.begin(); it != transactionRecord_->mapWallet.end(); ++it) {
-            const CWalletTx* pcoin = &(*it).second;
-            if (IsTrusted(*pcoin))
+        balanceLedger_->clear();
+        utxoIndex_->clear();
+        for(const auto& hashAndTransaction: transactionRecord_->mapWallet)
+        {
+            balanceLedger_->update(hashAndTransaction.first, ComputeBalanceContribution(hashAndTransaction.second));
+            IndexUnspentOutputs(hashAndTransaction.second);
+        }
+    }
+    else
+    {
+        const std::set<uint256> txHashes = balanceLedger_->getTransactionsToReevaluate();
+        std::set<uint256> spentTxHashes;
+        for(const uint256& txHash: txHashes)
+        {
+            const CWalletTx* walletTx = GetWalletTx(txHash);
+            if(walletTx == nullptr)
             {
-                int coinTypeEncoding = static_cast<int>(coinType) << 4;
-                int additionalFilterFlags = REQUIRE_UNSPENT | REQUIRE_AVAILABLE_TYPE | coinTypeEncoding;
-                if(coinType==STAKABLE_COINS) additionalFilterFlags |= REQUIRE_UNLOCKED;
-                nTotal += ComputeCredit(*pcoin,isminetype::ISMINE_SPENDABLE, additionalFilterFlags);
+                balanceLedger_->remove(txHash);
+                utxoIndex_->remove(txHash);
+                continue;
+            }
+            balanceLedger_->update(txHash, ComputeBalanceContribution(*walletTx));
+            IndexUnspentOutputs(*walletTx);
+            if(walletTx->IsCoinBase()) continue;
+            for(const CTxIn& txin: walletTx->vin)
+            {
+                spentTxHashes.insert(txin.prevout.hash);
             }
-
         }
-
-        if(coinType == STAKABLE_COINS && vaultManager_)
+        // Outputs spent by transactions that were added, got conflicted or left
+        // the mempool may have changed their availability.
+        for(const uint256& txHash: spentTxHashes)
         {
-            auto utxos = vaultManager_->getManagedUTXOs();
-            for(const auto& utxo: utxos)
+            if(txHashes.count(txHash) > 0) continue;
+            const CWalletTx* walletTx = GetWalletTx(txHash);
+            if(walletTx != nullptr)
             {
-                nTotal += utxo.Value();
+                balanceLedger_->update(txHash, ComputeBalanceContribution(*walletTx,false));
+                IndexUnspentOutputs(*walletTx);
             }
         }
     }
+    balanceLedger_->recordSynchronization(activeChain_.Tip());
+}
+
+CAmount CWallet::GetManagedVaultBalance() const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+    if(!vaultManager_) return 0;
+
+    const CBlockIndex* chainTip = activeChain_.Tip();
+    const uint64_t vaultRevision = vaultManager_->getRevision();
+    if(!balanceLedger_->vaultBalanceIsCurrent(chainTip, vaultRevision))
+    {
+        CAmount vaultBalance = 0;
+        auto utxos = vaultManager_->getManagedUTXOs();
+        for(const auto& utxo: utxos)
+        {
+            vaultBalance += utxo.Value();
+        }
+        balanceLedger_->updateVaultBalance(chainTip, vaultRevision, vaultBalance);
+    }
+    return balanceLedger_->vaultBalance();
+}
 
+CAmount CWallet::GetBalance() const
+{
+    LOCK2(cs_main, cs_wallet);
+    SynchronizeBalanceLedger();
+    return balanceLedger_->totals().trustedAvailableCredit + GetManagedVaultBalance();
+}
+
+CAmount CWallet::GetBalanceByCoinType(AvailableCoinsType coinType) const
+{
+    LOCK2(cs_main, cs_wallet);
+    SynchronizeBalanceLedger();
+    CAmount nTotal = balanceLedger_->totals().creditByCoinType[static_cast<unsigned>(coinType)];
+    if(coinType == STAKABLE_COINS)
+        nTotal += GetManagedVaultBalance();
     return nTotal;
 }
 
@@ -1718,9 +1903,13 @@ void CWallet::AvailableCoins(
 
     {
         LOCK2(cs_main, cs_wallet);
-        for (const auto& entry : transactionRecord_->mapWallet)
+        // Only transactions that still hold unspent outputs of this type need to be visited
+        SynchronizeBalanceLedger();
+        const unsigned coinTypeMask = 1u << static_cast<unsigned>(nCoinType);
+        for (const uint256& txHash : utxoIndex_->transactionsWithCoinType(nCoinType))
         {
-            const CWalletTx* pcoin = &entry.second;
+            const CWalletTx* pcoin = GetWalletTx(txHash);
+            if (pcoin == nullptr) continue;
 
             int nDepth = 0;
             if(!SatisfiesMinimumDepthRequirements(pcoin,nDepth,fOnlyConfirmed))
@@ -1728,22 +1917,22 @@ void CWallet::AvailableCoins(
                 continue;
             }
 
-            for (unsigned int i = 0; i < pcoin->vout.size(); i++)
+            for (const WalletUtxoIndex::IndexedOutput& output : utxoIndex_->outputsOf(txHash))
             {
+                const unsigned i = output.outputIndex;
+                if ((output.coinTypes & coinTypeMask) == 0u) continue;
                 bool found = (nExactValue>0)? pcoin->vout[i].nValue == nExactValue : true;
                 if (!found) continue;
+                if (IsLockedCoin(txHash, i)) continue;
+                if (pcoin->vout[i].nValue <= 0 && !fIncludeZeroValue) continue;
 
-                bool fIsSpendable = false;
-                if(!IsAvailableForSpending(pcoin,i,fIncludeZeroValue,fIsSpendable,nCoinType))
-                {
-                    continue;
-                }
-
-                vCoins.emplace_back(COutput(pcoin, i, nDepth, fIsSpendable));
+                vCoins.emplace_back(COutput(pcoin, i, nDepth, output.isSpendable));
             }
         }
         if(nCoinType == AvailableCoinsType::STAKABLE_COINS && vaultManager_)
         {
+            const bool vaultMinimumIsSet = settings.ParameterIsSet("-vault_min");
+            const CAmount vaultMinimum = settings.GetArg("-vault_min",0)*COIN;
             std::vector<COutput> utxos = vaultManager_->getManagedUTXOs();
             for (const auto& entry : utxos)
             {
@@ -1754,7 +1943,7 @@ void CWallet::AvailableCoins(
                 {
                     continue;
                 }
-                if(settings.ParameterIsSet("-vault_min") && entry.Value() <  settings.GetArg("-vault_min",0)*COIN)
+                if(vaultMinimumIsSet && entry.Value() < vaultMinimum)
                 {
                     continue;
                 }
@@ -2278,6 +2467,7 @@ bool CWallet::CommitTransaction(CWalletTx& wtxNew, CReserveKey& reservekey)
                         assert(coinPtr);
                     }
                     coinPtr->RecomputeCachedQuantities();
+                    balanceLedger_->markModified(txin.prevout.hash);
                     NotifyTransactionChanged(coinPtr->GetHash(), TransactionNotificationType::SPEND_FROM);
                     updated_hashes.insert(txin.prevout.hash);
                 }
@@ -2401,9 +2591,27 @@ bool CWallet::NewKeyPool()
     return true;
 }
 
-bool CWallet::TopUpKeyPool(unsigned int kpSize)
+static unsigned NumberOfKeyPoolThreads(const Settings& settings)
+{
+    int nThreads = settings.GetArg("-keypoolthreads", DEFAULT_KEYPOOL_THREADS);
+    if (nThreads <= 0)
+        nThreads += boost::thread::hardware_concurrency();
+    return std::max(1, std::min(nThreads, MAX_KEYPOOL_THREADS));
+}
+
+bool CWallet::TopUpKeyPool(unsigned int kpSize, bool fWaitForRunningTopUp)
 {
     constexpr unsigned int DEFAULT_KEYPOOL_SIZE = 1000;
+    // A top-up running elsewhere needs cs_wallet to add each batch of keys. Callers
+    // that may hold cs_wallet use the keys it has added so far instead of waiting
+    CCriticalBlock topUpLock(cs_KeyPoolTopUp, "cs_KeyPoolTopUp", __FILE__, __LINE__, !fWaitForRunningTopUp);
+    if (!topUpLock)
+        return true;
+
+    int64_t missingExternal;
+    int64_t missingInternal;
+    unsigned int nTargetSize;
+    bool fTopUpHDKeyPool = false;
     {
         LOCK(cs_wallet);
 
@@ -2411,7 +2619,6 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
             return false;
 
         // Top up key pool
-        unsigned int nTargetSize;
         if (kpSize > 0)
             nTargetSize = kpSize;
         else
@@ -2423,49 +2630,223 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
         // make sure the keypool of external and internal keys fits the user selected target (-keypool)
         int64_t amountExternal = setExternalKeyPool.size();
         int64_t amountInternal = setInternalKeyPool.size();
-        int64_t missingExternal = std::max(std::max((int64_t) nTargetSize, (int64_t) 1) - amountExternal, (int64_t) 0);
-        int64_t missingInternal = std::max(std::max((int64_t) nTargetSize, (int64_t) 1) - amountInternal, (int64_t) 0);
+        missingExternal = std::max(std::max((int64_t) nTargetSize, (int64_t) 1) - amountExternal, (int64_t) 0);
+        missingInternal = std::max(std::max((int64_t) nTargetSize, (int64_t) 1) - amountInternal, (int64_t) 0);
 
-        if (!IsHDEnabled())
+        if (IsHDEnabled())
         {
-            // don't create extra internal keys
-            missingInternal = 0;
-        } else {
+            // HD keys are added in batches below
+            fTopUpHDKeyPool = true;
             nTargetSize *= 2;
         }
-        bool fInternal = false;
-        CWalletDB walletdb(settings,strWalletFile);
-        for (int64_t i = missingInternal + missingExternal; i--;)
+        else
         {
-            int64_t nEnd = 1;
-            if (i < missingInternal) {
-                fInternal = true;
-            }
-            if (!setInternalKeyPool.empty()) {
-                nEnd = *(--setInternalKeyPool.end()) + 1;
-            }
-            if (!setExternalKeyPool.empty()) {
-                nEnd = std::max(nEnd, *(--setExternalKeyPool.end()) + 1);
-            }
-            // TODO: implement keypools for all accounts?
-            if (!walletdb.WritePool(nEnd, CKeyPool(GenerateNewKey(0, fInternal), fInternal)))
-                throw std::runtime_error(std::string(__func__) + ": writing generated key failed");
+            // don't create extra internal keys
+            missingInternal = 0;
 
-            if (fInternal) {
-                setInternalKeyPool.insert(nEnd);
-            } else {
-                setExternalKeyPool.insert(nEnd);
+            bool fInternal = false;
+            CWalletDB walletdb(settings,strWalletFile);
+            for (int64_t i = missingInternal + missingExternal; i--;)
+            {
+                int64_t nEnd = 1;
+                if (i < missingInternal) {
+                    fInternal = true;
+                }
+                if (!setInternalKeyPool.empty()) {
+                    nEnd = *(--setInternalKeyPool.end()) + 1;
+                }
+                if (!setExternalKeyPool.empty()) {
+                    nEnd = std::max(nEnd, *(--setExternalKeyPool.end()) + 1);
+                }
+                // TODO: implement keypools for all accounts?
+                if (!walletdb.WritePool(nEnd, CKeyPool(GenerateNewKey(0, fInternal), fInternal)))
+                    throw std::runtime_error(std::string(__func__) + ": writing generated key failed");
+
+                if (fInternal) {
+                    setInternalKeyPool.insert(nEnd);
+                } else {
+                    setExternalKeyPool.insert(nEnd);
+                }
+                LogPrintf("keypool added key %d, size=%u, internal=%d\n", nEnd, setInternalKeyPool.size() + setExternalKeyPool.size(), fInternal);
+
+                double dProgress = 100.f * nEnd / (nTargetSize + 1);
+                std::string strMsg = strprintf(translate("Loading wallet... (%3.2f %%)"), dProgress);
+                uiInterface.InitMessage(strMsg);
             }
-            LogPrintf("keypool added key %d, size=%u, internal=%d\n", nEnd, setInternalKeyPool.size() + setExternalKeyPool.size(), fInternal);
+        }
+    }
+    if (fTopUpHDKeyPool)
+        return TopUpHDKeyPool(missingExternal, missingInternal, nTargetSize);
+    return true;
+}
+
+/**
+ * Key pool keys of HD wallets are derived from the extended public key of their
+ * chain, in batches: every batch is written in one database transaction and then
+ * added to the pool. cs_wallet is only taken to read the chain and to add a batch,
+ * so when the caller does not hold it (keypoolrefill), keys can be reserved while
+ * the rest of the pool is still being derived. Callers holding cs_wallet keep it
+ * for the whole top-up.
+ */
+bool CWallet::TopUpHDKeyPool(int64_t missingExternal, int64_t missingInternal, unsigned int nTargetSize)
+{
+    if (missingExternal + missingInternal == 0)
+        return true;
+
+    // Small top-ups, like replacing a reserved key, are not worth starting threads for
+    const int64_t nDerivationBatches = (std::max(missingExternal, missingInternal) + KEYPOOL_DERIVATION_BATCH_SIZE - 1) / KEYPOOL_DERIVATION_BATCH_SIZE;
+    ParallelChildKeyDeriver deriver(std::min<int64_t>(NumberOfKeyPoolThreads(settings), nDerivationBatches));
+
+    // External keys first, like the keys generated one at a time
+    while (missingExternal + missingInternal > 0)
+    {
+        const bool fInternal = missingExternal == 0;
+        int64_t& missing = fInternal ? missingInternal : missingExternal;
+        const unsigned int nBatchSize = std::min<int64_t>(missing, KEYPOOL_TOPUP_BATCH_SIZE);
 
-            double dProgress = 100.f * nEnd / (nTargetSize + 1);
-            std::string strMsg = strprintf(translate("Loading wallet... (%3.2f %%)"), dProgress);
-            uiInterface.InitMessage(strMsg);
+        uint256 hdChainId;
+        CExtPubKey chainKey;
+        uint32_t nFirstChildIndex;
+        {
+            LOCK(cs_wallet);
+            if (IsLocked(true))
+                return false;
+            // TODO: implement keypools for all accounts?
+            if (!GetHDChainExtPubKey(0, fInternal, hdChainId, chainKey, nFirstChildIndex))
+                return false;
         }
+        const std::vector<CExtPubKey> keys = deriver.derive(chainKey, nFirstChildIndex, nBatchSize);
+        missing -= std::min<int64_t>(missing, AddHDKeysToKeyPool(hdChainId, 0, fInternal, keys, nTargetSize));
+    }
+    return true;
+}
+
+bool CWallet::GetHDChainExtPubKey(uint32_t nAccountIndex, bool fInternal, uint256& hdChainIdRet, CExtPubKey& chainKeyRet, uint32_t& nNextChildIndexRet)
+{
+    AssertLockHeld(cs_wallet);
+
+    CHDChain hdChainCurrent;
+    if (!GetHDChain(hdChainCurrent))
+        return false;
+
+    CHDAccount acc;
+    if (!hdChainCurrent.GetAccount(nAccountIndex, acc))
+        throw std::runtime_error(std::string(__func__) + ": Wrong HD account!");
+    nNextChildIndexRet = fInternal ? acc.nInternalChainCounter : acc.nExternalChainCounter;
+    hdChainIdRet = hdChainCurrent.GetID();
+
+    const std::tuple<uint256, uint32_t, bool> chain(hdChainIdRet, nAccountIndex, fInternal);
+    auto it = hdChainExtPubKeys_.find(chain);
+    if (it == hdChainExtPubKeys_.end())
+    {
+        if (!DecryptHDChain(hdChainCurrent))
+            throw std::runtime_error(std::string(__func__) + ": DecryptHDChainSeed failed");
+        // make sure seed matches this chain
+        if (hdChainCurrent.GetID() != hdChainCurrent.GetSeedHash())
+            throw std::runtime_error(std::string(__func__) + ": Wrong HD chain!");
+
+        CExtKey chainKey;
+        hdChainCurrent.DeriveChainExtKey(nAccountIndex, fInternal, chainKey);
+        it = hdChainExtPubKeys_.insert(std::make_pair(chain, chainKey.Neuter())).first;
     }
+    chainKeyRet = it->second;
     return true;
 }
 
+unsigned int CWallet::AddHDKeysToKeyPool(const uint256& hdChainId, uint32_t nAccountIndex, bool fInternal, const std::vector<CExtPubKey>& keys, unsigned int nTargetSize)
+{
+    LOCK(cs_wallet);
+
+    // The chain may have been replaced while the keys were derived
+    CHDChain hdChainCurrent;
+    if (!GetHDChain(hdChainCurrent) || hdChainCurrent.GetID() != hdChainId)
+        return 0;
+
+    CHDAccount acc;
+    if (!hdChainCurrent.GetAccount(nAccountIndex, acc))
+        throw std::runtime_error(std::string(__func__) + ": Wrong HD account!");
+    uint32_t& nChildIndex = fInternal ? acc.nInternalChainCounter : acc.nExternalChainCounter;
+
+    int64_t nEnd = 1;
+    if (!setInternalKeyPool.empty()) {
+        nEnd = *(--setInternalKeyPool.end()) + 1;
+    }
+    if (!setExternalKeyPool.empty()) {
+        nEnd = std::max(nEnd, *(--setExternalKeyPool.end()) + 1);
+    }
+
+    const int64_t nCreationTime = GetTime();
+    const CKeyMetadata metadata(nCreationTime);
+    std::vector<CHDPubKey> addedKeys;
+    CWalletDB walletdb(settings,strWalletFile);
+    if (!walletdb.TxnBegin())
+        throw std::runtime_error(std::string(__func__) + ": TxnBegin failed");
+    for (const CExtPubKey& extPubKey : keys)
+    {
+        // Keys before the counter were handed out by GenerateNewKey in the meantime
+        if (extPubKey.nChild < nChildIndex)
+            continue;
+        nChildIndex = extPubKey.nChild + 1;
+        // skip keys already known to the wallet
+        if (HaveKey(extPubKey.pubkey.GetID()))
+            continue;
+
+        CHDPubKey hdPubKey;
+        hdPubKey.extPubKey = extPubKey;
+        hdPubKey.hdchainID = hdChainId;
+        hdPubKey.nAccountIndex = nAccountIndex;
+        hdPubKey.nChangeIndex = fInternal ? 1 : 0;
+        if (!walletdb.WriteHDPubKey(hdPubKey, metadata) ||
+            !walletdb.WritePool(nEnd + addedKeys.size(), CKeyPool(extPubKey.pubkey, fInternal)))
+        {
+            walletdb.TxnAbort();
+            throw std::runtime_error(std::string(__func__) + ": writing generated key failed");
+        }
+        addedKeys.push_back(hdPubKey);
+    }
+
+    // update the chain model in the database, together with the keys
+    if (!hdChainCurrent.SetAccount(nAccountIndex, acc))
+    {
+        walletdb.TxnAbort();
+        throw std::runtime_error(std::string(__func__) + ": SetAccount failed");
+    }
+    if (!(IsCrypted()? walletdb.WriteCryptedHDChain(hdChainCurrent) : walletdb.WriteHDChain(hdChainCurrent)))
+    {
+        walletdb.TxnAbort();
+        throw std::runtime_error(std::string(__func__) + ": writing HD chain failed");
+    }
+    if (!walletdb.TxnCommit())
+        throw std::runtime_error(std::string(__func__) + ": TxnCommit failed");
+
+    if (IsCrypted())
+        SetCryptedHDChain(hdChainCurrent, true);
+    else
+        SetHDChain(hdChainCurrent, true);
+
+    std::set<int64_t>& setKeyPool = fInternal ? setInternalKeyPool : setExternalKeyPool;
+    for (const CHDPubKey& hdPubKey : addedKeys)
+    {
+        const CKeyID keyID = hdPubKey.extPubKey.pubkey.GetID();
+        mapKeyMetadata[keyID] = metadata;
+        mapHdPubKeys[keyID] = hdPubKey;
+        setKeyPool.insert(nEnd++);
+
+        // check if we need to remove from watch-only
+        CScript script = GetScriptForDestination(keyID);
+        if (HaveWatchOnly(script))
+            RemoveWatchOnly(script);
+    }
+    if (!addedKeys.empty())
+        UpdateTimeFirstKey(nCreationTime);
+    LogPrintf("keypool added %u keys, size=%u, internal=%d\n", addedKeys.size(), setInternalKeyPool.size() + setExternalKeyPool.size(), fInternal);
+
+    double dProgress = 100.f * (nEnd - 1) / (nTargetSize + 1);
+    std::string strMsg = strprintf(translate("Loading wallet... (%3.2f %%)"), dProgress);
+    uiInterface.InitMessage(strMsg);
+    return addedKeys.size();
+}
+
 void CWallet::ReserveKeyFromKeyPool(int64_t& nIndex, CKeyPool& keypool, bool fInternal)
 {
     nIndex = -1;
@@ -2767,17 +3148,23 @@ void CWallet::LockCoin(const COutPoint& output)
     setLockedCoins.insert(output);
     CWalletTx* txPtr = const_cast<CWalletTx*>(GetWalletTx(output.hash));
     if (txPtr != nullptr) txPtr->RecomputeCachedQuantities(); // recalculate all credits for this tx
+    balanceLedger_->markModified(output.hash);
 }
 
 void CWallet::UnlockCoin(const COutPoint& output)
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
     setLockedCoins.erase(output);
+    balanceLedger_->markModified(output.hash);
 }
 
 void CWallet::UnlockAllCoins()
 {
     AssertLockHeld(cs_wallet); // setLockedCoins
+    for(const COutPoint& lockedOutput: setLockedCoins)
+    {
+        balanceLedger_->markModified(lockedOutput.hash);
+    }
     setLockedCoins.clear();
 }
 
@@ -28,6 +28,7 @@
 #include <Output.h>
 #include <I_StakingCoinSelector.h>
 #include <I_WalletLoader.h>
+#include <tuple>
 
 class I_CoinSelectionAlgorithm;
 class CKeyMetadata;
@@ -54,6 +55,11 @@ class CTxIn;
 class I_MerkleTxConfirmationNumberCalculator;
 class I_VaultManagerDatabase;
 class VaultManager;
+class WalletBalanceLedger;
+class WalletUtxoIndex;
+class DeferredKeyVerifier;
+class RescanTransactionFilter;
+struct WalletBalanceContribution;
 class CBlockLocator;
 
 bool IsFinalTx(const CTransaction& tx, const CChain& activeChain, int nBlockHeight = 0 , int64_t nBlockTime = 0);
@@ -158,6 +164,9 @@ private:
     std::unique_ptr<VaultManager> vaultManager_;
     std::unique_ptr<WalletTransactionRecord> transactionRecord_;
     std::unique_ptr<SpentOutputTracker> outputTracker_;
+    std::unique_ptr<WalletBalanceLedger> balanceLedger_;
+    std::unique_ptr<WalletUtxoIndex> utxoIndex_;
+    std::unique_ptr<DeferredKeyVerifier> deferredKeyVerifier_;
     std::unique_ptr<CWalletDB> pwalletdbEncryption;
 
     int nWalletVersion;   //! the current wallet version: clients below this version are not able to load the wallet
@@ -178,13 +187,24 @@ private:
     int64_t nLastResend;
     std::set<int64_t> setInternalKeyPool;
     std::set<int64_t> setExternalKeyPool;
+    /** Held by the thread topping up the key pool. Unless its caller holds cs_wallet, it releases cs_wallet between batches of keys */
+    CCriticalSection cs_KeyPoolTopUp;
+    /** Extended public keys of the HD chains key pool keys are derived from, by HD chain, account and internal flag */
+    std::map<std::tuple<uint256, uint32_t, bool>, CExtPubKey> hdChainExtPubKeys_;
     bool walletStakingOnly;
     bool allowSpendingZeroConfirmationOutputs;
     int64_t defaultKeyPoolTopUp;
 
     bool SubmitTransactionToMemoryPool(const CWalletTx& wtx) const;
 
+    WalletBalanceContribution ComputeBalanceContribution(const CWalletTx& walletTransaction, bool fUseCache = true) const;
+    void IndexUnspentOutputs(const CWalletTx& walletTransaction) const;
+    /** Brings the balance ledger and the UTXO index up to date with the wallet and the chain. */
+    void SynchronizeBalanceLedger() const;
+    CAmount GetManagedVaultBalance() const;
+
     void DeriveNewChildKey(const CKeyMetadata& metadata, CKey& secretRet, uint32_t nAccountIndex, bool fInternal /*= false*/);
+    bool TopUpHDKeyPool(int64_t missingExternal, int64_t missingInternal, unsigned int nTargetSize);
 
     // Notification interface methods
     void SyncTransaction(const CTransaction& tx, const CBlock* pblock,const TransactionSyncType syncType) override;
@@ -202,6 +222,7 @@ protected:
     bool LoadMinVersion(int nVersion) override;
     bool LoadMultiSig(const CScript& dest) override;
     bool LoadKey(const CKey& key, const CPubKey& pubkey) override;
+    void DeferKeyVerification(const CPubKey& pubkey) override;
     bool LoadMasterKey(unsigned int masterKeyIndex, CMasterKey& masterKey) override;
     bool LoadCryptedKey(const CPubKey& vchPubKey, const std::vector<unsigned char>& vchCryptedSecret) override;
     bool LoadKeyMetadata(const CPubKey& pubkey, const CKeyMetadata& metadata, const bool updateFirstKeyTimestamp) override;
@@ -235,6 +256,9 @@ public:
     int64_t getTimestampOfFistKey() const;
     CKeyMetadata getKeyMetadata(const CBitcoinAddress& address) const;
     bool VerifyHDKeys() const;
+    /** Verifies the key pairs loaded with -deferkeyverification; run on a background thread. */
+    void VerifyDeferredKeys() const;
+    const DeferredKeyVerifier& GetDeferredKeyVerifier() const;
     bool SetAddressBook(const CTxDestination& address, const std::string& strName, const std::string& purpose) override;
 
     const CPubKey& GetDefaultKey() const;
@@ -348,6 +372,10 @@ public:
     bool AddToWallet(const CWalletTx& wtxIn,bool blockDisconnection = false);
 
     bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate, const TransactionSyncType syncType);
+    /** Adds the keys and scripts the wallet and its vault manager recognize outputs by */
+    void BuildRescanTransactionFilter(RescanTransactionFilter& filter) const;
+    /** Whether the transaction spends from a transaction known to the wallet or its vault manager */
+    bool SpendsKnownTransaction(const CTransaction& tx) const;
     void ReacceptWalletTransactions();
     CAmount GetBalance() const;
     CAmount GetBalanceByCoinType(AvailableCoinsType coinType) const;
@@ -374,7 +402,17 @@ public:
     std::string PrepareObfuscationDenominate(int minRounds, int maxRounds);
 
     bool NewKeyPool();
-    bool TopUpKeyPool(unsigned int kpSize = 0);
+    /** Tops the key pool up to kpSize keys per chain, or -keypool if 0. If another top-up
+     *  is running, returns straight away unless fWaitForRunningTopUp is set; only callers
+     *  that do not hold cs_wallet may set it, as the running top-up needs cs_wallet. */
+    bool TopUpKeyPool(unsigned int kpSize = 0, bool fWaitForRunningTopUp = false);
+    /** Returns the extended public key HD key pool keys of the given chain are derived
+     *  from, and the chain's next child index. Requires cs_wallet. */
+    bool GetHDChainExtPubKey(uint32_t nAccountIndex, bool fInternal, uint256& hdChainIdRet, CExtPubKey& chainKeyRet, uint32_t& nNextChildIndexRet);
+    /** Adds the derived keys at or past the chain's counter to the key pool, committing
+     *  them, their pool entries and the new counter in one database transaction.
+     *  Returns how many were added. */
+    unsigned int AddHDKeysToKeyPool(const uint256& hdChainId, uint32_t nAccountIndex, bool fInternal, const std::vector<CExtPubKey>& keys, unsigned int nTargetSize);
     bool GetKeyFromPool(CPubKey& key, bool fInternal);
     int64_t GetOldestKeyPoolTime();
     void GetAllReserveKeys(std::set<CKeyID>& setAddress) const;
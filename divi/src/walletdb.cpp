@@ -27,6 +27,9 @@
 #include <MasterKey.h>
 #include <keypool.h>
 #include <hdchain.h>
+#include <WalletTransactionLog.h>
+#include <defaultValues.h>
+#include <checkqueue.h>
 
 using namespace boost;
 using namespace std;
@@ -53,6 +56,45 @@ struct LockManagedWalletDBUpdatedMapping
 
 static LockManagedWalletDBUpdatedMapping lockedDBUpdateMapping;
 
+/** Transaction logs are opened once per wallet file and shared by every CWalletDB on it */
+struct LockManagedWalletTransactionLogs
+{
+    CCriticalSection cs_transactionLogs;
+    std::map<std::string,std::unique_ptr<WalletTransactionLog>> transactionLogByWalletFilename;
+
+    LockManagedWalletTransactionLogs(): cs_transactionLogs(), transactionLogByWalletFilename()
+    {
+    }
+
+    // Null if the wallet keeps its transactions in the Berkeley DB file
+    WalletTransactionLog* operator()(const Settings& settings, const std::string& walletFilename)
+    {
+        LOCK(cs_transactionLogs);
+        auto it = transactionLogByWalletFilename.find(walletFilename);
+        if(it != transactionLogByWalletFilename.end())
+            return it->second.get();
+
+        std::unique_ptr<WalletTransactionLog> transactionLog;
+        const filesystem::path logPath = GetDataDir() / (walletFilename + ".txlog");
+        if(filesystem::exists(logPath) || settings.GetBoolArg("-wallettxlog", DEFAULT_WALLET_TX_LOG))
+        {
+            transactionLog.reset(new WalletTransactionLog(logPath));
+            if(!transactionLog->Open())
+                throw runtime_error(strprintf("CWalletDB : Error opening wallet transaction log %s", logPath.string()));
+        }
+        return (transactionLogByWalletFilename[walletFilename] = std::move(transactionLog)).get();
+    }
+
+    WalletTransactionLog* find(const std::string& walletFilename)
+    {
+        LOCK(cs_transactionLogs);
+        auto it = transactionLogByWalletFilename.find(walletFilename);
+        return it != transactionLogByWalletFilename.end()? it->second.get() : nullptr;
+    }
+};
+
+static LockManagedWalletTransactionLogs lockedTransactionLogs;
+
 CWalletDB::CWalletDB(
     Settings& settings,
     const std::string& dbFilename,
@@ -61,6 +103,7 @@ CWalletDB::CWalletDB(
     , dbFilename_(dbFilename)
     , walletDbUpdated_(lockedDBUpdateMapping(dbFilename))
     , berkleyDB_(new CDB(BerkleyDBEnvWrapper(),dbFilename))
+    , transactionLog_(lockedTransactionLogs(settings,dbFilename))
 {
     berkleyDB_->Open(settings,pszMode);
 }
@@ -99,6 +142,13 @@ bool CWalletDB::ErasePurpose(const string& strPurpose)
 bool CWalletDB::WriteTx(uint256 hash, const CWalletTx& wtx)
 {
     walletDbUpdated_++;
+    if(transactionLog_)
+    {
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        ssValue.reserve(1000);
+        ssValue << wtx;
+        return transactionLog_->Append(hash, ssValue);
+    }
     return berkleyDB_->Write(std::make_pair(std::string("tx"), hash), wtx);
 }
 
@@ -230,6 +280,43 @@ bool CWalletDB::WriteAccount(const string& strAccount, const CAccount& account)
     return berkleyDB_->Write(std::make_pair(string("acc"), strAccount), account);
 }
 
+/** A wallet record read from the database, decoded by the wallet load threads if it holds a transaction or key */
+struct PendingWalletRecord
+{
+    CDataStream ssKey;
+    CDataStream ssValue;
+    std::string strType;
+    bool fTypeInKey; // Records from the transaction log are keyed by hash alone
+    bool fDecoded;
+    bool fDecodedOk;
+    bool fUpgraded;
+    bool fVerificationDeferred;
+    std::string strErr;
+    std::unique_ptr<CWalletTx> wtx;
+    std::unique_ptr<CKey> key;
+    CPubKey pubkey;
+
+    PendingWalletRecord(
+        CDataStream&& ssKeyIn,
+        CDataStream&& ssValueIn,
+        const std::string& strTypeIn,
+        bool fTypeInKeyIn
+        ): ssKey(std::move(ssKeyIn))
+        , ssValue(std::move(ssValueIn))
+        , strType(strTypeIn)
+        , fTypeInKey(fTypeInKeyIn)
+        , fDecoded(strTypeIn == "tx" || strTypeIn == "key" || strTypeIn == "wkey")
+        , fDecodedOk(false)
+        , fUpgraded(false)
+        , fVerificationDeferred(false)
+        , strErr()
+        , wtx()
+        , key()
+        , pubkey()
+    {
+    }
+};
+
 class CWalletScanState
 {
 public:
@@ -240,6 +327,11 @@ public:
     bool fAnyUnordered;
     int nFileVersion;
     std::vector<uint256> vWalletUpgrade;
+    bool fMoveTransactionsToLog;
+    std::vector<CWalletTx> vTransactionsToMove;
+    bool fDeferKeyVerification;
+    bool fDecodeInParallel;
+    std::vector<PendingWalletRecord> vPendingRecords;
 
     CWalletScanState()
     {
@@ -247,9 +339,119 @@ public:
         fIsEncrypted = false;
         fAnyUnordered = false;
         nFileVersion = 0;
+        fMoveTransactionsToLog = false;
+        fDeferKeyVerification = false;
+        fDecodeInParallel = false;
     }
 };
 
+/** Decodes a "tx" record, whose type has already been read from ssKey. */
+static bool DecodeWalletTransaction(CDataStream& ssKey, CDataStream& ssValue, CWalletTx& wtx, bool& fUpgraded, string& strErr)
+{
+    uint256 hash;
+    ssKey >> hash;
+    ssValue >> wtx;
+    CValidationState state;
+    // false because there is no reason to go through the zerocoin checks for our own wallet
+    if (wtx.GetHash() != hash)
+        return false;
+
+    // Undo serialize changes in 31600
+    fUpgraded = false;
+    if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703) {
+        if (!ssValue.empty()) {
+            char fTmp;
+            char fUnused;
+            ssValue >> fTmp >> fUnused >> wtx.strFromAccount;
+            strErr = strprintf("LoadWallet() upgrading tx ver=%d %d '%s' %s",
+                wtx.fTimeReceivedIsTxTime, fTmp, wtx.strFromAccount, hash.ToString());
+            wtx.fTimeReceivedIsTxTime = fTmp;
+        } else {
+            strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
+            wtx.fTimeReceivedIsTxTime = 0;
+        }
+        fUpgraded = true;
+    }
+    return true;
+}
+
+static void LoadDecodedWalletTransaction(I_WalletLoader* pwallet, const CWalletTx& wtx, bool fUpgraded, bool fStoredInLog, CWalletScanState& wss)
+{
+    if (fUpgraded)
+        wss.vWalletUpgrade.push_back(wtx.GetHash());
+
+    if (wtx.nOrderPos == -1)
+        wss.fAnyUnordered = true;
+
+    if(pwallet) pwallet->LoadWalletTransaction(wtx);
+    if(pwallet && wss.fMoveTransactionsToLog && !fStoredInLog) wss.vTransactionsToMove.push_back(wtx);
+}
+
+/**
+ * Decodes a "key" or "wkey" record, whose type has already been read from ssKey.
+ * With fDeferKeyVerification, a key pair that can only be checked by re-deriving
+ * the public key is loaded unchecked and fVerificationDeferred is set.
+ */
+static bool DecodeKey(const string& strType, CDataStream& ssKey, CDataStream& ssValue, bool fDeferKeyVerification, CPubKey& vchPubKey, CKey& key, bool& fVerificationDeferred, string& strErr)
+{
+    ssKey >> vchPubKey;
+    if (!vchPubKey.IsValid()) {
+        strErr = "Error reading wallet database: CPubKey corrupt";
+        return false;
+    }
+    CPrivKey pkey;
+    uint256 hash = 0;
+
+    if (strType == "key") {
+        ssValue >> pkey;
+    }
+
+    // Old wallets store keys as "key" [pubkey] => [privkey]
+    // ... which was slow for wallets with lots of keys, because the public key is re-derived from the private key
+    // using EC operations as a checksum.
+    // Newer wallets store keys as "key"[pubkey] => [privkey][hash(pubkey,privkey)], which is much faster while
+    // remaining backwards-compatible.
+    try {
+        ssValue >> hash;
+    } catch (...) {
+    }
+
+    bool fSkipCheck = false;
+
+    if (hash != 0) {
+        // hash pubkey/privkey to accelerate wallet load
+        std::vector<unsigned char> vchKey;
+        vchKey.reserve(vchPubKey.size() + pkey.size());
+        vchKey.insert(vchKey.end(), vchPubKey.begin(), vchPubKey.end());
+        vchKey.insert(vchKey.end(), pkey.begin(), pkey.end());
+
+        if (Hash(vchKey.begin(), vchKey.end()) != hash) {
+            strErr = "Error reading wallet database: CPubKey/CPrivKey corrupt";
+            return false;
+        }
+
+        fSkipCheck = true;
+    }
+
+    fVerificationDeferred = !fSkipCheck && fDeferKeyVerification;
+    if (!key.Load(pkey, vchPubKey, fSkipCheck || fVerificationDeferred)) {
+        strErr = "Error reading wallet database: CPrivKey corrupt";
+        return false;
+    }
+    return true;
+}
+
+static bool LoadDecodedKey(I_WalletLoader* pwallet, const CPubKey& vchPubKey, const CKey& key, bool fVerificationDeferred, string& strErr)
+{
+    if (pwallet && !pwallet->LoadKey(key, vchPubKey)) {
+        strErr = "Error reading wallet database: LoadKey failed";
+        return false;
+    }
+    if (pwallet && fVerificationDeferred)
+        pwallet->DeferKeyVerification(vchPubKey);
+    return true;
+}
+
 bool ReadKeyValue(I_WalletLoader* pwallet, CDataStream& ssKey, CDataStream& ssValue, CWalletScanState& wss, string& strType, string& strErr)
 {
     try {
@@ -282,35 +484,11 @@ bool ReadKeyValue(I_WalletLoader* pwallet, CDataStream& ssKey, CDataStream& ssVa
                 ssValue >> purpose;
             }
         } else if (strType == "tx") {
-            uint256 hash;
-            ssKey >> hash;
             CWalletTx wtx;
-            ssValue >> wtx;
-            CValidationState state;
-            // false because there is no reason to go through the zerocoin checks for our own wallet
-            if (wtx.GetHash() != hash)
+            bool fUpgraded = false;
+            if (!DecodeWalletTransaction(ssKey, ssValue, wtx, fUpgraded, strErr))
                 return false;
-
-            // Undo serialize changes in 31600
-            if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703) {
-                if (!ssValue.empty()) {
-                    char fTmp;
-                    char fUnused;
-                    ssValue >> fTmp >> fUnused >> wtx.strFromAccount;
-                    strErr = strprintf("LoadWallet() upgrading tx ver=%d %d '%s' %s",
-                        wtx.fTimeReceivedIsTxTime, fTmp, wtx.strFromAccount, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = fTmp;
-                } else {
-                    strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = 0;
-                }
-                wss.vWalletUpgrade.push_back(hash);
-            }
-
-            if (wtx.nOrderPos == -1)
-                wss.fAnyUnordered = true;
-
-            if(pwallet) pwallet->LoadWalletTransaction(wtx);
+            LoadDecodedWalletTransaction(pwallet, wtx, fUpgraded, false, wss);
         } else if (strType == "watchs") {
             CScript script;
             ssKey >> script;
@@ -330,56 +508,15 @@ bool ReadKeyValue(I_WalletLoader* pwallet, CDataStream& ssKey, CDataStream& ssVa
                 if(pwallet) pwallet->LoadMultiSig(script);
             }
         } else if (strType == "key" || strType == "wkey") {
+            if (strType == "key")
+                wss.nKeys++;
             CPubKey vchPubKey;
-            ssKey >> vchPubKey;
-            if (!vchPubKey.IsValid()) {
-                strErr = "Error reading wallet database: CPubKey corrupt";
-                return false;
-            }
             CKey key;
-            CPrivKey pkey;
-            uint256 hash = 0;
-
-            if (strType == "key") {
-                wss.nKeys++;
-                ssValue >> pkey;
-            }
-
-            // Old wallets store keys as "key" [pubkey] => [privkey]
-            // ... which was slow for wallets with lots of keys, because the public key is re-derived from the private key
-            // using EC operations as a checksum.
-            // Newer wallets store keys as "key"[pubkey] => [privkey][hash(pubkey,privkey)], which is much faster while
-            // remaining backwards-compatible.
-            try {
-                ssValue >> hash;
-            } catch (...) {
-            }
-
-            bool fSkipCheck = false;
-
-            if (hash != 0) {
-                // hash pubkey/privkey to accelerate wallet load
-                std::vector<unsigned char> vchKey;
-                vchKey.reserve(vchPubKey.size() + pkey.size());
-                vchKey.insert(vchKey.end(), vchPubKey.begin(), vchPubKey.end());
-                vchKey.insert(vchKey.end(), pkey.begin(), pkey.end());
-
-                if (Hash(vchKey.begin(), vchKey.end()) != hash) {
-                    strErr = "Error reading wallet database: CPubKey/CPrivKey corrupt";
-                    return false;
-                }
-
-                fSkipCheck = true;
-            }
-
-            if (!key.Load(pkey, vchPubKey, fSkipCheck)) {
-                strErr = "Error reading wallet database: CPrivKey corrupt";
+            bool fVerificationDeferred = false;
+            if (!DecodeKey(strType, ssKey, ssValue, wss.fDeferKeyVerification, vchPubKey, key, fVerificationDeferred, strErr))
                 return false;
-            }
-            if (pwallet && !pwallet->LoadKey(key, vchPubKey)) {
-                strErr = "Error reading wallet database: LoadKey failed";
+            if (!LoadDecodedKey(pwallet, vchPubKey, key, fVerificationDeferred, strErr))
                 return false;
-            }
         } else if (strType == "mkey") {
             unsigned int nID;
             ssKey >> nID;
@@ -492,14 +629,133 @@ static bool IsKeyType(string strType)
             strType == "mkey" || strType == "ckey");
 }
 
+/** Decodes a pending transaction or key record; safe to run on any thread. */
+static void DecodePendingRecord(PendingWalletRecord& record, bool fDeferKeyVerification)
+{
+    try {
+        std::string strType;
+        if (record.fTypeInKey)
+            record.ssKey >> strType;
+        if (record.strType == "tx") {
+            record.wtx.reset(new CWalletTx());
+            record.fDecodedOk = DecodeWalletTransaction(record.ssKey, record.ssValue, *record.wtx, record.fUpgraded, record.strErr);
+        } else {
+            record.key.reset(new CKey());
+            record.fDecodedOk = DecodeKey(record.strType, record.ssKey, record.ssValue, fDeferKeyVerification, record.pubkey, *record.key, record.fVerificationDeferred, record.strErr);
+        }
+    } catch (...) {
+        record.fDecodedOk = false;
+    }
+}
+
+class WalletRecordDecodingCheck
+{
+private:
+    PendingWalletRecord* record_;
+    bool fDeferKeyVerification_;
+
+public:
+    WalletRecordDecodingCheck(): record_(nullptr), fDeferKeyVerification_(false)
+    {
+    }
+    WalletRecordDecodingCheck(PendingWalletRecord& record, bool fDeferKeyVerification): record_(&record), fDeferKeyVerification_(fDeferKeyVerification)
+    {
+    }
+
+    // Failures are kept with the record, so that every record gets decoded
+    bool operator()()
+    {
+        if (record_)
+            DecodePendingRecord(*record_, fDeferKeyVerification_);
+        return true;
+    }
+
+    void swap(WalletRecordDecodingCheck& check)
+    {
+        std::swap(record_, check.record_);
+        std::swap(fDeferKeyVerification_, check.fDeferKeyVerification_);
+    }
+};
+
+static unsigned NumberOfWalletLoadThreads(const Settings& settings)
+{
+    int nThreads = settings.GetArg("-walletloadthreads", DEFAULT_WALLET_LOAD_THREADS);
+    if (nThreads <= 0)
+        nThreads += boost::thread::hardware_concurrency();
+    return std::max(1, std::min(nThreads, MAX_WALLET_LOAD_THREADS));
+}
+
+static void DecodePendingRecordsInParallel(std::vector<PendingWalletRecord>& records, unsigned nThreads, bool fDeferKeyVerification)
+{
+    std::vector<WalletRecordDecodingCheck> checks;
+    for (PendingWalletRecord& record : records) {
+        if (record.fDecoded)
+            checks.emplace_back(record, fDeferKeyVerification);
+    }
+
+    CCheckQueue<WalletRecordDecodingCheck> queue(WALLET_LOAD_BATCH_SIZE, nThreads);
+    boost::thread_group threads;
+    for (unsigned nThread = 1; nThread < nThreads; nThread++)
+        threads.create_thread(boost::bind(&CCheckQueue<WalletRecordDecodingCheck>::Thread, &queue));
+    {
+        CCheckQueueControl<WalletRecordDecodingCheck> control(&queue);
+        control.Add(checks);
+        control.Wait();
+    }
+    threads.interrupt_all();
+    threads.join_all();
+}
+
+static bool LoadPendingRecord(I_WalletLoader* pwallet, PendingWalletRecord& record, CWalletScanState& wss, string& strType, string& strErr)
+{
+    if (!record.fDecoded)
+        return ReadKeyValue(pwallet, record.ssKey, record.ssValue, wss, strType, strErr);
+
+    strType = record.strType;
+    strErr = record.strErr;
+    if (strType == "key")
+        wss.nKeys++;
+    if (!record.fDecodedOk)
+        return false;
+    if (strType == "tx") {
+        LoadDecodedWalletTransaction(pwallet, *record.wtx, record.fUpgraded, !record.fTypeInKey, wss);
+        return true;
+    }
+    return LoadDecodedKey(pwallet, record.pubkey, *record.key, record.fVerificationDeferred, strErr);
+}
+
 DBErrors CWalletDB::LoadWallet(I_WalletLoader& wallet)
 {
     I_WalletLoader* pwallet = &wallet;
     pwallet->SetDefaultKey(CPubKey(),false);
     CWalletScanState wss;
+    wss.fMoveTransactionsToLog = transactionLog_ != nullptr;
+    wss.fDeferKeyVerification = settings_.GetBoolArg("-deferkeyverification", DEFAULT_DEFER_KEY_VERIFICATION);
+    const unsigned nLoadThreads = NumberOfWalletLoadThreads(settings_);
+    wss.fDecodeInParallel = nLoadThreads > 1;
     bool fNoncriticalErrors = false;
     DBErrors result = DB_LOAD_OK;
 
+    auto handleRecordResult = [&](bool fReadOK, const string& strType, const string& strErr)
+    {
+        // Try to be tolerant of single corrupt records:
+        if (!fReadOK) {
+            // losing keys is considered a catastrophic error, anything else
+            // we assume the user can live with:
+            if (IsKeyType(strType))
+                result = DB_CORRUPT;
+            else {
+                // Leave other errors alone, if we try to fix them we might make things worse.
+                fNoncriticalErrors = true; // ... but do warn the user there is something wrong.
+                if (strType == "tx")
+                    // Rescan if there is a bad transaction record:
+                    settings_.SoftSetBoolArg("-rescan", true);
+            }
+        }
+        if (!strErr.empty())
+            LogPrintf("%s\n", strErr);
+    };
+
     try {
         int nMinVersion = 0;
         if (berkleyDB_->Read((string) "minversion", nMinVersion)) {
@@ -527,25 +783,37 @@ DBErrors CWalletDB::LoadWallet(I_WalletLoader& wallet)
                 return DB_CORRUPT;
             }
 
-            // Try to be tolerant of single corrupt records:
-            string strType, strErr;
-            if (!ReadKeyValue(pwallet, ssKey, ssValue, wss, strType, strErr)) {
-                // losing keys is considered a catastrophic error, anything else
-                // we assume the user can live with:
-                if (IsKeyType(strType))
-                    result = DB_CORRUPT;
-                else {
-                    // Leave other errors alone, if we try to fix them we might make things worse.
-                    fNoncriticalErrors = true; // ... but do warn the user there is something wrong.
-                    if (strType == "tx")
-                        // Rescan if there is a bad transaction record:
-                        settings_.SoftSetBoolArg("-rescan", true);
+            if (wss.fDecodeInParallel) {
+                // Records are only read here, transactions and keys get decoded by the load threads
+                string strType;
+                try {
+                    CDataStream(ssKey) >> strType;
+                } catch (...) {
                 }
+                wss.vPendingRecords.emplace_back(std::move(ssKey), std::move(ssValue), strType, true);
+                continue;
             }
-            if (!strErr.empty())
-                LogPrintf("%s\n", strErr);
+
+            string strType, strErr;
+            handleRecordResult(ReadKeyValue(pwallet, ssKey, ssValue, wss, strType, strErr), strType, strErr);
         }
         pcursor->close();
+
+        if (transactionLog_)
+            LoadTransactionsFromLog(*pwallet, wss, fNoncriticalErrors);
+
+        if (wss.fDecodeInParallel) {
+            int64_t nStart = GetTimeMillis();
+            DecodePendingRecordsInParallel(wss.vPendingRecords, nLoadThreads, wss.fDeferKeyVerification);
+            LogPrintf("Decoded %u wallet records on %u threads in %dms\n", wss.vPendingRecords.size(), nLoadThreads, GetTimeMillis() - nStart);
+
+            std::vector<PendingWalletRecord> vPendingRecords;
+            vPendingRecords.swap(wss.vPendingRecords);
+            for (PendingWalletRecord& record : vPendingRecords) {
+                string strType, strErr;
+                handleRecordResult(LoadPendingRecord(pwallet, record, wss, strType, strErr), strType, strErr);
+            }
+        }
     } catch (boost::thread_interrupted) {
         throw;
     } catch (...) {
@@ -571,6 +839,9 @@ DBErrors CWalletDB::LoadWallet(I_WalletLoader& wallet)
         LogPrintf("Some keys lack metadata. Wallet may require a rescan\n");
     }
 
+    if (!wss.vTransactionsToMove.empty() && !MoveTransactionsToLog(wss.vTransactionsToMove))
+        LogPrintf("Failed to move wallet transactions to the transaction log, they are kept in the wallet file\n");
+
     pwallet->ReserializeTransactions(wss.vWalletUpgrade);
 
     // Rewrite encrypted wallets of versions 0.4.0 and 0.5.0rc:
@@ -593,6 +864,67 @@ DBErrors CWalletDB::LoadWallet(I_WalletLoader& wallet)
     return result;
 }
 
+void CWalletDB::LoadTransactionsFromLog(I_WalletLoader& wallet, CWalletScanState& wss, bool& fNoncriticalErrors)
+{
+    unsigned nCorruptRecords = 0;
+    unsigned nUnreadableRecords = 0;
+    bool& fAnyUnordered = wss.fAnyUnordered;
+    const bool fLogRead = transactionLog_->ForEachRecord(
+        [&wallet, &wss, &fAnyUnordered, &nUnreadableRecords](const uint256& hash, CDataStream& ssValue)
+        {
+            if (wss.fDecodeInParallel) {
+                CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+                ssKey << hash;
+                wss.vPendingRecords.emplace_back(std::move(ssKey), std::move(ssValue), "tx", false);
+                return;
+            }
+            CWalletTx wtx;
+            try {
+                ssValue >> wtx;
+            } catch (const std::exception&) {
+                nUnreadableRecords++;
+                return;
+            }
+            if (wtx.GetHash() != hash) {
+                nUnreadableRecords++;
+                return;
+            }
+            if (wtx.nOrderPos == -1)
+                fAnyUnordered = true;
+            wallet.LoadWalletTransaction(wtx);
+        },
+        nCorruptRecords);
+
+    if (!fLogRead || nCorruptRecords + nUnreadableRecords > 0) {
+        LogPrintf("Error reading wallet transaction log: %u corrupt records\n", nCorruptRecords + nUnreadableRecords);
+        // Rescan to recover the transactions that could not be read
+        fNoncriticalErrors = true;
+        settings_.SoftSetBoolArg("-rescan", true);
+    }
+}
+
+bool CWalletDB::MoveTransactionsToLog(const std::vector<CWalletTx>& transactions)
+{
+    for (const CWalletTx& wtx : transactions) {
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        ssValue << wtx;
+        if (!transactionLog_->Append(wtx.GetHash(), ssValue))
+            return false;
+    }
+    transactionLog_->Sync();
+
+    // A crash before the commit leaves the transactions in both stores, which loads fine
+    if (!berkleyDB_->TxnBegin())
+        return false;
+    for (const CWalletTx& wtx : transactions)
+        berkleyDB_->Erase(std::make_pair(std::string("tx"), wtx.GetHash()));
+    if (!berkleyDB_->TxnCommit())
+        return false;
+    walletDbUpdated_++;
+    LogPrintf("Moved %u wallet transactions to %s\n", transactions.size(), transactionLog_->logPath().string());
+    return true;
+}
+
 void ThreadFlushWalletDB(const string& strFile)
 {
     // Make this thread recognisable as the wallet flushing thread
@@ -635,6 +967,9 @@ void ThreadFlushWalletDB(const string& strFile)
                         nLastFlushed = walletDbUpdated;
                         int64_t nStart = GetTimeMillis();
 
+                        if (WalletTransactionLog* transactionLog = lockedTransactionLogs.find(strFile))
+                            transactionLog->Sync();
+
                         // Flush wallet.dat so it's self contained
                         bitdb_.CloseDb(strFile);
                         bitdb_.CheckpointLSN(strFile);
@@ -675,6 +1010,16 @@ bool BackupWallet(const std::string& walletDBFilename, const string& strDest)
                     dst << src.rdbuf();
 #endif
                     LogPrintf("copied wallet.dat to %s\n", pathDest.string());
+
+                    if (WalletTransactionLog* transactionLog = lockedTransactionLogs.find(walletDBFilename)) {
+                        // The index goes first so that the copied log holds every record it points to
+                        transactionLog->Sync();
+                        const filesystem::path pathLogDest = pathDest.string() + ".txlog";
+                        const filesystem::path pathIndexDest = pathLogDest.string() + ".idx";
+                        filesystem::copy_file(transactionLog->indexPath(), pathIndexDest, filesystem::copy_option::overwrite_if_exists);
+                        filesystem::copy_file(transactionLog->logPath(), pathLogDest, filesystem::copy_option::overwrite_if_exists);
+                        LogPrintf("copied wallet transaction log to %s\n", pathLogDest.string());
+                    }
                     return true;
                 } catch (const filesystem::filesystem_error& e) {
                     LogPrintf("error copying wallet.dat to %s - %s\n", pathDest.string(), e.what());
@@ -26,6 +26,8 @@
 class CDB;
 class CDBEnv;
 class Settings;
+class WalletTransactionLog;
+class CWalletScanState;
 class CWalletDB final: public I_WalletDatabase
 {
 private:
@@ -33,6 +35,7 @@ private:
     const std::string dbFilename_;
     unsigned& walletDbUpdated_;
     std::unique_ptr<CDB> berkleyDB_;
+    WalletTransactionLog* transactionLog_;
 
     static bool Recover(
         CDBEnv& dbenv,
@@ -41,6 +44,8 @@ private:
     static bool Recover(
         CDBEnv& dbenv,
         std::string filename);
+    void LoadTransactionsFromLog(I_WalletLoader& wallet, CWalletScanState& wss, bool& fNoncriticalErrors);
+    bool MoveTransactionsToLog(const std::vector<CWalletTx>& transactions);
 public:
 
     CWalletDB(Settings& settings,const std::string& dbFilename, const char* pszMode = "r+");